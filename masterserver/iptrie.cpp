@@ -0,0 +1,154 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: iptrie.cpp
+//
+// Description: Index of IP address patterns (with wildcards) for fast ban list lookups.
+//
+//-----------------------------------------------------------------------------
+
+#include "../src/networkheaders.h"
+#include "../src/networkshared.h"
+#include "iptrie.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+//*****************************************************************************
+//	FUNCTIONS
+
+// Returns the value of an octet of a ban entry or -1 if it's not a number in its canonical form. IPList compares
+// the octets as strings, so something like "010" never matches any address and is simply left out of the trie.
+static int iptrie_ParseOctet( const char *Octet )
+{
+	const size_t length = strlen( Octet );
+	if (( length == 0 ) || ( length > 3 ) || (( length > 1 ) && ( Octet[0] == '0' )))
+		return ( -1 );
+
+	int value = 0;
+	for ( size_t i = 0; i < length; ++i )
+	{
+		if (( Octet[i] < '0' ) || ( Octet[i] > '9' ))
+			return ( -1 );
+		value = value * 10 + ( Octet[i] - '0' );
+	}
+
+	return ( value <= 255 ) ? value : -1;
+}
+
+//*****************************************************************************
+//
+void IPTrie::clear( )
+{
+	_nodes.clear();
+	_nodes.push_back( Node() );
+}
+
+//*****************************************************************************
+//
+void IPTrie::build( const IPList &List )
+{
+	clear();
+
+	for ( ULONG ulIdx = 0; ulIdx < List.size(); ulIdx++ )
+	{
+		const IPADDRESSBAN_s entry = List.getEntry( ulIdx );
+		int node = 0;
+
+		for ( int level = 0; ( level < 4 ) && ( node != -1 ); ++level )
+			node = getChild( node, entry.szIP[level] );
+	}
+}
+
+//*****************************************************************************
+//
+// Returns the child of Node for the given octet of an entry, creating it if necessary.
+int IPTrie::getChild( int NodeIndex, const char *Octet )
+{
+	if ( Octet[0] == '*' )
+	{
+		if ( _nodes[NodeIndex].wildcardChild == -1 )
+		{
+			_nodes.push_back( Node() );
+			_nodes[NodeIndex].wildcardChild = static_cast<int>( _nodes.size() ) - 1;
+		}
+		return _nodes[NodeIndex].wildcardChild;
+	}
+
+	const int value = iptrie_ParseOctet( Octet );
+	if ( value == -1 )
+		return ( -1 );
+
+	std::vector<std::pair<BYTE, int> > &children = _nodes[NodeIndex].children;
+	std::vector<std::pair<BYTE, int> >::iterator it = std::lower_bound( children.begin(), children.end(), std::make_pair( static_cast<BYTE>( value ), -1 ));
+	if (( it != children.end() ) && ( it->first == value ))
+		return it->second;
+
+	const int child = static_cast<int>( _nodes.size() );
+	children.insert( it, std::make_pair( static_cast<BYTE>( value ), child ));
+	_nodes.push_back( Node() );
+	return child;
+}
+
+//*****************************************************************************
+//
+bool IPTrie::contains( const NETADDRESS_s &Address ) const
+{
+	return containsFrom( 0, Address.abIP, 0 );
+}
+
+//*****************************************************************************
+//
+bool IPTrie::containsFrom( int NodeIndex, const BYTE *pbIP, int Level ) const
+{
+	// All four octets matched.
+	if ( Level == 4 )
+		return true;
+
+	const Node &node = _nodes[NodeIndex];
+
+	if (( node.wildcardChild != -1 ) && containsFrom( node.wildcardChild, pbIP, Level + 1 ))
+		return true;
+
+	std::vector<std::pair<BYTE, int> >::const_iterator it = std::lower_bound( node.children.begin(), node.children.end(), std::make_pair( pbIP[Level], -1 ));
+	return ( it != node.children.end() ) && ( it->first == pbIP[Level] ) && containsFrom( it->second, pbIP, Level + 1 );
+}
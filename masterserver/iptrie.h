@@ -0,0 +1,93 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: iptrie.h
+//
+// Description: Index of IP address patterns (with wildcards) for fast ban list lookups.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __IPTRIE_H__
+#define __IPTRIE_H__
+
+#include <vector>
+
+//==========================================================================
+//
+// IPTrie
+//
+// Radix tree over the four octets of the entries of an IPList. Each node
+// has a child for every explicit octet value and one for the '*' wildcard,
+// so a lookup visits at most 16 paths regardless of the size of the list.
+//
+//==========================================================================
+
+class IPTrie
+{
+	struct Node
+	{
+		// Children for explicit octet values, sorted by the octet.
+		std::vector<std::pair<BYTE, int> >	children;
+
+		// Child for the '*' wildcard, or -1.
+		int									wildcardChild;
+
+		Node ( ) : wildcardChild ( -1 ) { }
+	};
+
+	std::vector<Node>	_nodes;
+
+	//*************************************************************************
+public:
+	IPTrie ( ) { clear(); }
+
+	void			build( const IPList &List );
+	void			clear( );
+	bool			contains( const NETADDRESS_s &Address ) const;
+
+	//*************************************************************************
+private:
+	int				getChild( int Node, const char *Octet );
+	bool			containsFrom( int Node, const BYTE *pbIP, int Level ) const;
+};
+
+#endif	// __IPTRIE_H__
@@ -0,0 +1,462 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: loadgen.cpp
+//
+// Description: Simulates many servers and launchers talking to a master server to measure its throughput.
+//
+//-----------------------------------------------------------------------------
+
+#include "../src/networkheaders.h"
+#include "../src/networkshared.h"
+#include "../src/huffman/huffman.h"
+
+#include <chrono>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+//*****************************************************************************
+//	DEFINES
+
+// Revision the simulated servers claim to be built with. Anything from 2907 on gets the split ban list.
+#define	FAKE_SERVER_REVISION			9999
+
+// How often the simulated servers tell the master that they still exist.
+#define	SERVER_HEARTBEAT_MS				20000
+
+// How long to wait for the master to verify a server before asking again.
+#define	SERVER_RETRY_MS					2000
+
+// How long a launcher waits for the complete server list.
+#define	LAUNCHER_TIMEOUT_MS				1000
+
+// Limit the challenges sent at once, so that they don't overflow the receive buffer of the master.
+#define	MAX_CHALLENGES_PER_TICK			50
+
+//*****************************************************************************
+//	STRUCTURES
+
+struct FAKESERVER_s
+{
+	SOCKET			Socket;
+	std::string		VerificationString;
+	bool			bVerified;
+	long long		llLastChallenge;
+};
+
+struct FAKELAUNCHER_s
+{
+	SOCKET			Socket;
+	bool			bWaiting;
+	long long		llQuerySent;
+	int				iNumParts;
+	int				iNumPartsReceived;
+	unsigned int	uiNumServers;
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+static	NETADDRESS_s				g_MasterAddress;
+static	std::vector<FAKESERVER_s>	g_FakeServers;
+static	std::vector<FAKELAUNCHER_s>	g_FakeLaunchers;
+
+static	NETBUFFER_s					g_SendBuffer;
+static	NETBUFFER_s					g_ReceiveBuffer;
+static	UCHAR						g_ucHuffmanBuffer[131072];
+
+static	unsigned long				g_ulNumQueries;
+static	unsigned long				g_ulNumTimeouts;
+static	unsigned long				g_ulNumRejected;
+static	double						g_dTotalLatencyMS;
+static	unsigned int				g_uiLastNumServersListed;
+
+//*****************************************************************************
+//	FUNCTIONS
+
+static long long loadgen_GetTimeMS( void )
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+//*****************************************************************************
+//
+// Creates a socket bound to the given local IP (in network byte order) and a free port.
+static SOCKET loadgen_CreateSocket( ULONG ulLocalIP )
+{
+	SOCKET Socket = socket( PF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( Socket == INVALID_SOCKET )
+	{
+		fprintf( stderr, "Couldn't create socket: %s\n", strerror( errno ));
+		exit( 1 );
+	}
+
+	struct sockaddr_in address;
+	memset( &address, 0, sizeof( address ));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = ulLocalIP;
+	address.sin_port = 0;
+	if ( bind( Socket, (sockaddr *)&address, sizeof( address )) == SOCKET_ERROR )
+	{
+		fprintf( stderr, "Couldn't bind socket: %s\n", strerror( errno ));
+		exit( 1 );
+	}
+
+	ULONG ulArg = true;
+	ioctlsocket( Socket, FIONBIO, &ulArg );
+	return Socket;
+}
+
+//*****************************************************************************
+//
+static void loadgen_SendToMaster( SOCKET Socket )
+{
+	INT	iNumBytesOut = sizeof( g_ucHuffmanBuffer );
+
+	g_SendBuffer.ulCurrentSize = g_SendBuffer.CalcSize();
+	HUFFMAN_Encode( (unsigned char *)g_SendBuffer.pbData, g_ucHuffmanBuffer, g_SendBuffer.ulCurrentSize, &iNumBytesOut );
+
+	struct sockaddr_in SocketAddress = g_MasterAddress.ToSocketAddress();
+	sendto( Socket, (const char *)g_ucHuffmanBuffer, iNumBytesOut, 0, (struct sockaddr *)&SocketAddress, sizeof( SocketAddress ));
+}
+
+//*****************************************************************************
+//
+// Reads the next packet on Socket into g_ReceiveBuffer. Returns false if there is none.
+static bool loadgen_Receive( SOCKET Socket )
+{
+	INT iDecodedNumBytes = g_ReceiveBuffer.ulMaxSize;
+
+	const LONG lNumBytes = recv( Socket, (char *)g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), 0 );
+	if ( lNumBytes <= 0 )
+		return false;
+
+	HUFFMAN_Decode( g_ucHuffmanBuffer, (unsigned char *)g_ReceiveBuffer.pbData, lNumBytes, &iDecodedNumBytes );
+	g_ReceiveBuffer.ulCurrentSize = iDecodedNumBytes;
+	g_ReceiveBuffer.ByteStream.pbStream = g_ReceiveBuffer.pbData;
+	g_ReceiveBuffer.ByteStream.pbStreamEnd = g_ReceiveBuffer.pbData + g_ReceiveBuffer.ulCurrentSize;
+	return true;
+}
+
+//*****************************************************************************
+//
+static void loadgen_SendServerChallenge( FAKESERVER_s &Server, long long llNow )
+{
+	g_SendBuffer.Clear();
+	NETWORK_WriteLong( &g_SendBuffer.ByteStream, SERVER_MASTER_CHALLENGE );
+	NETWORK_WriteString( &g_SendBuffer.ByteStream, Server.VerificationString.c_str() );
+	NETWORK_WriteByte( &g_SendBuffer.ByteStream, 1 ); // Enforces the master ban list.
+	NETWORK_WriteLong( &g_SendBuffer.ByteStream, FAKE_SERVER_REVISION );
+	loadgen_SendToMaster( Server.Socket );
+	Server.llLastChallenge = llNow;
+}
+
+//*****************************************************************************
+//
+static void loadgen_HandleServerPacket( FAKESERVER_s &Server )
+{
+	BYTESTREAM_s *pByteStream = &g_ReceiveBuffer.ByteStream;
+
+	switch ( NETWORK_ReadByte( pByteStream ))
+	{
+	case MASTER_SERVER_VERIFICATION:
+		{
+			const std::string verificationString = NETWORK_ReadString( pByteStream );
+			const LONG lVerificationInt = NETWORK_ReadLong( pByteStream );
+
+			g_SendBuffer.Clear();
+			NETWORK_WriteLong( &g_SendBuffer.ByteStream, SERVER_MASTER_VERIFICATION );
+			NETWORK_WriteString( &g_SendBuffer.ByteStream, verificationString.c_str() );
+			NETWORK_WriteLong( &g_SendBuffer.ByteStream, lVerificationInt );
+			loadgen_SendToMaster( Server.Socket );
+		}
+		break;
+	case MASTER_SERVER_BANLISTPART:
+
+		// The master sends the ban list once it accepted the server. Acknowledge the last part.
+		Server.bVerified = true;
+		if (( g_ReceiveBuffer.ulCurrentSize > 0 ) && ( g_ReceiveBuffer.pbData[g_ReceiveBuffer.ulCurrentSize - 1] == MSB_ENDBANLIST ))
+		{
+			g_SendBuffer.Clear();
+			NETWORK_WriteLong( &g_SendBuffer.ByteStream, SERVER_MASTER_BANLIST_RECEIPT );
+			NETWORK_WriteString( &g_SendBuffer.ByteStream, Server.VerificationString.c_str() );
+			loadgen_SendToMaster( Server.Socket );
+		}
+		break;
+	}
+}
+
+//*****************************************************************************
+//
+static void loadgen_SendLauncherQuery( FAKELAUNCHER_s &Launcher, long long llNow )
+{
+	g_SendBuffer.Clear();
+	NETWORK_WriteLong( &g_SendBuffer.ByteStream, LAUNCHER_MASTER_CHALLENGE );
+	NETWORK_WriteShort( &g_SendBuffer.ByteStream, MASTER_SERVER_VERSION );
+	loadgen_SendToMaster( Launcher.Socket );
+
+	Launcher.bWaiting = true;
+	Launcher.llQuerySent = llNow;
+	Launcher.iNumParts = -1;
+	Launcher.iNumPartsReceived = 0;
+	Launcher.uiNumServers = 0;
+}
+
+//*****************************************************************************
+//
+static void loadgen_HandleLauncherPacket( FAKELAUNCHER_s &Launcher, long long llNow )
+{
+	BYTESTREAM_s *pByteStream = &g_ReceiveBuffer.ByteStream;
+
+	if ( Launcher.bWaiting == false )
+		return;
+
+	const LONG lCommand = NETWORK_ReadLong( pByteStream );
+	if ( lCommand != MSC_BEGINSERVERLISTPART )
+	{
+		// MSC_REQUESTIGNORED, MSC_IPISBANNED or MSC_WRONGVERSION.
+		g_ulNumRejected++;
+		Launcher.bWaiting = false;
+		return;
+	}
+
+	const int iPacketNum = NETWORK_ReadByte( pByteStream );
+	NETWORK_ReadByte( pByteStream ); // MSC_SERVERBLOCK
+
+	int iNumPorts;
+	while (( iNumPorts = NETWORK_ReadByte( pByteStream )) > 0 )
+	{
+		for ( int i = 0; i < 4; ++i )
+			NETWORK_ReadByte( pByteStream );
+		for ( int i = 0; i < iNumPorts; ++i )
+			NETWORK_ReadShort( pByteStream );
+		Launcher.uiNumServers += iNumPorts;
+	}
+
+	if ( NETWORK_ReadByte( pByteStream ) == MSC_ENDSERVERLIST )
+		Launcher.iNumParts = iPacketNum + 1;
+
+	Launcher.iNumPartsReceived++;
+	if ( Launcher.iNumPartsReceived == Launcher.iNumParts )
+	{
+		g_ulNumQueries++;
+		g_dTotalLatencyMS += static_cast<double>( llNow - Launcher.llQuerySent );
+		g_uiLastNumServersListed = Launcher.uiNumServers;
+		Launcher.bWaiting = false;
+	}
+}
+
+//*****************************************************************************
+//
+static unsigned int loadgen_NumVerifiedServers( void )
+{
+	unsigned int uiNumVerified = 0;
+	for ( unsigned int i = 0; i < g_FakeServers.size(); ++i )
+	{
+		if ( g_FakeServers[i].bVerified )
+			uiNumVerified++;
+	}
+	return uiNumVerified;
+}
+
+//*****************************************************************************
+//
+// Waits for packets on all sockets and handles them. Launchers are only served if bRunLaunchers is set.
+static void loadgen_Tick( std::vector<struct pollfd> &PollFDs, bool bRunLaunchers )
+{
+	const long long llNow = loadgen_GetTimeMS();
+	unsigned int uiNumChallenges = 0;
+
+	for ( unsigned int i = 0; ( i < g_FakeServers.size() ) && ( uiNumChallenges < MAX_CHALLENGES_PER_TICK ); ++i )
+	{
+		FAKESERVER_s &server = g_FakeServers[i];
+		const long long llInterval = server.bVerified ? SERVER_HEARTBEAT_MS : SERVER_RETRY_MS;
+		if ( llNow - server.llLastChallenge >= llInterval )
+		{
+			loadgen_SendServerChallenge( server, llNow );
+			uiNumChallenges++;
+		}
+	}
+
+	for ( unsigned int i = 0; bRunLaunchers && ( i < g_FakeLaunchers.size() ); ++i )
+	{
+		FAKELAUNCHER_s &launcher = g_FakeLaunchers[i];
+		if ( launcher.bWaiting && ( llNow - launcher.llQuerySent >= LAUNCHER_TIMEOUT_MS ))
+		{
+			g_ulNumTimeouts++;
+			launcher.bWaiting = false;
+		}
+
+		if ( launcher.bWaiting == false )
+			loadgen_SendLauncherQuery( launcher, llNow );
+	}
+
+	if ( poll( &PollFDs[0], PollFDs.size(), 10 ) <= 0 )
+		return;
+
+	for ( unsigned int i = 0; i < PollFDs.size(); ++i )
+	{
+		if (( PollFDs[i].revents & POLLIN ) == 0 )
+			continue;
+
+		while ( loadgen_Receive( PollFDs[i].fd ))
+		{
+			if ( i < g_FakeServers.size() )
+				loadgen_HandleServerPacket( g_FakeServers[i] );
+			else
+				loadgen_HandleLauncherPacket( g_FakeLaunchers[i - g_FakeServers.size()], loadgen_GetTimeMS() );
+		}
+	}
+}
+
+//*****************************************************************************
+//
+int main( int argc, char **argv )
+{
+	const char		*pszMaster = "127.0.0.1";
+	unsigned int	uiNumServers = 1000;
+	unsigned int	uiNumLaunchers = 32;
+	int				iSeconds = 10;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		if (( stricmp( argv[i], "-master" ) == 0 ) && ( i + 1 < argc ))
+			pszMaster = argv[++i];
+		else if (( stricmp( argv[i], "-servers" ) == 0 ) && ( i + 1 < argc ))
+			uiNumServers = atoi( argv[++i] );
+		else if (( stricmp( argv[i], "-launchers" ) == 0 ) && ( i + 1 < argc ))
+			uiNumLaunchers = atoi( argv[++i] );
+		else if (( stricmp( argv[i], "-time" ) == 0 ) && ( i + 1 < argc ))
+			iSeconds = atoi( argv[++i] );
+		else
+		{
+			fprintf( stderr, "Usage: %s [-master <address[:port]>] [-servers <num>] [-launchers <num>] [-time <seconds>]\n", argv[0] );
+			fprintf( stderr, "Start the master with -loadtest, otherwise it throttles the queries from this machine.\n" );
+			return 1;
+		}
+	}
+
+	if ( g_MasterAddress.LoadFromString( pszMaster ) == false )
+	{
+		fprintf( stderr, "Can't resolve %s.\n", pszMaster );
+		return 1;
+	}
+	if ( g_MasterAddress.usPort == 0 )
+		g_MasterAddress.SetPort( DEFAULT_MASTER_PORT );
+
+	// Every simulated server and launcher needs its own socket.
+	struct rlimit limit;
+	if ( getrlimit( RLIMIT_NOFILE, &limit ) == 0 )
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit( RLIMIT_NOFILE, &limit );
+	}
+
+	HUFFMAN_Construct( );
+	g_SendBuffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+	g_ReceiveBuffer.Init(( MAX_UDP_PACKET * 8 ) / 3 + 1, BUFFERTYPE_READ );
+
+	std::vector<struct pollfd> pollFDs;
+
+	// The master accepts at most 10 servers per IP. If it runs on this machine, give every simulated
+	// server and launcher its own address from 127.0.0.0/8 (Linux routes all of them to loopback).
+	const bool bLocalMaster = ( g_MasterAddress.abIP[0] == 127 );
+	if (( bLocalMaster == false ) && ( uiNumServers > 10 ))
+		printf( "Warning: The master only accepts 10 servers from this IP unless it's in its multiserver_whitelist.txt.\n" );
+
+	g_FakeServers.resize( uiNumServers );
+	for ( unsigned int i = 0; i < uiNumServers; ++i )
+	{
+		char szVerificationString[32];
+		snprintf( szVerificationString, sizeof( szVerificationString ), "loadgen%u", i );
+
+		g_FakeServers[i].Socket = loadgen_CreateSocket( bLocalMaster ? htonl(( 127 << 24 ) | ( 1 << 16 ) | ( i + 1 )) : INADDR_ANY );
+		g_FakeServers[i].VerificationString = szVerificationString;
+		g_FakeServers[i].bVerified = false;
+		g_FakeServers[i].llLastChallenge = 0;
+	}
+
+	g_FakeLaunchers.resize( uiNumLaunchers );
+	for ( unsigned int i = 0; i < uiNumLaunchers; ++i )
+	{
+		g_FakeLaunchers[i].Socket = loadgen_CreateSocket( bLocalMaster ? htonl(( 127 << 24 ) | ( 2 << 16 ) | ( i + 1 )) : INADDR_ANY );
+		g_FakeLaunchers[i].bWaiting = false;
+	}
+
+	for ( unsigned int i = 0; i < uiNumServers; ++i )
+	{
+		struct pollfd fd = { g_FakeServers[i].Socket, POLLIN, 0 };
+		pollFDs.push_back( fd );
+	}
+	for ( unsigned int i = 0; i < uiNumLaunchers; ++i )
+	{
+		struct pollfd fd = { g_FakeLaunchers[i].Socket, POLLIN, 0 };
+		pollFDs.push_back( fd );
+	}
+
+	printf( "Registering %u servers at %s...\n", uiNumServers, g_MasterAddress.ToString() );
+	long long llStart = loadgen_GetTimeMS();
+	while (( loadgen_NumVerifiedServers() < uiNumServers ) && ( loadgen_GetTimeMS() - llStart < 30000 ))
+		loadgen_Tick( pollFDs, false );
+
+	printf( "%u of %u servers registered in %.1f s.\n", loadgen_NumVerifiedServers(), uiNumServers, ( loadgen_GetTimeMS() - llStart ) / 1000.0 );
+
+	printf( "Querying the server list with %u launchers for %d s...\n", uiNumLaunchers, iSeconds );
+	llStart = loadgen_GetTimeMS();
+	while ( loadgen_GetTimeMS() - llStart < iSeconds * 1000LL )
+		loadgen_Tick( pollFDs, true );
+
+	const double dSeconds = ( loadgen_GetTimeMS() - llStart ) / 1000.0;
+	printf( "%lu queries answered (%.1f queries/s), average latency %.2f ms.\n", g_ulNumQueries, g_ulNumQueries / dSeconds, g_ulNumQueries ? g_dTotalLatencyMS / g_ulNumQueries : 0.0 );
+	printf( "%lu timed out, %lu rejected, %u servers in the last list.\n", g_ulNumTimeouts, g_ulNumRejected, g_uiLastNumServersListed );
+
+	for ( unsigned int i = 0; i < pollFDs.size(); ++i )
+		closesocket( pollFDs[i].fd );
+	g_SendBuffer.Free();
+	g_ReceiveBuffer.Free();
+	return 0;
+}
@@ -53,6 +53,7 @@
 #include "version.h"
 #include "network.h"
 #include "main.h"
+#include "iptrie.h"
 #include <sstream>
 #include <set>
 
@@ -68,17 +69,17 @@
 //	VARIABLES
 
 // [BB] Comparision function, necessary to put SERVER_s entries into a std::set.
+// Servers are ordered by IP and then by port, so all servers of an IP are next to each other.
 class SERVERCompFunc
 {
 public:
-	bool operator()(SERVER_s s1, SERVER_s s2) const
+	bool operator()( const SERVER_s &s1, const SERVER_s &s2 ) const
 	{
-		// [BB] NETWORK_AddressToString uses a static char array to generate the string, so we
-		// need to cache the string conversion of the first string when comparing to two.
-		// Note: Because we need a "<" comparison and not a "!=" comparison we can't use
-		// NETWORK_CompareAddress.
-		std::string address1 = s1.Address.ToString();
-		return ( stricmp ( address1.c_str(), s2.Address.ToString() ) < 0 );
+		const int result = memcmp( s1.Address.abIP, s2.Address.abIP, sizeof( s1.Address.abIP ));
+		if ( result != 0 )
+			return ( result < 0 );
+
+		return ( ntohs( s1.Address.usPort ) < ntohs( s2.Address.usPort ));
 	}
 };
 
@@ -98,6 +99,12 @@ static	IPList					g_BlockedIPs; // Blocked from hosting, but can still browse se
 static	IPList					g_BannedIPExemptions;
 static	IPList					g_MultiServerExceptions;
 
+// Indices of the above lists that are used to check incoming packets.
+static	IPTrie					g_BannedIPIndex;
+static	IPTrie					g_BlockedIPIndex;
+static	IPTrie					g_BannedIPExemptionIndex;
+static	IPTrie					g_MultiServerExceptionIndex;
+
 // IPs of launchers that we've sent full lists to recently.
 static	QueryIPQueue			g_queryIPQueue( 10 );
 
@@ -108,6 +115,17 @@ static	QueryIPQueue			g_ShortFloodQueue( 3 );
 // [BB] Do we want to hide servers that ignore our ban list?
 static	bool					g_bHideBanIgnoringServers = false;
 
+// Huffman encoded packets of the server list for LAUNCHER_SERVER_CHALLENGE and LAUNCHER_MASTER_CHALLENGE.
+// They are only built again when the list of servers sent to launchers changed.
+static	std::vector<std::vector<BYTE> >	g_ServerListPackets;
+static	std::vector<std::vector<BYTE> >	g_ServerListPartPackets;
+static	bool					g_bServerListPacketsValid = false;
+
+// When testing the master with master-loadgen, the same launchers query the list over and over.
+// So don't throttle queries per IP and don't log every single query.
+static	bool					g_bLoadTest = false;
+static	unsigned long			g_ulNumLauncherQueries = 0;
+
 //*****************************************************************************
 //	CLASSES
 
@@ -322,6 +340,101 @@ unsigned long MASTERSERVER_NumServers ( void )
 	return g_Servers.size();
 }
 
+//*****************************************************************************
+//
+void MASTERSERVER_InvalidateServerListPackets( void )
+{
+	g_bServerListPacketsValid = false;
+}
+
+//*****************************************************************************
+//
+bool MASTERSERVER_IsServerListed( const SERVER_s &Server )
+{
+	// [BB] Possibly omit servers that don't enforce our ban list.
+	return ( ( Server.bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ) );
+}
+
+//*****************************************************************************
+//
+void MASTERSERVER_BuildServerListPackets( void )
+{
+	if ( g_bServerListPacketsValid )
+		return;
+
+	g_ServerListPackets.clear();
+	g_ServerListPartPackets.clear();
+
+	// LAUNCHER_SERVER_CHALLENGE: All servers in one packet.
+	g_MessageBuffer.Clear();
+	NETWORK_WriteLong( &g_MessageBuffer.ByteStream, MSC_BEGINSERVERLIST );
+	for( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
+	{
+		if ( MASTERSERVER_IsServerListed( *it ))
+			MASTERSERVER_SendServerIPToLauncher ( it->Address, &g_MessageBuffer.ByteStream );
+	}
+
+	// Tell the launcher that we're done sending servers.
+	NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_ENDSERVERLIST );
+	g_ServerListPackets.push_back( std::vector<BYTE>() );
+	NETWORK_EncodePacket( &g_MessageBuffer, g_ServerListPackets.back() );
+
+	// LAUNCHER_MASTER_CHALLENGE: Blocks of servers sharing an IP, split over packets of at most ulMaxPacketSize bytes.
+	const unsigned long ulMaxPacketSize = 1024;
+	unsigned long ulPacketNum = 0;
+
+	std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin();
+
+	g_MessageBuffer.Clear();
+	NETWORK_WriteLong( &g_MessageBuffer.ByteStream, MSC_BEGINSERVERLISTPART );
+	NETWORK_WriteByte( &g_MessageBuffer.ByteStream, ulPacketNum );
+	NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_SERVERBLOCK );
+	unsigned long ulSizeOfPacket = 6; // 4 (MSC_BEGINSERVERLISTPART) + 1 (0) + 1 (MSC_SERVERBLOCK)
+
+	while ( it != g_Servers.end() )
+	{
+		NETADDRESS_s serverAddress = it->Address;
+		std::vector<USHORT> serverPortList;
+
+		do {
+			if ( MASTERSERVER_IsServerListed( *it ))
+				serverPortList.push_back ( it->Address.usPort );
+			++it;
+		} while ( ( it != g_Servers.end() ) && it->Address.CompareNoPort( serverAddress ) );
+
+		// [BB] All servers on this IP ignore the list, nothing to send.
+		if ( serverPortList.size() == 0 )
+			continue;
+
+		const unsigned long ulServerBlockNetSize = MASTERSERVER_CalcServerIPBlockNetSize( serverAddress, serverPortList );
+
+		// [BB] If sending this block would cause the current packet to exceed ulMaxPacketSize ...
+		if ( ulSizeOfPacket + ulServerBlockNetSize > ulMaxPacketSize - 1 )
+		{
+			// [BB] ... close the current packet and start a new one.
+			NETWORK_WriteByte( &g_MessageBuffer.ByteStream, 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
+			NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_ENDSERVERLISTPART );
+			g_ServerListPartPackets.push_back( std::vector<BYTE>() );
+			NETWORK_EncodePacket( &g_MessageBuffer, g_ServerListPartPackets.back() );
+
+			g_MessageBuffer.Clear();
+			++ulPacketNum;
+			ulSizeOfPacket = 5;
+			NETWORK_WriteLong( &g_MessageBuffer.ByteStream, MSC_BEGINSERVERLISTPART );
+			NETWORK_WriteByte( &g_MessageBuffer.ByteStream, ulPacketNum );
+			NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_SERVERBLOCK );
+		}
+		ulSizeOfPacket += ulServerBlockNetSize;
+		MASTERSERVER_SendServerIPBlockToLauncher ( serverAddress, serverPortList, &g_MessageBuffer.ByteStream );
+	}
+	NETWORK_WriteByte( &g_MessageBuffer.ByteStream, 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
+	NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_ENDSERVERLIST );
+	g_ServerListPartPackets.push_back( std::vector<BYTE>() );
+	NETWORK_EncodePacket( &g_MessageBuffer, g_ServerListPartPackets.back() );
+
+	g_bServerListPacketsValid = true;
+}
+
 //*****************************************************************************
 //
 bool MASTERSERVER_RefreshIPList( IPList &List, const char *FileName )
@@ -355,6 +468,11 @@ void MASTERSERVER_InitializeBans( void )
 	if ( !(g_BlockedIPs.clearAndLoadFromFile( "blocklist.txt" )) )
 		std::cerr << g_BlockedIPs.getErrorMessage();
 
+	g_BannedIPIndex.build( g_BannedIPs );
+	g_BlockedIPIndex.build( g_BlockedIPs );
+	g_BannedIPExemptionIndex.build( g_BannedIPExemptions );
+	g_MultiServerExceptionIndex.build( g_MultiServerExceptions );
+
 	std::cerr << "\nBan list: " << g_BannedIPs.size() << " banned IPs, " << g_BlockedIPs.size( ) << " blocked IPs, " << g_BannedIPExemptions.size() << " exemptions." << std::endl;
 	std::cerr << "Multi-server exceptions: " << g_MultiServerExceptions.size() << "." << std::endl;
 
@@ -395,6 +513,7 @@ void MASTERSERVER_AddServer( const SERVER_s &Server, std::set<SERVER_s, SERVERCo
 		addedServer->lLastReceived = g_lCurrentTime;						
 		if ( &ServerSet == &g_Servers )
 		{
+			MASTERSERVER_InvalidateServerListPackets( );
 			printf( "+ Adding %s (revision %d) to the server list.\n", addedServer->Address.ToString(), addedServer->iServerRevision );
 			MASTERSERVER_SendBanlistToServer( *addedServer );
 		}
@@ -421,7 +540,7 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 	}
 
 	// Is this IP banned? Send the user an explanation, and ignore the IP for 30 seconds.
-	if ( !g_BannedIPExemptions.isIPInList( AddressFrom ) && g_BannedIPs.isIPInList( AddressFrom ))
+	if ( !g_BannedIPExemptionIndex.contains( AddressFrom ) && g_BannedIPIndex.contains( AddressFrom ))
 	{
 		g_MessageBuffer.Clear();
 		NETWORK_WriteLong( &g_MessageBuffer.ByteStream, MSC_IPISBANNED );
@@ -440,7 +559,7 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 	case SERVER_MASTER_CHALLENGE:
 		{
 			// Certain IPs can be blocked from just hosting.
-			if ( !g_BannedIPExemptions.isIPInList( AddressFrom ) && g_BlockedIPs.isIPInList( AddressFrom ))
+			if ( !g_BannedIPExemptionIndex.contains( AddressFrom ) && g_BlockedIPIndex.contains( AddressFrom ))
 			{
 				g_MessageBuffer.Clear();
 				NETWORK_WriteLong( &g_MessageBuffer.ByteStream, MSC_IPISBANNED );
@@ -470,14 +589,15 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 			{
 				unsigned int iNumOtherServers = 0;
 
-				// First count the number of servers from this IP.
-				for( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
-				{
-					if ( it->Address.CompareNoPort( AddressFrom ))
-						iNumOtherServers++;
-				}
+				// First count the number of servers from this IP. Since the set is ordered by IP,
+				// they start where a server with this IP and port 0 would be.
+				SERVER_s firstServerOfIP;
+				firstServerOfIP.Address = AddressFrom;
+				firstServerOfIP.Address.usPort = 0;
+				for( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.lower_bound( firstServerOfIP ); ( it != g_Servers.end() ) && it->Address.CompareNoPort( AddressFrom ); ++it )
+					iNumOtherServers++;
 
-				if ( iNumOtherServers >= 10 && !g_MultiServerExceptions.isIPInList( AddressFrom ))
+				if ( iNumOtherServers >= 10 && !g_MultiServerExceptionIndex.contains( AddressFrom ))
 					printf( "* More than 10 servers received from %s. Ignoring request...\n", AddressFrom.ToString() );
 				else
 				{
@@ -513,7 +633,11 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 				{
 					currentServer->lLastReceived = g_lCurrentTime;
 					// [BB] The server possibly changed the ban setting, so update it.
-					currentServer->bEnforcesBanList = newServer.bEnforcesBanList;
+					if ( currentServer->bEnforcesBanList != newServer.bEnforcesBanList )
+					{
+						currentServer->bEnforcesBanList = newServer.bEnforcesBanList;
+						MASTERSERVER_InvalidateServerListPackets( );
+					}
 				}
 			}
 
@@ -569,7 +693,7 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 			g_MessageBuffer.Clear();
 
 			// Did this IP query us recently? If so, send it an explanation, and ignore it completely for 3 seconds.
-			if ( g_queryIPQueue.addressInQueue( AddressFrom ))
+			if ( ( g_bLoadTest == false ) && g_queryIPQueue.addressInQueue( AddressFrom ))
 			{
 				NETWORK_WriteLong( &g_MessageBuffer.ByteStream, MSC_REQUESTIGNORED );
 				NETWORK_LaunchPacket( &g_MessageBuffer, AddressFrom );
@@ -593,83 +717,20 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 				}
 			}
 
-			printf( "-> Sending server list to %s.\n", AddressFrom.ToString() );
+			g_ulNumLauncherQueries++;
 
-			// Wait 10 seconds before sending this IP the server list again.
-			g_queryIPQueue.addAddress( AddressFrom, g_lCurrentTime, &std::cerr );
-
-			switch ( lCommand )
+			if ( g_bLoadTest == false )
 			{
-			case LAUNCHER_SERVER_CHALLENGE:
-				// Send the list of servers.
-				NETWORK_WriteLong( &g_MessageBuffer.ByteStream, MSC_BEGINSERVERLIST );
-				for( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
-				{
-					// [BB] Possibly omit servers that don't enforce our ban list.
-					if ( ( it->bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ) )
-						MASTERSERVER_SendServerIPToLauncher ( it->Address, &g_MessageBuffer.ByteStream );
-				}
-
-				// Tell the launcher that we're done sending servers.
-				NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_ENDSERVERLIST );
-
-				// Send the launcher our packet.
-				NETWORK_LaunchPacket( &g_MessageBuffer, AddressFrom );
-				return;
-
-			case LAUNCHER_MASTER_CHALLENGE:
-
-				const unsigned long ulMaxPacketSize = 1024;
-				unsigned long ulPacketNum = 0;
-
-				std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin();
-
-				NETWORK_WriteLong( &g_MessageBuffer.ByteStream, MSC_BEGINSERVERLISTPART );
-				NETWORK_WriteByte( &g_MessageBuffer.ByteStream, ulPacketNum );
-				NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_SERVERBLOCK );
-				unsigned long ulSizeOfPacket = 6; // 4 (MSC_BEGINSERVERLISTPART) + 1 (0) + 1 (MSC_SERVERBLOCK)
-
-				while ( it != g_Servers.end() )
-				{
-					NETADDRESS_s serverAddress = it->Address;
-					std::vector<USHORT> serverPortList;
-
-					do {
-						// [BB] Possibly omit servers that don't enforce our ban list.
-						if ( ( it->bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ) )
-							serverPortList.push_back ( it->Address.usPort );
-						++it;
-					} while ( ( it != g_Servers.end() ) && it->Address.CompareNoPort( serverAddress ) );
-
-					// [BB] All servers on this IP ignore the list, nothing to send.
-					if ( serverPortList.size() == 0 )
-						continue;
+				printf( "-> Sending server list to %s.\n", AddressFrom.ToString() );
 
-					const unsigned long ulServerBlockNetSize = MASTERSERVER_CalcServerIPBlockNetSize( serverAddress, serverPortList );
-
-					// [BB] If sending this block would cause the current packet to exceed ulMaxPacketSize ...
-					if ( ulSizeOfPacket + ulServerBlockNetSize > ulMaxPacketSize - 1 )
-					{
-						// [BB] ... close the current packet and start a new one.
-						NETWORK_WriteByte( &g_MessageBuffer.ByteStream, 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
-						NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_ENDSERVERLISTPART );
-						NETWORK_LaunchPacket( &g_MessageBuffer, AddressFrom );
-
-						g_MessageBuffer.Clear();
-						++ulPacketNum;
-						ulSizeOfPacket = 5;
-						NETWORK_WriteLong( &g_MessageBuffer.ByteStream, MSC_BEGINSERVERLISTPART );
-						NETWORK_WriteByte( &g_MessageBuffer.ByteStream, ulPacketNum );
-						NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_SERVERBLOCK );
-					}
-					ulSizeOfPacket += ulServerBlockNetSize;
-					MASTERSERVER_SendServerIPBlockToLauncher ( serverAddress, serverPortList, &g_MessageBuffer.ByteStream );
-				}
-				NETWORK_WriteByte( &g_MessageBuffer.ByteStream, 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
-				NETWORK_WriteByte( &g_MessageBuffer.ByteStream, MSC_ENDSERVERLIST );
-				NETWORK_LaunchPacket( &g_MessageBuffer, AddressFrom );
-				return;
+				// Wait 10 seconds before sending this IP the server list again.
+				g_queryIPQueue.addAddress( AddressFrom, g_lCurrentTime, &std::cerr );
 			}
+
+			// The list is the same for all launchers, so it's only built when it changed.
+			MASTERSERVER_BuildServerListPackets( );
+			NETWORK_LaunchEncodedPackets( ( lCommand == LAUNCHER_SERVER_CHALLENGE ) ? g_ServerListPackets : g_ServerListPartPackets, AddressFrom );
+			return;
 		}
 	}
 
@@ -689,6 +750,8 @@ void MASTERSERVER_CheckTimeouts( std::set<SERVER_s, SERVERCompFunc> &ServerSet )
 		if (( g_lCurrentTime - it->lLastReceived ) >= 60 )
 		{
 			printf( "- %server at %s timed out.\n", ( &ServerSet == &g_UnverifiedServers ) ? "Unverified s" : "S", it->Address.ToString() );
+			if ( &ServerSet == &g_Servers )
+				MASTERSERVER_InvalidateServerListPackets( );
 			// [BB] The standard does not require set::erase to return the incremented operator,
 			// that's why we must use the post increment operator here.
 			ServerSet.erase ( it++ );
@@ -751,8 +814,19 @@ int main( int argc, char **argv )
 		g_bHideBanIgnoringServers = true;
 	}
 
+	// Master is being tested with master-loadgen.
+	for ( int i = 1; i < argc; ++i )
+	{
+		if ( stricmp ( argv[i], "-loadtest" ) == 0 )
+		{
+			std::cerr << "Note: Load test mode, launcher queries are neither throttled nor logged." << std::endl;
+			g_bLoadTest = true;
+		}
+	}
+
 	// Done setting up!
 	std::cerr << "\n=== Master server started! ===\n";
+	int lastLoadReportTime = I_GetTime( );
 
 	while ( 1 )
 	{
@@ -791,6 +865,14 @@ int main( int argc, char **argv )
 			lastBanlistVerificationTimeout = g_lCurrentTime;
 		}
 
+		// Report the throughput while load testing.
+		if ( g_bLoadTest && ( g_lCurrentTime >= lastLoadReportTime + 10 ))
+		{
+			std::cerr << "~ " << g_Servers.size() << " servers, " << ( g_ulNumLauncherQueries / ( g_lCurrentTime - lastLoadReportTime )) << " launcher queries/s\n";
+			g_ulNumLauncherQueries = 0;
+			lastLoadReportTime = g_lCurrentTime;
+		}
+
 		// [BB] Reparse the ban list every 15 minutes.
 		if ( g_lCurrentTime > lastParsingTime + 15*60 )
 		{
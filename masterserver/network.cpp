@@ -58,6 +58,10 @@
 #include <ctype.h>
 #include <math.h>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
 #include "../src/huffman/huffman.h"
 #include "network.h"
 
@@ -79,12 +83,18 @@ static	USHORT			g_usLocalPort;
 // Buffer for the Huffman encoding.
 static	UCHAR			g_ucHuffmanBuffer[131072];
 
+#ifdef __linux__
+// epoll instance that waits for packets on our socket.
+static	int				g_EpollFD = -1;
+#endif
+
 //*****************************************************************************
 //	PROTOTYPES
 
 static	void			network_Error( const char *pszError );
 static	SOCKET			network_AllocateSocket( void );
 static	bool			network_BindSocketToPort( SOCKET Socket, ULONG ulInAddr, USHORT usPort, bool bReUse );
+static	void			network_SendEncodedPacket( const UCHAR *pucData, INT iSize, NETADDRESS_s Address );
 
 //*****************************************************************************
 //	FUNCTIONS
@@ -170,6 +180,27 @@ void NETWORK_Construct( USHORT usPort, const char *pszIPAddress )
 	if ( ioctlsocket( g_NetworkSocket, FIONBIO, &ulArg ) == -1 )
 		printf( "network_AllocateSocket: ioctl FIONBIO: %s", strerror( errno ));
 
+#ifdef __linux__
+	// Wait for incoming packets with epoll instead of select.
+	g_EpollFD = epoll_create1( 0 );
+	if ( g_EpollFD != -1 )
+	{
+		struct epoll_event	Event;
+
+		memset( &Event, 0, sizeof( Event ));
+		Event.events = EPOLLIN;
+		Event.data.fd = g_NetworkSocket;
+		if ( epoll_ctl( g_EpollFD, EPOLL_CTL_ADD, g_NetworkSocket, &Event ) == -1 )
+		{
+			close( g_EpollFD );
+			g_EpollFD = -1;
+		}
+	}
+
+	if ( g_EpollFD == -1 )
+		printf( "NETWORK_Construct: Couldn't set up epoll (%s), using select instead.\n", strerror( errno ));
+#endif
+
 	// Init our read buffer.
 	// [BB] Vortex Cortex pointed us to the fact that the smallest huffman code is only 3 bits
 	// and it turns into 8 bits when it's decompressed. Thus we need to allocate a buffer that
@@ -275,7 +306,6 @@ NETADDRESS_s NETWORK_GetFromAddress( void )
 //
 void NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address )
 {
-	LONG				lNumBytes;
 	INT					iNumBytesOut = sizeof(g_ucHuffmanBuffer);
 
 	pBuffer->ulCurrentSize = pBuffer->CalcSize();
@@ -284,54 +314,68 @@ void NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address )
 	if ( pBuffer->ulCurrentSize == 0 )
 		return;
 
-	// Convert the IP address to a socket address.
-	struct sockaddr_in SocketAddress = Address.ToSocketAddress();
-
 	HUFFMAN_Encode( (unsigned char *)pBuffer->pbData, g_ucHuffmanBuffer, pBuffer->ulCurrentSize, &iNumBytesOut );
 
-	lNumBytes = sendto( g_NetworkSocket, (const char*)g_ucHuffmanBuffer, iNumBytesOut, 0, (struct sockaddr *)&SocketAddress, sizeof( SocketAddress ));
+	network_SendEncodedPacket( g_ucHuffmanBuffer, iNumBytesOut, Address );
+}
 
-	// If sendto returns -1, there was an error.
-	if ( lNumBytes == -1 )
-	{
-#ifdef __WIN32__
-		INT	iError = WSAGetLastError( );
+//*****************************************************************************
+//
+// Huffman encodes a packet so that it can be sent to any number of addresses
+// with NETWORK_LaunchEncodedPackets later.
+void NETWORK_EncodePacket( NETBUFFER_s *pBuffer, std::vector<BYTE> &Packet )
+{
+	INT					iNumBytesOut = sizeof(g_ucHuffmanBuffer);
 
-		// Wouldblock is silent.
-		if ( iError == WSAEWOULDBLOCK )
-			return;
+	pBuffer->ulCurrentSize = pBuffer->CalcSize();
+	Packet.clear();
 
-		switch ( iError )
-		{
-		case WSAEACCES:
+	if ( pBuffer->ulCurrentSize == 0 )
+		return;
 
-			printf( "NETWORK_LaunchPacket: Error #%d, WSAEACCES: Permission denied for address: %s\n", iError, Address.ToString() );
-			return;
-		case WSAEADDRNOTAVAIL:
+	HUFFMAN_Encode( (unsigned char *)pBuffer->pbData, g_ucHuffmanBuffer, pBuffer->ulCurrentSize, &iNumBytesOut );
+	Packet.assign( g_ucHuffmanBuffer, g_ucHuffmanBuffer + iNumBytesOut );
+}
 
-			printf( "NETWORK_LaunchPacket: Error #%d, WSAEADDRENOTAVAIL: Address %s not available\n", iError, Address.ToString() );
-			return;
-		case WSAEHOSTUNREACH:
+//*****************************************************************************
+//
+void NETWORK_LaunchEncodedPackets( const std::vector<std::vector<BYTE> > &Packets, NETADDRESS_s Address )
+{
+#ifdef __linux__
+	// Hand all packets to the kernel at once.
+	struct sockaddr_in			SocketAddress = Address.ToSocketAddress();
+	std::vector<struct iovec>	IOVectors( Packets.size() );
+	std::vector<struct mmsghdr>	Messages( Packets.size() );
 
-			printf( "NETWORK_LaunchPacket: Error #%d, WSAEHOSTUNREACH: Address %s unreachable\n", iError, Address.ToString() );
-			return;				
-		default:
+	for ( unsigned int i = 0; i < Packets.size(); ++i )
+	{
+		IOVectors[i].iov_base = const_cast<BYTE *>( Packets[i].data() );
+		IOVectors[i].iov_len = Packets[i].size();
+		memset( &Messages[i], 0, sizeof( Messages[i] ));
+		Messages[i].msg_hdr.msg_name = &SocketAddress;
+		Messages[i].msg_hdr.msg_namelen = sizeof( SocketAddress );
+		Messages[i].msg_hdr.msg_iov = &IOVectors[i];
+		Messages[i].msg_hdr.msg_iovlen = 1;
+	}
 
-			printf( "NETWORK_LaunchPacket: Error #%d\n", iError );
-			return;
-		}
-#else
-	if ( errno == EWOULDBLOCK )
-return;
+	unsigned int uiSent = 0;
+	while ( uiSent < Messages.size() )
+	{
+		const int iResult = sendmmsg( g_NetworkSocket, &Messages[uiSent], Messages.size() - uiSent, 0 );
 
-          if ( errno == ECONNREFUSED )
-              return;
+		// Let network_SendEncodedPacket deal with the error of the first packet that wasn't sent.
+		if ( iResult <= 0 )
+			break;
 
-		printf( "NETWORK_LaunchPacket: %s\n", strerror( errno ));
-		printf( "NETWORK_LaunchPacket: Address %s\n", Address.ToString() );
+		uiSent += iResult;
+	}
 
+	for ( ; uiSent < Packets.size(); ++uiSent )
+		network_SendEncodedPacket( Packets[uiSent].data(), static_cast<INT>( Packets[uiSent].size() ), Address );
+#else
+	for ( unsigned int i = 0; i < Packets.size(); ++i )
+		network_SendEncodedPacket( Packets[i].data(), static_cast<INT>( Packets[i].size() ), Address );
 #endif
-	}
 }
 
 //*****************************************************************************
@@ -434,6 +478,60 @@ bool network_BindSocketToPort( SOCKET Socket, ULONG ulInAddr, USHORT usPort, boo
 	return ( true );
 }
 
+//*****************************************************************************
+//
+static void network_SendEncodedPacket( const UCHAR *pucData, INT iSize, NETADDRESS_s Address )
+{
+	LONG				lNumBytes;
+
+	// Convert the IP address to a socket address.
+	struct sockaddr_in SocketAddress = Address.ToSocketAddress();
+
+	lNumBytes = sendto( g_NetworkSocket, (const char*)pucData, iSize, 0, (struct sockaddr *)&SocketAddress, sizeof( SocketAddress ));
+
+	// If sendto returns -1, there was an error.
+	if ( lNumBytes == -1 )
+	{
+#ifdef __WIN32__
+		INT	iError = WSAGetLastError( );
+
+		// Wouldblock is silent.
+		if ( iError == WSAEWOULDBLOCK )
+			return;
+
+		switch ( iError )
+		{
+		case WSAEACCES:
+
+			printf( "NETWORK_LaunchPacket: Error #%d, WSAEACCES: Permission denied for address: %s\n", iError, Address.ToString() );
+			return;
+		case WSAEADDRNOTAVAIL:
+
+			printf( "NETWORK_LaunchPacket: Error #%d, WSAEADDRENOTAVAIL: Address %s not available\n", iError, Address.ToString() );
+			return;
+		case WSAEHOSTUNREACH:
+
+			printf( "NETWORK_LaunchPacket: Error #%d, WSAEHOSTUNREACH: Address %s unreachable\n", iError, Address.ToString() );
+			return;				
+		default:
+
+			printf( "NETWORK_LaunchPacket: Error #%d\n", iError );
+			return;
+		}
+#else
+	if ( errno == EWOULDBLOCK )
+return;
+
+          if ( errno == ECONNREFUSED )
+              return;
+
+		printf( "NETWORK_LaunchPacket: %s\n", strerror( errno ));
+		printf( "NETWORK_LaunchPacket: Address %s\n", Address.ToString() );
+
+#endif
+	}
+}
+
 
 #ifndef	WIN32
 extern int	stdin_ready;
@@ -443,6 +541,19 @@ extern int	do_stdin;
 // [BB] We only need this for the server console input under Linux.
 void I_DoSelect (void)
 {
+#ifdef __linux__
+	if ( g_EpollFD != -1 )
+	{
+		// Sleep until a packet arrives (or for at most a second). The master doesn't read
+		// console input, so unlike with select we don't bother waiting for stdin.
+		struct epoll_event	Event;
+
+		epoll_wait( g_EpollFD, &Event, 1, 1000 );
+		stdin_ready = 0;
+		return;
+	}
+#endif
+
 #ifdef		WIN32
 	// [BC] We need this code here to be executed. The point of this function is to
 	// make the thread sleep until a packet is received. That way, the thread doesn't
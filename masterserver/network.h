@@ -57,6 +57,7 @@
 //#include "i_net.h"
 //#include "sv_main.h"
 #include "../src/networkshared.h"
+#include <vector>
 
 //*****************************************************************************
 //	DEFINES
@@ -73,6 +74,8 @@ int				NETWORK_GetPackets( void );
 int				NETWORK_GetLANPackets( void );
 NETADDRESS_s	NETWORK_GetFromAddress( void );
 void			NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address );
+void			NETWORK_EncodePacket( NETBUFFER_s *pBuffer, std::vector<BYTE> &Packet );
+void			NETWORK_LaunchEncodedPackets( const std::vector<std::vector<BYTE> > &Packets, NETADDRESS_s Address );
 //AActor			*NETWORK_FindThingByNetID( LONG lID );
 NETADDRESS_s	NETWORK_GetLocalAddress( void );
 NETBUFFER_s		*NETWORK_GetNetworkMessageBuffer( void );
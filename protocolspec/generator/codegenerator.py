@@ -30,6 +30,11 @@
 #	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #
 
+from parametertypes import fixedsizes
+
+# Fixed layouts are limited to this size, so that they always fit into the inline buffer of a NetCommand.
+maxfixedlayoutsize = 64
+
 def getVerifierForParameter(parameter):
 	'''
 		Returns the initializer name for a parameter (i.e. _valueInitialized for a parameter 'value')
@@ -44,6 +49,8 @@ class SourceCodeWriter:
 		self.output = output
 		self.tabs = ''
 		self.writingsender = False
+		self.infixedlayout = False
+		self.fixedoffset = 0
 		self.spec = spec
 		super().__init__()
 
@@ -95,6 +102,55 @@ class SourceCodeWriter:
 		self.unindent()
 		self.writeline('}')
 
+	def getfixedlayouts(self, command):
+		'''
+			Finds the runs of consecutive parameters of a command that always take the same number of bytes and are
+			subject to the same condition. Each run is read and written in one go, with a single bounds check.
+			Returns a list of (parameters, size) tuples.
+		'''
+		layouts = []
+		parameters = []
+		size = 0
+		for parameter in command:
+			if parameters and (parameter.fixedsize is None
+				or parameter.condition != parameters[0].condition
+				or size + parameter.fixedsize > maxfixedlayoutsize):
+				layouts.append((parameters, size))
+				parameters = []
+				size = 0
+
+			if parameter.fixedsize is not None:
+				parameters.append(parameter)
+				size += parameter.fixedsize
+
+		if parameters:
+			layouts.append((parameters, size))
+		return layouts
+
+	def readvalue(self, kind):
+		'''
+			Returns an expression that reads a value of the given kind (Byte, Short, Long or Float). Within a fixed
+			layout, the value is loaded directly from the data at its offset.
+		'''
+		if self.infixedlayout:
+			offset = self.fixedoffset
+			self.fixedoffset += fixedsizes[kind]
+			return 'NETWORK_Get{kind}( data + {offset} )'.format(**locals())
+		else:
+			return 'NETWORK_Read{kind}( bytestream )'.format(**locals())
+
+	def writevalue(self, kind, value):
+		'''
+			Writes code that adds a value of the given kind (Byte, Short, Long or Float) to the command. Within a fixed
+			layout, the value is stored directly into the data at its offset.
+		'''
+		if self.infixedlayout:
+			offset = self.fixedoffset
+			self.fixedoffset += fixedsizes[kind]
+			self.writeline('NETWORK_Put{kind}( data + {offset}, {value} );'.format(**locals()))
+		else:
+			self.writeline('command.add{kind}( {value} );'.format(**locals()))
+
 	def writecontext(self, context):
 		'''
 			Writes a context, i.e. a here document containing source code into the file.
@@ -133,23 +189,13 @@ class SourceWriter(SourceCodeWriter):
 		self.writeline('#include "servercommands.h"')
 		self.writeline('#include "network.h"')
 		self.writeline('#include "network/netcommand.h"')
+		self.writeline('#include "m_random.h"')
 		self.writeline('')
-		self.beginfunction(name = 'CLIENT_ParseServerCommand', enumtype = 'SVC')
 
 		for command in self.getcommands('GameServerToClient'):
-			if not command.extended:
-				self.writecommandreader(command)
+			self.writecommandreader(command)
 
-		self.endfunction()
-		self.writeline('')
-		self.beginfunction(name = 'CLIENT_ParseExtendedServerCommand', enumtype = 'SVC2')
-
-		# Write handling for the commands in the source:
-		for command in self.getcommands('GameServerToClient'):
-			if command.extended:
-				self.writecommandreader(command)
-
-		self.endfunction()
+		self.writeparsers()
 
 		for command in self.getcommands('GameServerToClient'):
 			# Write the SendToClient methods
@@ -180,31 +226,127 @@ class SourceWriter(SourceCodeWriter):
 					}}
 					'''.format(commandname = command.name, **locals()))
 
-	def beginfunction(self, name, enumtype):
+		self.writetests()
+
+	def writetests(self):
 		'''
-			Writes the beginning of a function definition.
+			Writes functions that create every server command with random parameters, for the protocol test. The
+			commands are returned unencoded, so that the test can time BuildNetCommand().
 		'''
-		self.writeline('bool {name}( {enumtype} header, BYTESTREAM_s *bytestream )'.format(**locals()))
-		self.startscope()
-		self.writeline('switch ( header )')
+		self.writecontext('''
+
+			static FString ServerCommandTest_RandomString( FRandom &random )
+			{
+				FString string;
+				for ( int i = random( 16 ); i > 0; --i )
+					string += static_cast<char>( 'a' + random( 26 ));
+				return string;
+			}
+			''')
+
+		for command in self.getcommands('GameServerToClient'):
+			self.writeline('static ServerCommands::BaseServerCommand *ServerCommandTest_Build%s( FRandom &random )' % command.name)
+			self.startscope()
+			self.writeline('ServerCommands::{name} *command = new ServerCommands::{name};'.format(name = command.name))
+			for parameter in command:
+				parameter.writerandom(self, lambda value, setter = parameter.setter: 'command->%s( %s );' % (setter, value))
+			self.writeline('return command;')
+			self.endscope()
+			self.writeline('')
+
+		self.writeline('const ServerCommandTest g_ServerCommandTests[] =')
 		self.writeline('{')
+		for command in self.getcommands('GameServerToClient'):
+			self.writeline('\t{{ "{name}", ServerCommandTest_Build{name} }},'.format(name = command.name))
+		self.writeline('};')
+		self.writeline('')
+		self.writeline('const unsigned int g_NumServerCommandTests = countof( g_ServerCommandTests );')
 
-	def endfunction(self):
+	def writeparsers(self):
 		'''
-			Writes the end of a function definition
+			Writes the tables that map the command headers to the Parse methods, and the functions that use them.
 		'''
-		self.writeline('default:')
-		self.writeline('\treturn false;')
+		self.writecontext('''
+			typedef bool ( *ServerCommandParser )( BYTESTREAM_s *bytestream, bool execute );
+
+			// The Parse methods of all server commands, indexed by their header.
+			static struct ServerCommandParsers
+			{
+				ServerCommandParser commands[NUM_SERVER_COMMANDS];
+				ServerCommandParser extendedCommands[NUM_SVC2_COMMANDS];
+
+				ServerCommandParsers()
+				{
+					memset( this, 0, sizeof( *this ));
+			''')
+		self.indent()
+		self.indent()
+		for command in self.getcommands('GameServerToClient'):
+			table = command.extended and 'extendedCommands' or 'commands'
+			self.writeline('{table}[{enumname}] = ServerCommands::{commandname}::Parse;'.format(
+				table = table, enumname = command.enumname, commandname = command.name))
+		self.unindent()
 		self.writeline('}')
-		self.endscope()
+		self.unindent()
+		self.writeline('} g_ServerCommandParsers;')
+		self.writeline('')
+		self.writecontext('''
+			bool CLIENT_ParseServerCommand( SVC header, BYTESTREAM_s *bytestream )
+			{
+				if (( static_cast<unsigned int>( header ) >= NUM_SERVER_COMMANDS )
+					|| ( g_ServerCommandParsers.commands[header] == NULL ))
+				{
+					return false;
+				}
+
+				return g_ServerCommandParsers.commands[header]( bytestream, true );
+			}
+
+			bool CLIENT_ParseExtendedServerCommand( SVC2 header, BYTESTREAM_s *bytestream )
+			{
+				if (( static_cast<unsigned int>( header ) >= NUM_SVC2_COMMANDS )
+					|| ( g_ServerCommandParsers.extendedCommands[header] == NULL ))
+				{
+					return false;
+				}
+
+				return g_ServerCommandParsers.extendedCommands[header]( bytestream, true );
+			}
+
+			bool CLIENT_SkipServerCommand( BYTESTREAM_s *bytestream )
+			{
+				const int header = NETWORK_ReadByte( bytestream );
+				bytestream->bitBuffer = NULL;
+				bytestream->bitShift = -1;
+
+				if ( header == SVC_EXTENDEDCOMMAND )
+				{
+					const int extendedHeader = NETWORK_ReadByte( bytestream );
+					if (( static_cast<unsigned int>( extendedHeader ) >= NUM_SVC2_COMMANDS )
+						|| ( g_ServerCommandParsers.extendedCommands[extendedHeader] == NULL ))
+					{
+						return false;
+					}
+
+					return g_ServerCommandParsers.extendedCommands[extendedHeader]( bytestream, false );
+				}
+
+				if (( static_cast<unsigned int>( header ) >= NUM_SERVER_COMMANDS )
+					|| ( g_ServerCommandParsers.commands[header] == NULL ))
+				{
+					return false;
+				}
+
+				return g_ServerCommandParsers.commands[header]( bytestream, false );
+			}
+			''')
 
 	def writecommandreader(self, command):
 		'''
-			Writes code to handle the read of a server command.
+			Writes the Parse method of a server command.
 		'''
 		commandname = command.name
-		self.writeline('case %s:' % command.enumname)
-		self.indent()
+		self.writeline('bool ServerCommands::{commandname}::Parse( BYTESTREAM_s *bytestream, bool execute )'.format(**locals()))
 		self.startscope()
 
 		self.declsection = self.output.addsection(command.name + ' declarations')
@@ -214,15 +356,29 @@ class SourceWriter(SourceCodeWriter):
 		# Write reading code and check parameter-specific conditions
 		self.writeline('ServerCommands::%s command;' % command.name)
 		self.output.setcurrentsection(self.readsection)
-		self.handleparameters(command, 'writeread')
-		# The checks need to be added separately so that everything can be read first, and only then we start
-		# doing any checks.
-		self.output.setcurrentsection(self.checksection)
-		self.handleparameters(command, 'writereadchecks')
 
-		# Generate code to print a warning if the packet is too short, and to execute the command if all is OK, unless
-		# the command was empty (in which case we're not reading anything).
-		if command.parameters:
+		# Parameters of a fixed size are read with a single bounds check per run.
+		layouts = self.getfixedlayouts(command)
+		if layouts:
+			self.declare('const BYTE', '*data')
+
+		def beginlayout(size):
+			self.writecontext('''
+				data = bytestream->pbStream;
+				bytestream->pbStream += {size};
+				if ( bytestream->pbStream > bytestream->pbStreamEnd )
+				{{
+					CLIENT_PrintWarning( "{commandname}: Packet contained %td too few bytes\\n",
+						bytestream->pbStream - bytestream->pbStreamEnd );
+					return true;
+				}}
+				'''.format(commandname = commandname, size = size))
+
+		self.handleparameters(command, 'writeread', layouts = layouts, beginlayout = beginlayout)
+
+		# Generate code to print a warning if the packet is too short, unless the command was empty or was read
+		# completely in fixed layouts.
+		if any(parameter.fixedsize is None for parameter in command):
 			self.writecontext('''
 			if ( bytestream->pbStream > bytestream->pbStreamEnd )
 			{{
@@ -231,16 +387,25 @@ class SourceWriter(SourceCodeWriter):
 				return true;
 			}}
 			'''.format(**locals()))
+		elif command.parameters:
+			self.writeline('')
+
+		# The checks need to be added separately so that everything can be read first, and only then we start
+		# doing any checks. They are skipped if the command is only read.
+		self.output.setcurrentsection(self.checksection)
+		self.writeline('if ( execute == false )')
+		self.writeline('\treturn true;')
+		self.writeline('')
+		self.handleparameters(command, 'writereadchecks')
 
 		# If all is good, then execute the command
 		self.output.setcurrentsection(self.output.addsection(command.name + ' finish'))
 		self.writeline('command.Execute();')
-		self.endscope()
 		self.writeline('return true;')
-		self.unindent()
+		self.endscope()
 		self.writeline('')
 
-	def handleparameters(self, command, methodname, **args):
+	def handleparameters(self, command, methodname, layouts = (), beginlayout = None, **args):
 		'''
 			Writes code to handle a parameter.
 			The method is expected to take the arguments:
@@ -249,8 +414,13 @@ class SourceWriter(SourceCodeWriter):
 				- reference -- this is an expression string that refers to the actual parameter reference.
 			The method is expected to be a method of a SpecParameter subclass, and is expected to write code handling
 			recievement or sending of the parameter in question. Any extra parameters are also passed to the parameters.
+			The parameters of the fixed layouts are read or written directly from or to the data of their layout,
+			beginlayout is called with the size of the layout before its first parameter is handled.
 		'''
 		for parameter in command:
+			layout = next((layout for layout in layouts if any(parameter is member for member in layout[0])), None)
+			self.infixedlayout = layout is not None
+
 			# If the condition for this parameter changed, we need to handle that:
 			if parameter.condition != self.activecondition:
 				# If there was a condition, the if block needs to be closed before a new one can begin.
@@ -271,9 +441,16 @@ class SourceWriter(SourceCodeWriter):
 				# Mark down what our current condition is.
 				self.activecondition = parameter.condition
 
+			# Start the layout this parameter is the first of.
+			if layout and layout[0][0] is parameter:
+				self.fixedoffset = 0
+				beginlayout(layout[1])
+
 			# Now call the appropriate method.
 			getattr(parameter, methodname)(writer = self, command = command, reference = parameter.name, **args)
 
+		self.infixedlayout = False
+
 		# If we're still in an if-block, close it now.
 		if self.activecondition:
 			self.endscope()
@@ -307,8 +484,16 @@ class SourceWriter(SourceCodeWriter):
 		if command.unreliable:
 			self.writeline('command.setUnreliable( true );')
 
+		# Parameters of a fixed size are written into space reserved in one go.
+		layouts = self.getfixedlayouts(command)
+		if layouts:
+			self.writeline('BYTE *data;')
+
+		def beginlayout(size):
+			self.writeline('data = command.reserve( %d );' % size)
+
 		# Let parameters write their senders in.
-		self.handleparameters(command, 'writesend')
+		self.handleparameters(command, 'writesend', layouts = layouts, beginlayout = beginlayout)
 
 		# Return the finished command.
 		self.writeline('return command;')
@@ -343,8 +528,24 @@ class HeaderWriter(SourceCodeWriter):
 		self.writeline('')
 		self.writeline('bool CLIENT_ParseServerCommand( SVC header, BYTESTREAM_s *bytestream );')
 		self.writeline('bool CLIENT_ParseExtendedServerCommand( SVC2 header, BYTESTREAM_s *bytestream );')
+		self.writeline('bool CLIENT_SkipServerCommand( BYTESTREAM_s *bytestream );')
 		self.writeline('')
 
+		# The protocol test creates every command with random parameters.
+		self.writecontext('''
+			class FRandom;
+			namespace ServerCommands { class BaseServerCommand; }
+
+			struct ServerCommandTest
+			{
+				const char *name;
+				ServerCommands::BaseServerCommand *( *createRandom )( FRandom &random );
+			};
+
+			extern const ServerCommandTest g_ServerCommandTests[];
+			extern const unsigned int g_NumServerCommandTests;
+			''')
+
 		# Add a namespace, so that we don't pollute the global namespace with the server commands.
 		self.writeline('namespace ServerCommands')
 		self.startscope()
@@ -368,6 +569,7 @@ class HeaderWriter(SourceCodeWriter):
 			class BaseServerCommand
 			{
 			public:
+				virtual ~BaseServerCommand() {}
 				virtual void PrintMissingParameters() const = 0;
 				virtual bool AllParametersInitialized() const = 0;
 				virtual NetCommand BuildNetCommand() const = 0;
@@ -418,11 +620,8 @@ class HeaderWriter(SourceCodeWriter):
 			# Add the BuildNetCommand() method
 			self.writeline('NetCommand BuildNetCommand() const;')
 
-			# The parser function must be a friend of this command, so that it can fill in parameters.
-			if command.extended:
-				self.writeline('friend bool ::CLIENT_ParseExtendedServerCommand( SVC2, BYTESTREAM_s * );')
-			else:
-				self.writeline('friend bool ::CLIENT_ParseServerCommand( SVC, BYTESTREAM_s * );')
+			# Add the Parse() method, that reads the command and executes it unless told otherwise.
+			self.writeline('static bool Parse( BYTESTREAM_s *bytestream, bool execute );')
 
 			# This function returns true if all parameters are initialized.
 			self.writeline('bool AllParametersInitialized() const')
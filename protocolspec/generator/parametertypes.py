@@ -37,6 +37,9 @@ passbyvalue = {'int', 'unsigned int', 'short', 'unsigned short', 'long', 'unsign
 			   'BYTE', 'SBYTE', 'WORD', 'SWORD', 'DWORD', 'SDWORD', 'QWORD', 'SQWORD',
 			   'FName', 'fixed_t', 'angle_t', 'size_t'}
 
+# Sizes of the values that can be part of a fixed layout.
+fixedsizes = {'Byte': 1, 'Short': 2, 'Long': 4, 'Float': 4}
+
 def getParameterClass(typename):
 	'''
 	Returns a class representing a the given parameter type
@@ -74,6 +77,29 @@ class SpecParameter:
 	def writespecialmethods(self, **args):
 		pass
 
+	def writerandom(self, writer, assign):
+		'''
+		Writes code that creates a random value for this parameter for the protocol test. assign is a function that
+		turns the value expression into the statement that stores it.
+		'''
+		writer.writeline(assign(self.randomvalue()))
+
+	def randomvalue(self):
+		raise Exception('BUG: %s does not define randomvalue!' % type(self).__name__)
+
+	@property
+	def fixedsize(self):
+		'''
+		The number of bytes this parameter always takes, or None if its size depends on its value. Parameters with a
+		fixed size can be read and written with a single bounds check.
+		'''
+		return None
+
+	@property
+	def testtypename(self):
+		''' The type name of this parameter outside the ServerCommands namespace. '''
+		return self.cxxtypename
+
 	@property
 	def constreference(self):
 		if self.cxxtypename.endswith('*') or self.cxxtypename in passbyvalue:
@@ -94,13 +120,19 @@ class ByteParameter(SpecParameter):
 
 	# Writes code to read in this parameter.
 	def writeread(self, writer, command, reference):
-		readfunction = 'NETWORK_Read' + self.methodname()
-		writer.writeline('command.{reference} = {readfunction}( bytestream );'.format(**locals()))
+		value = writer.readvalue(self.methodname())
+		writer.writeline('command.{reference} = {value};'.format(**locals()))
 
 	# Writes code to write this parameter to a NetCommand.
 	def writesend(self, writer, command, reference):
-		sendmethod = 'command.add' + capwords(self.methodname())
-		writer.writeline('{sendmethod}( this->{reference} );'.format(**locals()))
+		writer.writevalue(self.methodname(), 'this->' + reference)
+
+	def randomvalue(self):
+		return 'static_cast<%s>( random.GenRand32() )' % self.cxxtypename
+
+	@property
+	def fixedsize(self):
+		return fixedsizes[self.methodname()]
 
 	# Returns the C++ type name for this parameter
 	@property
@@ -156,6 +188,9 @@ class StringParameter(SpecParameter):
 	def writesend(self, writer, command, reference, **args):
 		writer.writeline('command.addString( this->{reference} );'.format(**locals()))
 
+	def randomvalue(self):
+		return 'ServerCommandTest_RandomString( random )'
+
 # ----------------------------------------------------------------------------------------------------------------------
 
 class FloatParameter(SpecParameter):
@@ -164,10 +199,18 @@ class FloatParameter(SpecParameter):
 		self.cxxtypename = 'float'
 
 	def writeread(self, writer, command, reference, **args):
-		writer.writeline('command.{reference} = NETWORK_ReadFloat( bytestream );'.format(**locals()))
+		value = writer.readvalue('Float')
+		writer.writeline('command.{reference} = {value};'.format(**locals()))
 
 	def writesend(self, writer, command, reference, **args):
-		writer.writeline('command.addFloat( this->{reference} );'.format(**locals()))
+		writer.writevalue('Float', 'this->' + reference)
+
+	def randomvalue(self):
+		return 'static_cast<float>( random.GenRand_Real1() * 2048 - 1024 )'
+
+	@property
+	def fixedsize(self):
+		return fixedsizes['Float']
 
 # ----------------------------------------------------------------------------------------------------------------------
 
@@ -182,6 +225,9 @@ class BoolParameter(SpecParameter):
 	def writesend(self, writer, command, reference, **args):
 		writer.writecontext('command.addBit( this->{reference} );'.format(**locals()))
 
+	def randomvalue(self):
+		return '!!( random() & 1 )'
+
 # ----------------------------------------------------------------------------------------------------------------------
 
 class VariableParameter(SpecParameter):
@@ -195,6 +241,10 @@ class VariableParameter(SpecParameter):
 	def writesend(self, writer, command, reference, **args):
 		writer.writecontext('command.addVariable( this->{reference} );'.format(**locals()))
 
+	def randomvalue(self):
+		# Shift the value so that all encoded lengths are used.
+		return 'static_cast<int>( random.GenRand32() ) >> random( 32 )'
+
 # ----------------------------------------------------------------------------------------------------------------------
 
 class ShortbyteParameter(SpecParameter):
@@ -209,6 +259,9 @@ class ShortbyteParameter(SpecParameter):
 		specialization = self.specialization
 		writer.writecontext('command.addShortByte( this->{reference}, {specialization} );'.format(**locals()))
 
+	def randomvalue(self):
+		return 'random( 1 << %s )' % self.specialization
+
 # ----------------------------------------------------------------------------------------------------------------------
 
 class ActorParameter(SpecParameter):
@@ -234,7 +287,8 @@ class ActorParameter(SpecParameter):
 
 		# Write the code to read in the netid
 		writer.declare('int', netid)
-		writer.writeline('{netid} = NETWORK_ReadShort( bytestream );'.format(**locals()))
+		value = writer.readvalue('Short')
+		writer.writeline('{netid} = {value};'.format(**locals()))
 
 	def writereadchecks(self, writer, command, reference, **args):
 		netid = self.readnetid
@@ -250,7 +304,15 @@ class ActorParameter(SpecParameter):
 					   allownull=('nullallowed' in self.attributes) and 'true' or 'false', **locals()))
 
 	def writesend(self, writer, command, reference, **args):
-		writer.writeline('command.addShort( this->{reference} ? this->{reference}->lNetID : -1 );'.format(**locals()))
+		writer.writevalue('Short', 'this->{reference} ? this->{reference}->lNetID : -1'.format(**locals()))
+
+	def randomvalue(self):
+		# The protocol test has no actors to refer to.
+		return 'NULL'
+
+	@property
+	def fixedsize(self):
+		return fixedsizes['Short']
 
 # ----------------------------------------------------------------------------------------------------------------------
 
@@ -265,7 +327,8 @@ class ClassParameter(SpecParameter):
 		netid = next(writer.tempvar)
 		self.readnetid = netid
 		writer.declare('int', netid)
-		writer.writeline('{netid} = NETWORK_ReadShort( bytestream );'.format(**locals()))
+		value = writer.readvalue('Short')
+		writer.writeline('{netid} = {value};'.format(**locals()))
 		writer.writeline('command.{reference} = NETWORK_GetClassFromIdentification( {netid} );'.format(**locals()))
 
 		# If the class parameter is specialized, ensure that it is a descendant of the specified class.
@@ -294,7 +357,14 @@ class ClassParameter(SpecParameter):
 				'''.format(commandname = command.name, **locals()))
 
 	def writesend(self, writer, command, reference, **args):
-		writer.writeline('command.addShort( this->{reference} ? this->{reference}->getActorNetworkIndex() : -1 );'.format(**locals()))
+		writer.writevalue('Short', 'this->{reference} ? this->{reference}->getActorNetworkIndex() : -1'.format(**locals()))
+
+	def randomvalue(self):
+		return 'NULL'
+
+	@property
+	def fixedsize(self):
+		return fixedsizes['Short']
 
 # ----------------------------------------------------------------------------------------------------------------------
 
@@ -305,7 +375,8 @@ class PlayerParameter(SpecParameter):
 
 	def writeread(self, writer, command, reference, **args):
 		# Player self. We store both the index and a pointer to the player structure.
-		writer.writeline('command.{reference} = &players[NETWORK_ReadByte( bytestream )];'.format(**locals()))
+		value = writer.readvalue('Byte')
+		writer.writeline('command.{reference} = &players[{value}];'.format(**locals()))
 
 	def writereadchecks(self, writer, command, reference, **args):
 		playernumber = next(writer.tempvar)
@@ -331,7 +402,14 @@ class PlayerParameter(SpecParameter):
 			writer.writeline('')
 
 	def writesend(self, writer, command, reference, **args):
-		writer.writeline('command.addByte( this->{reference} - players );'.format(**locals()))
+		writer.writevalue('Byte', 'this->{reference} - players'.format(**locals()))
+
+	def randomvalue(self):
+		return '&players[random( MAXPLAYERS )]'
+
+	@property
+	def fixedsize(self):
+		return fixedsizes['Byte']
 
 # ----------------------------------------------------------------------------------------------------------------------
 
@@ -341,16 +419,20 @@ class Vector3Parameter(SpecParameter):
 		self.cxxtypename = 'FVector3'
 
 	def writeread(self, writer, command, reference, **args):
-		writer.writecontext('''
-			command.{reference}.X = NETWORK_ReadFloat( bytestream );
-			command.{reference}.Y = NETWORK_ReadFloat( bytestream );
-			command.{reference}.Z = NETWORK_ReadFloat( bytestream );'''.format(**locals()))
+		for axis in 'XYZ':
+			value = writer.readvalue('Float')
+			writer.writeline('command.{reference}.{axis} = {value};'.format(**locals()))
 
 	def writesend(self, writer, command, reference, **args):
-		writer.writecontext('''
-			command.addFloat( this->{reference}.X );
-			command.addFloat( this->{reference}.Y );
-			command.addFloat( this->{reference}.Z );'''.format(**locals()))
+		for axis in 'XYZ':
+			writer.writevalue('Float', 'this->{reference}.{axis}'.format(**locals()))
+
+	def randomvalue(self):
+		return 'FVector3( random.GenRand_Real1(), random.GenRand_Real1(), random.GenRand_Real1() )'
+
+	@property
+	def fixedsize(self):
+		return 3 * fixedsizes['Float']
 
 # ----------------------------------------------------------------------------------------------------------------------
 
@@ -360,10 +442,18 @@ class FixedParameter(SpecParameter):
 		self.cxxtypename = 'fixed_t'
 
 	def writeread(self, writer, command, reference, **args):
-		writer.writeline('command.{reference} = NETWORK_ReadLong( bytestream );'.format(**locals()))
+		value = writer.readvalue('Long')
+		writer.writeline('command.{reference} = {value};'.format(**locals()))
 
 	def writesend(self, writer, command, reference, **args):
-		writer.writeline('command.addLong( this->{reference} );'.format(**locals()))
+		writer.writevalue('Long', 'this->' + reference)
+
+	def randomvalue(self):
+		return 'static_cast<%s>( random.GenRand32() )' % self.cxxtypename
+
+	@property
+	def fixedsize(self):
+		return fixedsizes['Long']
 
 # ----------------------------------------------------------------------------------------------------------------------
 
@@ -373,10 +463,18 @@ class AproxfixedParameter(SpecParameter):
 		self.cxxtypename = 'fixed_t'
 
 	def writeread(self, writer, command, reference, **args):
-		writer.writeline('command.{reference} = NETWORK_ReadShort( bytestream ) << FRACBITS;'.format(**locals()))
+		value = writer.readvalue('Short')
+		writer.writeline('command.{reference} = {value} << FRACBITS;'.format(**locals()))
 
 	def writesend(self, writer, command, reference, **args):
-		writer.writeline('command.addShort( this->{reference} >> FRACBITS );'.format(**locals()))
+		writer.writevalue('Short', 'this->{reference} >> FRACBITS'.format(**locals()))
+
+	def randomvalue(self):
+		return 'static_cast<%s>( random.GenRand32() )' % self.cxxtypename
+
+	@property
+	def fixedsize(self):
+		return fixedsizes['Short']
 
 # ----------------------------------------------------------------------------------------------------------------------
 
@@ -410,7 +508,8 @@ class SectorParameter(SpecParameter):
 		resolvingFunction = self.resolvingFunction
 		self.indexVariable = indexVariable
 		writer.declare('int', indexVariable)
-		writer.writeline('{indexVariable} = NETWORK_Read{indexLength}( bytestream );'.format(**locals()))
+		value = writer.readvalue(indexLength)
+		writer.writeline('{indexVariable} = {value};'.format(**locals()))
 		writer.writeline('command.{reference} = {resolvingFunction}( {indexVariable} );'.format(**locals()))
 
 	def writereadchecks(self, writer, command, reference, **args):
@@ -431,7 +530,15 @@ class SectorParameter(SpecParameter):
 	def writesend(self, writer, command, reference, **args):
 		arrayName = self.arrayName
 		indexLength = self.indexLength
-		writer.writeline('command.add{indexLength}( this->{reference} ? this->{reference} - {arrayName} : -1 );'.format(**locals()))
+		writer.writevalue(indexLength, 'this->{reference} ? this->{reference} - {arrayName} : -1'.format(**locals()))
+
+	def randomvalue(self):
+		# The protocol test may run without a level.
+		return 'NULL'
+
+	@property
+	def fixedsize(self):
+		return fixedsizes[self.indexLength]
 
 # ----------------------------------------------------------------------------------------------------------------------
 
@@ -484,6 +591,24 @@ class StructParameter(SpecParameter):
 		for member, membername in self.iterateMembers(reference):
 			member.writereadchecks(reference = membername, **args)
 
+	def writerandom(self, writer, assign):
+		# Fill in a local structure member by member.
+		writer.startscope()
+		writer.writeline('%s value;' % self.testtypename)
+		for member in self.struct['members'].values():
+			member.writerandom(writer, lambda value, name = member.name: 'value.%s = %s;' % (name, value))
+		writer.writeline(assign('value'))
+		writer.endscope()
+
+	@property
+	def fixedsize(self):
+		sizes = [member.fixedsize for member in self.struct['members'].values()]
+		return None if None in sizes else sum(sizes)
+
+	@property
+	def testtypename(self):
+		return 'ServerCommands::%s' % self.struct['name']
+
 # ----------------------------------------------------------------------------------------------------------------------
 
 class ArrayParameter(SpecParameter):
@@ -523,6 +648,21 @@ class ArrayParameter(SpecParameter):
 		self.elementType.writereadchecks(writer = writer, reference = reference + '[i]', **args)
 		writer.endscope()
 
+	def writerandom(self, writer, assign):
+		# Fill in a local array with up to three random elements.
+		writer.startscope()
+		writer.writeline('%s elements;' % self.testtypename)
+		writer.writeline('for ( int i = random( 4 ); i > 0; --i )')
+		writer.startscope()
+		self.elementType.writerandom(writer, lambda value: 'elements.Push( %s );' % value)
+		writer.endscope()
+		writer.writeline(assign('elements'))
+		writer.endscope()
+
+	@property
+	def testtypename(self):
+		return 'TArray<%s>' % self.elementType.testtypename
+
 	def writespecialmethods(self, writer, **args):
 		# Add a method to push to this parameter.
 		writer.writeline('void PushTo{name}({type} value)'.format(
@@ -561,3 +701,7 @@ class NameParameter(SpecParameter):
 
 	def writesend(self, writer, command, reference, **args):
 		writer.writeline('command.addName( this->{reference} );'.format(**locals()))
+
+	def randomvalue(self):
+		# Use both a predefined and a custom name.
+		return '( random() & 1 ) ? FName( NAME_Actor ) : FName( "ProtocolTest" )'
@@ -601,21 +601,17 @@ enum EThingSpecialActivationType
 	THINGSPEC_Switch			= 1<<10,	// The thing is alternatively activated and deactivated when triggered
 };
 
-// [RH] Like msecnode_t, but for the blockmap
-struct FBlockNode
+// An entry of a blockmap cell. The entries of each cell are kept in the order
+// the actors were linked and are iterated from the most recently linked one.
+struct FBlockThing
 {
-	AActor *Me;						// actor this node references
-	int BlockIndex;					// index into blocklinks for the block this node is in
-	FBlockNode **PrevActor;			// previous actor in this block
-	FBlockNode *NextActor;			// next actor in this block
-	FBlockNode **PrevBlock;			// previous block this actor is in
-	FBlockNode *NextBlock;			// next block this actor is in
+	AActor *Me;						// actor this entry references
+};
 
-	static FBlockNode *Create (AActor *who, int x, int y);
-	void Release ();
+typedef TArray<FBlockThing> FBlockCell;
 
-	static FBlockNode *FreeBlocks;
-};
+// Number of FBlockThingsIterators that can use visit stamps at the same time.
+enum { NUM_BLOCKVISIT_SLOTS = 4 };
 
 class FDecalBase;
 class AInventory;
@@ -962,7 +958,9 @@ public:
 // interaction info
 	fixed_t			pitch;
 	angle_t			roll;	// This was fixed_t before, which is probably wrong
-	FBlockNode		*BlockNode;			// links in blocks (if needed)
+	bool			InBlockmap;			// linked into the blockmap cells below
+	int				BlockX1, BlockY1, BlockX2, BlockY2;
+	DWORD			BlockVisit[NUM_BLOCKVISIT_SLOTS];	// visit stamps of FBlockThingsIterator
 	struct sector_t	*Sector;
 	subsector_t *		subsector;
 	fixed_t			floorz, ceilingz;	// closest together of contacted secs
@@ -52,9 +52,13 @@
 #include <stdlib.h>
 
 #include "astar.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
 #include "doomstat.h"
+#include "g_level.h"
 #include "gi.h"
 #include "m_random.h"
+#include "network.h"
 #include "p_lnspec.h"
 #include "p_local.h"
 #include "p_trace.h"
@@ -63,54 +67,172 @@
 #include "botpath.h"
 #include "doomerrors.h"
 
+//*****************************************************************************
+//	STRUCTURES
+
+typedef struct
+{
+	double			dX;
+	double			dY;
+
+} ASTARVERTEX_t;
+
+//*****************************************************************************
+// The area covered by a subsector, as a convex polygon whose inside lies to the right
+// of its edges. Only used while building the graph.
+typedef struct
+{
+	ULONG			ulFirstVertex;
+	ULONG			ulNumVertices;
+
+} ASTARPOLYGON_t;
+
+//*****************************************************************************
+// A place where a bot can walk from one subsector into another. Only used while
+// building the graph.
+typedef struct
+{
+	ULONG			ulFrom;
+	ULONG			ulTo;
+
+	// Sum of the points on the shared boundary that can be crossed.
+	double			dX;
+	double			dY;
+	ULONG			ulNumPoints;
+
+} ASTARPORTAL_t;
+
+//*****************************************************************************
+// A pair of clusters connected by at least one portal. Only used while building the graph.
+typedef struct
+{
+	ULONG			ulFrom;
+	ULONG			ulTo;
+
+} ASTARCLUSTERLINK_t;
+
+//*****************************************************************************
+// The result of a completed search.
+typedef struct
+{
+	// What was searched for. Failed searches are only used for the same start node.
+	ASTARNODE_t		*pStartNode;
+	ASTARNODE_t		*pGoalNode;
+	bool			bAvoidDamage;
+	bool			bSuccess;
+
+	// The nodes of the path (the goal node first), and the cost from each of them to the goal.
+	TArray<ASTARNODE_t *>	Nodes;
+	TArray<LONG>	CostsToGoal;
+	LONG			lTotalCost;
+
+	// The tic this entry was stored or last used.
+	int				iTic;
+
+} ASTARCACHEENTRY_t;
+
+//*****************************************************************************
+typedef struct
+{
+	ULONG			ulNumQueries;
+	ULONG			ulNumFailed;
+	ULONG			ulNumCorridorFallbacks;
+	ULONG			ulNumSearchedNodes;
+	ULONG			ulNumTics;
+	ULONG			ulMaxTics;
+	double			dTotalMS;
+	double			dMaxMS;
+
+	ULONG			ulNumCacheHits;
+
+	// Number of tics the scheduler ran, the sum and maximum of the queue's length in these
+	// tics, and how often the budget was used up.
+	ULONG			ulNumSchedulerTics;
+	ULONG			ulQueueLengthSum;
+	ULONG			ulMaxQueueLength;
+	ULONG			ulNumBudgetExhausted;
+
+} ASTARQUERYSTATS_t;
+
 //*****************************************************************************
 //	VARIABLES
 
-static	LONG			g_lNumHorizontalNodes;
-static	LONG			g_lNumVerticalNodes;
-static	LONG			g_lMapXMin;
-static	LONG			g_lMapYMin;
-static	LONG			g_lMapXMax;
-static	LONG			g_lMapYMax;
-static	LONG			g_lNodeListSize;
+// The navigation graph. The first g_ulNumSubsectorNodes nodes are the centers of the
+// subsectors (in the same order as the subsectors), the portal nodes follow.
+static	TArray<ASTARNODE_t>		g_Nodes;
+static	TArray<ASTAREDGE_t>		g_Edges;
+static	ULONG					g_ulNumSubsectorNodes;
+
+// The high level graph.
+static	TArray<ASTARCLUSTER_t>	g_Clusters;
+static	TArray<ASTAREDGE_t>		g_ClusterEdges;
+
+// Number of cells the old 64 unit grid would have needed for this map.
+static	ULONG			g_ulNumGridCells;
+
 static	LONG			g_lNumSearchedNodes;
 static	cycle_t			g_PathingCycles;
-static	ASTARNODE_t		*g_aMasterNodeList = NULL;
-static	ULONG			g_ulPriorityQueuePosition[MAX_PATHS];
-static	ASTARNODE_t		**g_apOpenListPriorityQueue[MAX_PATHS];
+static	cycle_t			g_BuildCycles;
 static	ASTARPATH_t		g_aPaths[MAX_PATHS];
-static	LONG			g_lCurrentPathIdx;
+static	ULONG			g_ulLastSearchID;
+static	ASTARQUERYSTATS_t	g_QueryStats;
+
+// Indices of the paths whose search isn't complete yet, in the order they are served.
+static	TArray<ULONG>	g_PathQueue;
+
+// Number of nodes that may still be searched this tic.
+static	LONG			g_lTicBudget;
+
+static	ASTARCACHEENTRY_t	g_aPathCache[ASTAR_CACHE_SIZE];
 static	FRandom			g_RandomRoamSeed( "RoamSeed" );
 static	bool			g_bIsInitialized;
 
+//*****************************************************************************
+//	CONSOLE VARIABLES
+
+// Number of nodes the paths of all bots together may search per tic.
+CVAR( Int, bot_pathbudget, 4096, CVAR_ARCHIVE )
+
 //*****************************************************************************
 //	PROTOTYPES
 
-static	bool			astar_PathNextNode( ASTARPATH_t *pPath );
+static	void			astar_BuildPolygons( void *pChild, const TArray<ASTARVERTEX_t> &Polygon, TArray<ASTARVERTEX_t> &Vertices, TArray<ASTARPOLYGON_t> &Polygons );
+static	void			astar_ClipPolygon( const TArray<ASTARVERTEX_t> &In, double dX, double dY, double dDX, double dDY, TArray<ASTARVERTEX_t> &Out );
+static	bool			astar_IsPointInPolygon( const TArray<ASTARVERTEX_t> &Vertices, const ASTARPOLYGON_t &Polygon, double dX, double dY );
+static	void			astar_FindPortals( ULONG ulSubsector, const TArray<ASTARVERTEX_t> &Vertices, const TArray<ASTARPOLYGON_t> &Polygons, TArray<ASTARPORTAL_t> &Portals );
+static	line_t			*astar_GetBoundaryLine( ULONG ulSubsector, double dX, double dY );
+static	bool			astar_IsPotentialDoor( sector_t *pSector );
+static	void			astar_BuildClusters( const TArray<ULONG> &FirstPortal, const TArray<ASTARPORTAL_t> &Portals );
+static	void			astar_BuildClusterEdges( const TArray<ASTARPORTAL_t> &Portals );
+static	int STACK_ARGS	astar_CompareClusterLinks( const void *pA, const void *pB );
+static	LONG			astar_GetDistance( const POS_t &A, const POS_t &B );
+static	LONG			astar_GetSectorPenalty( sector_t *pSector );
 static	ASTARNODE_t		*astar_GetNodeFromPoint( POS_t Point );
-static	LONG			astar_GetCostToGoalEstimate( ASTARPATH_t *pPath, ASTARNODE_t *pNode );
-static	void			astar_PushNodeToStack( ASTARNODE_t *pNode, ASTARPATH_t *pPath );
-static	bool			astar_PullNodeFromOpenList( ASTARPATH_t *pPath );
-static	void			astar_ProcessNextPathNode( ASTARPATH_t *pPath, ASTARNODE_t *pNode, LONG lAddedCost, LONG lDirection );
-static	ASTARNODE_t		*astar_GetNode( LONG lXNodeIdx, LONG lYNodeIdx );
-static	void			astar_InsertToPriorityQueue( ASTARNODE_t *pNode );
-static	ASTARNODE_t		*astar_PopFromPriorityQueue( void );
-static	void			astar_FixUpPriorityQueue( ULONG ulPosition );
-static	void			astar_FixDownPriorityQueue( ULONG ulStartPosition, ULONG ulEndPosition );
-static	bool			astar_IsPriorityQueueEmpty( void );
-static	void			astar_Exchange( ASTARNODE_t **pNode1, ASTARNODE_t **pNode2 );
-static	ULONG			astar_GetTotalCost( ASTARNODE_t *pNode );
+static	ULONG			astar_GetNodeIndex( const ASTARNODE_t *pNode );
+static	ASTARSCRATCH_t	&astar_GetScratch( TArray<ASTARSCRATCH_t> &Scratch, ULONG ulIdx, ULONG ulSearchID );
+static	void			astar_BeginSearch( ASTARPATH_t *pPath );
+static	bool			astar_FindCorridor( ASTARPATH_t *pPath );
+static	void			astar_OpenStartNode( ASTARPATH_t *pPath );
+static	bool			astar_PathNextNode( ASTARPATH_t *pPath );
+static	void			astar_BuildNodeStack( ASTARPATH_t *pPath );
+static	void			astar_SmoothNodeStack( ASTARPATH_t *pPath );
+static	void			astar_ServePath( ASTARPATH_t *pPath );
+static	void			astar_RunSearch( ASTARPATH_t *pPath, LONG lMaxNodes );
+static	void			astar_FinishQuery( ASTARPATH_t *pPath );
+static	void			astar_Dequeue( ULONG ulPathIdx );
+static	bool			astar_LookUpCache( ASTARPATH_t *pPath );
+static	void			astar_StoreInCache( ASTARPATH_t *pPath );
+static	void			astar_Visualize( ASTARPATH_t *pPath, ULONG ulNode, ULONG ulFrame );
+static	void			astar_PushToOpenList( TArray<ASTAROPENENTRY_t> &OpenList, LONG lTotalCost, ULONG ulNode );
+static	ASTAROPENENTRY_t	astar_PopFromOpenList( TArray<ASTAROPENENTRY_t> &OpenList );
+static	ULONG			astar_GetGraphMemory( void );
+static	ULONG			astar_GetSearchMemory( void );
 
 //*****************************************************************************
 //	FUNCTIONS
 
 void ASTAR_Construct( void )
 {
-	ULONG	ulIdx;
-
-	for ( ulIdx = 0; ulIdx < MAX_PATHS; ulIdx++ )
-		g_apOpenListPriorityQueue[ulIdx] = NULL;
-
 	g_bIsInitialized = false;
 }
 
@@ -118,91 +240,164 @@ void ASTAR_Construct( void )
 //
 void ASTAR_BuildNodes( void )
 {
-	ULONG	ulIdx;
-	ULONG	ulIdx2;
-
-	g_lMapXMax = INT_MIN;
-	g_lMapYMax = INT_MIN;
+	TArray<ASTARVERTEX_t>	Vertices;
+	TArray<ASTARVERTEX_t>	MapBox;
+	TArray<ASTARPOLYGON_t>	Polygons;
+	TArray<ASTARPORTAL_t>	Portals;
+	TArray<ULONG>			FirstPortal;
+	ASTARVERTEX_t			Vertex;
+	double					dMinX;
+	double					dMinY;
+	double					dMaxX;
+	double					dMaxY;
+	ULONG					ulIdx;
+	ULONG					ulIdx2;
+
+	if ( g_bIsInitialized )
+		ASTAR_ClearNodes( );
+
+	g_BuildCycles.Reset( );
+	g_BuildCycles.Clock( );
+	memset( &g_QueryStats, 0, sizeof( g_QueryStats ));
+
+	if ( numsubsectors == 0 )
+	{
+		g_BuildCycles.Unclock( );
+		g_bIsInitialized = true;
+		return;
+	}
 
+	dMinX = dMinY = 32768.0;
+	dMaxX = dMaxY = -32768.0;
 	for ( ulIdx = 0; ulIdx < (ULONG)numvertexes; ulIdx++ )
 	{
-		if ( vertexes[ulIdx].x > g_lMapXMax )
-			g_lMapXMax = vertexes[ulIdx].x;
-    
-		if ( vertexes[ulIdx].y > g_lMapYMax )
-			g_lMapYMax = vertexes[ulIdx].y;
+		dMinX = MIN( dMinX, FIXED2DBL( vertexes[ulIdx].x ));
+		dMinY = MIN( dMinY, FIXED2DBL( vertexes[ulIdx].y ));
+		dMaxX = MAX( dMaxX, FIXED2DBL( vertexes[ulIdx].x ));
+		dMaxY = MAX( dMaxY, FIXED2DBL( vertexes[ulIdx].y ));
 	}
 
-	g_lMapXMin = bmaporgx;
-	g_lMapYMin = bmaporgy;
-
-//	g_lNumHorizontalNodes = ((( g_lMapXMax - g_lMapXMin ) / FRACUNIT ) / ASTAR_NODE_SIZE );
-//	g_lNumVerticalNodes = ((( g_lMapYMax - g_lMapYMin ) / FRACUNIT ) / ASTAR_NODE_SIZE );
-	g_lNumHorizontalNodes = ( g_lMapXMax >> ASTAR_NODE_SHIFT ) - ( g_lMapXMin >> ASTAR_NODE_SHIFT ) + 1;
-	g_lNumVerticalNodes = ( g_lMapYMax >> ASTAR_NODE_SHIFT ) - ( g_lMapYMin >> ASTAR_NODE_SHIFT ) + 1;
-
-	g_lNodeListSize = ( g_lNumHorizontalNodes * g_lNumVerticalNodes );
+	g_ulNumGridCells = static_cast<ULONG>(( dMaxX - dMinX ) / 64 + 1 ) * static_cast<ULONG>(( dMaxY - dMinY ) / 64 + 1 );
+
+	// Split the map's bounding box along the partition lines of the BSP tree. This
+	// gives the whole area of every subsector, also for nodes without minisegs.
+	dMinX -= 64;
+	dMinY -= 64;
+	dMaxX += 64;
+	dMaxY += 64;
+	Vertex.dX = dMinX; Vertex.dY = dMaxY; MapBox.Push( Vertex );
+	Vertex.dX = dMaxX; Vertex.dY = dMaxY; MapBox.Push( Vertex );
+	Vertex.dX = dMaxX; Vertex.dY = dMinY; MapBox.Push( Vertex );
+	Vertex.dX = dMinX; Vertex.dY = dMinY; MapBox.Push( Vertex );
+
+	Polygons.Resize( numsubsectors );
+	memset( &Polygons[0], 0, sizeof( ASTARPOLYGON_t ) * numsubsectors );
+	if ( numnodes == 0 )
+		astar_BuildPolygons( (BYTE *)subsectors + 1, MapBox, Vertices, Polygons );
+	else
+		astar_BuildPolygons( &nodes[numnodes - 1], MapBox, Vertices, Polygons );
 
-	// Allocate a bunch of nodes for the master node list. The size of the master node list
-	// is the maximum number of nodes per search: length * width.
-	// [BB] This is certainly more memory than we want to assign for the bots...
-	if ( sizeof ( ASTARNODE_t ) * g_lNodeListSize > INT_MAX )
+	// Find out where bots can walk from one subsector into another.
+	FirstPortal.Resize( numsubsectors + 1 );
+	for ( ulIdx = 0; ulIdx < (ULONG)numsubsectors; ulIdx++ )
 	{
-		Printf ( "Unable to allocate bot nodes. Disabling bots on this map.\n");
-		g_bIsInitialized = true;
-		return;
+		FirstPortal[ulIdx] = Portals.Size( );
+		astar_FindPortals( ulIdx, Vertices, Polygons, Portals );
 	}
-	g_aMasterNodeList = new ASTARNODE_t[g_lNodeListSize];
+	FirstPortal[numsubsectors] = Portals.Size( );
 
-	for ( ulIdx = 0; ulIdx < (ULONG)g_lNumHorizontalNodes; ulIdx++ )
+	// Create a node at the center of every subsector, and one for every portal.
+	g_ulNumSubsectorNodes = numsubsectors;
+	g_Nodes.Resize( numsubsectors + Portals.Size( ));
+	for ( ulIdx = 0; ulIdx < (ULONG)numsubsectors; ulIdx++ )
 	{
-		for ( ulIdx2 = 0; ulIdx2 < (ULONG)g_lNumVerticalNodes; ulIdx2++ )
+		const ASTARPOLYGON_t	&Polygon = Polygons[ulIdx];
+		ASTARNODE_t				&Node = g_Nodes[ulIdx];
+		double					dX = 0;
+		double					dY = 0;
+
+		if ( Polygon.ulNumVertices >= 3 )
+		{
+			for ( ulIdx2 = 0; ulIdx2 < Polygon.ulNumVertices; ulIdx2++ )
+			{
+				dX += Vertices[Polygon.ulFirstVertex + ulIdx2].dX;
+				dY += Vertices[Polygon.ulFirstVertex + ulIdx2].dY;
+			}
+			dX /= Polygon.ulNumVertices;
+			dY /= Polygon.ulNumVertices;
+		}
+		else
 		{
-			g_aMasterNodeList[( ulIdx * g_lNumVerticalNodes ) + ulIdx2].lXNodeIdx = ulIdx;
-			g_aMasterNodeList[( ulIdx * g_lNumVerticalNodes ) + ulIdx2].lYNodeIdx = ulIdx2;
-			g_aMasterNodeList[( ulIdx * g_lNumVerticalNodes ) + ulIdx2].Position = ASTAR_GetPositionFromIndex( ulIdx, ulIdx2 );
+			for ( ulIdx2 = 0; ulIdx2 < subsectors[ulIdx].numlines; ulIdx2++ )
+			{
+				dX += FIXED2DBL( subsectors[ulIdx].firstline[ulIdx2].v1->x );
+				dY += FIXED2DBL( subsectors[ulIdx].firstline[ulIdx2].v1->y );
+			}
+			dX /= MAX<ULONG>( subsectors[ulIdx].numlines, 1 );
+			dY /= MAX<ULONG>( subsectors[ulIdx].numlines, 1 );
 		}
+
+		Node.pSubsector = &subsectors[ulIdx];
+		Node.pSector = subsectors[ulIdx].sector;
+		Node.Position.x = FLOAT2FIXED( dX );
+		Node.Position.y = FLOAT2FIXED( dY );
+		Node.Position.z = Node.pSector->floorplane.ZatPoint( Node.Position.x, Node.Position.y );
 	}
 
-	for ( ulIdx = 0; ulIdx < (ULONG)g_lNodeListSize; ulIdx++ )
+	for ( ulIdx = 0; ulIdx < Portals.Size( ); ulIdx++ )
 	{
-		for ( ulIdx2 = 0; ulIdx2 < MAX_PATHS; ulIdx2++ )
-		{
-			g_aMasterNodeList[ulIdx].bOnClosed[ulIdx2] = false;
-			g_aMasterNodeList[ulIdx].bOnOpen[ulIdx2] = false;
-			g_aMasterNodeList[ulIdx].lCostFromStart[ulIdx2] = 0;
-			g_aMasterNodeList[ulIdx].lTotalCost[ulIdx2] = 0;
-			g_aMasterNodeList[ulIdx].pParent[ulIdx2] = NULL;
-		}
+		ASTARNODE_t		&Node = g_Nodes[g_ulNumSubsectorNodes + ulIdx];
+
+		Node.pSubsector = &subsectors[Portals[ulIdx].ulTo];
+		Node.pSector = Node.pSubsector->sector;
+		Node.Position.x = FLOAT2FIXED( Portals[ulIdx].dX / Portals[ulIdx].ulNumPoints );
+		Node.Position.y = FLOAT2FIXED( Portals[ulIdx].dY / Portals[ulIdx].ulNumPoints );
+		Node.Position.z = Node.pSector->floorplane.ZatPoint( Node.Position.x, Node.Position.y );
 	}
 
-	for ( ulIdx = 0; ulIdx < MAX_PATHS; ulIdx++ )
+	// Connect the nodes. From the center of a subsector, a bot can walk to every portal
+	// that leaves the subsector. After walking through a portal, it can walk to the
+	// center of the subsector it entered or through any of its portals.
+	for ( ulIdx = 0; ulIdx < g_Nodes.Size( ); ulIdx++ )
 	{
-		g_aPaths[ulIdx].bInGoalNode = false;
-		g_aPaths[ulIdx].lStackPos = 0;
-		g_aPaths[ulIdx].pActor = NULL;
-		g_aPaths[ulIdx].paVisualizations = (AActor **)M_Malloc( sizeof(AActor *) * g_lNodeListSize );
-		for ( ulIdx2 = 0; ulIdx2 < (ULONG)g_lNodeListSize; ulIdx2++ )
-			g_aPaths[ulIdx].paVisualizations[ulIdx2] = NULL;
-		g_aPaths[ulIdx].pCurrentNode = NULL;
-		g_aPaths[ulIdx].pStartNode = NULL;
-		g_aPaths[ulIdx].pGoalNode = NULL;
-		for ( ulIdx2 = 0; ulIdx2 < MAX_NODES_IN_PATH; ulIdx2++ )
-			g_aPaths[ulIdx].pNodeStack[ulIdx2] = NULL;
-		g_aPaths[ulIdx].ulFlags = 0;
-		g_aPaths[ulIdx].ulNextStep = 0;
-		g_aPaths[ulIdx].ulNumSearchedNodes = 0;
-
-		g_ulPriorityQueuePosition[ulIdx] = 0;
-		g_apOpenListPriorityQueue[ulIdx] = (ASTARNODE_t **)M_Malloc( sizeof(ASTARNODE_t *) * ( g_lNodeListSize + 1 ));
-		for ( ulIdx2 = 0; ulIdx2 < (ULONG)g_lNodeListSize; ulIdx2++ )
-			g_apOpenListPriorityQueue[ulIdx][ulIdx2] = NULL;
+		ASTARNODE_t		&Node = g_Nodes[ulIdx];
+		ULONG			ulSubsector = static_cast<ULONG>( Node.pSubsector - subsectors );
+		ASTAREDGE_t		Edge;
+
+		Node.ulFirstEdge = g_Edges.Size( );
+
+		if ( ulIdx >= g_ulNumSubsectorNodes )
+		{
+			Edge.ulTarget = ulSubsector;
+			Edge.lCost = MAX<LONG>( astar_GetDistance( Node.Position, g_Nodes[ulSubsector].Position ), 1 );
+			g_Edges.Push( Edge );
+		}
+
+		for ( ulIdx2 = FirstPortal[ulSubsector]; ulIdx2 < FirstPortal[ulSubsector + 1]; ulIdx2++ )
+		{
+			// Don't walk right back to where we came from.
+			if (( ulIdx >= g_ulNumSubsectorNodes ) && ( Portals[ulIdx2].ulTo == Portals[ulIdx - g_ulNumSubsectorNodes].ulFrom ))
+				continue;
+
+			Edge.ulTarget = g_ulNumSubsectorNodes + ulIdx2;
+			Edge.lCost = MAX<LONG>( astar_GetDistance( Node.Position, g_Nodes[Edge.ulTarget].Position ), 1 );
+			g_Edges.Push( Edge );
+		}
+
+		Node.ulNumEdges = g_Edges.Size( ) - Node.ulFirstEdge;
 	}
 
-	g_lNumSearchedNodes = 0;
+	astar_BuildClusters( FirstPortal, Portals );
+	astar_BuildClusterEdges( Portals );
+
+	g_Nodes.ShrinkToFit( );
+	g_Edges.ShrinkToFit( );
+	g_Clusters.ShrinkToFit( );
+	g_ClusterEdges.ShrinkToFit( );
 
-	g_lCurrentPathIdx = -1;
+	g_lNumSearchedNodes = 0;
 
+	g_BuildCycles.Unclock( );
 	g_bIsInitialized = true;
 }
 
@@ -212,19 +407,45 @@ void ASTAR_ClearNodes( void )
 {
 	ULONG	ulIdx;
 
-	delete[] g_aMasterNodeList;
-	g_aMasterNodeList = NULL;
+	g_Nodes.Clear( );
+	g_Nodes.ShrinkToFit( );
+	g_Edges.Clear( );
+	g_Edges.ShrinkToFit( );
+	g_Clusters.Clear( );
+	g_Clusters.ShrinkToFit( );
+	g_ClusterEdges.Clear( );
+	g_ClusterEdges.ShrinkToFit( );
+	g_ulNumSubsectorNodes = 0;
+	g_ulNumGridCells = 0;
+	g_PathQueue.Clear( );
+
+	for ( ulIdx = 0; ulIdx < ASTAR_CACHE_SIZE; ulIdx++ )
+	{
+		g_aPathCache[ulIdx].pGoalNode = NULL;
+		g_aPathCache[ulIdx].Nodes.Clear( );
+		g_aPathCache[ulIdx].CostsToGoal.Clear( );
+	}
 
+	// The search state is sized for this graph, so it has to go as well.
 	for ( ulIdx = 0; ulIdx < MAX_PATHS; ulIdx++ )
 	{
-		M_Free( g_apOpenListPriorityQueue[ulIdx] );
-		g_apOpenListPriorityQueue[ulIdx] = NULL;
-
-		M_Free( g_aPaths[ulIdx].paVisualizations );
-		g_aPaths[ulIdx].paVisualizations = NULL;
+		ASTARPATH_t	*pPath = &g_aPaths[ulIdx];
+
+		pPath->NodeStack.Clear( );
+		pPath->pCurrentNode = NULL;
+		pPath->pStartNode = NULL;
+		pPath->pGoalNode = NULL;
+		pPath->ulFlags = 0;
+		pPath->Scratch.Clear( );
+		pPath->Scratch.ShrinkToFit( );
+		pPath->ClusterScratch.Clear( );
+		pPath->ClusterScratch.ShrinkToFit( );
+		pPath->OpenList.Clear( );
+		pPath->OpenList.ShrinkToFit( );
+		pPath->Visualizations.Clear( );
+		pPath->Visualizations.ShrinkToFit( );
 	}
 
-	g_lNodeListSize = 0;
 	g_bIsInitialized = false;
 }
 
@@ -235,99 +456,107 @@ bool ASTAR_IsInitialized( void )
 	return ( g_bIsInitialized );
 }
 
+//*****************************************************************************
+//
+// Gives the searches in the queue their share of this tic's budget. Searches that got
+// some of it move to the end of the queue, so every one of them gets its turn.
+//
+void ASTAR_Tick( void )
+{
+	TArray<ULONG>	Served;
+	ULONG			ulIdx;
+
+	g_PathingCycles.Reset();
+	g_PathingCycles.Clock();
+	g_lNumSearchedNodes = 0;
+	g_lTicBudget = MAX<LONG>( bot_pathbudget, 1 );
+
+	g_QueryStats.ulNumSchedulerTics++;
+	g_QueryStats.ulQueueLengthSum += g_PathQueue.Size( );
+	g_QueryStats.ulMaxQueueLength = MAX<ULONG>( g_QueryStats.ulMaxQueueLength, g_PathQueue.Size( ));
+
+	ulIdx = 0;
+	while (( ulIdx < g_PathQueue.Size( )) && ( g_lTicBudget > 0 ))
+	{
+		const ULONG	ulPathIdx = g_PathQueue[ulIdx];
+		ASTARPATH_t	*pPath = &g_aPaths[ulPathIdx];
+
+		// The bot is gone (or has respawned) since it asked for the path.
+		if (( playeringame[ulPathIdx % MAXPLAYERS] == false ) || ( pPath->pActor == NULL ) || ( pPath->pActor != players[ulPathIdx % MAXPLAYERS].mo ))
+		{
+			ASTAR_ClearPath( ulPathIdx );
+			continue;
+		}
+
+		astar_ServePath( pPath );
+		if ( pPath->ulFlags & PF_COMPLETE )
+			g_PathQueue.Delete( ulIdx );
+		else
+			Served.Push( g_PathQueue[ulIdx++] );
+	}
+
+	if ( g_lTicBudget <= 0 )
+		g_QueryStats.ulNumBudgetExhausted++;
+
+	if ( Served.Size( ) > 0 )
+	{
+		g_PathQueue.Delete( 0, Served.Size( ));
+		for ( ulIdx = 0; ulIdx < Served.Size( ); ulIdx++ )
+			g_PathQueue.Push( Served[ulIdx] );
+	}
+
+	g_PathingCycles.Unclock();
+}
+
 //*****************************************************************************
 //
 ASTARRETURNSTRUCT_t ASTAR_Path( ULONG ulPathIdx, POS_t GoalPoint, float fMaxSearchNodes, LONG lGiveUpLimit )
 {
-//	ASTARNODE_t				*pStartNode;
 	ASTARRETURNSTRUCT_t		ReturnVal;
 	POS_t					StartPoint;
 	ASTARPATH_t				*pPath;
 
-	g_lCurrentPathIdx = ulPathIdx;
+	ReturnVal.bIsGoal = false;
+	ReturnVal.pNode = NULL;
+	ReturnVal.ulFlags = 0;
+	ReturnVal.lTotalCost = 0;
 
 	pPath = &g_aPaths[ulPathIdx];
 	pPath->pActor = players[ulPathIdx % MAXPLAYERS].mo;
 
 	StartPoint.x = pPath->pActor->x;
 	StartPoint.y = pPath->pActor->y;
+	StartPoint.z = pPath->pActor->z;
 
-	pPath->pGoalNode = astar_GetNodeFromPoint( GoalPoint );
-	if ( pPath->pGoalNode == NULL )
+	// Without a navigation graph (e.g. on maps that don't use bot nodes), there's
+	// nothing to path on.
+	if ( g_Nodes.Size( ) == 0 )
 	{
 		Printf( "WARNING! Cannot path to location: (%d, %d)\n", GoalPoint.x / FRACUNIT, GoalPoint.y / FRACUNIT );
-		ReturnVal.bIsGoal = false;
-		ReturnVal.pNode = NULL;
-		ReturnVal.ulFlags = 0;
-		ReturnVal.lTotalCost = 0;
-
 		return ( ReturnVal );
 	}
 
+	pPath->pGoalNode = astar_GetNodeFromPoint( GoalPoint );
 	pPath->pStartNode = astar_GetNodeFromPoint( StartPoint );
-	if ( pPath->pStartNode == NULL )
-	{
-		// [BB] The bot spawned outside the map. This really should NOT happen.
-		// But if it does, we have to do something about it, otherwise ST will
-		// crash. So we kill the bot and hope he respawns inside the level.
-		Printf( "WARNING! Cannot find start point: (%d, %d)\n", StartPoint.x / FRACUNIT, StartPoint.y / FRACUNIT );
-		ReturnVal.bIsGoal = false;
-		ReturnVal.pNode = NULL;
-		ReturnVal.ulFlags = 0;
-		ReturnVal.lTotalCost = 0;
-
-		pPath->pActor->Die(NULL, NULL);
-		return ( ReturnVal );
-	}
-
-//	ASTAR_ClearPath( pPath );
 
 	// Has the path has already been built? If so, simply return the next node on the path.
 	if ( pPath->ulFlags & PF_COMPLETE )
 	{
-//		POS_t			CurPos;
 		POS_t			DestPos;
-//		sector_t		*pSector;
-//		fixed_t			vx;
-//		fixed_t			vy;
-//		fixed_t			vz;
-//		fixed_t			Angle;
-//		fixed_t			Pitch;
-//		FTraceResults	TraceResults;
 		ULONG			ulResults;
 
-//		CurPos.x = pPath->pActor->x;
-//		CurPos.y = pPath->pActor->y;
-//		CurPos.z = pPath->pActor->z;
+		if (( pPath->ulFlags & PF_SUCCESS ) == false )
+		{
+			ReturnVal.ulFlags = pPath->ulFlags;
+			return ( ReturnVal );
+		}
 
-		if ( pPath->lStackPos <= 0 )
+		if ( pPath->NodeStack.Size( ) == 0 )
 			I_Error( "ASTAR_Path: Bot pathing stack position went below 0!" );
 
-		DestPos = pPath->pNodeStack[pPath->lStackPos - 1]->Position;
-//		pSector = pPath->pActor->Sector;
-
-//		Angle = R_PointToAngle2( CurPos.x, CurPos.y, DestPos.x, DestPos.y ) >> ANGLETOFINESHIFT;
-//		Pitch = 0;
-
-//		vx = FixedMul( finecosine[Pitch], finecosine[Angle] );
-//		vy = FixedMul( finecosine[Pitch], finesine[Angle] );
-//		vz = finesine[Pitch];
+		DestPos = pPath->NodeStack.Last( )->Position;
 
 		// If we for some reason cannot reach the next node in our goal, we need to repath.
-/*
-		if ( Trace( CurPos.x,
-			CurPos.y,
-			pSector->floorplane.ZatPoint( CurPos.x, CurPos.y ) + gameinfo.StepHeight,
-			pSector,
-			vx,
-			vy,
-			vz,
-			ASTAR_NODE_SIZE * FRACUNIT,
-			MF_SOLID|MF_SHOOTABLE,
-			0,
-			pPath->pActor,
-			TraceResults ))
-*/
 		ulResults = BOTPATH_TryWalk( pPath->pActor, pPath->pActor->x, pPath->pActor->y, pPath->pActor->z, DestPos.x, DestPos.y );
 		if ( ulResults & BOTPATH_OBSTRUCTED )
 		{
@@ -337,15 +566,11 @@ ASTARRETURNSTRUCT_t ASTAR_Path( ULONG ulPathIdx, POS_t GoalPoint, float fMaxSear
 			{
 				pPath->pActor->player->pSkullBot->m_ulPathType = BOTPATHTYPE_NONE;
 
-				ReturnVal.bIsGoal = false;
-				ReturnVal.lTotalCost = 0;
-				ReturnVal.pNode = NULL;
 				ReturnVal.ulFlags = PF_COMPLETE;
-
 				return ( ReturnVal );
 			}
 
-			ASTAR_ClearPath( g_lCurrentPathIdx );
+			ASTAR_ClearPath( ulPathIdx );
 
 			// Retain a few things.
 			pPath->pActor = players[ulPathIdx % MAXPLAYERS].mo;
@@ -354,44 +579,26 @@ ASTARRETURNSTRUCT_t ASTAR_Path( ULONG ulPathIdx, POS_t GoalPoint, float fMaxSear
 		}
 		else
 		{
-			// If we've reached the node we've been heading to, it's time to pop a new node
-			// off the stack.
-			if ( pPath->pStartNode == pPath->pNodeStack[pPath->lStackPos - 1] )
+			// If we've reached the node we've been heading to (we're in the subsector it
+			// leads into), it's time to pop a new node off the stack.
+			if ( pPath->pStartNode->pSubsector == pPath->NodeStack.Last( )->pSubsector )
 			{
 				// If there is no new node to pop, this must be the goal node.
-				if ( pPath->lStackPos == 1 )
-				{
-					ReturnVal.pNode = pPath->pNodeStack[pPath->lStackPos - 1];
+				if ( pPath->NodeStack.Size( ) == 1 )
 					ReturnVal.bIsGoal = true;
-				}
 				else
-				{
-					pPath->lStackPos--;
-					ReturnVal.pNode = pPath->pNodeStack[pPath->lStackPos - 1];
-					ReturnVal.bIsGoal = false;
-				}
-			}
-			else
-			{
-				ReturnVal.pNode = pPath->pNodeStack[pPath->lStackPos - 1];
-				ReturnVal.bIsGoal = false;
+					pPath->NodeStack.Pop( );
 			}
 
+			ReturnVal.pNode = pPath->NodeStack.Last( );
 			ReturnVal.ulFlags = pPath->ulFlags;
-			ReturnVal.lTotalCost = pPath->pGoalNode->lTotalCost[g_lCurrentPathIdx];
-
-//			unclock( g_PathingCycles );
+			ReturnVal.lTotalCost = pPath->lTotalCost;
 			return ( ReturnVal );
 		}
 	}
 
-	g_PathingCycles.Reset();
-
 	g_PathingCycles.Clock();
 
-	// Begin the pathing process.
-	g_lNumSearchedNodes = 0;
-
 	// If the path has not been initialized, we need to set some things up.
 	if (( pPath->ulFlags & PF_INITIALIZED ) == false )
 	{
@@ -403,70 +610,61 @@ ASTARRETURNSTRUCT_t ASTAR_Path( ULONG ulPathIdx, POS_t GoalPoint, float fMaxSear
 			pSubSector = R_PointInSubsector( GoalPoint.x, GoalPoint.y );
 			if (( GoalPoint.z - pSubSector->sector->floorplane.ZatPoint( GoalPoint.x, GoalPoint.y )) > (( 36 * FRACUNIT ) + pPath->pActor->height ))
 			{
-				ReturnVal.bIsGoal = false;
-				ReturnVal.lTotalCost = 0;
-				ReturnVal.pNode = NULL;
 				ReturnVal.ulFlags = PF_COMPLETE;
 
+				g_PathingCycles.Unclock();
 				return ( ReturnVal );
 			}
 		}
 
-		// Estimate the total cost to the goal from this node.
-		pPath->pStartNode->lCostFromStart[g_lCurrentPathIdx] = 0;
-		pPath->pStartNode->lTotalCost[g_lCurrentPathIdx] = pPath->pStartNode->lCostFromStart[g_lCurrentPathIdx] + astar_GetCostToGoalEstimate( pPath, pPath->pStartNode );
-
-		// The start node does not have a parent.
-		pPath->pStartNode->pParent[g_lCurrentPathIdx] = NULL;
-
-		// Put this node on the open list.
-		pPath->pStartNode->bOnOpen[g_lCurrentPathIdx] = true;
-		astar_InsertToPriorityQueue( pPath->pStartNode );
-
-		pPath->pStartNode->bOnClosed[g_lCurrentPathIdx] = false;
-		pPath->pStartNode->lDirection[g_lCurrentPathIdx] = 0;
-//		pPath->pStartNode->ulFlags[g_lCurrentPathIdx] = 0;
-
-		// The first thing to do in our pathing algorithm is pull a node from the open list.
-		pPath->ulNextStep = ASTAR_NS_PULLFROMOPENLIST;
-
-		// All done!
 		pPath->ulFlags |= PF_INITIALIZED;
+		pPath->bAvoidDamage = ( pPath->pActor->player->pSkullBot->m_ulPathType == BOTPATHTYPE_ROAM );
+		pPath->bFromCache = false;
+		pPath->fMaxSearchNodes = fMaxSearchNodes;
+		pPath->lGiveUpLimit = lGiveUpLimit;
+		pPath->SearchCycles.Reset( );
+		pPath->iSearchStartTic = gametic;
+		pPath->SearchCycles.Clock( );
 
 		// The VERY first thing we can do is test to see if there's a straight path betwen the
 		// bot and his goal.
 		if (( BOTPATH_TryWalk( pPath->pActor, pPath->pActor->x, pPath->pActor->y, pPath->pActor->z, GoalPoint.x, GoalPoint.y ) & (BOTPATH_OBSTRUCTED|BOTPATH_DAMAGINGSECTOR)) == false )
 		{
 			pPath->ulFlags |= PF_COMPLETE|PF_SUCCESS;
-			astar_PushNodeToStack( pPath->pGoalNode, pPath );
-
-			ReturnVal.bIsGoal = true;
-			ReturnVal.lTotalCost = P_AproxDistance( pPath->pActor->x - GoalPoint.x, pPath->pActor->y - GoalPoint.y );
-			ReturnVal.pNode = pPath->pGoalNode;
-			ReturnVal.ulFlags = pPath->ulFlags;
-
-			g_PathingCycles.Unclock();
-			return ( ReturnVal );
+			pPath->NodeStack.Push( pPath->pGoalNode );
+			pPath->lTotalCost = astar_GetDistance( StartPoint, GoalPoint );
+			pPath->ulSearchID = 0;
 		}
-	}
-
-	if (( fMaxSearchNodes > 0 ) && ( fMaxSearchNodes < 1 ))
-	{
-		if (( gametic % (LONG)( 1.0f / fMaxSearchNodes )) == 0 )
-			astar_PathNextNode( pPath );
-	}
-	else
-	{
-		while ( astar_PathNextNode( pPath ) == false )
+		// Maybe this path (or one going through the bot's subsector) has been searched recently.
+		else if ( astar_LookUpCache( pPath ) == false )
 		{
-			if (( fMaxSearchNodes > 0 ) && ( g_lNumSearchedNodes >= fMaxSearchNodes ))
-				break;
+			// Find the clusters the path has to go through first. If there aren't any, the
+			// goal can't be reached.
+			astar_BeginSearch( pPath );
+			pPath->bInCorridor = astar_FindCorridor( pPath );
+			if ( pPath->bInCorridor )
+				astar_OpenStartNode( pPath );
+			else
+				pPath->ulFlags |= PF_COMPLETE;
+		}
+
+		pPath->SearchCycles.Unclock( );
 
-			if (( lGiveUpLimit > 0 ) && ( pPath->ulNumSearchedNodes >= (ULONG)lGiveUpLimit ))
+		if ( pPath->ulFlags & PF_COMPLETE )
+			astar_FinishQuery( pPath );
+		// A search without a limit has to be finished right away.
+		else if ( fMaxSearchNodes == 0 )
+			astar_RunSearch( pPath, 0 );
+		// Otherwise, the search joins the queue. If there's some budget left in this tic,
+		// it can start right away.
+		else
+		{
+			g_PathQueue.Push( ulPathIdx );
+			if ( g_lTicBudget > 0 )
 			{
-				// We've exceeded the give up limit. So, label the path as complete.
-				pPath->ulFlags |= PF_COMPLETE;
-				break;
+				astar_ServePath( pPath );
+				if ( pPath->ulFlags & PF_COMPLETE )
+					astar_Dequeue( ulPathIdx );
 			}
 		}
 	}
@@ -474,27 +672,12 @@ ASTARRETURNSTRUCT_t ASTAR_Path( ULONG ulPathIdx, POS_t GoalPoint, float fMaxSear
 	ReturnVal.ulFlags = pPath->ulFlags;
 	if ( pPath->ulFlags & PF_COMPLETE )
 	{
-		 if ( pPath->ulFlags & PF_SUCCESS )
-		 {
-			// We have not yet completed a path to the goal.
-			ReturnVal.pNode = pPath->pNodeStack[pPath->lStackPos - 1];
-			ReturnVal.bIsGoal = false;
-			ReturnVal.lTotalCost = pPath->pGoalNode->lTotalCost[g_lCurrentPathIdx];
-		 }
-		 // Were not able to find a path.
-		 else
-		 {
-			ReturnVal.pNode = NULL;
-			ReturnVal.bIsGoal = false;
-			ReturnVal.lTotalCost = 0;
-		 }
-	}
-	else
-	{
-		// We have not yet completed a path to the goal.
-		ReturnVal.pNode = NULL;
-		ReturnVal.bIsGoal = false;
-		ReturnVal.lTotalCost = 0;
+		if ( pPath->ulFlags & PF_SUCCESS )
+		{
+			ReturnVal.pNode = pPath->NodeStack.Last( );
+			ReturnVal.bIsGoal = ( pPath->NodeStack.Size( ) == 1 ) && ( pPath->pStartNode->pSubsector == ReturnVal.pNode->pSubsector );
+			ReturnVal.lTotalCost = pPath->lTotalCost;
+		}
 	}
 
 	g_PathingCycles.Unclock();
@@ -505,29 +688,7 @@ ASTARRETURNSTRUCT_t ASTAR_Path( ULONG ulPathIdx, POS_t GoalPoint, float fMaxSear
 //
 POS_t ASTAR_GetPosition( ASTARNODE_t *pNode )
 {
-	POS_t	Position;
-
-//	pNode->lXNodeIdx << ASTAR_NODE_SHIFT + (( g_lMapXMin >> ASTAR_NODE_SHIFT ) << ASTAR_NODE_SHIFT )
-//	Position.x = ( pNode->lXNodeIdx << ASTAR_NODE_SHIFT ) + (((( g_lMapXMin / FRACUNIT ) / 64 ) * 64 ) * FRACUNIT ) + ( 32 << FRACBITS );
-//	Position.y = ( pNode->lYNodeIdx << ASTAR_NODE_SHIFT ) + (((( g_lMapYMin / FRACUNIT ) / 64 ) * 64 ) * FRACUNIT ) + ( 32 << FRACBITS );
-	Position.x = ( pNode->lXNodeIdx << ASTAR_NODE_SHIFT ) + (( g_lMapXMin >> ASTAR_NODE_SHIFT ) << ASTAR_NODE_SHIFT ) + ( 32 << FRACBITS );
-	Position.y = ( pNode->lYNodeIdx << ASTAR_NODE_SHIFT ) + (( g_lMapYMin >> ASTAR_NODE_SHIFT ) << ASTAR_NODE_SHIFT ) + ( 32 << FRACBITS );
-	Position.z = 0;
-
-	return ( Position );
-}
-
-//*****************************************************************************
-//
-POS_t ASTAR_GetPositionFromIndex( LONG lXIdx, LONG lYIdx )
-{
-	POS_t	Position;
-
-	Position.x = ( lXIdx << ASTAR_NODE_SHIFT ) + (( g_lMapXMin >> ASTAR_NODE_SHIFT ) << ASTAR_NODE_SHIFT ) + ( 32 << FRACBITS );
-	Position.y = ( lYIdx << ASTAR_NODE_SHIFT ) + (( g_lMapYMin >> ASTAR_NODE_SHIFT ) << ASTAR_NODE_SHIFT ) + ( 32 << FRACBITS );
-	Position.z = 0;
-
-	return ( Position );
+	return ( pNode->Position );
 }
 
 //*****************************************************************************
@@ -539,12 +700,12 @@ void ASTAR_ClearVisualizations( void )
 
 	for ( ulIdx = 0; ulIdx < MAX_PATHS; ulIdx++ )
 	{
-		for ( ulIdx2 = 0; ulIdx2 < (ULONG)g_lNodeListSize; ulIdx2++ )
+		for ( ulIdx2 = 0; ulIdx2 < g_aPaths[ulIdx].Visualizations.Size( ); ulIdx2++ )
 		{
-			if ( g_aPaths[ulIdx].paVisualizations[ulIdx2] != NULL )
+			if ( g_aPaths[ulIdx].Visualizations[ulIdx2] != NULL )
 			{
-				g_aPaths[ulIdx].paVisualizations[ulIdx2]->Destroy( );
-				g_aPaths[ulIdx].paVisualizations[ulIdx2] = NULL;
+				g_aPaths[ulIdx].Visualizations[ulIdx2]->Destroy( );
+				g_aPaths[ulIdx].Visualizations[ulIdx2] = NULL;
 			}
 		}
 	}
@@ -554,24 +715,26 @@ void ASTAR_ClearVisualizations( void )
 //
 void ASTAR_ShowCosts( POS_t Position )
 {
-	ASTARNODE_t	*pNode;
+	ASTARNODE_t		*pNode;
+	ASTARPATH_t		*pPath;
+	ULONG			ulNode;
 
 	pNode = astar_GetNodeFromPoint( Position );
 
 	if ( pNode )
 	{
-		Printf( "(%d, %d) (%s)\n", static_cast<int> (pNode->lXNodeIdx), static_cast<int> (pNode->lYNodeIdx), pNode->lDirection[1] == 0 ? "N" :
-			pNode->lDirection[1] == 1 ? "NE" : 
-			pNode->lDirection[1] == 2 ? "E" : 
-			pNode->lDirection[1] == 3 ? "SE" : 
-			pNode->lDirection[1] == 4 ? "S" : 
-			pNode->lDirection[1] == 5 ? "SW" : 
-			pNode->lDirection[1] == 6 ? "W" : 
-			pNode->lDirection[1] == 7 ? "NW" : "UNKNOWN"
-		);
-		Printf( "From start (g): %d\n", static_cast<int> (pNode->lCostFromStart[1]) );
-		Printf( "From goal (h): %d\n", static_cast<int> (pNode->lTotalCost[1] - pNode->lCostFromStart[1]) );
-		Printf( "Total (f): %d\n", static_cast<int> (pNode->lTotalCost[1]) );
+		ulNode = astar_GetNodeIndex( pNode );
+		pPath = &g_aPaths[1];
+
+		Printf( "Subsector %d (cluster %d, %d edges)\n", static_cast<int> (ulNode), static_cast<int> (pNode->ulCluster), static_cast<int> (pNode->ulNumEdges) );
+		if (( pPath->ulSearchID != 0 ) && ( ulNode < pPath->Scratch.Size( )) && ( pPath->Scratch[ulNode].ulSearchID == pPath->ulSearchID ))
+		{
+			const ASTARSCRATCH_t	&Scratch = pPath->Scratch[ulNode];
+
+			Printf( "From start (g): %d\n", static_cast<int> (Scratch.lCostFromStart) );
+			Printf( "From goal (h): %d\n", static_cast<int> (Scratch.lTotalCost - Scratch.lCostFromStart) );
+			Printf( "Total (f): %d\n", static_cast<int> (Scratch.lTotalCost) );
+		}
 	}
 }
 
@@ -579,619 +742,1175 @@ void ASTAR_ShowCosts( POS_t Position )
 //
 void ASTAR_ClearPath( LONG lPathIdx )
 {
-	ULONG	ulIdx;
-
-	g_ulPriorityQueuePosition[lPathIdx] = 0;
+	ASTARPATH_t	*pPath = &g_aPaths[lPathIdx];
+	ULONG		ulIdx;
 
-	g_aPaths[lPathIdx].bInGoalNode = false;
-	g_aPaths[lPathIdx].lStackPos = 0;
-	g_aPaths[lPathIdx].pActor = NULL;
-	for ( ulIdx = 0; ulIdx < (ULONG)g_lNodeListSize; ulIdx++ )
+	pPath->pActor = NULL;
+	for ( ulIdx = 0; ulIdx < pPath->Visualizations.Size( ); ulIdx++ )
 	{
-		if ( g_aPaths[lPathIdx].paVisualizations[ulIdx] != NULL )
+		if ( pPath->Visualizations[ulIdx] != NULL )
 		{
-			g_aPaths[lPathIdx].paVisualizations[ulIdx]->Destroy( );
-			g_aPaths[lPathIdx].paVisualizations[ulIdx] = NULL;
+			pPath->Visualizations[ulIdx]->Destroy( );
+			pPath->Visualizations[ulIdx] = NULL;
 		}
-
-		g_apOpenListPriorityQueue[lPathIdx][ulIdx] = NULL;
-
-		g_aMasterNodeList[ulIdx].bOnClosed[lPathIdx] = false;
-		g_aMasterNodeList[ulIdx].bOnOpen[lPathIdx] = false;
-		g_aMasterNodeList[ulIdx].lCostFromStart[lPathIdx] = 0;
-		g_aMasterNodeList[ulIdx].lTotalCost[lPathIdx] = 0;
-		g_aMasterNodeList[ulIdx].pParent[lPathIdx] = NULL;
 	}
-	g_aPaths[lPathIdx].pCurrentNode = NULL;
-	g_aPaths[lPathIdx].pStartNode = NULL;
-	g_aPaths[lPathIdx].pGoalNode = NULL;
-	for ( ulIdx = 0; ulIdx < MAX_NODES_IN_PATH; ulIdx++ )
-		g_aPaths[lPathIdx].pNodeStack[ulIdx] = NULL;
-	g_aPaths[lPathIdx].ulFlags = 0;
-	g_aPaths[lPathIdx].ulNextStep = 0;
-	g_aPaths[lPathIdx].ulNumSearchedNodes = 0;
+
+	pPath->NodeStack.Clear( );
+	pPath->OpenList.Clear( );
+	pPath->pCurrentNode = NULL;
+	pPath->pStartNode = NULL;
+	pPath->pGoalNode = NULL;
+	pPath->ulFlags = 0;
+	pPath->ulNumSearchedNodes = 0;
+	pPath->lTotalCost = 0;
+	pPath->bInCorridor = false;
+	pPath->bLeftCorridor = false;
+	astar_Dequeue( lPathIdx );
 }
 
 //*****************************************************************************
 //
 void ASTAR_SelectRandomMapLocation( POS_t *pPos, fixed_t X, fixed_t Y )
 {
-	LONG	lXIdx;
-	LONG	lYIdx;
-	LONG	lXNode;
-	LONG	lYNode;
+	POS_t	Origin;
+	ULONG	ulNode = 0;
+	ULONG	ulTry;
+	LONG	lDistance;
 
-	lXNode = ( X >> ASTAR_NODE_SHIFT ) - ( g_lMapXMin >> ASTAR_NODE_SHIFT );
-	lYNode = ( Y >> ASTAR_NODE_SHIFT ) - ( g_lMapYMin >> ASTAR_NODE_SHIFT );
+	Origin.x = X;
+	Origin.y = Y;
+	Origin.z = 0;
 
-	if ( g_lNumHorizontalNodes <= 3 )
-	{
-		do
-		{
-			lXIdx = g_RandomRoamSeed ( g_lNumHorizontalNodes );
-		} while ( labs( lXNode - lXIdx ) > 8 );
-	}
-	else
+	if ( g_ulNumSubsectorNodes == 0 )
 	{
-		do
-		{
-			lXIdx = g_RandomRoamSeed ( g_lNumHorizontalNodes );
-		} while (( labs( lXNode - lXIdx ) > 8 ) || ( labs( lXNode - lXIdx ) < 2 ));
+		*pPos = Origin;
+		return;
 	}
 
-	if ( g_lNumVerticalNodes <= 3 )
-	{
-		do
-		{
-			lYIdx = g_RandomRoamSeed ( g_lNumVerticalNodes );
-		} while ( labs( lYNode - lYIdx ) > 8 );
-	}
-	else
+	// Pick the center of a subsector that's between 128 and 512 units away, and that
+	// can be left (otherwise it's probably not part of the playable area).
+	for ( ulTry = 0; ulTry < 32; ulTry++ )
 	{
-		do
-		{
-			lYIdx = g_RandomRoamSeed ( g_lNumVerticalNodes );
-		} while (( labs( lYNode - lYIdx ) > 8 ) || ( labs( lYNode - lYIdx ) < 2 ));
+		ulNode = g_RandomRoamSeed( g_ulNumSubsectorNodes );
+		lDistance = astar_GetDistance( g_Nodes[ulNode].Position, Origin );
+
+		if (( g_Nodes[ulNode].ulNumEdges > 0 ) && ( lDistance >= 128 ) && ( lDistance <= 512 ))
+			break;
 	}
 
-	*pPos = ASTAR_GetPositionFromIndex( lXIdx, lYIdx );
+	*pPos = g_Nodes[ulNode].Position;
 }
 
 //*****************************************************************************
 //*****************************************************************************
 //
-static bool astar_PathNextNode( ASTARPATH_t *pPath )
+// Clips the polygon (or in case of a subsector, the segs) in the BSP tree node pChild
+// by the partition lines below it, and stores the resulting polygons of all subsectors.
+//
+static void astar_BuildPolygons( void *pChild, const TArray<ASTARVERTEX_t> &Polygon, TArray<ASTARVERTEX_t> &Vertices, TArray<ASTARPOLYGON_t> &Polygons )
 {
-	ASTARNODE_t		*pNewNode;
-	LONG			lAddedCost;
-
-	g_lNumSearchedNodes++;
-	pPath->ulNumSearchedNodes++;
+	TArray<ASTARVERTEX_t>	Clipped;
 
-	// First, determine the next step.
-	switch ( pPath->ulNextStep )
+	if (( size_t )pChild & 1 )
 	{
-	case ASTAR_NS_PULLFROMOPENLIST:
-
-		if ( astar_PullNodeFromOpenList( pPath ))
-			return ( true );
-
-		pPath->ulNextStep = ASTAR_NS_LOOKABOVE;
-		break;
-	case ASTAR_NS_LOOKABOVE:
-
-		pNewNode = astar_GetNode( pPath->pCurrentNode->lXNodeIdx, pPath->pCurrentNode->lYNodeIdx + 1 );
-		lAddedCost = 64;
-
-		astar_ProcessNextPathNode( pPath, pNewNode, lAddedCost, 0 );
-
-		pPath->ulNextStep = ASTAR_NS_LOOKABOVEFORWARD;
-		break;
-	case ASTAR_NS_LOOKABOVEFORWARD:
-
-		pNewNode = astar_GetNode( pPath->pCurrentNode->lXNodeIdx + 1, pPath->pCurrentNode->lYNodeIdx + 1 );
-		lAddedCost = 91;
-
-		astar_ProcessNextPathNode( pPath, pNewNode, lAddedCost, 1 );
-
-		pPath->ulNextStep = ASTAR_NS_LOOKFORWARD;
-		break;
-	case ASTAR_NS_LOOKFORWARD:
+		subsector_t				*pSubsector = (subsector_t *)((BYTE *)pChild - 1 );
+		TArray<ASTARVERTEX_t>	Current = Polygon;
+		ASTARPOLYGON_t			&Result = Polygons[pSubsector - subsectors];
+		ULONG					ulIdx;
+
+		// The subsector lies in front of all its segs. Without minisegs, this removes the
+		// parts of the polygon that lie in the void behind the walls.
+		for ( ulIdx = 0; ulIdx < pSubsector->numlines; ulIdx++ )
+		{
+			const seg_t	*pSeg = &pSubsector->firstline[ulIdx];
 
-		pNewNode = astar_GetNode( pPath->pCurrentNode->lXNodeIdx + 1, pPath->pCurrentNode->lYNodeIdx );
-		lAddedCost = 64;
+			astar_ClipPolygon( Current, FIXED2DBL( pSeg->v1->x ), FIXED2DBL( pSeg->v1->y ),
+				FIXED2DBL( pSeg->v2->x - pSeg->v1->x ), FIXED2DBL( pSeg->v2->y - pSeg->v1->y ), Clipped );
+			Current = Clipped;
+		}
 
-		astar_ProcessNextPathNode( pPath, pNewNode, lAddedCost, 2 );
+		Result.ulFirstVertex = Vertices.Size( );
+		Result.ulNumVertices = Current.Size( );
+		for ( ulIdx = 0; ulIdx < Current.Size( ); ulIdx++ )
+			Vertices.Push( Current[ulIdx] );
 
-		pPath->ulNextStep = ASTAR_NS_LOOKBELOWFORWARD;
-		break;
-	case ASTAR_NS_LOOKBELOWFORWARD:
+		return;
+	}
 
-		pNewNode = astar_GetNode( pPath->pCurrentNode->lXNodeIdx + 1, pPath->pCurrentNode->lYNodeIdx - 1 );
-		lAddedCost = 91;
+	const node_t	*pNode = (node_t *)pChild;
 
-		astar_ProcessNextPathNode( pPath, pNewNode, lAddedCost, 3 );
+	// The front side (0) is the right side of the partition line. Swapping the line's
+	// direction turns the back side into the right side.
+	astar_ClipPolygon( Polygon, FIXED2DBL( pNode->x ), FIXED2DBL( pNode->y ), FIXED2DBL( pNode->dx ), FIXED2DBL( pNode->dy ), Clipped );
+	astar_BuildPolygons( pNode->children[0], Clipped, Vertices, Polygons );
+	astar_ClipPolygon( Polygon, FIXED2DBL( pNode->x ), FIXED2DBL( pNode->y ), -FIXED2DBL( pNode->dx ), -FIXED2DBL( pNode->dy ), Clipped );
+	astar_BuildPolygons( pNode->children[1], Clipped, Vertices, Polygons );
+}
 
-		pPath->ulNextStep = ASTAR_NS_LOOKBELOW;
-		break;
-	case ASTAR_NS_LOOKBELOW:
+//*****************************************************************************
+//
+// Keeps the part of the convex polygon In that lies to the right of the line through
+// (dX, dY) with direction (dDX, dDY).
+//
+static void astar_ClipPolygon( const TArray<ASTARVERTEX_t> &In, double dX, double dY, double dDX, double dDY, TArray<ASTARVERTEX_t> &Out )
+{
+	ULONG	ulIdx;
 
-		pNewNode = astar_GetNode( pPath->pCurrentNode->lXNodeIdx, pPath->pCurrentNode->lYNodeIdx - 1 );
-		lAddedCost = 64;
+	Out.Clear( );
+	for ( ulIdx = 0; ulIdx < In.Size( ); ulIdx++ )
+	{
+		const ASTARVERTEX_t	&A = In[ulIdx];
+		const ASTARVERTEX_t	&B = In[( ulIdx + 1 ) % In.Size( )];
+		const double		dSideA = dDX * ( A.dY - dY ) - dDY * ( A.dX - dX );
+		const double		dSideB = dDX * ( B.dY - dY ) - dDY * ( B.dX - dX );
 
-		astar_ProcessNextPathNode( pPath, pNewNode, lAddedCost, 4 );
+		if ( dSideA <= 0 )
+			Out.Push( A );
 
-		pPath->ulNextStep = ASTAR_NS_LOOKBELOWBACK;
-		break;
-	case ASTAR_NS_LOOKBELOWBACK:
+		if ((( dSideA < 0 ) && ( dSideB > 0 )) || (( dSideA > 0 ) && ( dSideB < 0 )))
+		{
+			const double	dFrac = dSideA / ( dSideA - dSideB );
+			ASTARVERTEX_t	Intersection;
 
-		pNewNode = astar_GetNode( pPath->pCurrentNode->lXNodeIdx - 1, pPath->pCurrentNode->lYNodeIdx - 1 );
-		lAddedCost = 91;
+			Intersection.dX = A.dX + ( B.dX - A.dX ) * dFrac;
+			Intersection.dY = A.dY + ( B.dY - A.dY ) * dFrac;
+			Out.Push( Intersection );
+		}
+	}
+}
 
-		astar_ProcessNextPathNode( pPath, pNewNode, lAddedCost, 5 );
+//*****************************************************************************
+//
+static bool astar_IsPointInPolygon( const TArray<ASTARVERTEX_t> &Vertices, const ASTARPOLYGON_t &Polygon, double dX, double dY )
+{
+	ULONG	ulIdx;
 
-		pPath->ulNextStep = ASTAR_NS_LOOKBACK;
-		break;
-	case ASTAR_NS_LOOKBACK:
+	if ( Polygon.ulNumVertices < 3 )
+		return ( false );
 
-		pNewNode = astar_GetNode( pPath->pCurrentNode->lXNodeIdx - 1, pPath->pCurrentNode->lYNodeIdx );
-		lAddedCost = 64;
+	for ( ulIdx = 0; ulIdx < Polygon.ulNumVertices; ulIdx++ )
+	{
+		const ASTARVERTEX_t	&A = Vertices[Polygon.ulFirstVertex + ulIdx];
+		const ASTARVERTEX_t	&B = Vertices[Polygon.ulFirstVertex + ( ulIdx + 1 ) % Polygon.ulNumVertices];
+		const double		dLength = sqrt(( B.dX - A.dX ) * ( B.dX - A.dX ) + ( B.dY - A.dY ) * ( B.dY - A.dY ));
 
-		astar_ProcessNextPathNode( pPath, pNewNode, lAddedCost, 6 );
+		// Allow the point to be half a unit outside of the polygon.
+		if (( dLength > 0 ) && ((( B.dX - A.dX ) * ( dY - A.dY ) - ( B.dY - A.dY ) * ( dX - A.dX )) > dLength * 0.5 ))
+			return ( false );
+	}
 
-		pPath->ulNextStep = ASTAR_NS_LOOKABOVEBACK;
-		break;
-	case ASTAR_NS_LOOKABOVEBACK:
+	return ( true );
+}
 
-		pNewNode = astar_GetNode( pPath->pCurrentNode->lXNodeIdx - 1, pPath->pCurrentNode->lYNodeIdx - 1 );
-		lAddedCost = 91;
+//*****************************************************************************
+//
+// Walks along the boundary of a subsector and looks at what's on the other side. Every
+// subsector a bot can walk into gets a portal.
+//
+static void astar_FindPortals( ULONG ulSubsector, const TArray<ASTARVERTEX_t> &Vertices, const TArray<ASTARPOLYGON_t> &Polygons, TArray<ASTARPORTAL_t> &Portals )
+{
+	const ASTARPOLYGON_t	&Polygon = Polygons[ulSubsector];
+	const ULONG				ulFirstPortal = Portals.Size( );
+	sector_t				*pSector = subsectors[ulSubsector].sector;
+	ULONG					ulIdx;
+	ULONG					ulIdx2;
+	ULONG					ulProbe;
+
+	for ( ulIdx = 0; ulIdx < Polygon.ulNumVertices; ulIdx++ )
+	{
+		const ASTARVERTEX_t	&A = Vertices[Polygon.ulFirstVertex + ulIdx];
+		const ASTARVERTEX_t	&B = Vertices[Polygon.ulFirstVertex + ( ulIdx + 1 ) % Polygon.ulNumVertices];
+		const double		dLength = sqrt(( B.dX - A.dX ) * ( B.dX - A.dX ) + ( B.dY - A.dY ) * ( B.dY - A.dY ));
+		ULONG				ulNumProbes;
 
-		astar_ProcessNextPathNode( pPath, pNewNode, lAddedCost, 7 );
+		if ( dLength < 1 )
+			continue;
 
-		// Now that we've checked all the adjacent nodes, add the parent node to the closed list.
-		if ( pPath->pCurrentNode->bOnClosed[g_lCurrentPathIdx] == false )
+		ulNumProbes = MAX<ULONG>( static_cast<ULONG>( dLength / ASTAR_PROBE_SPACING ), 1 );
+		for ( ulProbe = 0; ulProbe < ulNumProbes; ulProbe++ )
 		{
-			pPath->pCurrentNode->bOnClosed[g_lCurrentPathIdx] = true;
-
-			if ( botdebug_shownodes )
+			const double	dFrac = ( ulProbe + 0.5 ) / ulNumProbes;
+			const double	dX = A.dX + ( B.dX - A.dX ) * dFrac;
+			const double	dY = A.dY + ( B.dY - A.dY ) * dFrac;
+
+			// The inside of the polygon is to the right, so step one unit to the left.
+			const double	dProbeX = dX - ( B.dY - A.dY ) / dLength;
+			const double	dProbeY = dY + ( B.dX - A.dX ) / dLength;
+			const fixed_t	ProbeX = FLOAT2FIXED( dProbeX );
+			const fixed_t	ProbeY = FLOAT2FIXED( dProbeY );
+			const ULONG		ulOther = static_cast<ULONG>( R_PointInSubsector( ProbeX, ProbeY ) - subsectors );
+			sector_t		*pOtherSector = subsectors[ulOther].sector;
+			line_t			*pLine;
+
+			// Is there a different subsector, or only the void behind a wall?
+			if (( ulOther == ulSubsector ) || ( astar_IsPointInPolygon( Vertices, Polygons[ulOther], dProbeX, dProbeY ) == false ))
+				continue;
+
+			pLine = astar_GetBoundaryLine( ulSubsector, dX, dY );
+			if (( pLine != NULL ) && (( pLine->sidedef[1] == NULL ) || ( pLine->flags & ( ML_BLOCKING|ML_BLOCK_PLAYERS|ML_BLOCKEVERYTHING ))))
+				continue;
+
+			// Can the bot climb into the other subsector, and does it fit in there?
+			// Closed doors are fine, the bot will open them.
+			const fixed_t	FloorZ = pSector->floorplane.ZatPoint( FLOAT2FIXED( dX ), FLOAT2FIXED( dY ));
+			const fixed_t	OtherFloorZ = pOtherSector->floorplane.ZatPoint( ProbeX, ProbeY );
+			const fixed_t	OtherCeilingZ = pOtherSector->ceilingplane.ZatPoint( ProbeX, ProbeY );
+
+			if ( OtherFloorZ - FloorZ > ASTAR_MAX_CLIMB )
+				continue;
+
+			if (( OtherCeilingZ - OtherFloorZ < ASTAR_MIN_HEADROOM ) && ( astar_IsPotentialDoor( pOtherSector ) == false ))
+				continue;
+
+			// Two convex subsectors share at most one straight boundary, so all points
+			// where a bot can go from this subsector into the other one lie on a line.
+			for ( ulIdx2 = ulFirstPortal; ulIdx2 < Portals.Size( ); ulIdx2++ )
 			{
-				if ( pPath->paVisualizations[( pPath->pCurrentNode->lXNodeIdx * g_lNumVerticalNodes ) + pPath->pCurrentNode->lYNodeIdx] == NULL )
-					pPath->paVisualizations[( pPath->pCurrentNode->lXNodeIdx * g_lNumVerticalNodes ) + pPath->pCurrentNode->lYNodeIdx] = Spawn( PClass::FindClass( "PathNode" ), pPath->pCurrentNode->Position.x, pPath->pCurrentNode->Position.y, ONFLOORZ, NO_REPLACE );
+				if ( Portals[ulIdx2].ulTo == ulOther )
+					break;
+			}
 
-				AActor * pPathNode = pPath->paVisualizations[( pPath->pCurrentNode->lXNodeIdx * g_lNumVerticalNodes ) + pPath->pCurrentNode->lYNodeIdx];
-				pPathNode->SetState( pPathNode->SpawnState + ASTAR_FRAME_INCLOSED );
+			if ( ulIdx2 == Portals.Size( ))
+			{
+				ASTARPORTAL_t	Portal;
+
+				Portal.ulFrom = ulSubsector;
+				Portal.ulTo = ulOther;
+				Portal.dX = 0;
+				Portal.dY = 0;
+				Portal.ulNumPoints = 0;
+				Portals.Push( Portal );
 			}
+
+			Portals[ulIdx2].dX += dX;
+			Portals[ulIdx2].dY += dY;
+			Portals[ulIdx2].ulNumPoints++;
 		}
+	}
+}
+
+//*****************************************************************************
+//
+// Returns the line the point on the boundary of the subsector lies on, or NULL if the
+// boundary is only a partition line (or a miniseg) there.
+//
+static line_t *astar_GetBoundaryLine( ULONG ulSubsector, double dX, double dY )
+{
+	const subsector_t	*pSubsector = &subsectors[ulSubsector];
+	ULONG				ulIdx;
+
+	for ( ulIdx = 0; ulIdx < pSubsector->numlines; ulIdx++ )
+	{
+		const seg_t		*pSeg = &pSubsector->firstline[ulIdx];
+		const double	dX1 = FIXED2DBL( pSeg->v1->x );
+		const double	dY1 = FIXED2DBL( pSeg->v1->y );
+		const double	dDX = FIXED2DBL( pSeg->v2->x ) - dX1;
+		const double	dDY = FIXED2DBL( pSeg->v2->y ) - dY1;
+		const double	dLengthSquared = dDX * dDX + dDY * dDY;
+
+		if (( pSeg->linedef == NULL ) || ( dLengthSquared < 1 ))
+			continue;
 
+		const double	dFrac = (( dX - dX1 ) * dDX + ( dY - dY1 ) * dDY ) / dLengthSquared;
+		const double	dSide = dDX * ( dY - dY1 ) - dDY * ( dX - dX1 );
 
-		pPath->ulNextStep = ASTAR_NS_PULLFROMOPENLIST;
-		break;
+		if (( dFrac >= 0 ) && ( dFrac <= 1 ) && ( dSide * dSide <= dLengthSquared ))
+			return ( pSeg->linedef );
 	}
 
-	// We haven't finished creating the path, so return false.
-	return ( false );
+	return ( NULL );
 }
 
 //*****************************************************************************
 //
-static ASTARNODE_t *astar_GetNodeFromPoint( POS_t Point )
+// Check to see if this sector is actually a closed door, i.e. has a linedef attached to
+// it that opens it. This is the same test BOTPATH_TryWalk does.
+//
+static bool astar_IsPotentialDoor( sector_t *pSector )
 {
-	LONG	lXNode;
-	LONG	lYNode;
+	LONG	lIdx;
 
-//	lXNode = ( Point.x - g_lMapXMin ) >> ASTAR_NODE_SHIFT;
-//	lYNode = ( Point.y - g_lMapYMin ) >> ASTAR_NODE_SHIFT;
-	lXNode = ( Point.x >> ASTAR_NODE_SHIFT ) - ( g_lMapXMin >> ASTAR_NODE_SHIFT );
-	lYNode = ( Point.y >> ASTAR_NODE_SHIFT ) - ( g_lMapYMin >> ASTAR_NODE_SHIFT );
-
-	if (( lXNode >= g_lNumHorizontalNodes ) || ( lXNode < 0 ) ||
-		( lYNode >= g_lNumVerticalNodes ) || ( lYNode < 0 ))
+	for ( lIdx = 0; lIdx < pSector->linecount; lIdx++ )
 	{
-		return ( NULL );
+		if (( pSector->lines[lIdx]->special == Door_Open ) || ( pSector->lines[lIdx]->special == Door_Raise ))
+			return ( true );
 	}
 
-	return ( astar_GetNode( lXNode, lYNode ));
+	return ( false );
 }
 
 //*****************************************************************************
 //
-static LONG astar_GetCostToGoalEstimate( ASTARPATH_t *pPath, ASTARNODE_t *pNode )
+// Groups neighboring subsectors into clusters of up to ASTAR_CLUSTER_SIZE subsectors.
+//
+static void astar_BuildClusters( const TArray<ULONG> &FirstPortal, const TArray<ASTARPORTAL_t> &Portals )
 {
-	return ( P_AproxDistance( pNode->Position.x - pPath->pGoalNode->Position.x, pNode->Position.y - pPath->pGoalNode->Position.y ) / FRACUNIT );
-/*
-	POS_t	PosGoal;
-	POS_t	PosNode;
+	TArray<LONG>	SubsectorClusters;
+	TArray<ULONG>	Queue;
+	ULONG			ulIdx;
+	ULONG			ulIdx2;
+	ULONG			ulQueuePos;
 
-	PosNode = ASTAR_GetPosition( pNode );
-	PosGoal = ASTAR_GetPosition( pPath->pGoalNode );
+	SubsectorClusters.Resize( g_ulNumSubsectorNodes );
+	for ( ulIdx = 0; ulIdx < g_ulNumSubsectorNodes; ulIdx++ )
+		SubsectorClusters[ulIdx] = -1;
 
-	return ( P_AproxDistance( PosNode.x - PosGoal.x, PosNode.y - PosGoal.y ));
+	for ( ulIdx = 0; ulIdx < g_ulNumSubsectorNodes; ulIdx++ )
+	{
+		ASTARCLUSTER_t	Cluster;
+		const LONG		lCluster = g_Clusters.Size( );
+		double			dX = 0;
+		double			dY = 0;
 
-//	return (( labs( pPath->pGoalNode->lXNodeIdx - pNode->lXNodeIdx ) + ( labs( pPath->pGoalNode->lYNodeIdx - pNode->lYNodeIdx ))) * 64 );
+		if ( SubsectorClusters[ulIdx] != -1 )
+			continue;
 
-	LONG	lXDiff;
-	LONG	lYDiff;
+		Queue.Clear( );
+		Queue.Push( ulIdx );
+		SubsectorClusters[ulIdx] = lCluster;
 
-	lXDiff = (( pPath->pGoalNode->lXNodeIdx - pNode->lXNodeIdx ) * 64 ) * (( pPath->pGoalNode->lXNodeIdx - pNode->lXNodeIdx ) * 64 );
-	lYDiff = (( pPath->pGoalNode->lYNodeIdx - pNode->lYNodeIdx ) * 64 ) * (( pPath->pGoalNode->lYNodeIdx - pNode->lYNodeIdx ) * 64 );
+		for ( ulQueuePos = 0; ulQueuePos < Queue.Size( ); ulQueuePos++ )
+		{
+			const ULONG	ulSubsector = Queue[ulQueuePos];
 
-//	lXDiff *= lXDiff;
-//	lYDiff *= lYDiff;
+			dX += FIXED2DBL( g_Nodes[ulSubsector].Position.x );
+			dY += FIXED2DBL( g_Nodes[ulSubsector].Position.y );
 
-	// Fixme: THIS IS EXTREMELY EXPENSIVE! Revise.
-	return ( (LONG)sqrt( lXDiff + lYDiff ));
+			for ( ulIdx2 = FirstPortal[ulSubsector]; ( ulIdx2 < FirstPortal[ulSubsector + 1] ) && ( Queue.Size( ) < ASTAR_CLUSTER_SIZE ); ulIdx2++ )
+			{
+				if ( SubsectorClusters[Portals[ulIdx2].ulTo] != -1 )
+					continue;
 
-	return ( (LONG)sqrt(((( pPath->pGoalNode->lXNodeIdx - pNode->lXNodeIdx ) * 64 ) ^ 2 ) + ((( pPath->pGoalNode->lYNodeIdx - pNode->lYNodeIdx ) * 64 ) ^ 2 )));
+				SubsectorClusters[Portals[ulIdx2].ulTo] = lCluster;
+				Queue.Push( Portals[ulIdx2].ulTo );
+			}
+		}
 
-//	return (( labs( pPath->pGoalNode->lXNodeIdx - pNode->lXNodeIdx ) + labs( pPath->pGoalNode->lYNodeIdx - pNode->lYNodeIdx )) * 15 );
+		Cluster.Position.x = FLOAT2FIXED( dX / Queue.Size( ));
+		Cluster.Position.y = FLOAT2FIXED( dY / Queue.Size( ));
+		Cluster.Position.z = 0;
+		Cluster.ulFirstEdge = 0;
+		Cluster.ulNumEdges = 0;
+		g_Clusters.Push( Cluster );
+	}
 
-	return (( labs( pPath->pGoalNode->lXNodeIdx - pNode->lXNodeIdx ) * labs( pPath->pGoalNode->lXNodeIdx - pNode->lXNodeIdx )) + 
-			( labs( pPath->pGoalNode->lYNodeIdx - pNode->lYNodeIdx ) * labs( pPath->pGoalNode->lYNodeIdx - pNode->lYNodeIdx )));
-*/
+	// A portal node belongs to the cluster of the subsector it's leaving.
+	for ( ulIdx = 0; ulIdx < g_Nodes.Size( ); ulIdx++ )
+	{
+		if ( ulIdx < g_ulNumSubsectorNodes )
+			g_Nodes[ulIdx].ulCluster = SubsectorClusters[ulIdx];
+		else
+			g_Nodes[ulIdx].ulCluster = SubsectorClusters[Portals[ulIdx - g_ulNumSubsectorNodes].ulFrom];
+	}
 }
 
 //*****************************************************************************
 //
-static void astar_PushNodeToStack( ASTARNODE_t *pNode, ASTARPATH_t *pPath )
+// Connects two clusters if there's a portal from one into the other.
+//
+static void astar_BuildClusterEdges( const TArray<ASTARPORTAL_t> &Portals )
 {
-	if ( pPath->lStackPos == MAX_NODES_IN_PATH )
-		I_Error( "astar_PushNodeToStack: Number of nodes in path exceeded!" );
+	TArray<ASTARCLUSTERLINK_t>	Links;
+	ASTARCLUSTERLINK_t			Link;
+	ULONG						ulIdx;
 
-	pPath->pNodeStack[pPath->lStackPos++] = pNode;
+	// Collect all links, sorted by the cluster they're leaving.
+	for ( ulIdx = 0; ulIdx < Portals.Size( ); ulIdx++ )
+	{
+		Link.ulFrom = g_Nodes[Portals[ulIdx].ulFrom].ulCluster;
+		Link.ulTo = g_Nodes[Portals[ulIdx].ulTo].ulCluster;
+
+		if ( Link.ulFrom != Link.ulTo )
+			Links.Push( Link );
+	}
+
+	if ( Links.Size( ) > 0 )
+		qsort( &Links[0], Links.Size( ), sizeof( ASTARCLUSTERLINK_t ), astar_CompareClusterLinks );
+
+	for ( ulIdx = 0; ulIdx < Links.Size( ); ulIdx++ )
+	{
+		ASTARCLUSTER_t	&Cluster = g_Clusters[Links[ulIdx].ulFrom];
+		ASTAREDGE_t		Edge;
+
+		if (( ulIdx > 0 ) && ( Links[ulIdx].ulFrom == Links[ulIdx - 1].ulFrom ) && ( Links[ulIdx].ulTo == Links[ulIdx - 1].ulTo ))
+			continue;
+
+		if ( Cluster.ulNumEdges == 0 )
+			Cluster.ulFirstEdge = g_ClusterEdges.Size( );
+
+		Edge.ulTarget = Links[ulIdx].ulTo;
+		Edge.lCost = MAX<LONG>( astar_GetDistance( Cluster.Position, g_Clusters[Edge.ulTarget].Position ), 1 );
+		g_ClusterEdges.Push( Edge );
+		Cluster.ulNumEdges++;
+	}
 }
 
 //*****************************************************************************
 //
-static bool astar_PullNodeFromOpenList( ASTARPATH_t *pPath )
+static int STACK_ARGS astar_CompareClusterLinks( const void *pA, const void *pB )
 {
-	// If there aren't any nodes left in the open list, we're done.
-	if ( astar_IsPriorityQueueEmpty( ))
+	const ASTARCLUSTERLINK_t	*pLinkA = static_cast<const ASTARCLUSTERLINK_t *>( pA );
+	const ASTARCLUSTERLINK_t	*pLinkB = static_cast<const ASTARCLUSTERLINK_t *>( pB );
+
+	if ( pLinkA->ulFrom != pLinkB->ulFrom )
+		return ( pLinkA->ulFrom < pLinkB->ulFrom ) ? -1 : 1;
+
+	if ( pLinkA->ulTo != pLinkB->ulTo )
+		return ( pLinkA->ulTo < pLinkB->ulTo ) ? -1 : 1;
+
+	return ( 0 );
+}
+
+//*****************************************************************************
+//
+// Approximate distance in map units, like P_AproxDistance, but without overflowing on
+// large maps.
+//
+static LONG astar_GetDistance( const POS_t &A, const POS_t &B )
+{
+	const double	dDX = fabs( FIXED2DBL( A.x ) - FIXED2DBL( B.x ));
+	const double	dDY = fabs( FIXED2DBL( A.y ) - FIXED2DBL( B.y ));
+
+	return ( static_cast<LONG>( dDX + dDY - MIN( dDX, dDY ) / 2 ));
+}
+
+//*****************************************************************************
+//
+// If this sector is a damaging sector, make it more costly to go through here.
+//
+static LONG astar_GetSectorPenalty( sector_t *pSector )
+{
+	switch ( pSector->special )
 	{
-		pPath->ulFlags |= PF_COMPLETE;
-		return ( true );
+	case dDamage_Hellslime:
+
+		return ( 32 );
+	case dDamage_SuperHellslime:
+	case dLight_Strobe_Hurt:
+
+		return ( 64 );
+	case dDamage_Nukage:
+	case dDamage_LavaWimpy:
+	case dScroll_EastLavaDamage:
+
+		return ( 16 );
+	case dDamage_LavaHefty:
+
+		return ( 24 );
+	default:
+
+		return ( 0 );
 	}
+}
 
-	// Get the lowest cost node from the open stack.
-	pPath->pCurrentNode = astar_PopFromPriorityQueue( );
-	pPath->pCurrentNode->bOnOpen[g_lCurrentPathIdx] = false;
+//*****************************************************************************
+//
+static ASTARNODE_t *astar_GetNodeFromPoint( POS_t Point )
+{
+	if ( g_ulNumSubsectorNodes == 0 )
+		return ( NULL );
 
-	if ( botdebug_shownodes )
+	return ( &g_Nodes[R_PointInSubsector( Point.x, Point.y ) - subsectors] );
+}
+
+//*****************************************************************************
+//
+static ULONG astar_GetNodeIndex( const ASTARNODE_t *pNode )
+{
+	return ( static_cast<ULONG>( pNode - &g_Nodes[0] ));
+}
+
+//*****************************************************************************
+//
+static ASTARSCRATCH_t &astar_GetScratch( TArray<ASTARSCRATCH_t> &Scratch, ULONG ulIdx, ULONG ulSearchID )
+{
+	ASTARSCRATCH_t	&Entry = Scratch[ulIdx];
+
+	// This entry is still from an older search, so the node is untouched.
+	if ( Entry.ulSearchID != ulSearchID )
+	{
+		Entry.ulSearchID = ulSearchID;
+		Entry.lParent = -1;
+		Entry.lCostFromStart = 0;
+		Entry.lTotalCost = 0;
+		Entry.bOnClosed = false;
+		Entry.bInCorridor = false;
+	}
+
+	return ( Entry );
+}
+
+//*****************************************************************************
+//
+static void astar_BeginSearch( ASTARPATH_t *pPath )
+{
+	ULONG	ulIdx;
+
+	// When the IDs wrap around, old entries could be mistaken for current ones.
+	if ( ++g_ulLastSearchID == 0 )
 	{
-		if ( pPath->paVisualizations[( pPath->pCurrentNode->lXNodeIdx * g_lNumVerticalNodes ) + pPath->pCurrentNode->lYNodeIdx] == NULL )
-			pPath->paVisualizations[( pPath->pCurrentNode->lXNodeIdx * g_lNumVerticalNodes ) + pPath->pCurrentNode->lYNodeIdx] = Spawn( PClass::FindClass( "PathNode" ), pPath->pCurrentNode->Position.x, pPath->pCurrentNode->Position.y, ONFLOORZ, NO_REPLACE );
+		for ( ulIdx = 0; ulIdx < MAX_PATHS; ulIdx++ )
+		{
+			g_aPaths[ulIdx].Scratch.Clear( );
+			g_aPaths[ulIdx].ClusterScratch.Clear( );
+		}
 
-		AActor * pPathNode = pPath->paVisualizations[( pPath->pCurrentNode->lXNodeIdx * g_lNumVerticalNodes ) + pPath->pCurrentNode->lYNodeIdx];
-		pPathNode->SetState( pPathNode->SpawnState + ASTAR_FRAME_OFFOPEN );
+		g_ulLastSearchID = 1;
 	}
 
-	// If this node is the goal node, we've found the goal node. Now we can construct a path
-	// back to the goal node.
-	if ( pPath->pCurrentNode == pPath->pGoalNode )
+	// The scratch space is only allocated for paths that are actually used.
+	if ( pPath->Scratch.Size( ) != g_Nodes.Size( ))
 	{
-		ASTARNODE_t	*pNextNode;
-		bool		bPushNextNode = true;
+		pPath->Scratch.Resize( g_Nodes.Size( ));
+		memset( &pPath->Scratch[0], 0, sizeof( ASTARSCRATCH_t ) * g_Nodes.Size( ));
+	}
 
-		// Construct path.
-		pNextNode = pPath->pGoalNode;
-		while ( pNextNode->pParent[g_lCurrentPathIdx] && pNextNode->pParent[g_lCurrentPathIdx]->pParent[g_lCurrentPathIdx] )
+	if ( pPath->ClusterScratch.Size( ) != g_Clusters.Size( ))
+	{
+		pPath->ClusterScratch.Resize( g_Clusters.Size( ));
+		memset( &pPath->ClusterScratch[0], 0, sizeof( ASTARSCRATCH_t ) * g_Clusters.Size( ));
+	}
+
+	pPath->ulSearchID = g_ulLastSearchID;
+	pPath->OpenList.Clear( );
+}
+
+//*****************************************************************************
+//
+// Searches the high level graph for the clusters between the start and the goal, and
+// marks them as the corridor the node search is restricted to.
+//
+static bool astar_FindCorridor( ASTARPATH_t *pPath )
+{
+	const ULONG			ulStart = pPath->pStartNode->ulCluster;
+	const ULONG			ulGoal = pPath->pGoalNode->ulCluster;
+	const POS_t			&GoalPos = g_Clusters[ulGoal].Position;
+	ASTAROPENENTRY_t	Entry;
+	ULONG				ulIdx;
+
+	ASTARSCRATCH_t	&Start = astar_GetScratch( pPath->ClusterScratch, ulStart, pPath->ulSearchID );
+	Start.lTotalCost = astar_GetDistance( g_Clusters[ulStart].Position, GoalPos );
+	astar_PushToOpenList( pPath->OpenList, Start.lTotalCost, ulStart );
+
+	while ( pPath->OpenList.Size( ) > 0 )
+	{
+		Entry = astar_PopFromOpenList( pPath->OpenList );
+
+		ASTARSCRATCH_t	&Current = astar_GetScratch( pPath->ClusterScratch, Entry.ulNode, pPath->ulSearchID );
+		if (( Current.bOnClosed ) || ( Current.lTotalCost != Entry.lTotalCost ))
+			continue;
+
+		Current.bOnClosed = true;
+		if ( Entry.ulNode == ulGoal )
 		{
-			if (( bPushNextNode ) || ( pNextNode->lDirection[g_lCurrentPathIdx] != pNextNode->pParent[g_lCurrentPathIdx]->lDirection[g_lCurrentPathIdx] ))
+			LONG	lCluster = ulGoal;
+
+			while ( lCluster != -1 )
 			{
-				astar_PushNodeToStack( pNextNode, pPath );
+				pPath->ClusterScratch[lCluster].bInCorridor = true;
+				lCluster = pPath->ClusterScratch[lCluster].lParent;
+			}
 
-				if ( botdebug_shownodes )
-				{
-					if ( pPath->paVisualizations[( pNextNode->lXNodeIdx * g_lNumVerticalNodes ) + pNextNode->lYNodeIdx] == NULL )
-						pPath->paVisualizations[( pNextNode->lXNodeIdx * g_lNumVerticalNodes ) + pNextNode->lYNodeIdx] = Spawn( PClass::FindClass( "PathNode" ), pNextNode->Position.x, pNextNode->Position.y, ONFLOORZ, NO_REPLACE );
+			pPath->OpenList.Clear( );
+			return ( true );
+		}
 
-					AActor * pPathNode = pPath->paVisualizations[( pNextNode->lXNodeIdx * g_lNumVerticalNodes ) + pNextNode->lYNodeIdx];
-					pPathNode ->SetState( pPathNode->SpawnState + ASTAR_FRAME_ONPATH );
-				}
-			}
+		const ASTARCLUSTER_t	&Cluster = g_Clusters[Entry.ulNode];
+		const LONG				lCostFromStart = Current.lCostFromStart;
 
-			if (( pNextNode == pPath->pGoalNode ) || ( pNextNode->lDirection[g_lCurrentPathIdx] != pNextNode->pParent[g_lCurrentPathIdx]->lDirection[g_lCurrentPathIdx] ))
-				bPushNextNode = true;
-			else
-				bPushNextNode = false;
+		for ( ulIdx = Cluster.ulFirstEdge; ulIdx < Cluster.ulFirstEdge + Cluster.ulNumEdges; ulIdx++ )
+		{
+			const ASTAREDGE_t	&Edge = g_ClusterEdges[ulIdx];
+			ASTARSCRATCH_t		&Next = astar_GetScratch( pPath->ClusterScratch, Edge.ulTarget, pPath->ulSearchID );
+			const LONG			lNewCost = lCostFromStart + Edge.lCost;
+
+			if (( Next.bOnClosed ) || (( Next.lCostFromStart > 0 ) && ( lNewCost >= Next.lCostFromStart )))
+				continue;
 
-			pNextNode = pNextNode->pParent[g_lCurrentPathIdx];
+			Next.lParent = Entry.ulNode;
+			Next.lCostFromStart = lNewCost;
+			Next.lTotalCost = lNewCost + astar_GetDistance( g_Clusters[Edge.ulTarget].Position, GoalPos );
+			astar_PushToOpenList( pPath->OpenList, Next.lTotalCost, Edge.ulTarget );
 		}
+	}
 
-		// If there's 1 or less nodes in the path, just push the goal node.
-		if ( pPath->lStackPos == 0 )
-			astar_PushNodeToStack( pPath->pGoalNode, pPath );
-		else if ( pPath->lStackPos > 1 )
-		{
-			ASTARNODE_t		*pNode;
-			ASTARNODE_t		*pNecessaryNodeList[MAX_NODES_IN_PATH];
-			LONG			lListPos;
-			LONG			lStackPos;
-			POS_t			GoalPos;
-			POS_t			NodePos;
-
-			lListPos = 0;
-			lStackPos = 1;
-			pNode = pPath->pNodeStack[pPath->lStackPos - lStackPos];
-			GoalPos = ASTAR_GetPositionFromIndex( pPath->pGoalNode->lXNodeIdx, pPath->pGoalNode->lYNodeIdx );
-			while (( pNode != pPath->pGoalNode ) && ( pNode != pPath->pGoalNode->pParent[g_lCurrentPathIdx] ))
-			{
-				NodePos = ASTAR_GetPositionFromIndex( pNode->lXNodeIdx, pNode->lYNodeIdx );
-				pNecessaryNodeList[lListPos++] = pNode;
-
-				if ( BOTPATH_TryWalk( pPath->pActor, NodePos.x, NodePos.y, pPath->pActor->z, GoalPos.x, GoalPos.y ) & (BOTPATH_OBSTRUCTED|BOTPATH_DAMAGINGSECTOR) )
-				{
-					lStackPos++;
-					pNode = pPath->pNodeStack[pPath->lStackPos - lStackPos];
-				}
-				else
-				{
-					ULONG	ulIdx;
+	return ( false );
+}
 
-					for ( ulIdx = 0; ulIdx < MAX_NODES_IN_PATH; ulIdx++ )
-						pPath->pNodeStack[ulIdx] = NULL;
+//*****************************************************************************
+//
+static void astar_OpenStartNode( ASTARPATH_t *pPath )
+{
+	const ULONG		ulStart = astar_GetNodeIndex( pPath->pStartNode );
+	ASTARSCRATCH_t	&Start = astar_GetScratch( pPath->Scratch, ulStart, pPath->ulSearchID );
 
-					pPath->lStackPos = 0;
-					astar_PushNodeToStack( pPath->pGoalNode, pPath );
+	// Estimate the total cost to the goal from this node. The start node does not have a parent.
+	Start.lCostFromStart = 0;
+	Start.lTotalCost = astar_GetDistance( pPath->pStartNode->Position, pPath->pGoalNode->Position );
+	Start.lParent = -1;
 
-					for ( ulIdx = 0; ulIdx < (ULONG)lListPos; ulIdx++ )
-						astar_PushNodeToStack( pNecessaryNodeList[ulIdx], pPath );
+	// Put this node on the open list.
+	astar_PushToOpenList( pPath->OpenList, Start.lTotalCost, ulStart );
+	astar_Visualize( pPath, ulStart, ASTAR_FRAME_INOPEN );
+}
 
-					break;
-				}
+//*****************************************************************************
+//
+// Takes the cheapest node from the open list and looks at all its neighbors. Returns
+// true once the search is over.
+//
+static bool astar_PathNextNode( ASTARPATH_t *pPath )
+{
+	ASTAROPENENTRY_t	Entry;
+	ASTARSCRATCH_t		*pCurrent;
+	ULONG				ulIdx;
+
+	g_lNumSearchedNodes++;
+	pPath->ulNumSearchedNodes++;
+
+	// Get the lowest cost node from the open list. Skip entries of nodes that have been
+	// reached in a cheaper way since they were added.
+	do
+	{
+		if ( pPath->OpenList.Size( ) == 0 )
+		{
+			// The clusters are connected, but not the nodes inside of them that matter.
+			// Search the whole graph instead.
+			if ( pPath->bInCorridor )
+			{
+				pPath->bInCorridor = false;
+				pPath->bLeftCorridor = true;
+				astar_BeginSearch( pPath );
+				astar_OpenStartNode( pPath );
+				return ( false );
 			}
+
+			// If there aren't any nodes left in the open list, we're done.
+			pPath->ulFlags |= PF_COMPLETE;
+			return ( true );
 		}
 
+		Entry = astar_PopFromOpenList( pPath->OpenList );
+		pCurrent = &pPath->Scratch[Entry.ulNode];
+	} while (( pCurrent->bOnClosed ) || ( pCurrent->lTotalCost != Entry.lTotalCost ));
+
+	pCurrent->bOnClosed = true;
+	pPath->pCurrentNode = &g_Nodes[Entry.ulNode];
+	astar_Visualize( pPath, Entry.ulNode, ASTAR_FRAME_INCLOSED );
+
+	// If this node is the goal node, we've found the goal node. Now we can construct a path
+	// back to the goal node.
+	if ( pPath->pCurrentNode == pPath->pGoalNode )
+	{
+		pPath->lTotalCost = pCurrent->lCostFromStart;
+		astar_BuildNodeStack( pPath );
 		pPath->ulFlags |= PF_COMPLETE|PF_SUCCESS;
 		return ( true );
 	}
 
+	const LONG	lCostFromStart = pCurrent->lCostFromStart;
+
+	for ( ulIdx = pPath->pCurrentNode->ulFirstEdge; ulIdx < pPath->pCurrentNode->ulFirstEdge + pPath->pCurrentNode->ulNumEdges; ulIdx++ )
+	{
+		const ASTAREDGE_t	&Edge = g_Edges[ulIdx];
+		ASTARNODE_t			*pNode = &g_Nodes[Edge.ulTarget];
+		LONG				lAddedCost = Edge.lCost;
+		LONG				lPenalty;
+		LONG				lNewCost;
+
+		if (( pPath->bInCorridor ) && (( pPath->ClusterScratch[pNode->ulCluster].ulSearchID != pPath->ulSearchID ) || ( pPath->ClusterScratch[pNode->ulCluster].bInCorridor == false )))
+			continue;
+
+		ASTARSCRATCH_t	&Next = astar_GetScratch( pPath->Scratch, Edge.ulTarget, pPath->ulSearchID );
+
+		// This node is on the closed list. Don't do anything with it.
+		if ( Next.bOnClosed )
+			continue;
+
+		lPenalty = astar_GetSectorPenalty( pNode->pSector );
+		if (( lPenalty > 0 ) && ( pPath->bAvoidDamage ))
+			continue;
+
+		lAddedCost += lPenalty;
+		lNewCost = lCostFromStart + lAddedCost;
+
+		// If this node is already in the open list, and this path to the node isn't any better,
+		// don't do anything.
+		if (( Next.lCostFromStart > 0 ) && ( lNewCost >= Next.lCostFromStart ))
+			continue;
+
+		// Store the new or improved information.
+		Next.lParent = Entry.ulNode;
+		Next.lCostFromStart = lNewCost;
+		Next.lTotalCost = lNewCost + astar_GetDistance( pNode->Position, pPath->pGoalNode->Position );
+		astar_PushToOpenList( pPath->OpenList, Next.lTotalCost, Edge.ulTarget );
+		astar_Visualize( pPath, Edge.ulTarget, ASTAR_FRAME_INOPEN );
+	}
+
+	// We haven't finished creating the path, so return false.
 	return ( false );
 }
 
 //*****************************************************************************
 //
-static void astar_ProcessNextPathNode( ASTARPATH_t *pPath, ASTARNODE_t *pNode, LONG lAddedCost, LONG lDirection )
+static void astar_BuildNodeStack( ASTARPATH_t *pPath )
 {
-	LONG	lNewCost;
+	const ULONG	ulStart = astar_GetNodeIndex( pPath->pStartNode );
+	LONG		lNode = astar_GetNodeIndex( pPath->pGoalNode );
 
-	if ( pNode == NULL )
-		return;
+	// Construct path. The goal node ends up at the bottom of the stack.
+	pPath->NodeStack.Clear( );
+	while (( lNode != -1 ) && ( static_cast<ULONG>( lNode ) != ulStart ))
+	{
+		pPath->NodeStack.Push( &g_Nodes[lNode] );
+		astar_Visualize( pPath, lNode, ASTAR_FRAME_ONPATH );
+		lNode = pPath->Scratch[lNode].lParent;
+	}
 
-	// This node is on the closed list. Don't do anything with it.
-	if ( pNode->bOnClosed[g_lCurrentPathIdx] )
-		return;
+	// If there's 1 or less nodes in the path, just push the goal node.
+	if ( pPath->NodeStack.Size( ) == 0 )
+		pPath->NodeStack.Push( pPath->pGoalNode );
+}
+
+//*****************************************************************************
+//
+// Skips the nodes the bot can walk past in a straight line.
+//
+static void astar_SmoothNodeStack( ASTARPATH_t *pPath )
+{
+	ULONG	ulIdx;
 
-	// Issue a small penalty for changing directions.
-	if ( lDirection != pPath->pCurrentNode->lDirection[g_lCurrentPathIdx] )
-		lAddedCost = (LONG)( lAddedCost * 1.5 );
+	if ( pPath->pActor == NULL )
+		return;
 
-	// Check if it's possible to get to this new node.
+	for ( ulIdx = 0; ( ulIdx < 8 ) && ( pPath->NodeStack.Size( ) > 1 ); ulIdx++ )
 	{
-		POS_t			CurPos;
-		POS_t			DestPos;
-		sector_t		*pSector;
-//		fixed_t			vx;
-//		fixed_t			vy;
-//		fixed_t			vz;
-//		fixed_t			Angle;
-//		fixed_t			Pitch;
-//		FTraceResults	TraceResults;
-		ULONG			ulResults;
-		fixed_t			Distance;
+		const POS_t	&NextPos = pPath->NodeStack[pPath->NodeStack.Size( ) - 2]->Position;
 
-		if ( pPath->pCurrentNode == pPath->pStartNode )
-		{
-			CurPos.x = pPath->pActor->x;
-			CurPos.y = pPath->pActor->y;
-		}
-		else
-			CurPos = pPath->pCurrentNode->Position;
-
-		DestPos = pNode->Position;
-		pSector = R_PointInSubsector( CurPos.x, CurPos.y )->sector;
-
-//		Angle = R_PointToAngle2( CurPos.x, CurPos.y, DestPos.x, DestPos.y ) >> ANGLETOFINESHIFT;
-//		Pitch = 0;
-	
-//		vx = FixedMul( finecosine[Pitch], finecosine[Angle/* >> ANGLETOFINESHIFT*/] );
-//		vy = FixedMul( finecosine[Pitch], finesine[Angle/* >> ANGLETOFINESHIFT*/] );
-//		vz = finesine[Pitch];
-
-		// THIS NEEDS TO CHANGE IF ASTAR_NODE_SIZE EVER CHANGES!!!
-		if (( lDirection == 0 ) ||
-			( lDirection == 2 ) ||
-			( lDirection == 4 ) ||
-			( lDirection == 6 ))
-		{
-			Distance = 64 * FRACUNIT;
-		}
-		else
-		{
-			Distance = 91 * FRACUNIT;
-		}
-/*
-		if ( Trace( CurPos.x,
-			CurPos.y,
-			pSector->floorplane.ZatPoint( CurPos.x, CurPos.y ) + gameinfo.StepHeight,
-			pSector,
-			vx,
-			vy,
-			vz,
-			Distance,
-			MF_SOLID|MF_SHOOTABLE,
-			0,
-			pPath->pActor,
-			TraceResults ))
-		{
-			return;
-		}
-*/
-		ulResults = BOTPATH_TryWalk( pPath->pActor, CurPos.x, CurPos.y, pSector->floorplane.ZatPoint( CurPos.x, CurPos.y ), DestPos.x, DestPos.y );
-		if (( ulResults & BOTPATH_OBSTRUCTED ) || (( pPath->pActor->player->pSkullBot->m_ulPathType == BOTPATHTYPE_ROAM ) && ( ulResults & BOTPATH_DAMAGINGSECTOR )))
-			return;
+		if ( BOTPATH_TryWalk( pPath->pActor, pPath->pActor->x, pPath->pActor->y, pPath->pActor->z, NextPos.x, NextPos.y ) & (BOTPATH_OBSTRUCTED|BOTPATH_DAMAGINGSECTOR) )
+			break;
 
-		// If this sector is a damaging sector, make it more costly to go through here.
-		switch ( pSector->special )
-		{
-		case dDamage_End:
+		pPath->NodeStack.Pop( );
+	}
+}
 
-			break;
-		case dDamage_Hellslime:
+//*****************************************************************************
+//
+// Searches as much of the path as its own limit and this tic's budget allow.
+//
+static void astar_ServePath( ASTARPATH_t *pPath )
+{
+	LONG	lMaxNodes;
 
-			lAddedCost += 32;
-			break;
-		case dDamage_SuperHellslime:
-		case dLight_Strobe_Hurt:
+	// Only search one node every few tics.
+	if (( pPath->fMaxSearchNodes > 0 ) && ( pPath->fMaxSearchNodes < 1 ))
+	{
+		if (( gametic % (LONG)( 1.0f / pPath->fMaxSearchNodes )) != 0 )
+			return;
 
-			lAddedCost += 64;
-			break;
-		case dDamage_Nukage:
-		case dDamage_LavaWimpy:
-		case dScroll_EastLavaDamage:
+		lMaxNodes = 1;
+	}
+	else
+		lMaxNodes = MIN<LONG>( static_cast<LONG>( pPath->fMaxSearchNodes ), g_lTicBudget );
 
-			lAddedCost += 16;
-			break;
-		case dDamage_LavaHefty:
+	astar_RunSearch( pPath, MAX<LONG>( lMaxNodes, 1 ));
+}
+
+//*****************************************************************************
+//
+// Searches at most lMaxNodes nodes (0 means no limit), and takes them from this tic's budget.
+//
+static void astar_RunSearch( ASTARPATH_t *pPath, LONG lMaxNodes )
+{
+	const ULONG	ulNumSearchedNodes = pPath->ulNumSearchedNodes;
+
+	pPath->SearchCycles.Clock( );
 
-			lAddedCost += 24;
+	while ( astar_PathNextNode( pPath ) == false )
+	{
+		if (( lMaxNodes > 0 ) && ( pPath->ulNumSearchedNodes - ulNumSearchedNodes >= static_cast<ULONG>( lMaxNodes )))
 			break;
-		default:
 
+		if (( pPath->lGiveUpLimit > 0 ) && ( pPath->ulNumSearchedNodes >= (ULONG)pPath->lGiveUpLimit ))
+		{
+			// We've exceeded the give up limit. So, label the path as complete.
+			pPath->ulFlags |= PF_COMPLETE|PF_GAVEUP;
 			break;
 		}
 	}
 
-	lNewCost = pPath->pCurrentNode->lCostFromStart[g_lCurrentPathIdx] + lAddedCost;// + astar_TraverseCost( pPath->pCurrentNode, pNode );
+	pPath->SearchCycles.Unclock( );
+	g_lTicBudget -= pPath->ulNumSearchedNodes - ulNumSearchedNodes;
 
-	// If this node is already in the open list, and this path to the node isn't any better,
-	// don't do anything.
-	if (( pNode->bOnOpen[g_lCurrentPathIdx] ) && ( lNewCost >= pNode->lCostFromStart[g_lCurrentPathIdx] ))
-	{
-		return;
-	}
-	// Store the new or improved information.
-	else
-	{
-		pNode->pParent[g_lCurrentPathIdx] = pPath->pCurrentNode;
-		pNode->lDirection[g_lCurrentPathIdx] = lDirection;
-		if ( pPath->pCurrentNode == pNode )
-			I_Error( "astar_ProcessNextPathNode: Parent node same as child node!" );
-		pNode->lCostFromStart[g_lCurrentPathIdx] = lNewCost;
-		pNode->lTotalCost[g_lCurrentPathIdx] = pNode->lCostFromStart[g_lCurrentPathIdx] + astar_GetCostToGoalEstimate( pPath, pNode );
-
-		if ( pNode->bOnOpen[g_lCurrentPathIdx] == false )
-		{
-			pNode->bOnOpen[g_lCurrentPathIdx] = true;
-			astar_InsertToPriorityQueue( pNode );
+	if ( pPath->ulFlags & PF_COMPLETE )
+		astar_FinishQuery( pPath );
+}
 
-			if ( botdebug_shownodes )
-			{
-				if ( pPath->paVisualizations[( pNode->lXNodeIdx * g_lNumVerticalNodes ) + pNode->lYNodeIdx] == NULL )
-					pPath->paVisualizations[( pNode->lXNodeIdx * g_lNumVerticalNodes ) + pNode->lYNodeIdx] = Spawn( PClass::FindClass( "PathNode" ), pNode->Position.x, pNode->Position.y, ONFLOORZ, NO_REPLACE );
+//*****************************************************************************
+//
+static void astar_FinishQuery( ASTARPATH_t *pPath )
+{
+	const double	dMS = pPath->SearchCycles.TimeMS( );
+	const ULONG		ulTics = gametic - pPath->iSearchStartTic;
+
+	// Only complete searches are worth keeping.
+	if (( pPath->ulFlags & PF_GAVEUP ) == false )
+		astar_StoreInCache( pPath );
+
+	if ( pPath->ulFlags & PF_SUCCESS )
+		astar_SmoothNodeStack( pPath );
+
+	g_QueryStats.ulNumQueries++;
+	if (( pPath->ulFlags & PF_SUCCESS ) == false )
+		g_QueryStats.ulNumFailed++;
+	if ( pPath->bLeftCorridor )
+		g_QueryStats.ulNumCorridorFallbacks++;
+	g_QueryStats.ulNumSearchedNodes += pPath->ulNumSearchedNodes;
+	g_QueryStats.ulNumTics += ulTics;
+	g_QueryStats.ulMaxTics = MAX( g_QueryStats.ulMaxTics, ulTics );
+	g_QueryStats.dTotalMS += dMS;
+	g_QueryStats.dMaxMS = MAX( g_QueryStats.dMaxMS, dMS );
+}
 
-				AActor *pPathNode = pPath->paVisualizations[( pNode->lXNodeIdx * g_lNumVerticalNodes ) + pNode->lYNodeIdx];
-				pPathNode->SetState( pPathNode->SpawnState + ASTAR_FRAME_INOPEN );
-			}
+//*****************************************************************************
+//
+static void astar_Dequeue( ULONG ulPathIdx )
+{
+	ULONG	ulIdx;
+
+	for ( ulIdx = 0; ulIdx < g_PathQueue.Size( ); ulIdx++ )
+	{
+		if ( g_PathQueue[ulIdx] == ulPathIdx )
+		{
+			g_PathQueue.Delete( ulIdx );
+			return;
 		}
 	}
 }
 
 //*****************************************************************************
 //
-static ASTARNODE_t *astar_GetNode( LONG lXNodeIdx, LONG lYNodeIdx )
+// Looks for a recent search to the same goal that either started in the same subsector,
+// or whose path goes through the subsector the bot is in. Since every part of a shortest
+// path is a shortest path too, the rest of that path can be used.
+//
+static bool astar_LookUpCache( ASTARPATH_t *pPath )
 {
-	if (( lXNodeIdx >= g_lNumHorizontalNodes ) || ( lXNodeIdx < 0 ) ||
-		( lYNodeIdx >= g_lNumVerticalNodes ) || ( lYNodeIdx < 0 ))
+	ULONG	ulIdx;
+	ULONG	ulNode;
+
+	if (( pPath->pStartNode == NULL ) || ( pPath->pGoalNode == NULL ))
+		return ( false );
+
+	for ( ulIdx = 0; ulIdx < ASTAR_CACHE_SIZE; ulIdx++ )
 	{
-		return ( NULL );
+		ASTARCACHEENTRY_t	&Entry = g_aPathCache[ulIdx];
+
+		if (( Entry.pGoalNode != pPath->pGoalNode ) || ( Entry.bAvoidDamage != pPath->bAvoidDamage ) || ( gametic - Entry.iTic >= ASTAR_CACHE_TICS ))
+			continue;
+
+		if ( Entry.pStartNode == pPath->pStartNode )
+			ulNode = Entry.Nodes.Size( );
+		else if ( Entry.bSuccess == false )
+			continue;
+		else
+		{
+			for ( ulNode = 0; ulNode < Entry.Nodes.Size( ); ulNode++ )
+			{
+				if ( Entry.Nodes[ulNode]->pSubsector == pPath->pStartNode->pSubsector )
+					break;
+			}
+
+			if ( ulNode == Entry.Nodes.Size( ))
+				continue;
+		}
+
+		pPath->NodeStack.Clear( );
+		if ( Entry.bSuccess )
+		{
+			// The bot is already in the subsector node ulNode leads into, so continue with
+			// the node after it.
+			pPath->NodeStack.Push( Entry.Nodes[0] );
+			for ( ULONG ulIdx2 = 1; ulIdx2 < ulNode; ulIdx2++ )
+				pPath->NodeStack.Push( Entry.Nodes[ulIdx2] );
+
+			pPath->lTotalCost = ( ulNode < Entry.Nodes.Size( )) ? Entry.CostsToGoal[ulNode] : Entry.lTotalCost;
+			pPath->ulFlags |= PF_SUCCESS;
+		}
+
+		pPath->ulFlags |= PF_COMPLETE;
+		pPath->bFromCache = true;
+		Entry.iTic = gametic;
+		g_QueryStats.ulNumCacheHits++;
+		return ( true );
 	}
 
-	return ( &g_aMasterNodeList[( lXNodeIdx * g_lNumVerticalNodes ) + lYNodeIdx] );
+	return ( false );
 }
 
 //*****************************************************************************
 //
-static void astar_InsertToPriorityQueue( ASTARNODE_t *pNode )
+static void astar_StoreInCache( ASTARPATH_t *pPath )
 {
-	g_apOpenListPriorityQueue[g_lCurrentPathIdx][++g_ulPriorityQueuePosition[g_lCurrentPathIdx]] = pNode;
+	ASTARCACHEENTRY_t	*pEntry = &g_aPathCache[0];
+	ULONG				ulIdx;
 
-	// Resort the priority queue.
-	astar_FixUpPriorityQueue( g_ulPriorityQueuePosition[g_lCurrentPathIdx] );
+	// Only store the results of actual searches (a straight walk has no search ID).
+	if (( pPath->bFromCache ) || ( pPath->pStartNode == NULL ) || ( pPath->pGoalNode == NULL ) ||
+		(( pPath->ulFlags & PF_SUCCESS ) && ( pPath->ulSearchID == 0 )))
+	{
+		return;
+	}
+
+	// Use an empty entry, or replace the one that hasn't been used for the longest time.
+	for ( ulIdx = 0; ulIdx < ASTAR_CACHE_SIZE; ulIdx++ )
+	{
+		if ( g_aPathCache[ulIdx].pGoalNode == NULL )
+		{
+			pEntry = &g_aPathCache[ulIdx];
+			break;
+		}
+
+		if ( g_aPathCache[ulIdx].iTic < pEntry->iTic )
+			pEntry = &g_aPathCache[ulIdx];
+	}
+
+	pEntry->pStartNode = pPath->pStartNode;
+	pEntry->pGoalNode = pPath->pGoalNode;
+	pEntry->bAvoidDamage = pPath->bAvoidDamage;
+	pEntry->bSuccess = !!( pPath->ulFlags & PF_SUCCESS );
+	pEntry->lTotalCost = pPath->lTotalCost;
+	pEntry->iTic = gametic;
+	pEntry->Nodes.Clear( );
+	pEntry->CostsToGoal.Clear( );
+
+	if ( pEntry->bSuccess )
+	{
+		// The node stack has the goal first, like the entry.
+		for ( ulIdx = 0; ulIdx < pPath->NodeStack.Size( ); ulIdx++ )
+		{
+			const ULONG		ulNode = astar_GetNodeIndex( pPath->NodeStack[ulIdx] );
+
+			pEntry->Nodes.Push( pPath->NodeStack[ulIdx] );
+			pEntry->CostsToGoal.Push( pPath->lTotalCost - pPath->Scratch[ulNode].lCostFromStart );
+		}
+	}
 }
 
 //*****************************************************************************
 //
-static ASTARNODE_t *astar_PopFromPriorityQueue( void )
+static void astar_Visualize( ASTARPATH_t *pPath, ULONG ulNode, ULONG ulFrame )
 {
-	astar_Exchange( &g_apOpenListPriorityQueue[g_lCurrentPathIdx][g_ulPriorityQueuePosition[g_lCurrentPathIdx]], &g_apOpenListPriorityQueue[g_lCurrentPathIdx][1] );
-	astar_FixDownPriorityQueue( 1, g_ulPriorityQueuePosition[g_lCurrentPathIdx] - 1 );
+	if (( botdebug_shownodes == 0 ) || ( pPath->pActor == NULL ))
+		return;
 
-	return ( g_apOpenListPriorityQueue[g_lCurrentPathIdx][g_ulPriorityQueuePosition[g_lCurrentPathIdx]--] );
+	if ( pPath->Visualizations.Size( ) != g_Nodes.Size( ))
+	{
+		pPath->Visualizations.Resize( g_Nodes.Size( ));
+		memset( &pPath->Visualizations[0], 0, sizeof( AActor * ) * g_Nodes.Size( ));
+	}
+
+	if ( pPath->Visualizations[ulNode] == NULL )
+		pPath->Visualizations[ulNode] = Spawn( PClass::FindClass( "PathNode" ), g_Nodes[ulNode].Position.x, g_Nodes[ulNode].Position.y, ONFLOORZ, NO_REPLACE );
+
+	AActor	*pPathNode = pPath->Visualizations[ulNode];
+	pPathNode->SetState( pPathNode->SpawnState + ulFrame );
 }
 
 //*****************************************************************************
 //
-static void astar_FixUpPriorityQueue( ULONG ulPosition )
+static void astar_PushToOpenList( TArray<ASTAROPENENTRY_t> &OpenList, LONG lTotalCost, ULONG ulNode )
 {
-	while (( ulPosition > 1 ) &&
-		( astar_GetTotalCost( g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulPosition] ) < astar_GetTotalCost( g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulPosition / 2] )))
+	ASTAROPENENTRY_t	Entry;
+	ULONG				ulPosition;
+
+	Entry.lTotalCost = lTotalCost;
+	Entry.ulNode = ulNode;
+	ulPosition = OpenList.Push( Entry );
+
+	// Resort the priority queue.
+	while (( ulPosition > 0 ) && ( OpenList[ulPosition].lTotalCost < OpenList[( ulPosition - 1 ) / 2].lTotalCost ))
 	{
-		astar_Exchange( &g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulPosition], &g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulPosition / 2] );
-		ulPosition /= 2;
+		Entry = OpenList[ulPosition];
+		OpenList[ulPosition] = OpenList[( ulPosition - 1 ) / 2];
+		OpenList[( ulPosition - 1 ) / 2] = Entry;
+		ulPosition = ( ulPosition - 1 ) / 2;
 	}
 }
 
 //*****************************************************************************
 //
-static void astar_FixDownPriorityQueue( ULONG ulStartPosition, ULONG ulEndPosition )
+static ASTAROPENENTRY_t astar_PopFromOpenList( TArray<ASTAROPENENTRY_t> &OpenList )
 {
-	ULONG		ulChild;
-	ASTARNODE_t	*pTempNode;
+	ASTAROPENENTRY_t	Result = OpenList[0];
+	ASTAROPENENTRY_t	Entry;
+	ULONG				ulPosition = 0;
+	ULONG				ulChild;
 
-	pTempNode = g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulStartPosition];
-	while (( ulStartPosition * 2 ) < ulEndPosition )
-	{
-		ulChild = ulStartPosition * 2;
+	OpenList.Pop( Entry );
+	if ( OpenList.Size( ) == 0 )
+		return ( Result );
 
-		// If there is a right child and it is bigger than the left child, move it.
-		if (( ulChild < ulEndPosition ) && ( astar_GetTotalCost( g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulChild + 1] ) < astar_GetTotalCost( g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulChild] )))
+	// Move the last entry to the top and let it sink down.
+	while (( ulChild = ulPosition * 2 + 1 ) < OpenList.Size( ))
+	{
+		if (( ulChild + 1 < OpenList.Size( )) && ( OpenList[ulChild + 1].lTotalCost < OpenList[ulChild].lTotalCost ))
 			ulChild++;
 
-		// Move child up?
-		if ( astar_GetTotalCost( g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulChild] ) < astar_GetTotalCost( pTempNode ))
-			g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulStartPosition] = g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulChild];
-		else
+		if ( OpenList[ulChild].lTotalCost >= Entry.lTotalCost )
 			break;
 
-		ulStartPosition = ulChild;
+		OpenList[ulPosition] = OpenList[ulChild];
+		ulPosition = ulChild;
 	}
 
-	g_apOpenListPriorityQueue[g_lCurrentPathIdx][ulStartPosition] = pTempNode;
+	OpenList[ulPosition] = Entry;
+	return ( Result );
 }
 
 //*****************************************************************************
 //
-static bool astar_IsPriorityQueueEmpty( void )
+static ULONG astar_GetGraphMemory( void )
 {
-	return ( g_ulPriorityQueuePosition[g_lCurrentPathIdx] == 0 );
+	return ( g_Nodes.Max( ) * sizeof( ASTARNODE_t ) + g_Edges.Max( ) * sizeof( ASTAREDGE_t ) +
+		g_Clusters.Max( ) * sizeof( ASTARCLUSTER_t ) + g_ClusterEdges.Max( ) * sizeof( ASTAREDGE_t ));
 }
 
 //*****************************************************************************
 //
-static void astar_Exchange( ASTARNODE_t **pNode1, ASTARNODE_t **pNode2 )
+static ULONG astar_GetSearchMemory( void )
 {
-	ASTARNODE_t	*pNode3;
+	ULONG	ulMemory = 0;
+	ULONG	ulIdx;
+
+	for ( ulIdx = 0; ulIdx < MAX_PATHS; ulIdx++ )
+	{
+		const ASTARPATH_t	&Path = g_aPaths[ulIdx];
 
-	pNode3 = *pNode1;
-	*pNode1 = *pNode2;
-	*pNode2 = pNode3;
+		ulMemory += ( Path.Scratch.Max( ) + Path.ClusterScratch.Max( )) * sizeof( ASTARSCRATCH_t );
+		ulMemory += Path.OpenList.Max( ) * sizeof( ASTAROPENENTRY_t );
+		ulMemory += Path.NodeStack.Max( ) * sizeof( ASTARNODE_t * );
+		ulMemory += Path.Visualizations.Max( ) * sizeof( AActor * );
+	}
+
+	return ( ulMemory );
 }
 
 //*****************************************************************************
-//
-static ULONG astar_GetTotalCost( ASTARNODE_t *pNode )
+//	CONSOLE COMMANDS
+
+// Shows the size of the bots' navigation graph, how long it took to build and how long
+// the bots' path queries took. With an argument, that many paths between random
+// subsectors are searched as well.
+CCMD( botgraphinfo )
 {
-	return ( pNode == NULL ? 0 : pNode->lTotalCost[g_lCurrentPathIdx] );
+	// Clients don't path for bots.
+	if ( NETWORK_InClientMode( ))
+	{
+		Printf( "Only the server has a bot navigation graph.\n" );
+		return;
+	}
+
+	if ( gamestate != GS_LEVEL )
+	{
+		Printf( "You must be in a level to use this command.\n" );
+		return;
+	}
+
+	if ( ASTAR_IsInitialized( ) == false )
+	{
+		if ( level.flagsZA & LEVEL_ZA_NOBOTNODES )
+		{
+			Printf( "This level does not use bot nodes.\n" );
+			return;
+		}
+
+		ASTAR_BuildNodes( );
+	}
+
+	Printf( "%d subsectors, %d portals, %d edges, %d clusters with %d edges\n",
+		static_cast<int> (g_ulNumSubsectorNodes), static_cast<int> (g_Nodes.Size( ) - g_ulNumSubsectorNodes),
+		static_cast<int> (g_Edges.Size( )), static_cast<int> (g_Clusters.Size( )), static_cast<int> (g_ClusterEdges.Size( )));
+	Printf( "Built in %.2f ms. Graph: %d KB, search state: %d KB (a 64 unit grid would have %d cells)\n",
+		g_BuildCycles.TimeMS( ), static_cast<int> (astar_GetGraphMemory( ) / 1024), static_cast<int> (astar_GetSearchMemory( ) / 1024),
+		static_cast<int> (g_ulNumGridCells) );
+
+	if ( g_QueryStats.ulNumQueries > 0 )
+	{
+		Printf( "%d queries (%d failed, %d left their corridor), %.1f nodes searched per query\n",
+			static_cast<int> (g_QueryStats.ulNumQueries), static_cast<int> (g_QueryStats.ulNumFailed),
+			static_cast<int> (g_QueryStats.ulNumCorridorFallbacks), static_cast<double> (g_QueryStats.ulNumSearchedNodes) / g_QueryStats.ulNumQueries );
+		Printf( "Query latency: %.3f ms average, %.3f ms max, %.1f tics average, %d tics max\n",
+			g_QueryStats.dTotalMS / g_QueryStats.ulNumQueries, g_QueryStats.dMaxMS,
+			static_cast<double> (g_QueryStats.ulNumTics) / g_QueryStats.ulNumQueries, static_cast<int> (g_QueryStats.ulMaxTics) );
+		Printf( "%d queries (%.1f%%) were answered from the cache\n",
+			static_cast<int> (g_QueryStats.ulNumCacheHits), 100.0 * g_QueryStats.ulNumCacheHits / g_QueryStats.ulNumQueries );
+	}
+
+	if ( g_QueryStats.ulNumSchedulerTics > 0 )
+	{
+		Printf( "Search queue: %.2f paths average, %d max. The budget of %d nodes was used up in %d of %d tics\n",
+			static_cast<double> (g_QueryStats.ulQueueLengthSum) / g_QueryStats.ulNumSchedulerTics, static_cast<int> (g_QueryStats.ulMaxQueueLength),
+			static_cast<int> (bot_pathbudget), static_cast<int> (g_QueryStats.ulNumBudgetExhausted), static_cast<int> (g_QueryStats.ulNumSchedulerTics) );
+	}
+
+	if (( argv.argc( ) < 2 ) || ( g_ulNumSubsectorNodes == 0 ))
+		return;
+
+	// Run the queries on a path of their own, so that the bots' paths and the statistics
+	// above aren't affected. The searched node count of the current tic is restored afterwards.
+	ASTARPATH_t		Path;
+	FRandom			Random;
+	cycle_t			Cycles;
+	const int		iNumQueries = MAX( atoi( argv[1] ), 1 );
+	int				iNumFound = 0;
+	int				iNumFallbacks = 0;
+	ULONG			ulNumSearchedNodes = 0;
+	double			dTotalMS = 0;
+	double			dMaxMS = 0;
+	const LONG		lNumSearchedNodes = g_lNumSearchedNodes;
+
+	Path.pActor = NULL;
+	Path.bAvoidDamage = false;
+	Path.ulSearchID = 0;
+
+	for ( int i = 0; i < iNumQueries; i++ )
+	{
+		Path.NodeStack.Clear( );
+		Path.ulFlags = PF_INITIALIZED;
+		Path.ulNumSearchedNodes = 0;
+		Path.bLeftCorridor = false;
+		Path.pStartNode = &g_Nodes[Random( g_ulNumSubsectorNodes )];
+		Path.pGoalNode = &g_Nodes[Random( g_ulNumSubsectorNodes )];
+
+		Cycles.Reset( );
+		Cycles.Clock( );
+
+		astar_BeginSearch( &Path );
+		Path.bInCorridor = astar_FindCorridor( &Path );
+		if ( Path.bInCorridor )
+		{
+			astar_OpenStartNode( &Path );
+			while ( astar_PathNextNode( &Path ) == false )
+				;
+		}
+
+		Cycles.Unclock( );
+
+		if ( Path.ulFlags & PF_SUCCESS )
+			iNumFound++;
+		if ( Path.bLeftCorridor )
+			iNumFallbacks++;
+		ulNumSearchedNodes += Path.ulNumSearchedNodes;
+		dTotalMS += Cycles.TimeMS( );
+		dMaxMS = MAX( dMaxMS, Cycles.TimeMS( ));
+	}
+
+	g_lNumSearchedNodes = lNumSearchedNodes;
+
+	Printf( "%d random queries: %d paths found (%d left their corridor), %.1f nodes searched per query\n",
+		iNumQueries, iNumFound, iNumFallbacks, static_cast<double> (ulNumSearchedNodes) / iNumQueries );
+	Printf( "Query latency: %.3f ms average, %.3f ms max\n", dTotalMS / iNumQueries, dMaxMS );
 }
 
 //*****************************************************************************
@@ -1201,9 +1920,11 @@ ADD_STAT( pathing )
 {
 	FString	Out;
 
-	Out.Format( "Pathing cycles = %04.1f ms (%3d nodes pathed)", 
+	Out.Format( "Pathing cycles = %04.1f ms (%3d nodes pathed, %d budget left, %d searches queued)", 
 		g_PathingCycles.TimeMS(),
-		static_cast<int> (g_lNumSearchedNodes)
+		static_cast<int> (g_lNumSearchedNodes),
+		static_cast<int> (MAX<LONG>( g_lTicBudget, 0 )),
+		static_cast<int> (g_PathQueue.Size( ))
 		);
 
 	return ( Out );
@@ -53,22 +53,38 @@
 
 #include "actor.h"
 #include "doomtype.h"
+#include "stats.h"
+#include "tarray.h"
 
 //*****************************************************************************
 //	DEFINES
 
-// Size of each astar node.
-#define	ASTAR_NODE_SIZE			64
-
-#define	ASTAR_NODE_SHIFT		22
-
 #define	MAX_PATHS				( MAXPLAYERS * 2 )
 
-#define	MAX_NODES_IN_PATH		128
-
 // Maximum number of nodes that can be pathed in a tick.
 #define	MAX_NODES_TO_SEARCH		1//256
 
+// Maximum number of subsectors that are grouped into one cluster of the high level graph.
+#define	ASTAR_CLUSTER_SIZE		32
+
+// Maximum height difference a bot can climb when entering another subsector. This
+// matches what BOTPATH_TryWalk considers a jumpable ledge.
+#define	ASTAR_MAX_CLIMB			( 60 * FRACUNIT )
+
+// Minimum space between floor and ceiling a bot needs to walk into a subsector.
+#define	ASTAR_MIN_HEADROOM		( 56 * FRACUNIT )
+
+// Number of completed searches that are kept, so that other bots (or the same bot again)
+// heading for the same goal can use their result.
+#define	ASTAR_CACHE_SIZE		64
+
+// Number of tics a cached search result can be used.
+#define	ASTAR_CACHE_TICS		( TICRATE * 10 )
+
+// Distance (in map units) between the points along a subsector's boundary that are
+// used to look for neighboring subsectors.
+#define	ASTAR_PROBE_SPACING		64.0
+
 // The path has been initialized.
 #define	PF_INITIALIZED			1
 
@@ -78,53 +94,91 @@
 // The pathing algorith successfully created a path from start to goal.
 #define	PF_SUCCESS				4
 
+// The search was stopped because it exceeded its give up limit.
+#define	PF_GAVEUP				8
+
 #define	ASTAR_FRAME_INOPEN		0
 #define	ASTAR_FRAME_OFFOPEN		1
 #define	ASTAR_FRAME_INCLOSED	2
 #define	ASTAR_FRAME_ONPATH		3
 
-// Possible next steps in the pathing process.
-#define	ASTAR_NS_PULLFROMOPENLIST		0
-#define	ASTAR_NS_LOOKABOVE				1
-#define	ASTAR_NS_LOOKABOVEFORWARD		2
-#define	ASTAR_NS_LOOKFORWARD			3
-#define	ASTAR_NS_LOOKBELOWFORWARD		4
-#define	ASTAR_NS_LOOKBELOW				5
-#define	ASTAR_NS_LOOKBELOWBACK			6
-#define	ASTAR_NS_LOOKBACK				7
-#define	ASTAR_NS_LOOKABOVEBACK			8
-
 //*****************************************************************************
 //	STRUCTURES
 
-typedef struct ASTARNODE_s
+// A node of the navigation graph. Every subsector has a node at its center. Every
+// place where a bot can walk from one subsector into a neighboring one has a portal
+// node in the middle of the boundary they share. Portal nodes are directional: the
+// portal from A to B only exists if a bot can walk from A into B.
+typedef struct
+{
+	// The point the bot walks to when it heads for this node.
+	POS_t				Position;
+
+	// The subsector the bot is in once it has reached this node (the one entered
+	// through a portal node).
+	subsector_t			*pSubsector;
+
+	// The sector of that subsector.
+	sector_t			*pSector;
+
+	// The outgoing edges of this node in the graph's edge list.
+	ULONG				ulFirstEdge;
+	ULONG				ulNumEdges;
+
+	// The cluster of the high level graph this node belongs to.
+	ULONG				ulCluster;
+
+} ASTARNODE_t;
+
+//*****************************************************************************
+typedef struct
 {
-	// The XY Node indicies this node is in.
-	LONG				lXNodeIdx;
-	LONG				lYNodeIdx;
+	// The node (or cluster, in the high level graph) this edge leads to.
+	ULONG				ulTarget;
+
+	// Cost of walking along this edge.
+	LONG				lCost;
+
+} ASTAREDGE_t;
 
-	// The XY coordinates of the center of this node.
+//*****************************************************************************
+// A group of neighboring subsectors. The high level search finds the clusters a
+// path has to pass through before the nodes inside of them are searched.
+typedef struct
+{
+	// The center of all subsectors in this cluster.
 	POS_t				Position;
 
-	// Parent of this node.
-	struct ASTARNODE_s		*pParent[MAX_PATHS];
+	// The outgoing edges of this cluster in the high level graph's edge list.
+	ULONG				ulFirstEdge;
+	ULONG				ulNumEdges;
+
+} ASTARCLUSTER_t;
+
+//*****************************************************************************
+// Per path search state of a node or cluster. An entry belongs to the search with
+// the same ID, entries of older searches count as untouched, so the scratch space
+// doesn't need to be cleared between searches.
+typedef struct
+{
+	ULONG				ulSearchID;
+
+	// Parent of this node (index), -1 for the start node.
+	LONG				lParent;
 
 	// Cost of getting from the start node to this node.
-	LONG				lCostFromStart[MAX_PATHS];
+	LONG				lCostFromStart;
 
 	// lCostFromStart (g, or "gone") + h, or "heuristic".
-	LONG				lTotalCost[MAX_PATHS];
-
-	// Is this node on the open list?
-	bool				bOnOpen[MAX_PATHS];
+	LONG				lTotalCost;
 
 	// Is this node on the closed list?
-	bool				bOnClosed[MAX_PATHS];
+	bool				bOnClosed;
 
-	// Direction this node.
-	LONG				lDirection[MAX_PATHS];
+	// Is this cluster part of the high level path?
+	bool				bInCorridor;
 
-} ASTARNODE_t;
+} ASTARSCRATCH_t;
 
 //*****************************************************************************
 typedef struct
@@ -146,20 +200,19 @@ typedef struct
 //*****************************************************************************
 typedef struct
 {
-	// Flags for this path (initialized, complete, successful, etc.)
-	ULONG			ulFlags;
-
-	// The list of all the nodes to follow in this path.
-	ASTARNODE_t		*pNodeStack[MAX_NODES_IN_PATH];
+	LONG			lTotalCost;
+	ULONG			ulNode;
 
-	// Current position in the node stack.
-	LONG			lStackPos;
+} ASTAROPENENTRY_t;
 
-	// Has the goal node been reached?
-	bool			bInGoalNode;
+//*****************************************************************************
+typedef struct
+{
+	// Flags for this path (initialized, complete, successful, etc.)
+	ULONG			ulFlags;
 
-	// The next step in the pathing process.
-	ULONG			ulNextStep;
+	// The list of all the nodes to follow in this path. The next one is at the end.
+	TArray<ASTARNODE_t *>	NodeStack;
 
 	// The current node being used in the pathing process.
 	ASTARNODE_t		*pCurrentNode;
@@ -173,11 +226,43 @@ typedef struct
 	// Actor this path belongs to.
 	AActor			*pActor;
 
+	// Should the path avoid damaging sectors entirely?
+	bool			bAvoidDamage;
+
+	// Limits given by the caller: the maximum number of nodes searched per tic (0 means
+	// the search has to finish right away) and after how many nodes to give up.
+	float			fMaxSearchNodes;
+	LONG			lGiveUpLimit;
+
+	// Was the path taken from the cache?
+	bool			bFromCache;
+
 	// How many nodes have been searched?
 	ULONG			ulNumSearchedNodes;
 
-	// Dynamic array of visualizations for this path.
-	AActor			**paVisualizations;
+	// The cost of the completed path.
+	LONG			lTotalCost;
+
+	// ID of the current search, see ASTARSCRATCH_t.
+	ULONG			ulSearchID;
+
+	// Is the search restricted to the clusters found by the high level search?
+	bool			bInCorridor;
+
+	// Did the search have to give up the restriction?
+	bool			bLeftCorridor;
+
+	// Time spent on this search, and the tic it was started.
+	cycle_t			SearchCycles;
+	int				iSearchStartTic;
+
+	// Search state of every node and every cluster, and the open list.
+	TArray<ASTARSCRATCH_t>		Scratch;
+	TArray<ASTARSCRATCH_t>		ClusterScratch;
+	TArray<ASTAROPENENTRY_t>	OpenList;
+
+	// Visualizations for this path (one per node, only allocated while botdebug_shownodes is on).
+	TArray<AActor *>	Visualizations;
 
 } ASTARPATH_t;
 
@@ -188,9 +273,9 @@ void				ASTAR_Construct( void );
 void				ASTAR_BuildNodes( void );
 void				ASTAR_ClearNodes( void );
 bool				ASTAR_IsInitialized( void );
+void				ASTAR_Tick( void );
 ASTARRETURNSTRUCT_t	ASTAR_Path( ULONG ulIdx, POS_t GoalPoint, float fMaxSearchNodes, LONG lGiveUpLimit );
 POS_t				ASTAR_GetPosition( ASTARNODE_t *pNode );
-POS_t				ASTAR_GetPositionFromIndex( LONG lXIdx, LONG lYIdx );
 void				ASTAR_ClearVisualizations( void );
 void				ASTAR_ShowCosts( POS_t Position );
 void				ASTAR_ClearPath( LONG lPathIdx );
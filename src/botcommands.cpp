@@ -1048,7 +1048,12 @@ static void botcmd_GetClosestPlayerEnemy( CSkullBot *pBot )
 	if ( pBot->GetPlayer( )->health <= 0 )
 		g_iReturnInt = -1;
 
-	lClosestPlayer = -1;
+	// Check the line of sight to all possible enemies at once.
+	FSightQuery	aQueries[MAXPLAYERS];
+	bool		abVisible[MAXPLAYERS];
+	ULONG		aulCandidates[MAXPLAYERS];
+	ULONG		ulNumCandidates = 0;
+
 	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
 	{
 		if (( playeringame[ulIdx] == false ) ||
@@ -1061,10 +1066,23 @@ static void botcmd_GetClosestPlayerEnemy( CSkullBot *pBot )
 			continue;
 		}
 
+		aQueries[ulNumCandidates].Looker = pBot->GetPlayer( )->mo;
+		aQueries[ulNumCandidates].Target = players[ulIdx].mo;
+		aQueries[ulNumCandidates].Flags = SF_SEEPASTBLOCKEVERYTHING;
+		aulCandidates[ulNumCandidates++] = ulIdx;
+	}
+
+	P_CheckSightBatch( aQueries, ulNumCandidates, abVisible );
+
+	lClosestPlayer = -1;
+	for ( ULONG ulCandidate = 0; ulCandidate < ulNumCandidates; ulCandidate++ )
+	{
 		// Check if we have a line of sight to this player.
-		if ( P_CheckSight( pBot->GetPlayer( )->mo, players[ulIdx].mo, SF_SEEPASTBLOCKEVERYTHING ) == false )
+		if ( abVisible[ulCandidate] == false )
 			continue;
 
+		ulIdx = aulCandidates[ulCandidate];
+
 		Angle = R_PointToAngle2( pBot->GetPlayer( )->mo->x,
 							  pBot->GetPlayer( )->mo->y, 
 							  players[ulIdx].mo->x,
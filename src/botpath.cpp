@@ -230,47 +230,44 @@ bool P_BlockThingsIterator (int x, int y, bool(*func)(AActor*), TArray<AActor *>
 	}
 	else
 	{
-		FBlockNode *block;
 		int index = y*bmapwidth + x;
+		FBlockCell &cell = blocklinks[index];
+		int b = cell.Size();
 
-		if (actor == NULL)
+		if (actor != NULL)
 		{
-			block = blocklinks[index];
-		}
-		else
-		{
-			block = actor->BlockNode;
-			while (block != NULL && block->BlockIndex != index)
+			// Only check the actors that were linked before this one.
+			do
 			{
-				block = block->NextBlock;
-			}
-			if (block != NULL)
+				--b;
+			} while (b >= 0 && cell[b].Me != actor);
+
+			if (b < 0)
 			{
-				block = block->NextActor;
+				b = 0;
 			}
 		}
-		while (block != NULL)
+		for (b = MIN<int>(b, cell.Size()) - 1; b >= 0; b = MIN<int>(b, cell.Size()) - 1)
 		{
-			FBlockNode *next = block->NextActor;
+			AActor *me = cell[b].Me;
 			int i;
 
 			// Don't recheck things that were already checked
 			for (i = (int)checkarray.Size() - 1; i >= 0; --i)
 			{
-				if (checkarray[i] == block->Me)
+				if (checkarray[i] == me)
 				{
 					break;
 				}
 			}
 			if (i < 0)
 			{
-				checkarray.Push (block->Me);
-				if (!func (block->Me))
+				checkarray.Push (me);
+				if (!func (me))
 				{
 					return false;
 				}
 			}
-			block = next;
 		}
 	}
 	return true;
@@ -438,6 +438,10 @@ void BOTS_Tick( void )
 			}
 		}
 	}
+
+	// Continue the path searches that didn't finish in earlier tics.
+	if ( ASTAR_IsInitialized( ))
+		ASTAR_Tick( );
 }
 
 //*****************************************************************************
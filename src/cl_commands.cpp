@@ -302,7 +302,17 @@ void CLIENTCOMMANDS_ClientMove( void )
 	NETWORK_WriteByte( &CLIENT_GetLocalBuffer( )->ByteStream, CLC_CLIENTMOVE );
 	NETWORK_WriteLong( &CLIENT_GetLocalBuffer( )->ByteStream, gametic );
 	// [CK] Send the server the latest known server-gametic
-	NETWORK_WriteLong( &CLIENT_GetLocalBuffer( )->ByteStream, CLIENT_GetLatestServerGametic( ) + CLIENT_GetServerGameticOffset( ) );
+	const int serverGametic = CLIENT_GetLatestServerGametic( ) + CLIENT_GetServerGameticOffset( );
+	NETWORK_WriteLong( &CLIENT_GetLocalBuffer( )->ByteStream, serverGametic );
+
+	// Tell the server the last tic of which we received all player movement, relative to
+	// the tic above. 255 means that we can't acknowledge any tic.
+	const int ackedMovementTic = CLIENT_GetAckedMovementTic( );
+	const int movementTicAge = serverGametic - ackedMovementTic;
+	if (( ackedMovementTic >= 0 ) && ( movementTicAge >= 0 ) && ( movementTicAge < 255 ))
+		NETWORK_WriteByte( &CLIENT_GetLocalBuffer( )->ByteStream, movementTicAge );
+	else
+		NETWORK_WriteByte( &CLIENT_GetLocalBuffer( )->ByteStream, 255 );
 
 	// Decide what additional information needs to be sent.
 	ulBits = 0;
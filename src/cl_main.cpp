@@ -117,6 +117,7 @@
 #include "network_enums.h"
 #include "decallib.h"
 #include "network/servercommands.h"
+#include "network/playermovement.h"
 #include "am_map.h"
 #include "menu/menu.h"
 
@@ -166,6 +167,8 @@ CVAR( Bool, cl_showwarnings, false, CVAR_ARCHIVE )
 // [BB] Does not work with the latest ZDoom changes. Check if it's still necessary.
 //static	void	client_SetPlayerPieces( BYTESTREAM_s *pByteStream );
 static	void	client_IgnorePlayer( BYTESTREAM_s *pByteStream );
+static	void	client_ApplyPlayerMovement( player_t *player, int flags, const PlayerMovementState &state );
+static	void	client_FinishMovementTic( void );
 
 // Game commands.
 static	void	client_SetGameMode( BYTESTREAM_s *pByteStream );
@@ -370,6 +373,19 @@ static	int					g_lLatestServerGametic = 0;
 // Offset from the server gametic caused by cl_ticsperupdate.
 static	int					g_ServerGameticOffset;
 
+// The player movement we received during the last tics. Used as baseline for the
+// delta compressed movement updates.
+static	PlayerMovementHistory	g_MovementHistory;
+
+// The tic the player movement in the packet we are parsing belongs to, -1 if unknown.
+static	int					g_MovementTic = -1;
+
+// Did we fail to decode any of the player movement of g_MovementTic?
+static	bool				g_bMovementTicIncomplete;
+
+// The last tic of which we received all player movement, -1 if none.
+static	int					g_AckedMovementTic = -1;
+
 // [TP] Client's understanding of the account names of players.
 static FString				g_PlayerAccountNames[MAXPLAYERS];
 
@@ -762,6 +778,14 @@ int CLIENT_GetServerGameticOffset( void )
 	return g_ServerGameticOffset;
 }
 
+//*****************************************************************************
+//
+// The last tic of which we received all player movement, -1 if none.
+int CLIENT_GetAckedMovementTic( void )
+{
+	return g_AckedMovementTic;
+}
+
 //*****************************************************************************
 //
 bool CLIENT_GetFullUpdateIncomplete ( void )
@@ -829,6 +853,11 @@ void CLIENT_AttemptConnection( void )
 	g_bServerLagging = false;
 	g_bClientLagging = false;
 
+	g_MovementHistory.Clear( );
+	g_MovementTic = -1;
+	g_bMovementTicIncomplete = false;
+	g_AckedMovementTic = -1;
+
 	g_bPacketNum = 0;
 	g_lCurrentPosition = 0;
 	g_lLastParsedSequence = -1;
@@ -1269,6 +1298,9 @@ void CLIENT_ParsePacket( BYTESTREAM_s *pByteStream, bool bSequencedPacket )
 
 	}
 
+	// The player movement of this packet is complete now.
+	client_FinishMovementTic( );
+
 	// All done!
 	g_bIsParsingPacket = false;
 
@@ -2230,7 +2262,7 @@ void CLIENT_PrintCommand( LONG lCommand )
 	{
 		if (( cl_showcommands >= 2 ) && ( lCommand == SVC_MOVELOCALPLAYER ))
 			return;
-		if (( cl_showcommands >= 3 ) && ( lCommand == SVC_MOVEPLAYER ))
+		if (( cl_showcommands >= 3 ) && (( lCommand == SVC_MOVEPLAYER ) || ( lCommand == SVC_MOVEPLAYERDELTA ) || ( lCommand == SVC_PLAYERMOVEMENTTIC )))
 			return;
 		if (( cl_showcommands >= 4 ) && ( lCommand == SVC_UPDATEPLAYEREXTRADATA ))
 			return;
@@ -3633,23 +3665,89 @@ void ServerCommands::MovePlayer::Execute()
 		// Don't move the player since the server didn't send any useful position information.
 		return;
 	}
-	else
-		player->mo->renderflags &= ~RF_INVISIBLE;
+
+	PlayerMovementState state;
+	state.Set( x, y, z, angle, velx, vely, velz, isCrouching );
+
+	// Remember the movement, the server may send the following updates relative to it.
+	if ( g_MovementTic >= 0 )
+		g_MovementHistory.Store( player - players, g_MovementTic, state );
+
+	client_ApplyPlayerMovement( player, flags, state );
+}
+
+//*****************************************************************************
+//
+void ServerCommands::PlayerMovementTic::Execute()
+{
+	client_FinishMovementTic( );
+	g_MovementTic = tic;
+}
+
+//*****************************************************************************
+//
+void ServerCommands::MovePlayerDelta::Execute()
+{
+	// Check to make sure everything is valid. If not, break out.
+	if ( gamestate != GS_LEVEL )
+	{
+		CLIENT_PrintWarning( "MovePlayerDelta: not in a level\n" );
+		return;
+	}
+
+	const ULONG ulPlayer = player - players;
+	const PlayerMovementState *pBaseline = ( g_MovementTic >= 0 ) ? g_MovementHistory.Find( ulPlayer, g_MovementTic - baselineAge ) : NULL;
+
+	// Without the baseline, we can't do anything with this update. Since we don't know
+	// the movement of this tic completely, we must not acknowledge it.
+	if ( pBaseline == NULL )
+	{
+		CLIENT_PrintWarning( "MovePlayerDelta: Missing baseline %d tics before tic %d for player %d\n", baselineAge, g_MovementTic, static_cast<int>( ulPlayer ));
+		g_bMovementTicIncomplete = true;
+		return;
+	}
+
+	PlayerMovementState state = *pBaseline;
+	if ( fields & PLAYERMOVE_X )
+		state.x = x;
+	if ( fields & PLAYERMOVE_Y )
+		state.y = y;
+	if ( fields & PLAYERMOVE_Z )
+		state.z = z;
+	if ( fields & PLAYERMOVE_ANGLE )
+		state.angle = angle;
+	if ( fields & PLAYERMOVE_VELX )
+		state.velx = velx;
+	if ( fields & PLAYERMOVE_VELY )
+		state.vely = vely;
+	if ( fields & PLAYERMOVE_VELZ )
+		state.velz = velz;
+	state.isCrouching = !!( fields & PLAYERMOVE_CROUCHING );
+
+	g_MovementHistory.Store( ulPlayer, g_MovementTic, state );
+	client_ApplyPlayerMovement( player, flags, state );
+}
+
+//*****************************************************************************
+//
+static void client_ApplyPlayerMovement( player_t *player, int flags, const PlayerMovementState &state )
+{
+	player->mo->renderflags &= ~RF_INVISIBLE;
 
 	// Set the player's XYZ position.
 	// [BB] But don't just set the position, but also properly set floorz and ceilingz, etc.
-	CLIENT_MoveThing( player->mo, x, y, z );
+	CLIENT_MoveThing( player->mo, state.x, state.y, state.z );
 
 	// Set the player's angle.
-	player->mo->angle = angle;
+	player->mo->angle = state.angle;
 
 	// Set the player's XYZ momentum.
-	player->mo->velx = velx;
-	player->mo->vely = vely;
-	player->mo->velz = velz;
+	player->mo->velx = state.velx;
+	player->mo->vely = state.vely;
+	player->mo->velz = state.velz;
 
 	// Is the player crouching?
-	player->crouchdir = ( isCrouching ) ? 1 : -1;
+	player->crouchdir = ( state.isCrouching ) ? 1 : -1;
 
 	if (( player->crouchdir == 1 ) &&
 		( player->crouchfactor < FRACUNIT ) &&
@@ -3676,6 +3774,20 @@ void ServerCommands::MovePlayer::Execute()
 		player->cmd.ucmd.buttons &= ~BT_ALTATTACK;
 }
 
+//*****************************************************************************
+//
+// Acknowledges the player movement of the current tic, unless some of it
+// couldn't be decoded.
+//
+static void client_FinishMovementTic( void )
+{
+	if (( g_MovementTic > g_AckedMovementTic ) && ( g_bMovementTicIncomplete == false ))
+		g_AckedMovementTic = g_MovementTic;
+
+	g_MovementTic = -1;
+	g_bMovementTicIncomplete = false;
+}
+
 //*****************************************************************************
 //
 void ServerCommands::DamagePlayer::Execute()
@@ -6211,6 +6323,7 @@ void ServerCommands::SetSectorFloorPlane::Execute()
 
 	// Change the height.
 	sector->floorplane.ChangeHeight( -delta );
+	P_InvalidateSightCache( );
 
 	// Call this to update various actor's within the sector.
 	P_ChangeSector( sector, false, -delta, 0, false );
@@ -6234,6 +6347,7 @@ void ServerCommands::SetSectorCeilingPlane::Execute()
 
 	// Change the height.
 	sector->ceilingplane.ChangeHeight( delta );
+	P_InvalidateSightCache( );
 
 	// Finally, adjust textures.
 	sector->SetPlaneTexZ(sector_t::ceiling, sector->GetPlaneTexZ(sector_t::ceiling) + sector->ceilingplane.HeightDiff( lastPos ) );
@@ -6576,6 +6690,7 @@ void ServerCommands::SetSomeLineFlags::Execute()
 {
 	line->flags &= ~(ML_BLOCKING|ML_BLOCK_PLAYERS|ML_BLOCKEVERYTHING|ML_RAILING|ML_ADDTRANS);
 	line->flags |= blockFlags;
+	P_InvalidateSightCache( );
 }
 
 //*****************************************************************************
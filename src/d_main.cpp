@@ -2721,6 +2721,106 @@ static void CheckCmdLine()
 	}
 }
 
+//==========================================================================
+//
+// FStartupPhase
+//
+// Times one step of the startup. Before the step parses its lumps they
+// can be prefetched, which reads and decompresses lumps from different
+// files in parallel and follows their includes. The parsing itself still
+// happens in order on this thread, because it registers everything as it
+// goes. With -stdout the time of every phase is printed.
+//
+//==========================================================================
+
+class FStartupPhase
+{
+public:
+	FStartupPhase (const char *name)
+	{
+		Name = name;
+		PrefetchMS = 0;
+		PrefetchBytes = 0;
+		Total.Reset ();
+		Total.Clock ();
+	}
+
+	~FStartupPhase ()
+	{
+		Wads.ReleasePrefetchedLumps (Prefetched);
+		Total.Unclock ();
+
+		if (Args->CheckParm ("-stdout"))
+		{
+			Printf ("%s: %.1f ms", Name, Total.TimeMS ());
+			if (Prefetched.Size () > 0)
+			{
+				Printf (" (%.1f ms prefetching %u lumps, %d KB)", PrefetchMS, Prefetched.Size (), PrefetchBytes / 1024);
+			}
+			Printf ("\n");
+		}
+	}
+
+	void Prefetch (const char *const *lumpnames);
+
+private:
+	const char *Name;
+	TArray<int> Prefetched;
+	cycle_t Total;
+	double PrefetchMS;
+	int PrefetchBytes;
+};
+
+void FStartupPhase::Prefetch (const char *const *lumpnames)
+{
+	if (Args->CheckParm ("-noprefetch"))
+	{
+		return;
+	}
+
+	cycle_t time;
+	TArray<int> lumps;
+
+	time.Reset ();
+	time.Clock ();
+	for (; *lumpnames != NULL; lumpnames++)
+	{
+		int lump, lastlump = 0;
+
+		while ((lump = Wads.FindLump (*lumpnames, &lastlump)) != -1)
+		{
+			lumps.Push (lump);
+		}
+	}
+
+	// Included lumps are only known once their parents have been read, so
+	// this goes in waves. Nesting deeper than a few levels is unusual and
+	// will simply be read by the parser itself.
+	for (int wave = 0; wave < 4 && lumps.Size () > 0; wave++)
+	{
+		TArray<FString> includes;
+
+		Wads.PrefetchLumps (lumps, &includes);
+		for (unsigned i = 0; i < lumps.Size (); i++)
+		{
+			Prefetched.Push (lumps[i]);
+			PrefetchBytes += Wads.LumpLength (lumps[i]);
+		}
+
+		lumps.Clear ();
+		for (unsigned i = 0; i < includes.Size (); i++)
+		{
+			int lump = Wads.CheckNumForFullName (includes[i], true);
+			if (lump >= 0)
+			{
+				lumps.Push (lump);
+			}
+		}
+	}
+	time.Unclock ();
+	PrefetchMS += time.TimeMS ();
+}
+
 //==========================================================================
 //
 // FinalGC
@@ -2896,7 +2996,12 @@ void D_DoomMain (void)
 		GAMEMODE_ParseGamemodeInfo( );
 
 		// [RH] Initialize localizable strings.
-		GStrings.LoadStrings (false);
+		{
+			static const char *const lumps[] = { "LANGUAGE", NULL };
+			FStartupPhase phase ("LoadStrings");
+			phase.Prefetch (lumps);
+			GStrings.LoadStrings (false);
+		}
 
 		V_InitFontColors ();
 
@@ -2955,11 +3060,21 @@ void D_DoomMain (void)
 
 		// [RH] Parse any SNDINFO lumps
 		Printf ("S_InitData: Load sound definitions.\n");
-		S_InitData ();
+		{
+			static const char *const lumps[] = { "SNDINFO", "SNDSEQ", NULL };
+			FStartupPhase phase ("S_InitData");
+			phase.Prefetch (lumps);
+			S_InitData ();
+		}
 
 		// [RH] Parse through all loaded mapinfo lumps
 		Printf ("G_ParseMapInfo: Load map definitions.\n");
-		G_ParseMapInfo (iwad_info->MapInfo);
+		{
+			static const char *const lumps[] = { "MAPINFO", "ZMAPINFO", NULL };
+			FStartupPhase phase ("G_ParseMapInfo");
+			phase.Prefetch (lumps);
+			G_ParseMapInfo (iwad_info->MapInfo);
+		}
 		ReadStatistics();
 
 		// MUSINFO must be parsed after MAPINFO
@@ -2969,7 +3084,12 @@ void D_DoomMain (void)
 		SECTINFO_Load();
 
 		Printf ("Texman.Init: Init texture manager.\n");
-		TexMan.Init();
+		{
+			static const char *const lumps[] = { "TEXTURES", "ANIMDEFS", NULL };
+			FStartupPhase phase ("Texman.Init");
+			phase.Prefetch (lumps);
+			TexMan.Init();
+		}
 		C_InitConback();
 
 		// [CW] Parse any TEAMINFO lumps.
@@ -2978,7 +3098,12 @@ void D_DoomMain (void)
 		// [BB] At the moment Skulltag still doesn't use the new ZDoom TeamLibrary class.
 		TEAMINFO_Init ();
 
-		FActorInfo::StaticInit ();
+		{
+			static const char *const lumps[] = { "DECORATE", NULL };
+			FStartupPhase phase ("FActorInfo::StaticInit");
+			phase.Prefetch (lumps);
+			FActorInfo::StaticInit ();
+		}
 
 		// [GRB] Initialize player class list
 		SetupPlayerClasses ();
@@ -3000,7 +3125,12 @@ void D_DoomMain (void)
 		R_Init ();
 
 		Printf ("DecalLibrary: Load decals.\n");
-		DecalLibrary.ReadAllDecals ();
+		{
+			static const char *const lumps[] = { "DECALDEF", NULL };
+			FStartupPhase phase ("DecalLibrary");
+			phase.Prefetch (lumps);
+			DecalLibrary.ReadAllDecals ();
+		}
 
 		// [RH] Add any .deh and .bex files on the command line.
 		// If there are none, try adding any in the config file.
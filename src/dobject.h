@@ -490,15 +490,9 @@ public:
 		Class = inClass;
 	}
 
-	void *operator new(size_t len)
-	{
-		return M_Malloc(len);
-	}
-
-	void operator delete (void *mem)
-	{
-		M_Free(mem);
-	}
+	// Objects are allocated from the object pool. See dobjpool.cpp.
+	void *operator new(size_t len);
+	void operator delete (void *mem);
 
 	// GC fiddling
 
@@ -564,7 +558,7 @@ protected:
 
 	void operator delete (void *mem, EInPlace *)
 	{
-		M_Free (mem);
+		operator delete (mem);
 	}
 };
 
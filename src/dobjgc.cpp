@@ -74,6 +74,7 @@
 #include "v_video.h"
 #include "menu/menu.h"
 #include "intermission/intermission.h"
+#include "c_cvars.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -106,6 +107,11 @@
 #define GCSWEEPCOST		10
 #define GCFINALIZECOST	100
 
+// Upper bounds (in ms) of the buckets of the GC pause histogram. The last
+// bucket collects everything above.
+#define NUM_PAUSEBUCKETS	8
+static const double PauseBucketLimits[NUM_PAUSEBUCKETS - 1] = { 0.1, 0.25, 0.5, 1, 2, 4, 8 };
+
 // TYPES -------------------------------------------------------------------
 
 // This object is responsible for marking sectors during the propagate
@@ -135,6 +141,11 @@ extern DThinker *NextToThink;
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
+// Maximum time in ms the collector may spend per tic (0 = no limit). If
+// memory grows too much while collection steps are held back, they are
+// done anyway.
+CVAR (Float, gc_ticbudget, 2.f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
 namespace GC
 {
 size_t AllocBytes;
@@ -155,6 +166,15 @@ size_t Dept;
 
 static DSectorMarker *SectorMarker;
 
+// Time spent collecting during the tic BudgetTic.
+static cycle_t TicCycles;
+static int BudgetTic = -1;
+static bool BudgetExhausted;
+
+static int PauseHistogram[NUM_PAUSEBUCKETS];
+static double LastPause, MaxPause;
+static int BudgetTics, ForcedSteps;
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -170,6 +190,52 @@ void SetThreshold()
 	Threshold = (Estimate / 100) * Pause;
 }
 
+//==========================================================================
+//
+// BeginTic
+//
+// Once per tic, adds the time the collector needed during the previous
+// tic to the pause histogram and resets the budget.
+//
+//==========================================================================
+
+static void BeginTic()
+{
+	if (BudgetTic == gametic)
+	{
+		return;
+	}
+
+	double pause = TicCycles.TimeMS();
+	if (pause > 0)
+	{
+		int bucket = 0;
+		while (bucket < NUM_PAUSEBUCKETS - 1 && pause > PauseBucketLimits[bucket])
+		{
+			bucket++;
+		}
+		PauseHistogram[bucket]++;
+		LastPause = pause;
+		MaxPause = MAX(MaxPause, pause);
+	}
+	TicCycles.Reset();
+	BudgetTic = gametic;
+	BudgetExhausted = false;
+}
+
+//==========================================================================
+//
+// ResetPauseStats
+//
+//==========================================================================
+
+static void ResetPauseStats()
+{
+	memset(PauseHistogram, 0, sizeof(PauseHistogram));
+	LastPause = MaxPause = 0;
+	BudgetTics = ForcedSteps = 0;
+}
+
 //==========================================================================
 //
 // PropagateMark
@@ -442,6 +508,19 @@ static size_t SingleStep()
 
 void Step()
 {
+	BeginTic();
+	if (BudgetExhausted)
+	{
+		// Let the memory grow to twice the threshold before we exceed the
+		// budget.
+		if (AllocBytes / 2 < Threshold)
+		{
+			return;
+		}
+		ForcedSteps++;
+	}
+	TicCycles.Clock();
+
 	size_t lim = (GCSTEPSIZE/100) * StepMul;
 	size_t olim;
 	if (lim == 0)
@@ -472,6 +551,13 @@ void Step()
 		SetThreshold();
 	}
 	StepCount++;
+
+	TicCycles.Unclock();
+	if (!BudgetExhausted && gc_ticbudget > 0 && TicCycles.TimeMS() >= gc_ticbudget)
+	{
+		BudgetExhausted = true;
+		BudgetTics++;
+	}
 }
 
 //==========================================================================
@@ -721,6 +807,19 @@ ADD_STAT(gc)
 	{
 		out.AppendFormat("  %zuK", (GC::Dept + 1023) >> 10);
 	}
+	out.AppendFormat("\nPause: %.2f ms (%.2f max)  Over budget: %d tics  Forced steps: %d\n",
+		GC::LastPause, GC::MaxPause, GC::BudgetTics, GC::ForcedSteps);
+	for (int i = 0; i < NUM_PAUSEBUCKETS; ++i)
+	{
+		if (i < NUM_PAUSEBUCKETS - 1)
+		{
+			out.AppendFormat("<%gms:%d  ", PauseBucketLimits[i], GC::PauseHistogram[i]);
+		}
+		else
+		{
+			out.AppendFormat(">%gms:%d", PauseBucketLimits[i - 1], GC::PauseHistogram[i]);
+		}
+	}
 	return out;
 }
 
@@ -736,7 +835,7 @@ CCMD(gc)
 {
 	if (argv.argc() == 1)
 	{
-		Printf ("Usage: gc stop|now|full|pause [size]|stepmul [size]\n");
+		Printf ("Usage: gc stop|now|full|pause [size]|stepmul [size]|resetstats\n");
 		return;
 	}
 	if (stricmp(argv[1], "stop") == 0)
@@ -762,6 +861,10 @@ CCMD(gc)
 			GC::Pause = MAX(1,atoi(argv[2]));
 		}
 	}
+	else if (stricmp(argv[1], "resetstats") == 0)
+	{
+		GC::ResetPauseStats();
+	}
 	else if (stricmp(argv[1], "stepmul") == 0)
 	{
 		if (argv.argc() == 2)
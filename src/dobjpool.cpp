@@ -0,0 +1,424 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: dobjpool.cpp
+//
+// Description: Size-bucketed pool allocator for DObjects.
+//
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <stdlib.h>
+#include "doomtype.h"
+#include "m_alloc.h"
+#include "i_system.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "dobject.h"
+#include "dobjpool.h"
+#include "stats.h"
+#include "tarray.h"
+#include "templates.h"
+
+// MACROS ------------------------------------------------------------------
+
+// Marks an allocation that doesn't belong to any bucket.
+#define NO_BUCKET	0xFFFFFFFF
+
+// TYPES -------------------------------------------------------------------
+
+// Precedes every object. It is as large as the alignment malloc guarantees
+// so that the object itself stays aligned the same way.
+struct FObjectPool::Header
+{
+	DWORD Bucket;
+	DWORD Padding[3];
+};
+
+struct FObjectPool::Slab
+{
+	Slab *Next;
+	void *Memory;
+	size_t Bytes;
+};
+
+struct FObjectPool::FreeNode
+{
+	FreeNode *Next;
+};
+
+// PUBLIC DATA DEFINITIONS -------------------------------------------------
+
+FObjectPool ObjectPool;
+
+// Take the memory for small objects from the object pool.
+CVAR (Bool, objectpool, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+// CODE --------------------------------------------------------------------
+
+//==========================================================================
+//
+// FObjectPool Constructor
+//
+// There is no destructor, since objects can still be freed during shutdown
+// after this pool would have been destroyed. The system reclaims the slabs.
+//
+//==========================================================================
+
+FObjectPool::FObjectPool()
+{
+	memset(Buckets, 0, sizeof(Buckets));
+	SlabBytes = 0;
+	NumPooledAllocs = 0;
+	NumSlabAllocs = 0;
+}
+
+//==========================================================================
+//
+// FObjectPool :: Alloc
+//
+//==========================================================================
+
+void *FObjectPool::Alloc(size_t size)
+{
+	Header *header;
+	size_t fullsize = size + sizeof(Header);
+
+	if (objectpool && fullsize <= MAX_POOLED_SIZE)
+	{
+		int bucketnum = int((fullsize + GRANULARITY - 1) / GRANULARITY) - 1;
+		Bucket &bucket = Buckets[bucketnum];
+
+		if (bucket.FreeList == NULL)
+		{
+			AddSlab(bucketnum);
+		}
+		FreeNode *node = bucket.FreeList;
+		bucket.FreeList = node->Next;
+		bucket.NumFree--;
+		bucket.NumLive++;
+		NumPooledAllocs++;
+		GC::AllocBytes += (bucketnum + 1) * GRANULARITY;
+
+		header = (Header *)node;
+		header->Bucket = bucketnum;
+	}
+	else
+	{
+		header = (Header *)M_Malloc(fullsize);
+		header->Bucket = NO_BUCKET;
+	}
+	return header + 1;
+}
+
+//==========================================================================
+//
+// FObjectPool :: Free
+//
+//==========================================================================
+
+void FObjectPool::Free(void *mem)
+{
+	if (mem == NULL)
+	{
+		return;
+	}
+
+	Header *header = (Header *)mem - 1;
+	if (header->Bucket == NO_BUCKET)
+	{
+		M_Free(header);
+		return;
+	}
+
+	assert(header->Bucket < NUM_BUCKETS);
+	Bucket &bucket = Buckets[header->Bucket];
+	assert(bucket.NumLive > 0);
+
+	GC::AllocBytes -= (header->Bucket + 1) * GRANULARITY;
+	FreeNode *node = (FreeNode *)header;
+	node->Next = bucket.FreeList;
+	bucket.FreeList = node;
+	bucket.NumFree++;
+	bucket.NumLive--;
+}
+
+//==========================================================================
+//
+// FObjectPool :: AddSlab
+//
+// Allocates a new slab for a bucket and puts all of its entries on the
+// bucket's free list. Slabs are not counted in GC::AllocBytes, only the
+// objects taken from them are.
+//
+//==========================================================================
+
+void FObjectPool::AddSlab(int bucketnum)
+{
+	Bucket &bucket = Buckets[bucketnum];
+	size_t objsize = (bucketnum + 1) * GRANULARITY;
+	size_t count = MAX<size_t>(SLAB_SIZE / objsize, 4);
+	size_t bytes = count * objsize;
+
+	// Entries must be aligned as well as malloc aligns, which the
+	// granularity is a multiple of.
+	BYTE *mem = (BYTE *)malloc(bytes + GRANULARITY);
+	if (mem == NULL)
+	{
+		I_FatalError("Could not allocate an object pool slab of %zu bytes", bytes);
+	}
+	BYTE *entries = (BYTE *)(((size_t)mem + GRANULARITY - 1) & ~(size_t)(GRANULARITY - 1));
+
+	Slab *slab = new Slab;
+	slab->Memory = mem;
+	slab->Bytes = bytes + GRANULARITY;
+	slab->Next = bucket.Slabs;
+	bucket.Slabs = slab;
+	bucket.NumSlabs++;
+	SlabBytes += slab->Bytes;
+	NumSlabAllocs++;
+
+	// Link the entries backwards so that they are handed out in address order.
+	for (size_t i = count; i-- > 0; )
+	{
+		FreeNode *node = (FreeNode *)(entries + i * objsize);
+		node->Next = bucket.FreeList;
+		bucket.FreeList = node;
+	}
+	bucket.NumFree += count;
+}
+
+//==========================================================================
+//
+// FObjectPool :: ReleaseUnused
+//
+// Called after a level has been unloaded. Buckets that still contain live
+// objects (e.g. the inventory of travelling players) keep their slabs.
+//
+//==========================================================================
+
+void FObjectPool::ReleaseUnused()
+{
+	for (int i = 0; i < NUM_BUCKETS; ++i)
+	{
+		Bucket &bucket = Buckets[i];
+
+		if (bucket.NumLive != 0 || bucket.Slabs == NULL)
+		{
+			continue;
+		}
+		for (Slab *next, *slab = bucket.Slabs; slab != NULL; slab = next)
+		{
+			next = slab->Next;
+			SlabBytes -= slab->Bytes;
+			free(slab->Memory);
+			delete slab;
+		}
+		bucket.Slabs = NULL;
+		bucket.FreeList = NULL;
+		bucket.NumFree = 0;
+		bucket.NumSlabs = 0;
+	}
+}
+
+//==========================================================================
+//
+// FObjectPool :: GetBucketStats
+//
+//==========================================================================
+
+void FObjectPool::GetBucketStats(int bucketnum, BucketStats &stats) const
+{
+	const Bucket &bucket = Buckets[bucketnum];
+
+	stats.ObjectSize = (bucketnum + 1) * GRANULARITY;
+	stats.NumLive = bucket.NumLive;
+	stats.NumFree = bucket.NumFree;
+	stats.NumSlabs = bucket.NumSlabs;
+}
+
+//==========================================================================
+//
+// DObject :: operator new / operator delete
+//
+//==========================================================================
+
+void *DObject::operator new(size_t len)
+{
+	return ObjectPool.Alloc(len);
+}
+
+void DObject::operator delete (void *mem)
+{
+	ObjectPool.Free(mem);
+}
+
+//==========================================================================
+//
+// CountObjectClasses
+//
+// Counts the live objects and their memory for every class.
+//
+//==========================================================================
+
+struct FClassCount
+{
+	const PClass *Type;
+	size_t Count;
+	size_t Bytes;
+};
+
+static void CountObjectClasses(TArray<FClassCount> &counts)
+{
+	TMap<const PClass *, unsigned int> indices;
+
+	counts.Clear();
+	for (DObject *obj = GC::Root; obj != NULL; obj = obj->ObjNext)
+	{
+		const PClass *type = obj->GetClass();
+		unsigned int *index = indices.CheckKey(type);
+		if (index == NULL)
+		{
+			FClassCount count = { type, 0, 0 };
+			index = &indices[type];
+			*index = counts.Push(count);
+		}
+		counts[*index].Count++;
+		counts[*index].Bytes += type->Size;
+	}
+}
+
+static int STACK_ARGS CompareClassCounts(const void *a, const void *b)
+{
+	const FClassCount *ca = (const FClassCount *)a;
+	const FClassCount *cb = (const FClassCount *)b;
+
+	if (ca->Bytes != cb->Bytes)
+	{
+		return ca->Bytes < cb->Bytes ? 1 : -1;
+	}
+	return stricmp(ca->Type->TypeName.GetChars(), cb->Type->TypeName.GetChars());
+}
+
+static void SortObjectClasses(TArray<FClassCount> &counts)
+{
+	if (counts.Size() > 1)
+	{
+		qsort(&counts[0], counts.Size(), sizeof(FClassCount), CompareClassCounts);
+	}
+}
+
+//==========================================================================
+//
+// STAT objects
+//
+// Shows the state of the object pool and the classes that use the most
+// memory.
+//
+//==========================================================================
+
+ADD_STAT(objects)
+{
+	TArray<FClassCount> counts;
+	size_t live = 0, numfree = 0, totalobjs = 0, totalbytes = 0;
+	FString out;
+
+	for (int i = 0; i < FObjectPool::NUM_BUCKETS; ++i)
+	{
+		FObjectPool::BucketStats stats;
+		ObjectPool.GetBucketStats(i, stats);
+		live += stats.NumLive;
+		numfree += stats.NumFree;
+	}
+
+	CountObjectClasses(counts);
+	SortObjectClasses(counts);
+	for (unsigned int i = 0; i < counts.Size(); ++i)
+	{
+		totalobjs += counts[i].Count;
+		totalbytes += counts[i].Bytes;
+	}
+
+	out.Format("Objects: %zu (%zuK)  Pool: %zu live %zu free %zuK in slabs  Allocs: %zu pooled %zu slabs\n",
+		totalobjs, (totalbytes + 1023) >> 10, live, numfree, (ObjectPool.GetSlabBytes() + 1023) >> 10,
+		ObjectPool.GetNumPooledAllocs(), ObjectPool.GetNumSlabAllocs());
+	for (unsigned int i = 0; i < counts.Size() && i < 10; ++i)
+	{
+		out.AppendFormat("%-24s %6zu %7zuK\n", counts[i].Type->TypeName.GetChars(),
+			counts[i].Count, (counts[i].Bytes + 1023) >> 10);
+	}
+	return out;
+}
+
+//==========================================================================
+//
+// CCMD dumpobjects
+//
+// Lists the number of live objects and their memory for every class.
+//
+//==========================================================================
+
+CCMD(dumpobjects)
+{
+	TArray<FClassCount> counts;
+
+	CountObjectClasses(counts);
+	SortObjectClasses(counts);
+	for (unsigned int i = 0; i < counts.Size(); ++i)
+	{
+		Printf("%-32s %7zu objects %9zu bytes\n", counts[i].Type->TypeName.GetChars(),
+			counts[i].Count, counts[i].Bytes);
+	}
+	Printf("%u classes\n", counts.Size());
+
+	Printf("\nPool buckets:\n");
+	for (int i = 0; i < FObjectPool::NUM_BUCKETS; ++i)
+	{
+		FObjectPool::BucketStats stats;
+		ObjectPool.GetBucketStats(i, stats);
+		if (stats.NumSlabs > 0)
+		{
+			Printf("%5zu bytes: %7zu live %7zu free %4zu slabs\n",
+				stats.ObjectSize, stats.NumLive, stats.NumFree, stats.NumSlabs);
+		}
+	}
+}
@@ -0,0 +1,126 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: dobjpool.h
+//
+// Description: Size-bucketed pool allocator for DObjects.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __DOBJPOOL_H__
+#define __DOBJPOOL_H__
+
+#include "doomtype.h"
+
+//==========================================================================
+//
+// FObjectPool
+//
+// Hands out the memory for all DObjects. Objects up to MAX_POOLED_SIZE
+// bytes are taken from per-size buckets that are carved out of large
+// slabs, and freed objects are put on the bucket's free list, so spawning
+// and collecting lots of projectiles and puffs does not go through malloc
+// every time. Larger objects still use M_Malloc.
+//
+// Every allocation is preceded by a small header that records which bucket
+// it came from. The bytes handed out are counted in GC::AllocBytes like
+// they would be by M_Malloc, so the collector is paced the same way.
+//
+//==========================================================================
+
+class FObjectPool
+{
+public:
+	enum
+	{
+		GRANULARITY = 16,
+		NUM_BUCKETS = 256,
+		MAX_POOLED_SIZE = GRANULARITY * NUM_BUCKETS,
+		SLAB_SIZE = 64*1024,
+	};
+
+	struct BucketStats
+	{
+		size_t ObjectSize;
+		size_t NumLive;
+		size_t NumFree;
+		size_t NumSlabs;
+	};
+
+	FObjectPool();
+
+	void *Alloc(size_t size);
+	void Free(void *mem);
+
+	// Returns the slabs of all buckets without live objects to the system.
+	void ReleaseUnused();
+
+	void GetBucketStats(int bucket, BucketStats &stats) const;
+	size_t GetSlabBytes() const { return SlabBytes; }
+	size_t GetNumPooledAllocs() const { return NumPooledAllocs; }
+	size_t GetNumSlabAllocs() const { return NumSlabAllocs; }
+
+private:
+	struct Header;
+	struct Slab;
+	struct FreeNode;
+
+	struct Bucket
+	{
+		FreeNode *FreeList;
+		Slab *Slabs;
+		size_t NumLive;
+		size_t NumFree;
+		size_t NumSlabs;
+	};
+
+	void AddSlab(int bucket);
+
+	Bucket Buckets[NUM_BUCKETS];
+	size_t SlabBytes;
+	size_t NumPooledAllocs;
+	size_t NumSlabAllocs;
+};
+
+extern FObjectPool ObjectPool;
+
+#endif //__DOBJPOOL_H__
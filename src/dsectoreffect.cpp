@@ -29,6 +29,7 @@
 #include "r_data/r_interpolate.h"
 #include "statnums.h"
 #include "farchive.h"
+#include "unlagged.h"
 
 IMPLEMENT_CLASS (DSectorEffect)
 
@@ -172,6 +173,10 @@ DMover::EResult DMover::MovePlane (fixed_t speed, fixed_t dest, int crush,
 	else
 		m_Sector->bCeilingHeightChange = true;
 
+	// Let the unlagged module record where the sector was before it moved.
+	UNLAGGED_SectorMoving( m_Sector );
+	P_InvalidateSightCache( );
+
 	switch (floorOrCeiling)
 	{
 	case 0:
@@ -107,6 +107,7 @@
 #include "possession.h"
 #include "statnums.h"
 #include "domination.h"
+#include "unlagged.h"
 #include "win32/g15/g15.h"
 #include "gl/dynlights/gl_dynlight.h"
 #include "p_3dmidtex.h"
@@ -3528,6 +3529,8 @@ void GAME_ResetMap( bool bRunEnterScripts )
 */
 		if ( sectors[ulIdx].bCeilingHeightChange )
 		{
+			UNLAGGED_SectorMoving( &sectors[ulIdx] );
+			P_InvalidateSightCache( );
 			sectors[ulIdx].ceilingplane = sectors[ulIdx].SavedCeilingPlane;
 			sectors[ulIdx].SetPlaneTexZ(sector_t::ceiling, sectors[ulIdx].SavedCeilingTexZ);
 			sectors[ulIdx].bCeilingHeightChange = false;
@@ -3547,6 +3550,8 @@ void GAME_ResetMap( bool bRunEnterScripts )
 */
 		if ( sectors[ulIdx].bFloorHeightChange )
 		{
+			UNLAGGED_SectorMoving( &sectors[ulIdx] );
+			P_InvalidateSightCache( );
 			sectors[ulIdx].floorplane = sectors[ulIdx].SavedFloorPlane;
 			sectors[ulIdx].SetPlaneTexZ(sector_t::floor, sectors[ulIdx].SavedFloorTexZ);
 			sectors[ulIdx].bFloorHeightChange = false;
@@ -5343,8 +5348,9 @@ bool G_CheckDemoStatus (void)
 				// seems to cause problems. I don't feel like fixing that
 				// right now.
 				I_FatalError ("timed %i gametics in %i realtics (%.1f fps)\n"
-							  "(This is not really an error.)", gametic,
-							  endtime, (float)gametic/(float)endtime*(float)TICRATE);
+							  "%s(This is not really an error.)", gametic,
+							  endtime, (float)gametic/(float)endtime*(float)TICRATE,
+							  R_GetViewTimingReport().GetChars());
 			}
 			else
 			{
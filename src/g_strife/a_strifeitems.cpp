@@ -32,6 +32,7 @@ DEFINE_ACTION_FUNCTION(AActor, A_RemoveForceField)
 		{
 			line->flags &= ~(ML_BLOCKING|ML_BLOCKEVERYTHING);
 			line->special = 0;
+			P_InvalidateSightCache ();
 			line->sidedef[0]->SetTexture(side_t::mid, FNullTextureID());
 			line->sidedef[1]->SetTexture(side_t::mid, FNullTextureID());
 		}
@@ -23,6 +23,7 @@
 #include "cl_demo.h"
 #include "sv_commands.h"
 #include "deathmatch.h"
+#include "unlagged.h"
 
 // Include all the other Strife stuff here to reduce compile time
 #include "a_acolyte.cpp"
@@ -91,6 +91,8 @@ DEFINE_ACTION_FUNCTION(AActor, A_LightGoesOut)
 
 	fixed_t oldtheight = sec->floorplane.Zat0();
 	newheight = sec->FindLowestFloorSurrounding(&spot);
+	UNLAGGED_SectorMoving( sec );
+	P_InvalidateSightCache( );
 	sec->floorplane.d = sec->floorplane.PointToDist (spot, newheight);
 	fixed_t newtheight = sec->floorplane.Zat0();
 	sec->ChangePlaneTexZ(sector_t::floor, newtheight - oldtheight);
@@ -70,7 +70,7 @@ namespace skulltag {
 		root->code = 0;
 		root->value = -1;
 		// recursive Huffman tree builder.
-		buildTree( root, treeData, 0, dataLength, codeTable, 256 );
+		if ( buildTree( root, treeData, 0, dataLength, codeTable, 256 ) >= 0 ) buildTables();
 		huffResourceOwner = true;
 	}
 	
@@ -88,6 +88,7 @@ namespace skulltag {
 		root = treeRootNode;
 		codeTable = leafCodeTable;
 		huffResourceOwner = false;
+		buildTables();
 	}
 	
 	/** Checks the ownership state of this HuffmanCodec's resources.
@@ -103,6 +104,42 @@ namespace skulltag {
 		reverseBits = false;
 		expandable = true;
 		huffResourceOwner = false;
+		useTables = true;
+		tablesValid = false;
+	}
+
+	/** Builds the encoding and decoding lookup tables from the Huffman tree. <br>
+	 * Leaves tablesValid false if the tree is incomplete or has codes that are too long. */
+	void HuffmanCodec::buildTables(){
+		tablesValid = false;
+		if ( (root == 0) || (root->branch == 0) || (codeTable == 0) ) return;
+
+		// The encoder stores the codes starting at the least significant bit, so reverse their bit order.
+		for ( int i = 0; i < 256; i++ ){
+			HuffmanNode const * leaf = codeTable[i];
+			// Codes must fit into the encoder's bit buffer along with a partially filled int.
+			if ( (leaf == 0) || (leaf->bitCount < 1) || (leaf->bitCount > 24) ) return;
+			unsigned int reversedCode = 0;
+			for ( int bit = 0; bit < leaf->bitCount; bit++ ){
+				if ( leaf->code & (1 << bit) ) reversedCode |= 1u << (leaf->bitCount - 1 - bit);
+			}
+			encodeTable[i].code = reversedCode;
+			encodeTable[i].bitCount = leaf->bitCount;
+		}
+
+		// Walk the tree for every possible combination of decodeTableBits bits, first bit in the least significant bit.
+		for ( int i = 0; i < (1 << decodeTableBits); i++ ){
+			HuffmanNode const * node = root;
+			int bits = 0;
+			while ( (node->branch != 0) && (bits < decodeTableBits) ){
+				node = &(node->branch[ (i >> bits) & 0x01 ]);
+				bits++;
+			}
+			decodeTable[i].node = node;
+			decodeTable[i].bitCount = bits;
+		}
+
+		tablesValid = true;
 	}
 	
 	/** Increases a codeLength up to the longest Huffman code bit length found in the node or any of its children. <br>
@@ -214,6 +251,8 @@ namespace skulltag {
 		int const &inLength,				/**< in: number of bytes of input buffer to encoded. */
 		int const &outLength				/**< in: maximum length of data to output. */
 	) const {
+		if ( useTables && tablesValid ) return encodeWithTables( input, output, inLength, outLength );
+
 		// setup the bit buffer to output. if not expandable Limit output to input length.
 		if ( expandable ) writer->outputBuffer( output, outLength );
 		else writer->outputBuffer( output, ((inLength + 1) < outLength) ? inLength + 1 : outLength );
@@ -248,6 +287,8 @@ namespace skulltag {
 		int const &inLength,				/**< in: number of bytes of input buffer to read. */
 		int const &outLength				/**< in: maximum length of data to output. */
 	){
+		if ( useTables && tablesValid ) return decodeWithTables( input, output, inLength, outLength );
+
 		if ( inLength < 1 ) return 0;
 		int bitsAvailable = ((inLength-1) << 3) - (0xff & input[0]);
 		int rIndex = 1;		// read index of input buffer.
@@ -287,6 +328,115 @@ namespace skulltag {
 		return wIndex;
 	} // end function decode
 
+	/** Table driven version of encode(). Does not use the BitWriter, so it may be called concurrently.
+	 * @return number of bytes stored in the output buffer or -1 if an error occurs while encoding. */
+	int HuffmanCodec::encodeWithTables(
+		unsigned char const * const input,	/**< in: pointer to the first byte to encode. */
+		unsigned char * const output,		/**< out: pointer to an output buffer to store data. */
+		int const &inLength,				/**< in: number of bytes of input buffer to encoded. */
+		int const &outLength				/**< in: maximum length of data to output. */
+	) const {
+		// if not expandable Limit output to input length.
+		int maxBytes = outLength;
+		if ( !expandable && ((inLength + 1) < outLength) ) maxBytes = inLength + 1;
+		if ( (output == 0) || (maxBytes < 1) ) return -1;
+
+		unsigned long long bitBuffer = 0;	// pending bits, the first one in the least significant bit.
+		int bufferedBits = 0;				// number of pending bits.
+		int wIndex = 1;						// write index of output buffer, output[0] holds the padding signal.
+
+		for ( int i = 0; i < inLength; i++ ){
+			EncodeEntry const &entry = encodeTable[ 0xff & input[i] ];
+			bitBuffer |= (unsigned long long)entry.code << bufferedBits;
+			bufferedBits += entry.bitCount;
+
+			// Output a full int worth of bits at once.
+			if ( bufferedBits >= 32 ){
+				if ( (wIndex + 4) > maxBytes ) return -1;
+				output[wIndex] = (unsigned char)bitBuffer;
+				output[wIndex+1] = (unsigned char)(bitBuffer >> 8);
+				output[wIndex+2] = (unsigned char)(bitBuffer >> 16);
+				output[wIndex+3] = (unsigned char)(bitBuffer >> 24);
+				wIndex += 4;
+				bitBuffer >>= 32;
+				bufferedBits -= 32;
+			}
+		}
+
+		// Output the remaining bits, the last byte is padded with zeros.
+		int padding = (8 - (bufferedBits & 7)) & 7;
+		if ( (wIndex + ((bufferedBits + 7) >> 3)) > maxBytes ) return -1;
+		while ( bufferedBits > 0 ){
+			output[wIndex++] = (unsigned char)bitBuffer;
+			bitBuffer >>= 8;
+			bufferedBits -= 8;
+		}
+
+		// write padding signal byte to begining of stream.
+		output[0] = (unsigned char)padding;
+
+		// Storing the first bit in the least significant bit already results in the backwards
+		// bit ordering of the original ST Huffman Encoding. Reverse the bytes if it's not wanted.
+		if ( !reverseBits ) for ( int i = 1; i < wIndex; i++ ){
+			output[i] = reverseMap[ output[i] ];
+		}
+
+		return wIndex;
+	} // end function encodeWithTables
+
+	/** Table driven version of decode().
+	 * @return number of bytes stored in the output buffer. */
+	int HuffmanCodec::decodeWithTables(
+		unsigned char const * const input,	/**< in: pointer to data that needs decoding. */
+		unsigned char * const output,		/**< out: pointer to output buffer to store decoded data. */
+		int const &inLength,				/**< in: number of bytes of input buffer to read. */
+		int const &outLength				/**< in: maximum length of data to output. */
+	) const {
+		if ( inLength < 1 ) return 0;
+		int bitsAvailable = ((inLength-1) << 3) - (0xff & input[0]);
+		int rIndex = 1;						// read index of input buffer.
+		int wIndex = 0;						// write index of output buffer.
+		unsigned long long bitBuffer = 0;	// bits read from the input, the next one in the least significant bit.
+		int bufferedBits = 0;				// number of bits in bitBuffer.
+
+		while ( bitsAvailable > 0 ){
+
+			// Top up the bit buffer. Since it then holds at least 57 bits (or the rest of the input),
+			// no code can run out of buffered bits before running out of available bits.
+			while ( (bufferedBits <= 56) && (rIndex < inLength) ){
+				unsigned char byte = input[rIndex++];
+				if ( !reverseBits ) byte = reverseMap[ byte ];
+				bitBuffer |= (unsigned long long)byte << bufferedBits;
+				bufferedBits += 8;
+			}
+
+			DecodeEntry const &entry = decodeTable[ bitBuffer & ((1 << decodeTableBits) - 1) ];
+
+			// The remaining bits don't form a complete code.
+			if ( entry.bitCount > bitsAvailable ) break;
+
+			HuffmanNode const * node = entry.node;
+			bitBuffer >>= entry.bitCount;
+			bufferedBits -= entry.bitCount;
+			bitsAvailable -= entry.bitCount;
+
+			// The code is longer than the table, traverse the rest of the tree bit by bit.
+			while ( node->branch != 0 ){
+				if ( bitsAvailable <= 0 ) return wIndex;
+				node = &(node->branch[ bitBuffer & 0x01 ]);
+				bitBuffer >>= 1;
+				bufferedBits--;
+				bitsAvailable--;
+			}
+
+			// buffer overflow prevention
+			if ( wIndex >= outLength ) return wIndex;
+			output[ wIndex++ ] = (unsigned char)(node->value & 0xff);
+		}
+
+		return wIndex;
+	} // end function decodeWithTables
+
 	/** Deletes all sub nodes of a HuffmanNode by traversing and deleting its child nodes.
 	 * @param treeNode pointer to a HuffmanNode whos children will be deleted. */
 	void HuffmanCodec::deleteTree( HuffmanNode * treeNode ){
@@ -325,5 +475,13 @@ namespace skulltag {
 	 * @return	 true: data expansion is allowed.  false: data is not allowed to expand. */
 	bool HuffmanCodec::allowExpansion(){ return expandable; }
 
+	/** Enables or Disables the table driven encoder and decoder. Both produce the same output as the bitwise ones.
+	 * @param enabled	"true" uses the lookup tables (if the tree permits it), "false" processes the data bit by bit. */
+	void HuffmanCodec::lookupTables( bool enabled ){ useTables = enabled; }
+
+	/** Check whether the table driven encoder and decoder are used.
+	 * @return	 true: data is encoded / decoded through lookup tables.  false: data is processed bit by bit. */
+	bool HuffmanCodec::lookupTables(){ return useTables && tablesValid; }
+
 
 }; // end namespace skulltag
@@ -67,6 +67,33 @@ namespace skulltag {
 		/** Number of bits the shortest huffman code in the tree has. */
 		int shortestCode;	
 
+		/** Number of bits looked up at once by the table driven decoder. */
+		static int const decodeTableBits = 10;
+
+		/** Entry of the encoding lookup table. */
+		struct EncodeEntry {
+			unsigned int code;		/**< the Huffman code with its bit order reversed (first bit in the least significant bit). */
+			int bitCount;			/**< number of bits in the Huffman code. */
+		};
+
+		/** Entry of the decoding lookup table. */
+		struct DecodeEntry {
+			HuffmanNode const * node;	/**< the leaf reached by the looked up bits, or the branch reached after decodeTableBits bits. */
+			int bitCount;				/**< number of bits used by the leaf, or decodeTableBits if node is a branch. */
+		};
+
+		/** Huffman codes indexed by byte value, used by the table driven encoder. */
+		EncodeEntry encodeTable[256];
+
+		/** Maps the next decodeTableBits bits of the input (first bit in the least significant bit) to a tree node. */
+		DecodeEntry decodeTable[1 << decodeTableBits];
+
+		/** When true encode() and decode() use the lookup tables instead of processing the data bit by bit. */
+		bool useTables;
+
+		/** Set if the lookup tables could be built from the Huffman tree. */
+		bool tablesValid;
+
 	public:	
 
 		/** Creates a new HuffmanCodec from the Huffman tree data.
@@ -120,6 +147,14 @@ namespace skulltag {
 		 * @return	 true: data expansion is allowed.  false: data is not allowed to expand. */
 		bool allowExpansion();
 
+		/** Enables or Disables the table driven encoder and decoder. Both produce the same output as the bitwise ones.
+		 * @param enabled	"true" uses the lookup tables (if the tree permits it), "false" processes the data bit by bit. */
+		void lookupTables( bool enabled );
+
+		/** Check whether the table driven encoder and decoder are used.
+		 * @return	 true: data is encoded / decoded through lookup tables.  false: data is processed bit by bit. */
+		bool lookupTables();
+
 		/** Sets the ownership of this HuffmanCodec's resources.
 		* @param ownsResources	When false the tree will not be released upon destruction of this HuffmanCodec.
 		* 						When true deleting this HuffmanCodec will cause the Huffman tree to be released. */
@@ -176,6 +211,28 @@ namespace skulltag {
 		/** Perform initialization procedures common to all constructors. */
 		void init();
 
+		/** Builds the encoding and decoding lookup tables from the Huffman tree. <br>
+		 * Leaves tablesValid false if the tree is incomplete or has codes that are too long. */
+		void buildTables();
+
+		/** Table driven version of encode(). Does not use the BitWriter, so it may be called concurrently.
+		 * @return number of bytes stored in the output buffer or -1 if an error occurs while encoding. */
+		int encodeWithTables(
+			unsigned char const * const input,
+			unsigned char * const output,
+			int const &inLength,
+			int const &outLength
+		) const;
+
+		/** Table driven version of decode().
+		 * @return number of bytes stored in the output buffer. */
+		int decodeWithTables(
+			unsigned char const * const input,
+			unsigned char * const output,
+			int const &inLength,
+			int const &outLength
+		) const;
+
 	}; // end class Huffman Codec.
 } // end namespace skulltag
 
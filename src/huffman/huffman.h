@@ -44,6 +44,21 @@ void HUFFMAN_Encode(
 	int *outputBufferSize						/**< in+out: Max chars to write into outputBuffer. Upon return holds the number of chars stored or 0 if an error occurs. */
 );
 
+/** Creates an additional HuffmanCodec for use by another thread. */
+skulltag::HuffmanCodec *HUFFMAN_CreateCodec();
+
+/** Releases a HuffmanCodec created by HUFFMAN_CreateCodec(). */
+void HUFFMAN_DestroyCodec( skulltag::HuffmanCodec *codec );
+
+/** Applies Huffman encoding to a block of data using the given HuffmanCodec. */
+void HUFFMAN_EncodeWithCodec(
+	skulltag::HuffmanCodec *codec,				/**< in: The HuffmanCodec to encode with. */
+	unsigned char const * const inputBuffer,	/**< in: Pointer to start of data that is to be encoded. */
+	unsigned char * const outputBuffer,			/**< out: Pointer to destination buffer where encoded data will be stored. */
+	int const &inputBufferSize,					/**< in: Number of chars to read from inputBuffer. */
+	int *outputBufferSize						/**< in+out: Max chars to write into outputBuffer. Upon return holds the number of chars stored or 0 if an error occurs. */
+);
+
 /** Decodes a block of data that is Huffman encoded. */
 void HUFFMAN_Decode(
 	unsigned char const * const inputBuffer,	/**< in: Pointer to start of data that is to be decoded. */
@@ -91,7 +91,11 @@
 
 #include "md5.h"
 #include "network/sv_auth.h"
+#include "network/packetencoder.h"
+#include "network/checksumcache.h"
 #include "doomerrors.h"
+#include "doomstat.h"
+#include "stats.h"
 
 enum LumpAuthenticationMode {
 	LAST_LUMP,
@@ -140,6 +144,80 @@ static	USHORT			g_usLocalPort;
 // Buffer for the Huffman encoding.
 static	UCHAR			g_ucHuffmanBuffer[131072];
 
+// Under Linux, the socket is drained with recvmmsg and the packets launched while
+// batching is active are sent with sendmmsg. If the kernel doesn't support these
+// calls, g_bUseMultiMessageIO is cleared and we fall back to recvfrom / sendto.
+#if defined ( __linux__ ) && defined ( MSG_WAITFORONE )
+#define NETWORK_USE_MMSG
+#endif
+
+enum
+{
+	// Number of packets received / sent with a single system call.
+	NETWORK_IO_BATCH_SIZE = 32,
+
+	// Size of the receive buffers. Must be at least g_NetworkMessage.ulMaxSize, bigger
+	// packets are ignored anyway.
+	NETWORK_MAX_RECEIVE_SIZE = (( MAX_UDP_PACKET * 8 ) / 3 + 1 ),
+};
+
+#ifdef NETWORK_USE_MMSG
+static	bool			g_bUseMultiMessageIO = true;
+
+// Packets read from the socket that haven't been processed yet.
+static	struct
+{
+	UCHAR				aucData[NETWORK_IO_BATCH_SIZE][NETWORK_MAX_RECEIVE_SIZE];
+	struct sockaddr_in	aFrom[NETWORK_IO_BATCH_SIZE];
+	struct iovec		aIOVec[NETWORK_IO_BATCH_SIZE];
+	struct mmsghdr		aMessages[NETWORK_IO_BATCH_SIZE];
+	ULONG				ulNumPackets;
+	ULONG				ulNextPacket;
+} g_ReceiveBatch;
+
+// Encoded packets waiting to be sent.
+static	struct
+{
+	UCHAR				aucData[NETWORK_IO_BATCH_SIZE][MAX_UDP_PACKET + 1];
+	NETADDRESS_s		aAddresses[NETWORK_IO_BATCH_SIZE];
+	struct sockaddr_in	aTo[NETWORK_IO_BATCH_SIZE];
+	struct iovec		aIOVec[NETWORK_IO_BATCH_SIZE];
+	struct mmsghdr		aMessages[NETWORK_IO_BATCH_SIZE];
+	ULONG				ulNumPackets;
+} g_SendBatch;
+#endif
+
+// Are packets passed to NETWORK_LaunchPacket currently collected instead of being sent immediately?
+static	bool			g_bBatchingPackets = false;
+
+// Worker threads that encode and send the packets of a batch (if sv_encodethreads > 0).
+static	PacketEncoderPool	g_PacketEncoder;
+
+// Were packets handed to the worker threads whose results haven't been collected yet?
+static	bool			g_bPacketEncoderBusy = false;
+
+// Number of threads used to encode and send the packets of a batch. If 0, the packets
+// are encoded and sent by the main thread.
+CVAR( Int, sv_encodethreads, 0, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// Number of socket system calls and packets. Collected for the current and the last tic.
+struct NETWORKIOSTATS_s
+{
+	ULONG	ulReceiveCalls;
+	ULONG	ulPacketsReceived;
+	ULONG	ulSendCalls;
+	ULONG	ulPacketsSent;
+};
+
+static	NETWORKIOSTATS_s	g_IOStatsThisTic;
+static	NETWORKIOSTATS_s	g_IOStatsLastTic;
+static	int					g_iIOStatsTic = -1;
+
+// Packet payloads (before encoding / after decoding) captured for "huffmanbenchmark".
+static	TArray<BYTE>	g_CapturedPayloadData;
+static	TArray<ULONG>	g_CapturedPayloadSizes;
+static	ULONG			g_ulPayloadsToCapture = 0;
+
 // Our local address;
 NETADDRESS_s	g_LocalAddress;
 
@@ -165,6 +243,12 @@ static	void			network_Error( const char *pszError );
 static	SOCKET			network_AllocateSocket( void );
 static	bool			network_BindSocketToPort( SOCKET Socket, ULONG ulInAddr, USHORT usPort, bool bReUse );
 static	bool			network_GenerateLumpMD5HashAndWarnIfNeeded( const int LumpNum, const char *LumpName, FString &MD5Hash );
+static	NETWORKIOSTATS_s	&network_GetIOStats( void );
+static	LONG			network_ReceiveFromSocket( UCHAR *&pucData, struct sockaddr_in &SocketFrom );
+static	void			network_SendToSocket( const UCHAR *pucData, int iNumBytes, struct sockaddr_in &SocketAddress, const NETADDRESS_s &Address );
+static	void			network_PrintSendError( const NETADDRESS_s &Address );
+static	void			network_CollectEncodedPackets( void );
+static	void			network_CapturePayload( const BYTE *pbData, ULONG ulSize );
 
 //*****************************************************************************
 //	FUNCTIONS
@@ -297,6 +381,12 @@ void NETWORK_Construct( USHORT usPort, bool bAllocateLANSocket )
 	if( NETWORK_GetState() == NETSTATE_SERVER )
 		SERVERCONSOLE_UpdateIP( g_LocalAddress );
 
+	// Checksums of the loaded files and lumps are cached between runs.
+	cycle_t checksumTime;
+	checksumTime.Reset( );
+	checksumTime.Clock( );
+	CHECKSUMCACHE_Construct( );
+
 	// [BB] Initialize the checksum of the non-map lumps that need to be authenticated when connecting a new player.
 	std::vector<std::string>	lumpsToAuthenticate;
 	std::vector<LumpAuthenticationMode>	lumpsToAuthenticateMode;
@@ -451,6 +541,11 @@ void NETWORK_Construct( USHORT usPort, bool bAllocateLANSocket )
 	// [RC/BB] Init the list of PWADs.
 	network_InitPWADList( );
 
+	checksumTime.Unclock( );
+	CHECKSUMCACHE_Save( );
+	Printf( "Checksums computed in %.1f ms (%u cached, %u computed).\n", checksumTime.TimeMS( ),
+		static_cast<unsigned int>( CHECKSUMCACHE_GetNumHits( )), static_cast<unsigned int>( CHECKSUMCACHE_GetNumMisses( )));
+
 	// [BB] Initialize the GeoIP database.
 	if( NETWORK_GetState() == NETSTATE_SERVER )
 	{
@@ -508,6 +603,10 @@ void NETWORK_Construct( USHORT usPort, bool bAllocateLANSocket )
 //
 void NETWORK_Destruct( void )
 {
+	// Stop the packet encoding threads.
+	network_CollectEncodedPackets( );
+	g_PacketEncoder.SetNumThreads( 0 );
+
 	// Free the network message buffer.
 	g_NetworkMessage.Free();
 
@@ -526,64 +625,67 @@ int NETWORK_GetPackets( void )
 	LONG				lNumBytes;
 	INT					iDecodedNumBytes = sizeof(g_ucHuffmanBuffer);
 	struct sockaddr_in	SocketFrom;
-	INT					iSocketFromLength;
-
-	iSocketFromLength = sizeof( SocketFrom );
+	UCHAR				*pucData;
 
 	// [BB] If the socket is invalid, there is no point in trying to use it.
 	if ( g_NetworkSocket == INVALID_SOCKET )
 		return ( 0 );
 
-#ifdef	WIN32
-	lNumBytes = recvfrom( g_NetworkSocket, (char *)g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), 0, (struct sockaddr *)&SocketFrom, &iSocketFromLength );
-#else
-	lNumBytes = recvfrom( g_NetworkSocket, (char *)g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), 0, (struct sockaddr *)&SocketFrom, (socklen_t *)&iSocketFromLength );
-#endif
+	// Datagrams that we ignore are skipped here instead of ending the caller's loop.
+	// Otherwise the packets after them in a received batch would wait for the next
+	// tic, since select doesn't see packets that we already read from the socket.
+	while ( true )
+	{
+		lNumBytes = network_ReceiveFromSocket( pucData, SocketFrom );
 
-	// If the number of bytes returned is -1, an error has occured.
-	if ( lNumBytes == -1 ) 
-	{ 
+		// If the number of bytes returned is -1, an error has occured.
+		if ( lNumBytes == -1 ) 
+		{ 
 #ifdef __WIN32__
-		errno = WSAGetLastError( );
+			errno = WSAGetLastError( );
 
-		if ( errno == WSAEWOULDBLOCK )
-			return ( false );
+			if ( errno == WSAEWOULDBLOCK )
+				return ( false );
 
-		// Connection reset by peer. Doesn't mean anything to the server.
-		if ( errno == WSAECONNRESET )
-			return ( false );
+			// Connection reset by peer. Doesn't mean anything to the server.
+			if ( errno == WSAECONNRESET )
+				continue;
 
-		if ( errno == WSAEMSGSIZE )
-		{
-			Printf( "NETWORK_GetPackets:  WARNING! Oversized packet from %s\n", g_AddressFrom.ToString() );
-			return ( false );
-		}
+			if ( errno == WSAEMSGSIZE )
+			{
+				Printf( "NETWORK_GetPackets:  WARNING! Oversized packet from %s\n", g_AddressFrom.ToString() );
+				continue;
+			}
 
-		Printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
-		return ( false );
-#else
-		if ( errno == EWOULDBLOCK )
+			Printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
 			return ( false );
+#else
+			if ( errno == EWOULDBLOCK )
+				return ( false );
 
-		if ( errno == ECONNREFUSED )
-			return ( false );
+			if ( errno == ECONNREFUSED )
+				continue;
 
-		Printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
-		return ( false );
+			Printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
+			return ( false );
 #endif
-	}
+		}
 
-	// No packets or an error, so don't process anything.
-	if ( lNumBytes <= 0 )
-		return ( 0 );
+		// Ignore empty packets.
+		if ( lNumBytes <= 0 )
+			continue;
 
-	// Record this for our statistics window.
-	if ( NETWORK_GetState( ) == NETSTATE_SERVER )
-		SERVER_STATISTIC_AddToInboundDataTransfer( lNumBytes );
+		// Record this for our statistics window.
+		if ( NETWORK_GetState( ) == NETSTATE_SERVER )
+			SERVER_STATISTIC_AddToInboundDataTransfer( lNumBytes );
+		network_GetIOStats( ).ulPacketsReceived++;
 
-	// If the number of bytes we're receiving exceeds our buffer size, ignore the packet.
-	if ( lNumBytes >= static_cast<LONG>(g_NetworkMessage.ulMaxSize) )
-		return ( 0 );
+		// If the number of bytes we're receiving exceeds our buffer size, ignore the packet.
+		if ( lNumBytes >= static_cast<LONG>(g_NetworkMessage.ulMaxSize) )
+			continue;
+
+		break;
+	}
 
 	// Store the IP address of the sender.
 	g_AddressFrom.LoadFromSocketAddress( SocketFrom );
@@ -592,14 +694,17 @@ int NETWORK_GetPackets( void )
 	// [BB] Communication with the auth server is not Huffman-encoded.
 	if ( g_AddressFrom.Compare( NETWORK_AUTH_GetCachedServerAddress() ) == false )
 	{
-		HUFFMAN_Decode( g_ucHuffmanBuffer, (unsigned char *)g_NetworkMessage.pbData, lNumBytes, &iDecodedNumBytes );
+		HUFFMAN_Decode( pucData, (unsigned char *)g_NetworkMessage.pbData, lNumBytes, &iDecodedNumBytes );
 		g_NetworkMessage.ulCurrentSize = iDecodedNumBytes;
+
+		if ( g_ulPayloadsToCapture > 0 )
+			network_CapturePayload( g_NetworkMessage.pbData, g_NetworkMessage.ulCurrentSize );
 	}
 	else
 	{
 		// [BB] We don't need to decode, so we just copy the data.
 		// Not very efficient, but this keeps the changes at a minimum for now.
-		memcpy ( g_NetworkMessage.pbData, g_ucHuffmanBuffer, lNumBytes );
+		memcpy ( g_NetworkMessage.pbData, pucData, lNumBytes );
 		g_NetworkMessage.ulCurrentSize = lNumBytes;
 	}
 	g_NetworkMessage.ByteStream.pbStream = g_NetworkMessage.pbData;
@@ -610,6 +715,78 @@ int NETWORK_GetPackets( void )
 	return ( g_NetworkMessage.ulCurrentSize );
 }
 
+//*****************************************************************************
+//
+// Reads the next packet from our network socket. Returns the number of bytes read,
+// or -1 on error (in which case errno is set like recvfrom does). pucData points to
+// the received data afterwards.
+static LONG network_ReceiveFromSocket( UCHAR *&pucData, struct sockaddr_in &SocketFrom )
+{
+	INT		iSocketFromLength = sizeof( SocketFrom );
+
+#ifdef NETWORK_USE_MMSG
+	if ( g_bUseMultiMessageIO )
+	{
+		// Everything from the last batch has been processed, so read a new one.
+		if ( g_ReceiveBatch.ulNextPacket >= g_ReceiveBatch.ulNumPackets )
+		{
+			for ( ULONG ulIdx = 0; ulIdx < NETWORK_IO_BATCH_SIZE; ulIdx++ )
+			{
+				g_ReceiveBatch.aIOVec[ulIdx].iov_base = g_ReceiveBatch.aucData[ulIdx];
+				g_ReceiveBatch.aIOVec[ulIdx].iov_len = NETWORK_MAX_RECEIVE_SIZE;
+
+				memset( &g_ReceiveBatch.aMessages[ulIdx], 0, sizeof( g_ReceiveBatch.aMessages[ulIdx] ));
+				g_ReceiveBatch.aMessages[ulIdx].msg_hdr.msg_name = &g_ReceiveBatch.aFrom[ulIdx];
+				g_ReceiveBatch.aMessages[ulIdx].msg_hdr.msg_namelen = sizeof( g_ReceiveBatch.aFrom[ulIdx] );
+				g_ReceiveBatch.aMessages[ulIdx].msg_hdr.msg_iov = &g_ReceiveBatch.aIOVec[ulIdx];
+				g_ReceiveBatch.aMessages[ulIdx].msg_hdr.msg_iovlen = 1;
+			}
+
+			g_ReceiveBatch.ulNumPackets = 0;
+			g_ReceiveBatch.ulNextPacket = 0;
+
+			network_GetIOStats( ).ulReceiveCalls++;
+			const int iNumPackets = recvmmsg( g_NetworkSocket, g_ReceiveBatch.aMessages, NETWORK_IO_BATCH_SIZE, MSG_DONTWAIT, NULL );
+			if ( iNumPackets < 0 )
+			{
+				if ( errno != ENOSYS )
+					return ( -1 );
+
+				// The kernel doesn't know recvmmsg, use recvfrom from now on.
+				g_bUseMultiMessageIO = false;
+				return ( network_ReceiveFromSocket( pucData, SocketFrom ));
+			}
+
+			g_ReceiveBatch.ulNumPackets = iNumPackets;
+			if ( iNumPackets == 0 )
+			{
+				errno = EWOULDBLOCK;
+				return ( -1 );
+			}
+		}
+
+		const ULONG ulIdx = g_ReceiveBatch.ulNextPacket++;
+		pucData = g_ReceiveBatch.aucData[ulIdx];
+		SocketFrom = g_ReceiveBatch.aFrom[ulIdx];
+
+		// A truncated packet didn't fit into our buffer. Report the buffer size, so that
+		// the packet is ignored.
+		if ( g_ReceiveBatch.aMessages[ulIdx].msg_hdr.msg_flags & MSG_TRUNC )
+			return ( NETWORK_MAX_RECEIVE_SIZE );
+
+		return ( g_ReceiveBatch.aMessages[ulIdx].msg_len );
+	}
+#endif
+
+	pucData = g_ucHuffmanBuffer;
+	network_GetIOStats( ).ulReceiveCalls++;
+#ifdef	WIN32
+	return ( recvfrom( g_NetworkSocket, (char *)g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), 0, (struct sockaddr *)&SocketFrom, &iSocketFromLength ));
+#else
+	return ( recvfrom( g_NetworkSocket, (char *)g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), 0, (struct sockaddr *)&SocketFrom, (socklen_t *)&iSocketFromLength ));
+#endif
+}
+
 //*****************************************************************************
 //
 int NETWORK_GetLANPackets( void )
@@ -710,8 +887,8 @@ NETADDRESS_s NETWORK_GetFromAddress( void )
 //
 void NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address )
 {
-	LONG				lNumBytes;
 	INT					iNumBytesOut = sizeof(g_ucHuffmanBuffer);
+	UCHAR				*pucOutput = g_ucHuffmanBuffer;
 
 	pBuffer->ulCurrentSize = pBuffer->CalcSize();
 
@@ -723,69 +900,275 @@ void NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address )
 	struct sockaddr_in SocketAddress = Address.ToSocketAddress();
 
 	// [BB] Communication with the auth server is not Huffman-encoded.
-	if ( Address.Compare( NETWORK_AUTH_GetCachedServerAddress() ) == false )
-		HUFFMAN_Encode( (unsigned char *)pBuffer->pbData, g_ucHuffmanBuffer, pBuffer->ulCurrentSize, &iNumBytesOut );
+	const bool bEncode = ( Address.Compare( NETWORK_AUTH_GetCachedServerAddress() ) == false );
+
+	if ( bEncode && ( g_ulPayloadsToCapture > 0 ))
+		network_CapturePayload( pBuffer->pbData, pBuffer->ulCurrentSize );
+
+	// While batching with encoder threads, just queue the packet. The threads encode
+	// and send it after NETWORK_FlushPacketBatch.
+	if ( g_bBatchingPackets && ( g_PacketEncoder.GetNumThreads( ) > 0 ) && bEncode && ( pBuffer->ulCurrentSize <= MAX_UDP_PACKET ))
+	{
+		g_PacketEncoder.QueuePacket( pBuffer->pbData, pBuffer->ulCurrentSize, Address );
+		return;
+	}
+
+	// Make sure that this packet doesn't overtake any packets still handled by the
+	// encoder threads.
+	if ( g_bPacketEncoderBusy )
+		network_CollectEncodedPackets( );
+
+#ifdef NETWORK_USE_MMSG
+	// While batching, encode the packet directly into the send batch. It is sent
+	// by NETWORK_FlushPacketBatch (or as soon as the batch is full).
+	if ( g_bBatchingPackets && g_bUseMultiMessageIO && bEncode && ( pBuffer->ulCurrentSize <= MAX_UDP_PACKET ))
+	{
+		if ( g_SendBatch.ulNumPackets == NETWORK_IO_BATCH_SIZE )
+			NETWORK_FlushPacketBatch( );
+
+		const ULONG ulIdx = g_SendBatch.ulNumPackets;
+		iNumBytesOut = sizeof( g_SendBatch.aucData[ulIdx] );
+		HUFFMAN_Encode( (unsigned char *)pBuffer->pbData, g_SendBatch.aucData[ulIdx], pBuffer->ulCurrentSize, &iNumBytesOut );
+
+		g_SendBatch.aAddresses[ulIdx] = Address;
+		g_SendBatch.aTo[ulIdx] = SocketAddress;
+		g_SendBatch.aIOVec[ulIdx].iov_base = g_SendBatch.aucData[ulIdx];
+		g_SendBatch.aIOVec[ulIdx].iov_len = iNumBytesOut;
+		memset( &g_SendBatch.aMessages[ulIdx], 0, sizeof( g_SendBatch.aMessages[ulIdx] ));
+		g_SendBatch.aMessages[ulIdx].msg_hdr.msg_name = &g_SendBatch.aTo[ulIdx];
+		g_SendBatch.aMessages[ulIdx].msg_hdr.msg_namelen = sizeof( g_SendBatch.aTo[ulIdx] );
+		g_SendBatch.aMessages[ulIdx].msg_hdr.msg_iov = &g_SendBatch.aIOVec[ulIdx];
+		g_SendBatch.aMessages[ulIdx].msg_hdr.msg_iovlen = 1;
+		g_SendBatch.ulNumPackets++;
+		return;
+	}
+#endif
+
+	if ( bEncode )
+		HUFFMAN_Encode( (unsigned char *)pBuffer->pbData, pucOutput, pBuffer->ulCurrentSize, &iNumBytesOut );
 	else
 	{
 		// [BB] We don't need to encode, so we just copy the data.
 		// Not very efficient, but this keeps the changes at a minimum for now.
-		memcpy ( g_ucHuffmanBuffer, pBuffer->pbData, pBuffer->ulCurrentSize );
+		memcpy ( pucOutput, pBuffer->pbData, pBuffer->ulCurrentSize );
 		iNumBytesOut = pBuffer->ulCurrentSize;
 	}
 
-	lNumBytes = sendto( g_NetworkSocket, (const char*)g_ucHuffmanBuffer, iNumBytesOut, 0, (struct sockaddr *)&SocketAddress, sizeof( SocketAddress ));
+	network_SendToSocket( pucOutput, iNumBytesOut, SocketAddress, Address );
+}
 
-	// If sendto returns -1, there was an error.
-	if ( lNumBytes == -1 )
+//*****************************************************************************
+//
+// From now on, collect the packets passed to NETWORK_LaunchPacket and send them
+// together when NETWORK_FlushPacketBatch is called.
+void NETWORK_BeginPacketBatch( void )
+{
+	// Wait for the encoder threads to finish the previous batch.
+	network_CollectEncodedPackets( );
+
+	const unsigned int numThreads = clamp<int>( sv_encodethreads, 0, 16 );
+	if ( g_PacketEncoder.GetNumThreads( ) != numThreads )
+		g_PacketEncoder.SetNumThreads( numThreads );
+
+	g_PacketEncoder.SetSocket( g_NetworkSocket );
+	g_bBatchingPackets = true;
+}
+
+//*****************************************************************************
+//
+// Sends all collected packets and stops batching.
+void NETWORK_FlushPacketBatch( void )
+{
+	// Let the encoder threads send the queued packets while we continue with the
+	// next tic. The results are collected by network_CollectEncodedPackets.
+	if ( g_PacketEncoder.GetNumResults( ) > 0 )
 	{
-#ifdef __WIN32__
-		INT	iError = WSAGetLastError( );
+		g_PacketEncoder.Dispatch( );
+		g_bPacketEncoderBusy = true;
+	}
 
-		// Wouldblock is silent.
-		if ( iError == WSAEWOULDBLOCK )
-			return;
+#ifdef NETWORK_USE_MMSG
+	ULONG	ulNumSent = 0;
 
-		switch ( iError )
+	while ( ulNumSent < g_SendBatch.ulNumPackets )
+	{
+		if ( g_bUseMultiMessageIO == false )
 		{
-		case WSAEACCES:
+			network_SendToSocket( g_SendBatch.aucData[ulNumSent], g_SendBatch.aIOVec[ulNumSent].iov_len, g_SendBatch.aTo[ulNumSent], g_SendBatch.aAddresses[ulNumSent] );
+			ulNumSent++;
+			continue;
+		}
 
-			Printf( "NETWORK_LaunchPacket: Error #%d, WSAEACCES: Permission denied for address: %s\n", iError, Address.ToString() );
-			return;
-		case WSAEAFNOSUPPORT:
+		network_GetIOStats( ).ulSendCalls++;
+		const int iResult = sendmmsg( g_NetworkSocket, &g_SendBatch.aMessages[ulNumSent], g_SendBatch.ulNumPackets - ulNumSent, 0 );
 
-			Printf( "NETWORK_LaunchPacket: Error #%d, WSAEAFNOSUPPORT: Address %s incompatible with the requested protocol\n", iError, Address.ToString() );
-			return;
-		case WSAEADDRNOTAVAIL:
+		if ( iResult < 0 )
+		{
+			// The kernel doesn't know sendmmsg, send the remaining packets one by one.
+			if ( errno == ENOSYS )
+			{
+				g_bUseMultiMessageIO = false;
+				continue;
+			}
 
-			Printf( "NETWORK_LaunchPacket: Error #%d, WSAEADDRENOTAVAIL: Address %s not available\n", iError, Address.ToString() );
-			return;
-		case WSAEHOSTUNREACH:
+			// The first packet couldn't be sent, skip it and try again with the rest.
+			network_PrintSendError( g_SendBatch.aAddresses[ulNumSent] );
+			ulNumSent++;
+			continue;
+		}
 
-			Printf( "NETWORK_LaunchPacket: Error #%d, WSAEHOSTUNREACH: Address %s unreachable\n", iError, Address.ToString() );
-			return;				
-		default:
+		for ( int i = 0; i < iResult; i++, ulNumSent++ )
+		{
+			network_GetIOStats( ).ulPacketsSent++;
 
-			Printf( "NETWORK_LaunchPacket: Error #%d\n", iError );
-			return;
+			// Record this for our statistics window.
+			if ( NETWORK_GetState( ) == NETSTATE_SERVER )
+				SERVER_STATISTIC_AddToOutboundDataTransfer( g_SendBatch.aMessages[ulNumSent].msg_len );
 		}
-#else
-	if ( errno == EWOULDBLOCK )
-return;
+	}
+
+	g_SendBatch.ulNumPackets = 0;
+#endif
 
-          if ( errno == ECONNREFUSED )
-              return;
+	g_bBatchingPackets = false;
+}
 
-		Printf( "NETWORK_LaunchPacket: %s\n", strerror( errno ));
-		Printf( "NETWORK_LaunchPacket: Address %s\n", Address.ToString() );
+//*****************************************************************************
+//
+static void network_SendToSocket( const UCHAR *pucData, int iNumBytes, struct sockaddr_in &SocketAddress, const NETADDRESS_s &Address )
+{
+	network_GetIOStats( ).ulSendCalls++;
+	const LONG lNumBytes = sendto( g_NetworkSocket, (const char*)pucData, iNumBytes, 0, (struct sockaddr *)&SocketAddress, sizeof( SocketAddress ));
 
-#endif
+	// If sendto returns -1, there was an error.
+	if ( lNumBytes == -1 )
+	{
+		network_PrintSendError( Address );
+		return;
 	}
 
+	network_GetIOStats( ).ulPacketsSent++;
+
 	// Record this for our statistics window.
 	if ( NETWORK_GetState( ) == NETSTATE_SERVER )
 		SERVER_STATISTIC_AddToOutboundDataTransfer( lNumBytes );
 }
 
+//*****************************************************************************
+//
+// Waits until the encoder threads have sent all dispatched packets and accounts
+// for them in the statistics. Errors are printed here since the threads must not
+// call Printf.
+static void network_CollectEncodedPackets( void )
+{
+	if ( g_bPacketEncoderBusy == false )
+		return;
+
+	g_PacketEncoder.Wait( );
+	g_bPacketEncoderBusy = false;
+
+	for ( unsigned int i = 0; i < g_PacketEncoder.GetNumResults( ); i++ )
+	{
+		const PacketEncoderPool::Result &result = g_PacketEncoder.GetResult( i );
+
+		network_GetIOStats( ).ulSendCalls++;
+
+		if ( result.bytesSent == -1 )
+		{
+#ifdef __WIN32__
+			WSASetLastError( result.error );
+#else
+			errno = result.error;
+#endif
+			network_PrintSendError( result.address );
+			continue;
+		}
+
+		network_GetIOStats( ).ulPacketsSent++;
+
+		// Record this for our statistics window.
+		if ( NETWORK_GetState( ) == NETSTATE_SERVER )
+			SERVER_STATISTIC_AddToOutboundDataTransfer( result.bytesSent );
+	}
+
+	g_PacketEncoder.ClearResults( );
+}
+
+//*****************************************************************************
+//
+static void network_CapturePayload( const BYTE *pbData, ULONG ulSize )
+{
+	const unsigned int position = g_CapturedPayloadData.Size( );
+	g_CapturedPayloadData.Resize( position + ulSize );
+	memcpy( &g_CapturedPayloadData[position], pbData, ulSize );
+	g_CapturedPayloadSizes.Push( ulSize );
+
+	if ( --g_ulPayloadsToCapture == 0 )
+		Printf( "Captured %d packet payloads (%d bytes).\n", g_CapturedPayloadSizes.Size( ), g_CapturedPayloadData.Size( ));
+}
+
+//*****************************************************************************
+//
+static void network_PrintSendError( const NETADDRESS_s &Address )
+{
+#ifdef __WIN32__
+	INT	iError = WSAGetLastError( );
+
+	// Wouldblock is silent.
+	if ( iError == WSAEWOULDBLOCK )
+		return;
+
+	switch ( iError )
+	{
+	case WSAEACCES:
+
+		Printf( "NETWORK_LaunchPacket: Error #%d, WSAEACCES: Permission denied for address: %s\n", iError, Address.ToString() );
+		return;
+	case WSAEAFNOSUPPORT:
+
+		Printf( "NETWORK_LaunchPacket: Error #%d, WSAEAFNOSUPPORT: Address %s incompatible with the requested protocol\n", iError, Address.ToString() );
+		return;
+	case WSAEADDRNOTAVAIL:
+
+		Printf( "NETWORK_LaunchPacket: Error #%d, WSAEADDRENOTAVAIL: Address %s not available\n", iError, Address.ToString() );
+		return;
+	case WSAEHOSTUNREACH:
+
+		Printf( "NETWORK_LaunchPacket: Error #%d, WSAEHOSTUNREACH: Address %s unreachable\n", iError, Address.ToString() );
+		return;				
+	default:
+
+		Printf( "NETWORK_LaunchPacket: Error #%d\n", iError );
+		return;
+	}
+#else
+	if ( errno == EWOULDBLOCK )
+		return;
+
+	if ( errno == ECONNREFUSED )
+		return;
+
+	Printf( "NETWORK_LaunchPacket: %s\n", strerror( errno ));
+	Printf( "NETWORK_LaunchPacket: Address %s\n", Address.ToString() );
+#endif
+}
+
+//*****************************************************************************
+//
+// Returns the I/O counters of the current tic. The counters of the previous tic are
+// kept for "stat netio".
+static NETWORKIOSTATS_s &network_GetIOStats( void )
+{
+	if ( g_iIOStatsTic != gametic )
+	{
+		g_IOStatsLastTic = g_IOStatsThisTic;
+		memset( &g_IOStatsThisTic, 0, sizeof( g_IOStatsThisTic ));
+		g_iIOStatsTic = gametic;
+	}
+
+	return ( g_IOStatsThisTic );
+}
+
 //*****************************************************************************
 //
 NETADDRESS_s NETWORK_GetLocalAddress( void )
@@ -994,17 +1377,31 @@ void NETWORK_AddLumpForAuthentication( const LONG LumpNumber )
 //
 void NETWORK_GenerateLumpMD5Hash( const int LumpNum, FString &MD5Hash )
 {
-	const int lumpSize = Wads.LumpLength (LumpNum);
-	BYTE *pbData = new BYTE[lumpSize];
+	// The lump numbers only refer to the same lumps as long as the same files are loaded.
+	const FString &signature = CHECKSUMCACHE_GetLoadSignature( );
+	FString key;
+
+	if ( signature.IsNotEmpty( ))
+	{
+		key.Format( "lump:%s:%d", signature.GetChars( ), LumpNum );
+		if ( CHECKSUMCACHE_Find( key, MD5Hash ))
+			return;
+	}
 
+	// Hash the lump directly from the file instead of copying it to a buffer first.
 	FWadLump lump = Wads.OpenLumpNum (LumpNum);
+	MD5Context md5;
+	BYTE digest[16];
+
+	md5.Update( &lump, Wads.LumpLength (LumpNum) );
+	md5.Final( digest );
 
-	// Dump the data from the lump into our data buffer.
-	lump.Read (pbData, lumpSize);
+	MD5Hash = "";
+	for ( unsigned int i = 0; i < sizeof( digest ); i++ )
+		MD5Hash.AppendFormat( "%02x", digest[i] );
 
-	// Perform the checksum on our buffer, and free it.
-	CMD5Checksum::GetMD5( pbData, lumpSize, MD5Hash );
-	delete[] pbData;
+	if ( key.IsNotEmpty( ))
+		CHECKSUMCACHE_Store( key, MD5Hash );
 }
 
 //*****************************************************************************
@@ -1031,6 +1428,18 @@ bool network_GenerateLumpMD5HashAndWarnIfNeeded( const int LumpNum, const char *
 FString NETWORK_MapCollectionChecksum( )
 {
 	FString longSum, fullSum;
+
+	// The maps and their order are determined by the loaded files.
+	const FString &signature = CHECKSUMCACHE_GetLoadSignature( );
+	FString key;
+
+	if ( signature.IsNotEmpty( ))
+	{
+		key.Format( "maps:%s", signature.GetChars( ));
+		if ( CHECKSUMCACHE_Find( key, fullSum ))
+			return fullSum;
+	}
+
 	for( unsigned i = 0; i < wadlevelinfos.Size( ); i++ )
 	{
 		char* mname = wadlevelinfos[i].mapname;
@@ -1055,6 +1464,12 @@ FString NETWORK_MapCollectionChecksum( )
 
 	CMD5Checksum::GetMD5( reinterpret_cast<const BYTE *>( longSum.GetChars( ) ),
 		longSum.Len( ), fullSum );
+
+	if ( key.IsNotEmpty( ))
+	{
+		CHECKSUMCACHE_Store( key, fullSum );
+		CHECKSUMCACHE_Save( );
+	}
 	return fullSum;
 }
 
@@ -1403,6 +1818,7 @@ static void network_InitPWADList( void )
 	g_IWAD = Wads.GetWadName( ulRealIWADIdx );
 
 	// Collect all the PWADs into a list.
+	TArray<FString> files;
 	for ( ULONG ulIdx = 0; Wads.GetWadName( ulIdx ) != NULL; ulIdx++ )
 	{
 		// Skip the IWAD, zandronum.pk3, files that were automatically loaded from subdirectories (such as skin files), and WADs loaded automatically within pk3 files.
@@ -1413,15 +1829,19 @@ static void network_InitPWADList( void )
 		{
 			continue;
 		}
-		char MD5Sum[33];
-		MD5SumOfFile ( Wads.GetWadFullName( ulIdx ), MD5Sum );
 
 		NetworkPWAD pwad;
 		pwad.name = Wads.GetWadName( ulIdx );
-		pwad.checksum = MD5Sum;
 		pwad.wadnum = ulIdx;
 		g_PWADs.Push( pwad );
+		files.Push( Wads.GetWadFullName( ulIdx ));
 	}
+
+	// Compute the checksums of all of them at once, so that those that aren't cached can be hashed in parallel.
+	TArray<FString> checksums;
+	CHECKSUMCACHE_GetFileChecksums( files, checksums );
+	for ( unsigned int i = 0; i < g_PWADs.Size(); i++ )
+		g_PWADs[i].checksum = checksums[i];
 }
 
 void network_Error( const char *pszError )
@@ -1512,6 +1932,56 @@ void I_DoSelect (void)
 #endif
 } 
 
+//*****************************************************************************
+//
+// Blocks until either a packet arrives on the network socket or iTimeoutMS
+// milliseconds have passed. Under Linux, pending console input also wakes us up.
+// Returns true if there is something to read from the network socket.
+bool NETWORK_WaitForPackets( int iTimeoutMS )
+{
+	struct timeval	timeout;
+	fd_set			fdset;
+	int				iMaxSocket;
+
+	// If the socket is invalid, there is nothing to wait for.
+	if ( g_NetworkSocket == INVALID_SOCKET )
+	{
+		I_Sleep( MAX( iTimeoutMS, 0 ));
+		return ( false );
+	}
+
+#ifdef NETWORK_USE_MMSG
+	// Packets left over from the last batch are already read from the socket, so
+	// select wouldn't report them.
+	if ( g_bUseMultiMessageIO && ( g_ReceiveBatch.ulNextPacket < g_ReceiveBatch.ulNumPackets ))
+		return ( true );
+#endif
+
+	FD_ZERO( &fdset );
+	FD_SET( g_NetworkSocket, &fdset );
+	iMaxSocket = static_cast<int>( g_NetworkSocket );
+
+#ifndef	WIN32
+	// Don't watch stdin while the last input wasn't consumed yet. Otherwise
+	// select would return immediately until the next tic and we'd spin.
+	if ( do_stdin && ( stdin_ready == 0 ))
+		FD_SET( 0, &fdset );
+#endif
+
+	iTimeoutMS = MAX( iTimeoutMS, 0 );
+	timeout.tv_sec = iTimeoutMS / 1000;
+	timeout.tv_usec = ( iTimeoutMS % 1000 ) * 1000;
+	if ( select( iMaxSocket + 1, &fdset, NULL, NULL, &timeout ) <= 0 )
+		return ( false );
+
+#ifndef	WIN32
+	if ( FD_ISSET( 0, &fdset ))
+		stdin_ready = 1;
+#endif
+
+	return ( FD_ISSET( g_NetworkSocket, &fdset ) != 0 );
+}
+
 //*****************************************************************************
 // [BB] Let Skulltag's existing code use ZDoom's MD5 code.
 void CMD5Checksum::GetMD5(const BYTE* pBuf, UINT nLength, FString &OutString)
@@ -1575,6 +2045,137 @@ CCMD( netstate )
 	}
 }
 
+//*****************************************************************************
+//
+// Replays the captured packet payloads through the bitwise and the table driven
+// Huffman codec and reports their throughput. Use "huffmanbenchmark capture <count>"
+// to capture the payloads of the next packets sent and received first.
+CCMD( huffmanbenchmark )
+{
+	if (( argv.argc( ) >= 2 ) && ( stricmp( argv[1], "capture" ) == 0 ))
+	{
+		g_CapturedPayloadData.Clear( );
+		g_CapturedPayloadSizes.Clear( );
+		g_ulPayloadsToCapture = ( argv.argc( ) >= 3 ) ? clamp( atoi( argv[2] ), 1, 1000000 ) : 1000;
+		Printf( "Capturing the next %d packet payloads.\n", static_cast<int> (g_ulPayloadsToCapture) );
+		return;
+	}
+
+	if ( g_CapturedPayloadSizes.Size( ) == 0 )
+	{
+		Printf( "No packet payloads captured yet. Use \"huffmanbenchmark capture [count]\" first.\n" );
+		return;
+	}
+
+	const int iPasses = ( argv.argc( ) >= 2 ) ? clamp( atoi( argv[1] ), 1, 10000 ) : 100;
+	const ULONG ulNumPackets = g_CapturedPayloadSizes.Size( );
+
+	skulltag::HuffmanCodec *const pCodecs[2] = { HUFFMAN_CreateCodec( ), HUFFMAN_CreateCodec( ) };
+	pCodecs[0]->lookupTables( false );
+	pCodecs[1]->lookupTables( true );
+
+	// Encode every payload once to have input for the decoders, and also make sure that
+	// both codecs agree.
+	TArray<BYTE> EncodedData;
+	TArray<int> EncodedSizes;
+	UCHAR aucEncoded[2][MAX_UDP_PACKET * 2 + 1];
+	UCHAR aucDecoded[MAX_UDP_PACKET * 2];
+	ULONG ulPosition = 0;
+	ULONG ulNumMismatches = 0;
+
+	for ( ULONG ulIdx = 0; ulIdx < ulNumPackets; ulIdx++ )
+	{
+		const int iSize = MIN<int>( g_CapturedPayloadSizes[ulIdx], MAX_UDP_PACKET * 2 );
+		int aiEncodedSize[2] = { sizeof( aucEncoded[0] ), sizeof( aucEncoded[1] ) };
+
+		for ( int i = 0; i < 2; i++ )
+			HUFFMAN_EncodeWithCodec( pCodecs[i], &g_CapturedPayloadData[ulPosition], aucEncoded[i], iSize, &aiEncodedSize[i] );
+
+		if (( aiEncodedSize[0] != aiEncodedSize[1] ) || ( memcmp( aucEncoded[0], aucEncoded[1], aiEncodedSize[0] ) != 0 ))
+			ulNumMismatches++;
+
+		const unsigned int uiEncodedPosition = EncodedData.Size( );
+		EncodedData.Resize( uiEncodedPosition + aiEncodedSize[0] );
+		memcpy( &EncodedData[uiEncodedPosition], aucEncoded[0], aiEncodedSize[0] );
+		EncodedSizes.Push( aiEncodedSize[0] );
+		ulPosition += g_CapturedPayloadSizes[ulIdx];
+	}
+
+	Printf( "Replaying %d packet payloads (%d bytes, %d bytes encoded) %d times.\n",
+		static_cast<int> (ulNumPackets), g_CapturedPayloadData.Size( ), EncodedData.Size( ), iPasses );
+
+	const char *const pszNames[2] = { "Bitwise", "Table driven" };
+	for ( int i = 0; i < 2; i++ )
+	{
+		cycle_t EncodeCycles;
+		cycle_t DecodeCycles;
+		EncodeCycles.Reset( );
+		DecodeCycles.Reset( );
+
+		for ( int iPass = 0; iPass < iPasses; iPass++ )
+		{
+			ulPosition = 0;
+			EncodeCycles.Clock( );
+			for ( ULONG ulIdx = 0; ulIdx < ulNumPackets; ulIdx++ )
+			{
+				int iEncodedSize = sizeof( aucEncoded[0] );
+				HUFFMAN_EncodeWithCodec( pCodecs[i], &g_CapturedPayloadData[ulPosition], aucEncoded[0], MIN<int>( g_CapturedPayloadSizes[ulIdx], MAX_UDP_PACKET * 2 ), &iEncodedSize );
+				ulPosition += g_CapturedPayloadSizes[ulIdx];
+			}
+			EncodeCycles.Unclock( );
+
+			ulPosition = 0;
+			DecodeCycles.Clock( );
+			for ( ULONG ulIdx = 0; ulIdx < ulNumPackets; ulIdx++ )
+			{
+				// The unencoded signal is handled by HUFFMAN_Decode, only the codec is measured here.
+				if ( EncodedData[ulPosition] != 0xff )
+					pCodecs[i]->decode( &EncodedData[ulPosition], aucDecoded, EncodedSizes[ulIdx], sizeof( aucDecoded ));
+				ulPosition += EncodedSizes[ulIdx];
+			}
+			DecodeCycles.Unclock( );
+		}
+
+		// Throughput is measured in unencoded bytes for both directions.
+		const double dMegaBytes = static_cast<double>( g_CapturedPayloadData.Size( )) * iPasses / ( 1024.0 * 1024.0 );
+		Printf( "%s: encoding %.2f MB/s (%.2f ms), decoding %.2f MB/s (%.2f ms)\n", pszNames[i],
+			dMegaBytes / MAX( EncodeCycles.TimeMS( ) / 1000.0, 1e-9 ), EncodeCycles.TimeMS( ),
+			dMegaBytes / MAX( DecodeCycles.TimeMS( ) / 1000.0, 1e-9 ), DecodeCycles.TimeMS( ));
+	}
+
+	if ( ulNumMismatches > 0 )
+		Printf( TEXTCOLOR_RED "%d packets were encoded differently by the two codecs!\n", static_cast<int> (ulNumMismatches) );
+
+	HUFFMAN_DestroyCodec( pCodecs[0] );
+	HUFFMAN_DestroyCodec( pCodecs[1] );
+}
+
+//*****************************************************************************
+//	STATISTICS
+
+ADD_STAT( netio )
+{
+	FString	Out;
+
+	Out.Format( "Last tic: %d receive call%s (%d packets), %d send call%s (%d packets), %s, %d encoder thread%s",
+		static_cast<int> (g_IOStatsLastTic.ulReceiveCalls),
+		g_IOStatsLastTic.ulReceiveCalls == 1 ? "" : "s",
+		static_cast<int> (g_IOStatsLastTic.ulPacketsReceived),
+		static_cast<int> (g_IOStatsLastTic.ulSendCalls),
+		g_IOStatsLastTic.ulSendCalls == 1 ? "" : "s",
+		static_cast<int> (g_IOStatsLastTic.ulPacketsSent),
+#ifdef NETWORK_USE_MMSG
+		g_bUseMultiMessageIO ? "recvmmsg/sendmmsg" : "recvfrom/sendto"
+#else
+		"recvfrom/sendto"
+#endif
+		, static_cast<int> (g_PacketEncoder.GetNumThreads( )),
+		g_PacketEncoder.GetNumThreads( ) == 1 ? "" : "s"
+		);
+
+	return ( Out );
+}
+
 //*****************************************************************************
 //
 #if BUILD_ID != BUILD_RELEASE
@@ -90,6 +90,20 @@ enum
 	PLAYER_ALTATTACK	= 1 << 2,
 };
 
+// Fields of SVC_MOVEPLAYERDELTA. PLAYERMOVE_CROUCHING is not a change marker,
+// but directly contains whether the player is crouching.
+enum
+{
+	PLAYERMOVE_X			= 1 << 0,
+	PLAYERMOVE_Y			= 1 << 1,
+	PLAYERMOVE_Z			= 1 << 2,
+	PLAYERMOVE_ANGLE		= 1 << 3,
+	PLAYERMOVE_VELX			= 1 << 4,
+	PLAYERMOVE_VELY			= 1 << 5,
+	PLAYERMOVE_VELZ			= 1 << 6,
+	PLAYERMOVE_CROUCHING	= 1 << 7,
+};
+
 /* [BB] This is not used anywhere anymore.
 // Should we use huffman compression?
 #define	USE_HUFFMAN_COMPRESSION
@@ -228,6 +242,8 @@ int				NETWORK_GetPackets( void );
 int				NETWORK_GetLANPackets( void );
 NETADDRESS_s	NETWORK_GetFromAddress( void );
 void			NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address );
+void			NETWORK_BeginPacketBatch( void );
+void			NETWORK_FlushPacketBatch( void );
 NETADDRESS_s	NETWORK_GetLocalAddress( void );
 NETADDRESS_s	NETWORK_GetCachedLocalAddress( void );
 NETBUFFER_s		*NETWORK_GetNetworkMessageBuffer( void );
@@ -298,6 +314,7 @@ LONG			NETWORK_GetState( void );
 void			NETWORK_SetState( LONG lState );
 
 void			I_DoSelect( void );
+bool			NETWORK_WaitForPackets( int iTimeoutMS );
 
 // DEBUG FUNCTION!
 #ifdef	_DEBUG
@@ -0,0 +1,472 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: checksumcache.cpp
+//
+// Description: Caches the MD5 checksums of loaded files and lumps on disk.
+//
+//-----------------------------------------------------------------------------
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <thread>
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "cmdlib.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "version.h"
+#include "w_wad.h"
+#include "workerpool.h"
+#include "checksumcache.h"
+
+//*****************************************************************************
+//	DEFINES
+
+#define	CHECKSUMCACHE_FILENAME		"checksums.txt"
+#define	CHECKSUMCACHE_HEADER		"ZA_CHECKSUMCACHE 1"
+
+// Entries that haven't been used for this many seconds are dropped when the cache is saved.
+#define	CHECKSUMCACHE_MAXAGE		( 30 * 24 * 60 * 60 )
+
+// The last use time of an entry is only updated if it's older than this, so that
+// starting the same server over and over again doesn't rewrite the cache each time.
+#define	CHECKSUMCACHE_TOUCHINTERVAL	( 24 * 60 * 60 )
+
+#define	CHECKSUMCACHE_MAXTHREADS	8
+
+//*****************************************************************************
+struct CHECKSUMCACHEENTRY_s
+{
+	FString		Checksum;
+
+	// Size and modification time of the file, zero for entries that don't belong to a file.
+	long long	llSize;
+	long long	llModificationTime;
+
+	long long	llLastUsed;
+};
+
+//*****************************************************************************
+struct CHECKSUMCACHEJOB_s
+{
+	FString		Path;
+	long long	llSize;
+	long long	llModificationTime;
+	char		szChecksum[33];
+	int			iError;
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+static	TMap<FString, CHECKSUMCACHEENTRY_s>	g_ChecksumCache;
+static	bool				g_bChecksumCacheLoaded = false;
+static	bool				g_bChecksumCacheDirty = false;
+
+static	FString				g_LoadSignature;
+static	bool				g_bLoadSignatureValid = false;
+
+static	ULONG				g_ulNumHits = 0;
+static	ULONG				g_ulNumMisses = 0;
+
+// Allows the checksums of the loaded files and lumps to be cached on disk.
+CVAR( Bool, checksumcache, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG )
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	FString		checksumcache_GetPath( bool bCreate );
+static	void		checksumcache_Load( void );
+static	bool		checksumcache_StatFile( const char *pszPath, long long &llSize, long long &llModificationTime, bool &bIsDirectory );
+static	void		checksumcache_HashFile( CHECKSUMCACHEJOB_s &Job );
+static	void		checksumcache_Touch( CHECKSUMCACHEENTRY_s &Entry );
+
+//*****************************************************************************
+//	FUNCTIONS
+
+void CHECKSUMCACHE_Construct( void )
+{
+	// The loaded files may have changed since the last time.
+	g_LoadSignature = "";
+	g_bLoadSignatureValid = false;
+
+	g_ulNumHits = 0;
+	g_ulNumMisses = 0;
+
+	checksumcache_Load( );
+}
+
+//*****************************************************************************
+//
+void CHECKSUMCACHE_Save( void )
+{
+	if (( checksumcache == false ) || ( g_bChecksumCacheDirty == false ))
+		return;
+
+	const FString path = checksumcache_GetPath( true );
+	FILE *pFile = fopen( path, "w" );
+	if ( pFile == NULL )
+	{
+		Printf( "CHECKSUMCACHE_Save: Couldn't write %s: %s\n", path.GetChars( ), strerror( errno ));
+		return;
+	}
+
+	const long long llNow = time( NULL );
+	fprintf( pFile, "%s\n", CHECKSUMCACHE_HEADER );
+
+	TMap<FString, CHECKSUMCACHEENTRY_s>::Iterator it( g_ChecksumCache );
+	TMap<FString, CHECKSUMCACHEENTRY_s>::Pair *pair;
+	while ( it.NextPair( pair ))
+	{
+		const CHECKSUMCACHEENTRY_s &entry = pair->Value;
+		if ( llNow - entry.llLastUsed > CHECKSUMCACHE_MAXAGE )
+			continue;
+
+		fprintf( pFile, "%s %lld %lld %lld %s\n", entry.Checksum.GetChars( ), entry.llSize,
+			entry.llModificationTime, entry.llLastUsed, pair->Key.GetChars( ));
+	}
+
+	fclose( pFile );
+	g_bChecksumCacheDirty = false;
+}
+
+//*****************************************************************************
+//
+void CHECKSUMCACHE_GetFileChecksums( const TArray<FString> &Files, TArray<FString> &Checksums )
+{
+	TArray<CHECKSUMCACHEJOB_s> jobs;
+	TArray<unsigned int> jobIndices;
+
+	Checksums.Clear( );
+	Checksums.Resize( Files.Size( ));
+
+	for ( unsigned int i = 0; i < Files.Size( ); i++ )
+	{
+		CHECKSUMCACHEJOB_s job;
+		bool bIsDirectory;
+
+		job.Path = Files[i];
+		job.szChecksum[0] = 0;
+		job.iError = 0;
+		job.llSize = -1;
+		job.llModificationTime = -1;
+
+		if ( checksumcache_StatFile( Files[i], job.llSize, job.llModificationTime, bIsDirectory ) && bIsDirectory )
+		{
+			job.llSize = -1;
+		}
+		else if ( job.llSize >= 0 )
+		{
+			CHECKSUMCACHEENTRY_s *pEntry = checksumcache ? g_ChecksumCache.CheckKey( FString( "file:" ) + Files[i] ) : NULL;
+
+			if (( pEntry != NULL ) && ( pEntry->llSize == job.llSize ) && ( pEntry->llModificationTime == job.llModificationTime ))
+			{
+				Checksums[i] = pEntry->Checksum;
+				checksumcache_Touch( *pEntry );
+				g_ulNumHits++;
+				continue;
+			}
+		}
+
+		jobs.Push( job );
+		jobIndices.Push( i );
+	}
+
+	g_ulNumMisses += jobs.Size( );
+	if ( jobs.Size( ) == 0 )
+		return;
+
+	// Hash the files that aren't in the cache, several at once if possible.
+	unsigned int numThreads = std::thread::hardware_concurrency( );
+	if ( numThreads > CHECKSUMCACHE_MAXTHREADS )
+		numThreads = CHECKSUMCACHE_MAXTHREADS;
+
+	FWorkerPool::ParallelFor( jobs.Size( ), numThreads, [&jobs]( unsigned int index )
+	{
+		checksumcache_HashFile( jobs[index] );
+	} );
+
+	const long long llNow = time( NULL );
+	for ( unsigned int i = 0; i < jobs.Size( ); i++ )
+	{
+		const CHECKSUMCACHEJOB_s &job = jobs[i];
+
+		if ( job.iError != 0 )
+		{
+			Printf( "%s: %s\n", job.Path.GetChars( ), strerror( job.iError ));
+			continue;
+		}
+
+		Checksums[jobIndices[i]] = job.szChecksum;
+
+		// Files that we couldn't stat, or directories, aren't cached.
+		if ( checksumcache && ( job.llSize >= 0 ))
+		{
+			CHECKSUMCACHEENTRY_s &entry = g_ChecksumCache[FString( "file:" ) + job.Path];
+			entry.Checksum = job.szChecksum;
+			entry.llSize = job.llSize;
+			entry.llModificationTime = job.llModificationTime;
+			entry.llLastUsed = llNow;
+			g_bChecksumCacheDirty = true;
+		}
+	}
+}
+
+//*****************************************************************************
+//
+const FString &CHECKSUMCACHE_GetLoadSignature( void )
+{
+	if ( g_bLoadSignatureValid )
+		return g_LoadSignature;
+
+	g_bLoadSignatureValid = true;
+	g_LoadSignature = "";
+
+	// The lump numbers and contents are determined by the engine version and
+	// the files that were loaded, in that order.
+	FString description = GetVersionStringRev( );
+	for ( int i = 0; i < Wads.GetNumWads( ); i++ )
+	{
+		const char *pszPath = Wads.GetWadFullName( i );
+		description.AppendFormat( "\n%s", pszPath );
+
+		// Files embedded in other files are covered by their container.
+		if ( Wads.GetParentWad( i ) != i )
+			continue;
+
+		long long llSize, llModificationTime;
+		bool bIsDirectory;
+
+		// The contents of a directory can change without its modification time
+		// changing, so we can't tell whether cached checksums are still valid.
+		if (( checksumcache_StatFile( pszPath, llSize, llModificationTime, bIsDirectory ) == false ) || bIsDirectory )
+			return g_LoadSignature;
+
+		description.AppendFormat( " %lld %lld", llSize, llModificationTime );
+	}
+
+	MD5Context md5;
+	BYTE digest[16];
+	md5.Update( reinterpret_cast<const BYTE *>( description.GetChars( )), description.Len( ));
+	md5.Final( digest );
+	for ( unsigned int i = 0; i < sizeof( digest ); i++ )
+		g_LoadSignature.AppendFormat( "%02x", digest[i] );
+
+	return g_LoadSignature;
+}
+
+//*****************************************************************************
+//
+bool CHECKSUMCACHE_Find( const char *pszKey, FString &Checksum )
+{
+	if ( checksumcache == false )
+		return false;
+
+	CHECKSUMCACHEENTRY_s *pEntry = g_ChecksumCache.CheckKey( pszKey );
+	if ( pEntry == NULL )
+	{
+		g_ulNumMisses++;
+		return false;
+	}
+
+	Checksum = pEntry->Checksum;
+	checksumcache_Touch( *pEntry );
+	g_ulNumHits++;
+	return true;
+}
+
+//*****************************************************************************
+//
+void CHECKSUMCACHE_Store( const char *pszKey, const FString &Checksum )
+{
+	if ( checksumcache == false )
+		return;
+
+	CHECKSUMCACHEENTRY_s &entry = g_ChecksumCache[pszKey];
+	entry.Checksum = Checksum;
+	entry.llSize = 0;
+	entry.llModificationTime = 0;
+	entry.llLastUsed = time( NULL );
+	g_bChecksumCacheDirty = true;
+}
+
+//*****************************************************************************
+//
+ULONG CHECKSUMCACHE_GetNumHits( void )
+{
+	return g_ulNumHits;
+}
+
+//*****************************************************************************
+//
+ULONG CHECKSUMCACHE_GetNumMisses( void )
+{
+	return g_ulNumMisses;
+}
+
+//*****************************************************************************
+//
+static FString checksumcache_GetPath( bool bCreate )
+{
+	FString path = M_GetCachePath( bCreate );
+	if ( bCreate )
+		CreatePath( path );
+
+	path << "/" CHECKSUMCACHE_FILENAME;
+	return path;
+}
+
+//*****************************************************************************
+//
+static void checksumcache_Load( void )
+{
+	if (( checksumcache == false ) || g_bChecksumCacheLoaded )
+		return;
+
+	g_bChecksumCacheLoaded = true;
+
+	FILE *pFile = fopen( checksumcache_GetPath( false ), "r" );
+	if ( pFile == NULL )
+		return;
+
+	char szLine[4096];
+	if (( fgets( szLine, sizeof( szLine ), pFile ) == NULL ) || ( strncmp( szLine, CHECKSUMCACHE_HEADER, strlen( CHECKSUMCACHE_HEADER )) != 0 ))
+	{
+		// An old or broken cache file, it will be replaced.
+		fclose( pFile );
+		g_bChecksumCacheDirty = true;
+		return;
+	}
+
+	while ( fgets( szLine, sizeof( szLine ), pFile ) != NULL )
+	{
+		char szChecksum[33];
+		long long llSize, llModificationTime, llLastUsed;
+		int iKeyStart = 0;
+
+		if (( sscanf( szLine, "%32s %lld %lld %lld %n", szChecksum, &llSize, &llModificationTime, &llLastUsed, &iKeyStart ) < 4 ) || ( iKeyStart == 0 ))
+			continue;
+
+		FString key = szLine + iKeyStart;
+		key.StripRight( "\r\n" );
+		if ( key.IsEmpty( ))
+			continue;
+
+		CHECKSUMCACHEENTRY_s &entry = g_ChecksumCache[key];
+		entry.Checksum = szChecksum;
+		entry.llSize = llSize;
+		entry.llModificationTime = llModificationTime;
+		entry.llLastUsed = llLastUsed;
+	}
+
+	fclose( pFile );
+}
+
+//*****************************************************************************
+//
+static bool checksumcache_StatFile( const char *pszPath, long long &llSize, long long &llModificationTime, bool &bIsDirectory )
+{
+	struct stat fileInfo;
+
+	if ( stat( pszPath, &fileInfo ) == -1 )
+		return false;
+
+	llSize = fileInfo.st_size;
+	llModificationTime = fileInfo.st_mtime;
+	bIsDirectory = ( fileInfo.st_mode & S_IFDIR ) != 0;
+	return true;
+}
+
+//*****************************************************************************
+//
+// Runs on a worker thread, so this must not touch any global state.
+//
+static void checksumcache_HashFile( CHECKSUMCACHEJOB_s &Job )
+{
+	FILE *pFile = fopen( Job.Path, "rb" );
+	if ( pFile == NULL )
+	{
+		Job.iError = errno;
+		return;
+	}
+
+	MD5Context md5;
+	BYTE readbuf[32768];
+	size_t len;
+
+	while (( len = fread( readbuf, 1, sizeof( readbuf ), pFile )) > 0 )
+		md5.Update( readbuf, static_cast<unsigned int>( len ));
+
+	fclose( pFile );
+
+	md5.Final( readbuf );
+	for ( int i = 0; i < 16; i++ )
+		mysnprintf( Job.szChecksum + 2 * i, 3, "%02x", readbuf[i] );
+}
+
+//*****************************************************************************
+//
+static void checksumcache_Touch( CHECKSUMCACHEENTRY_s &Entry )
+{
+	const long long llNow = time( NULL );
+
+	if ( llNow - Entry.llLastUsed > CHECKSUMCACHE_TOUCHINTERVAL )
+	{
+		Entry.llLastUsed = llNow;
+		g_bChecksumCacheDirty = true;
+	}
+}
+
+//*****************************************************************************
+//	CONSOLE COMMANDS
+
+CCMD( checksumcache_clear )
+{
+	g_ChecksumCache.Clear( );
+	g_bChecksumCacheDirty = true;
+	CHECKSUMCACHE_Save( );
+	Printf( "Checksum cache cleared.\n" );
+}
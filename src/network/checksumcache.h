@@ -0,0 +1,80 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: checksumcache.h
+//
+// Description: Caches the MD5 checksums of loaded files and lumps on disk.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __CHECKSUMCACHE_H__
+#define __CHECKSUMCACHE_H__
+
+#include "doomtype.h"
+#include "tarray.h"
+#include "zstring.h"
+
+//*****************************************************************************
+//	PROTOTYPES
+
+void	CHECKSUMCACHE_Construct( void );
+void	CHECKSUMCACHE_Save( void );
+
+// Computes the MD5 checksums of the given files, in lowercase hex. The checksums of
+// files whose path, size and modification time match a cache entry are taken from
+// the cache, the others are hashed in parallel. Files that can't be read get an
+// empty checksum.
+void	CHECKSUMCACHE_GetFileChecksums( const TArray<FString> &Files, TArray<FString> &Checksums );
+
+// Returns a string that identifies the set of currently loaded files, or an empty
+// string if the loaded files can't be identified reliably (e.g. because a
+// directory was loaded). Checksums derived from the loaded lumps are cached under
+// keys that contain this signature.
+const FString	&CHECKSUMCACHE_GetLoadSignature( void );
+
+bool	CHECKSUMCACHE_Find( const char *pszKey, FString &Checksum );
+void	CHECKSUMCACHE_Store( const char *pszKey, const FString &Checksum );
+
+ULONG	CHECKSUMCACHE_GetNumHits( void );
+ULONG	CHECKSUMCACHE_GetNumMisses( void );
+
+#endif	// __CHECKSUMCACHE_H__
@@ -46,7 +46,26 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <string.h>
 #include "netcommand.h"
+#include "../stats.h"
+
+//*****************************************************************************
+//	VARIABLES
+
+struct NETCOMMANDSTATS_s
+{
+	// Number of commands built and how many of them needed a heap buffer.
+	ULONG			ulNumBuilt;
+	ULONG			ulNumHeapBuffers;
+
+	// Number of times a command was written to a client and the bytes written.
+	ULONG			ulNumSent;
+	ULONG			ulBytesSent;
+};
+
+static	NETCOMMANDSTATS_s	g_StatsThisTic;
+static	NETCOMMANDSTATS_s	g_StatsLastTic;
 
 //*****************************************************************************
 //
@@ -105,8 +124,8 @@ ULONG ClientIterator::operator++ ( ) {
 NetCommand::NetCommand ( const SVC Header ) :
 	_unreliable( false )
 {
-	_buffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
-	_buffer.Clear();
+	initBuffer();
+	++g_StatsThisTic.ulNumBuilt;
 	addByte( Header );
 }
 
@@ -115,17 +134,110 @@ NetCommand::NetCommand ( const SVC Header ) :
 NetCommand::NetCommand ( const SVC2 Header2 ) :
 	_unreliable( false )
 {
-	_buffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
-	_buffer.Clear();
+	initBuffer();
+	++g_StatsThisTic.ulNumBuilt;
 	addByte( SVC_EXTENDEDCOMMAND );
 	addByte( Header2 );
 }
 
+//*****************************************************************************
+//
+NetCommand::NetCommand ( const NetCommand &other ) :
+	_unreliable( other._unreliable )
+{
+	copyBuffer( other );
+}
+
+//*****************************************************************************
+//
+NetCommand::NetCommand ( NetCommand &&other ) :
+	_unreliable( other._unreliable )
+{
+	if ( other._heapData == NULL )
+	{
+		copyBuffer( other );
+		return;
+	}
+
+	// Take over the heap buffer instead of copying it.
+	_heapData = other._heapData;
+	_buffer.pbData = other._buffer.pbData;
+	_buffer.ulMaxSize = other._buffer.ulMaxSize;
+	_buffer.ulCurrentSize = other._buffer.ulCurrentSize;
+	_buffer.ByteStream = other._buffer.ByteStream;
+	_buffer.BufferType = other._buffer.BufferType;
+	other.initBuffer();
+}
+
 //*****************************************************************************
 //
 NetCommand::~NetCommand ( )
 {
-	_buffer.Free();
+	// _buffer doesn't own its data, so don't call _buffer.Free() here.
+	delete[] _heapData;
+}
+
+//*****************************************************************************
+//
+void NetCommand::initBuffer ( )
+{
+	_heapData = NULL;
+	_buffer.pbData = _inlineData;
+	_buffer.ulMaxSize = NETCOMMAND_INLINE_SIZE;
+	_buffer.BufferType = BUFFERTYPE_WRITE;
+	_buffer.Clear();
+}
+
+//*****************************************************************************
+//
+void NetCommand::copyBuffer ( const NetCommand &other )
+{
+	initBuffer();
+
+	if ( other._heapData != NULL )
+	{
+		_heapData = new BYTE[MAX_UDP_PACKET];
+		_buffer.pbData = _heapData;
+		_buffer.ulMaxSize = MAX_UDP_PACKET;
+		_buffer.Clear();
+		++g_StatsThisTic.ulNumHeapBuffers;
+	}
+
+	const LONG size = other._buffer.CalcSize();
+	memcpy( _buffer.pbData, other._buffer.pbData, size );
+	_buffer.ByteStream.pbStream = _buffer.pbData + size;
+	_buffer.ByteStream.bitShift = other._buffer.ByteStream.bitShift;
+	if ( other._buffer.ByteStream.bitBuffer != NULL )
+		_buffer.ByteStream.bitBuffer = _buffer.pbData + ( other._buffer.ByteStream.bitBuffer - other._buffer.pbData );
+	_buffer.ulCurrentSize = other._buffer.ulCurrentSize;
+}
+
+//*****************************************************************************
+//
+// Makes sure that Size more bytes fit into the buffer, moving the command
+// from the inline buffer to the heap if necessary.
+//
+bool NetCommand::ensureSpace ( const int Size )
+{
+	if ( ( _buffer.ByteStream.pbStream + Size ) <= _buffer.ByteStream.pbStreamEnd )
+		return true;
+
+	if ( _heapData != NULL )
+		return false;
+
+	const LONG size = _buffer.CalcSize();
+	_heapData = new BYTE[MAX_UDP_PACKET];
+	memcpy( _heapData, _inlineData, size );
+	++g_StatsThisTic.ulNumHeapBuffers;
+
+	if ( _buffer.ByteStream.bitBuffer != NULL )
+		_buffer.ByteStream.bitBuffer = _heapData + ( _buffer.ByteStream.bitBuffer - _inlineData );
+	_buffer.pbData = _heapData;
+	_buffer.ulMaxSize = MAX_UDP_PACKET;
+	_buffer.ByteStream.pbStream = _heapData + size;
+	_buffer.ByteStream.pbStreamEnd = _heapData + MAX_UDP_PACKET;
+
+	return ( ( _buffer.ByteStream.pbStream + Size ) <= _buffer.ByteStream.pbStreamEnd );
 }
 
 //*****************************************************************************
@@ -143,7 +255,7 @@ const char *NetCommand::getHeaderAsString() const
 //
 void NetCommand::addInteger( const int IntValue, const int Size )
 {
-	if ( ( _buffer.ByteStream.pbStream + Size ) > _buffer.ByteStream.pbStreamEnd )
+	if ( ensureSpace( Size ) == false )
 	{
 		Printf( "NetCommand::AddInteger: Overflow! Header: %s\n", getHeaderAsString() );
 		return;
@@ -194,6 +306,7 @@ void NetCommand::addFloat ( const float FloatValue )
 //
 void NetCommand::addBit( const bool value )
 {
+	ensureSpace( 1 );
 	NETWORK_WriteBit( &_buffer.ByteStream, value );
 	_buffer.ulCurrentSize = _buffer.CalcSize();
 }
@@ -202,6 +315,8 @@ void NetCommand::addBit( const bool value )
 //
 void NetCommand::addVariable( const int value )
 {
+	// Up to two bits for the length and a long.
+	ensureSpace( 1 + sizeof( SDWORD ));
 	NETWORK_WriteVariable( &_buffer.ByteStream, value );
 	_buffer.ulCurrentSize = _buffer.CalcSize();
 }
@@ -211,10 +326,34 @@ void NetCommand::addVariable( const int value )
 //
 void NetCommand::addShortByte ( int value, int bits )
 {
+	ensureSpace( 1 );
 	NETWORK_WriteShortByte( &_buffer.ByteStream, value, bits );
 	_buffer.ulCurrentSize = _buffer.CalcSize();
 }
 
+//*****************************************************************************
+//
+// Reserves Size bytes and returns where they start, so that a run of fixed
+// size values can be stored without checking the bounds of each of them.
+// Size must not exceed NETCOMMAND_INLINE_SIZE.
+//
+BYTE *NetCommand::reserve ( const int Size )
+{
+	if ( ensureSpace( Size ) == false )
+	{
+		Printf( "NetCommand::reserve: Overflow! Header: %s\n", getHeaderAsString() );
+
+		// A command can only overflow once it moved to the heap, so the inline
+		// buffer is unused and can take the values that are discarded.
+		return _inlineData;
+	}
+
+	BYTE *data = _buffer.ByteStream.pbStream;
+	_buffer.ByteStream.pbStream += Size;
+	_buffer.ulCurrentSize = _buffer.CalcSize();
+	return data;
+}
+
 //*****************************************************************************
 //
 void NetCommand::addString ( const char *pszString )
@@ -300,6 +439,9 @@ void NetCommand::sendCommandToOneClient( ULONG i )
 	}
 
 	writeCommandToStream( getBytestreamForClient( i ));
+
+	++g_StatsThisTic.ulNumSent;
+	g_StatsThisTic.ulBytesSent += _buffer.ulCurrentSize;
 }
 
 //*****************************************************************************
@@ -325,3 +467,27 @@ int NetCommand::calcSize() const
 {
 	return _buffer.CalcSize();
 }
+
+//*****************************************************************************
+//
+void NETCOMMAND_BeginTic( void )
+{
+	g_StatsLastTic = g_StatsThisTic;
+	memset( &g_StatsThisTic, 0, sizeof( g_StatsThisTic ));
+}
+
+//*****************************************************************************
+//	STATISTICS
+
+ADD_STAT( netcommands )
+{
+	FString	Out;
+
+	Out.Format( "Last tic: %lu commands built (%lu heap buffers), sent %lu times (%lu bytes)",
+		g_StatsLastTic.ulNumBuilt,
+		g_StatsLastTic.ulNumHeapBuffers,
+		g_StatsLastTic.ulNumSent,
+		g_StatsLastTic.ulBytesSent );
+
+	return ( Out );
+}
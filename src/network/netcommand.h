@@ -76,6 +76,10 @@ public:
 	ULONG operator++ ( );
 };
 
+// Most commands are only a few bytes long, these are built in an inline
+// buffer. Longer commands move to a heap buffer of MAX_UDP_PACKET bytes.
+enum { NETCOMMAND_INLINE_SIZE = 256 };
+
 /**
  * \brief Creates and sends network commands to the clients.
  *
@@ -84,10 +88,21 @@ public:
 class NetCommand {
 	NETBUFFER_s	_buffer;
 	bool		_unreliable;
+	BYTE		*_heapData;
+	BYTE		_inlineData[NETCOMMAND_INLINE_SIZE];
+
+	void initBuffer ( );
+	void copyBuffer ( const NetCommand &other );
+	bool ensureSpace ( const int Size );
+
+	// Not needed, commands are built once and then sent.
+	NetCommand &operator= ( const NetCommand &other );
 
 public:
 	NetCommand ( const SVC Header );
 	NetCommand ( const SVC2 Header2 );
+	NetCommand ( const NetCommand &other );
+	NetCommand ( NetCommand &&other );
 	~NetCommand ( );
 
 	const char *getHeaderAsString() const;
@@ -102,6 +117,7 @@ public:
 	void addBit ( const bool value );
 	void addVariable ( const int value );
 	void addShortByte ( int value, int bits );
+	BYTE *reserve ( const int Size );
 	void writeCommandToStream ( BYTESTREAM_s &ByteStream ) const;
 	NETBUFFER_s& getBufferForClient( ULONG i ) const;
 	BYTESTREAM_s& getBytestreamForClient( ULONG i ) const;
@@ -111,3 +127,5 @@ public:
 	void setUnreliable ( bool a );
 	int calcSize() const;
 };
+
+void	NETCOMMAND_BeginTic( void );
@@ -0,0 +1,205 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: packetencoder.cpp
+//
+// Description: Encodes and sends outgoing packets on worker threads.
+//
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include "../huffman/huffman.h"
+#include "packetencoder.h"
+
+//*****************************************************************************
+//
+PacketEncoderPool::PacketEncoderPool() :
+	_socket( INVALID_SOCKET ) {}
+
+//*****************************************************************************
+//
+PacketEncoderPool::~PacketEncoderPool()
+{
+	StopThreads();
+}
+
+//*****************************************************************************
+//
+// Changes the number of worker threads. The packets dispatched before must
+// have been waited for.
+//
+void PacketEncoderPool::SetNumThreads( unsigned int numThreads )
+{
+	if ( numThreads == _workers.Size() )
+		return;
+
+	StopThreads();
+
+	for ( unsigned int i = 0; i < numThreads; ++i )
+	{
+		Worker *worker = new Worker;
+		worker->codec = HUFFMAN_CreateCodec();
+		_workers.Push( worker );
+	}
+
+	_pool.SetNumThreads( numThreads );
+}
+
+//*****************************************************************************
+//
+unsigned int PacketEncoderPool::GetNumThreads() const
+{
+	return _workers.Size();
+}
+
+//*****************************************************************************
+//
+void PacketEncoderPool::SetSocket( SOCKET socket )
+{
+	_socket = socket;
+}
+
+//*****************************************************************************
+//
+void PacketEncoderPool::QueuePacket( const BYTE *data, size_t size, const NETADDRESS_s &address )
+{
+	Job job;
+	job.position = _packetData.Size();
+	job.size = size;
+	job.socketAddress = address.ToSocketAddress();
+	job.result.address = address;
+	job.result.bytesSent = -1;
+	job.result.error = 0;
+
+	_packetData.Resize( job.position + size );
+	memcpy( &_packetData[job.position], data, size );
+
+	// Keep all packets to an address on the same worker.
+	const unsigned int workerIndex = ( address.abIP[0] + address.abIP[1] + address.abIP[2] + address.abIP[3] + address.usPort ) % _workers.Size();
+	_workers[workerIndex]->jobIndices.Push( _jobs.Push( job ));
+}
+
+//*****************************************************************************
+//
+// Lets the workers start with the queued packets. Returns immediately.
+//
+void PacketEncoderPool::Dispatch()
+{
+	if ( _jobs.Size() == 0 )
+		return;
+
+	_pool.Start( [this]( unsigned int workerIndex ) { ProcessJobs( *_workers[workerIndex] ); } );
+}
+
+//*****************************************************************************
+//
+// Blocks until all dispatched packets are sent.
+//
+void PacketEncoderPool::Wait()
+{
+	_pool.Wait();
+}
+
+//*****************************************************************************
+//
+unsigned int PacketEncoderPool::GetNumResults() const
+{
+	return _jobs.Size();
+}
+
+//*****************************************************************************
+//
+const PacketEncoderPool::Result &PacketEncoderPool::GetResult( unsigned int index ) const
+{
+	return _jobs[index].result;
+}
+
+//*****************************************************************************
+//
+void PacketEncoderPool::ClearResults()
+{
+	_jobs.Clear();
+	_packetData.Clear();
+	for ( unsigned int i = 0; i < _workers.Size(); ++i )
+		_workers[i]->jobIndices.Clear();
+}
+
+//*****************************************************************************
+//
+void PacketEncoderPool::StopThreads()
+{
+	_pool.SetNumThreads( 0 );
+
+	for ( unsigned int i = 0; i < _workers.Size(); ++i )
+	{
+		HUFFMAN_DestroyCodec( _workers[i]->codec );
+		delete _workers[i];
+	}
+
+	_workers.Clear();
+	ClearResults();
+}
+
+//*****************************************************************************
+//
+void PacketEncoderPool::ProcessJobs( Worker &worker )
+{
+	for ( unsigned int i = 0; i < worker.jobIndices.Size(); ++i )
+	{
+		Job &job = _jobs[worker.jobIndices[i]];
+		int encodedSize = sizeof( worker.encodedData );
+		HUFFMAN_EncodeWithCodec( worker.codec, &_packetData[job.position], worker.encodedData, static_cast<int>( job.size ), &encodedSize );
+
+		const int bytesSent = sendto( _socket, (const char*)worker.encodedData, encodedSize, 0, (struct sockaddr *)&job.socketAddress, sizeof( job.socketAddress ));
+		if ( bytesSent < 0 )
+		{
+			job.result.bytesSent = -1;
+#ifdef __WIN32__
+			job.result.error = WSAGetLastError( );
+#else
+			job.result.error = errno;
+#endif
+		}
+		else
+			job.result.bytesSent = bytesSent;
+	}
+}
@@ -0,0 +1,115 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: packetencoder.h
+//
+// Description: Encodes and sends outgoing packets on worker threads.
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+#include "../networkheaders.h"
+#include "../networkshared.h"
+#include "../workerpool.h"
+
+namespace skulltag { class HuffmanCodec; }
+
+//==========================================================================
+//
+// PacketEncoderPool
+//
+// Collects the packets launched during a tic and lets a small pool of
+// worker threads Huffman-encode and send them, while the game thread
+// continues with the next tic. Packets to the same address are always
+// handled by the same worker, so they are sent in the order they were
+// queued.
+//
+//==========================================================================
+class PacketEncoderPool
+{
+public:
+	struct Result
+	{
+		NETADDRESS_s address;
+		int bytesSent; // Number of bytes sent, -1 if sending failed.
+		int error; // The socket error if sending failed.
+	};
+
+	PacketEncoderPool();
+	~PacketEncoderPool();
+
+	void SetNumThreads( unsigned int numThreads );
+	unsigned int GetNumThreads() const;
+	void SetSocket( SOCKET socket );
+	void QueuePacket( const BYTE *data, size_t size, const NETADDRESS_s &address );
+	void Dispatch();
+	void Wait();
+	unsigned int GetNumResults() const;
+	const Result &GetResult( unsigned int index ) const;
+	void ClearResults();
+
+private:
+	struct Job
+	{
+		size_t position; // The position of the packet data within _packetData.
+		size_t size;
+		struct sockaddr_in socketAddress;
+		Result result;
+	};
+
+	struct Worker
+	{
+		skulltag::HuffmanCodec *codec;
+		TArray<unsigned int> jobIndices;
+		BYTE encodedData[MAX_UDP_PACKET + 1]; // Scratch buffer for the encoded packet.
+	};
+
+	void StopThreads();
+	void ProcessJobs( Worker &worker );
+
+	// The unencoded data of all queued packets.
+	TArray<BYTE> _packetData;
+	TArray<Job> _jobs;
+	TArray<Worker *> _workers;
+	SOCKET _socket;
+	FWorkerPool _pool;
+};
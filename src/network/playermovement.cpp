@@ -0,0 +1,227 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: playermovement.cpp
+//
+// Description: Player movement snapshots used to delta compress player
+// movement updates against the last state a client has acknowledged.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+#include "../network.h"
+#include "playermovement.h"
+
+//*****************************************************************************
+//	VARIABLES
+
+cycle_t PlayerMovementCycles;
+
+struct PLAYERMOVEMENTSTATS_s
+{
+	// Number of full and delta compressed updates sent.
+	ULONG			ulNumFullUpdates;
+	ULONG			ulNumDeltaUpdates;
+
+	// Bytes used by these updates.
+	ULONG			ulFullBytes;
+	ULONG			ulDeltaBytes;
+
+	// Bytes the delta compressed updates would have needed as full updates.
+	ULONG			ulBytesSaved;
+
+	double			dEncodeMS;
+};
+
+static	PLAYERMOVEMENTSTATS_s	g_StatsThisTic;
+static	PLAYERMOVEMENTSTATS_s	g_StatsLastTic;
+
+//*****************************************************************************
+//	FUNCTIONS
+
+void PlayerMovementState::Set( fixed_t X, fixed_t Y, fixed_t Z, angle_t Angle, fixed_t VelX, fixed_t VelY, fixed_t VelZ, bool IsCrouching )
+{
+	x = X;
+	y = Y;
+	z = RoundAproxFixed( Z );
+	angle = Angle;
+	velx = RoundAproxFixed( VelX );
+	vely = RoundAproxFixed( VelY );
+	velz = RoundAproxFixed( VelZ );
+	isCrouching = IsCrouching;
+}
+
+//*****************************************************************************
+//
+int PlayerMovementState::GetChangedFields( const PlayerMovementState &baseline ) const
+{
+	int fields = 0;
+
+	if ( x != baseline.x )
+		fields |= PLAYERMOVE_X;
+	if ( y != baseline.y )
+		fields |= PLAYERMOVE_Y;
+	if ( z != baseline.z )
+		fields |= PLAYERMOVE_Z;
+	if ( angle != baseline.angle )
+		fields |= PLAYERMOVE_ANGLE;
+	if ( velx != baseline.velx )
+		fields |= PLAYERMOVE_VELX;
+	if ( vely != baseline.vely )
+		fields |= PLAYERMOVE_VELY;
+	if ( velz != baseline.velz )
+		fields |= PLAYERMOVE_VELZ;
+
+	return fields;
+}
+
+//*****************************************************************************
+//
+// Rounds the value the same way sending it as AproxFixed does, so that the
+// server and the client compare exactly the same values.
+//
+fixed_t PlayerMovementState::RoundAproxFixed( fixed_t value )
+{
+	return static_cast<SWORD>( value >> FRACBITS ) << FRACBITS;
+}
+
+//*****************************************************************************
+//
+PlayerMovementHistory::PlayerMovementHistory()
+{
+	Clear();
+}
+
+//*****************************************************************************
+//
+void PlayerMovementHistory::Clear()
+{
+	for ( unsigned int player = 0; player < MAXPLAYERS; ++player )
+	{
+		for ( unsigned int i = 0; i < PLAYER_MOVEMENT_HISTORY_SIZE; ++i )
+			_records[player][i].tic = -1;
+	}
+}
+
+//*****************************************************************************
+//
+void PlayerMovementHistory::Store( unsigned int player, int tic, const PlayerMovementState &state )
+{
+	if (( player >= MAXPLAYERS ) || ( tic < 0 ))
+		return;
+
+	Record &record = _records[player][tic % PLAYER_MOVEMENT_HISTORY_SIZE];
+	record.tic = tic;
+	record.state = state;
+}
+
+//*****************************************************************************
+//
+const PlayerMovementState *PlayerMovementHistory::Find( unsigned int player, int tic ) const
+{
+	if (( player >= MAXPLAYERS ) || ( tic < 0 ))
+		return NULL;
+
+	const Record &record = _records[player][tic % PLAYER_MOVEMENT_HISTORY_SIZE];
+	return ( record.tic == tic ) ? &record.state : NULL;
+}
+
+//*****************************************************************************
+//
+void PlayerMovementHistory::InvalidateTic( int tic )
+{
+	if ( tic < 0 )
+		return;
+
+	for ( unsigned int player = 0; player < MAXPLAYERS; ++player )
+	{
+		Record &record = _records[player][tic % PLAYER_MOVEMENT_HISTORY_SIZE];
+		if ( record.tic == tic )
+			record.tic = -1;
+	}
+}
+
+//*****************************************************************************
+//
+void PLAYERMOVEMENT_BeginTic( void )
+{
+	g_StatsLastTic = g_StatsThisTic;
+	g_StatsLastTic.dEncodeMS = PlayerMovementCycles.TimeMS();
+	memset( &g_StatsThisTic, 0, sizeof( g_StatsThisTic ));
+	PlayerMovementCycles.Reset();
+}
+
+//*****************************************************************************
+//
+void PLAYERMOVEMENT_AddFullUpdate( int size )
+{
+	g_StatsThisTic.ulNumFullUpdates++;
+	g_StatsThisTic.ulFullBytes += size;
+}
+
+//*****************************************************************************
+//
+void PLAYERMOVEMENT_AddDeltaUpdate( int size, int fullSize )
+{
+	g_StatsThisTic.ulNumDeltaUpdates++;
+	g_StatsThisTic.ulDeltaBytes += size;
+	if ( fullSize > size )
+		g_StatsThisTic.ulBytesSaved += fullSize - size;
+}
+
+//*****************************************************************************
+//	STATISTICS
+
+ADD_STAT( playermovement )
+{
+	FString	Out;
+
+	Out.Format( "Last tic: %u full (%u bytes), %u delta (%u bytes, %u saved), %.3f ms",
+		static_cast<unsigned int>( g_StatsLastTic.ulNumFullUpdates ),
+		static_cast<unsigned int>( g_StatsLastTic.ulFullBytes ),
+		static_cast<unsigned int>( g_StatsLastTic.ulNumDeltaUpdates ),
+		static_cast<unsigned int>( g_StatsLastTic.ulDeltaBytes ),
+		static_cast<unsigned int>( g_StatsLastTic.ulBytesSaved ),
+		g_StatsLastTic.dEncodeMS );
+
+	return ( Out );
+}
@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: playermovement.h
+//
+// Description: Player movement snapshots used to delta compress player
+// movement updates against the last state a client has acknowledged.
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+#include "../doomdef.h"
+#include "../m_fixed.h"
+#include "../stats.h"
+
+// Number of tics a snapshot stays available as a delta baseline.
+enum { PLAYER_MOVEMENT_HISTORY_SIZE = 32 };
+
+//*****************************************************************************
+//
+// The movement of a player as it is seen by the clients, i.e. with z and the
+// velocity rounded to the precision used by SVC_MOVEPLAYER.
+//
+struct PlayerMovementState
+{
+	fixed_t		x;
+	fixed_t		y;
+	fixed_t		z;
+	angle_t		angle;
+	fixed_t		velx;
+	fixed_t		vely;
+	fixed_t		velz;
+	bool		isCrouching;
+
+	void Set( fixed_t X, fixed_t Y, fixed_t Z, angle_t Angle, fixed_t VelX, fixed_t VelY, fixed_t VelZ, bool IsCrouching );
+	int GetChangedFields( const PlayerMovementState &baseline ) const;
+
+	static fixed_t RoundAproxFixed( fixed_t value );
+};
+
+//==========================================================================
+//
+// PlayerMovementHistory
+//
+// Remembers the movement of all players over the last
+// PLAYER_MOVEMENT_HISTORY_SIZE tics. The server keeps one history per client
+// containing what it sent to the client, the client keeps one containing
+// what it received.
+//
+//==========================================================================
+class PlayerMovementHistory
+{
+public:
+	PlayerMovementHistory();
+
+	void Clear();
+	void Store( unsigned int player, int tic, const PlayerMovementState &state );
+	const PlayerMovementState *Find( unsigned int player, int tic ) const;
+	void InvalidateTic( int tic );
+
+private:
+	struct Record
+	{
+		int tic; // The tic this snapshot belongs to, -1 if the record is unused.
+		PlayerMovementState state;
+	};
+
+	Record _records[MAXPLAYERS][PLAYER_MOVEMENT_HISTORY_SIZE];
+};
+
+//*****************************************************************************
+//	PROTOTYPES
+
+// Time the server spends building player movement updates.
+extern cycle_t PlayerMovementCycles;
+
+void	PLAYERMOVEMENT_BeginTic( void );
+void	PLAYERMOVEMENT_AddFullUpdate( int size );
+void	PLAYERMOVEMENT_AddDeltaUpdate( int size, int fullSize );
@@ -0,0 +1,242 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: protocoltest.cpp
+//
+// Description: Console command that round-trips, fuzzes and times the generated server command code.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+#include "../c_dispatch.h"
+#include "../m_random.h"
+#include "../stats.h"
+#include "servercommands.h"
+
+//*****************************************************************************
+//	VARIABLES
+
+struct PROTOCOLTESTSTATS_s
+{
+	ULONG			ulNumRoundTrips;
+	ULONG			ulNumTruncations;
+	ULONG			ulNumMutations;
+	ULONG			ulNumFailures;
+};
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	bool	protocoltest_Parse( const BYTE *pbData, int size, const BYTE *&pbEnd );
+static	int		protocoltest_Encode( const NetCommand &command, TArray<BYTE> &data );
+
+//*****************************************************************************
+//	FUNCTIONS
+
+//*****************************************************************************
+//
+// Reads one command from a copy of the data that is exactly size bytes long,
+// so that memory checkers catch any read beyond its end. Returns whether the
+// command was read completely and stores where reading stopped in pbEnd.
+//
+static bool protocoltest_Parse( const BYTE *pbData, int size, const BYTE *&pbEnd )
+{
+	BYTE *pbCopy = new BYTE[size > 0 ? size : 1];
+	memcpy( pbCopy, pbData, size );
+
+	BYTESTREAM_s byteStream;
+	byteStream.pbStream = pbCopy;
+	byteStream.pbStreamEnd = pbCopy + size;
+
+	const bool bKnown = CLIENT_SkipServerCommand( &byteStream );
+	pbEnd = pbData + ( byteStream.pbStream - pbCopy );
+
+	delete[] pbCopy;
+	return bKnown && ( byteStream.pbStream <= byteStream.pbStreamEnd );
+}
+
+//*****************************************************************************
+//
+// Appends the command to data and returns its size.
+//
+static int protocoltest_Encode( const NetCommand &command, TArray<BYTE> &data )
+{
+	const int size = command.calcSize();
+	const unsigned int position = data.Reserve( size );
+
+	BYTESTREAM_s byteStream;
+	byteStream.pbStream = &data[position];
+	byteStream.pbStreamEnd = byteStream.pbStream + size;
+	command.writeCommandToStream( byteStream );
+	return size;
+}
+
+//*****************************************************************************
+//	CONSOLE COMMANDS
+
+// Builds every server command with random parameters and checks that the
+// client reads each of them completely, detects every truncation of it and
+// survives random changes to it. Then times encoding and decoding a batch of
+// all these commands.
+CCMD( protocoltest )
+{
+	const int iterations = ( argv.argc( ) > 1 ) ? atoi( argv[1] ) : 100;
+	if ( iterations <= 0 )
+	{
+		Printf( "Usage: protocoltest [iterations] [seed]\n" );
+		return;
+	}
+
+	FRandom random;
+	random.Init(( argv.argc( ) > 2 ) ? atoi( argv[2] ) : 0 );
+
+	PROTOCOLTESTSTATS_s stats;
+	memset( &stats, 0, sizeof( stats ));
+
+	TArray<BYTE> data;
+	TArray<BYTE> mutated;
+	const BYTE *pbEnd;
+
+	for ( unsigned int test = 0; test < g_NumServerCommandTests; ++test )
+	{
+		bool bFailed = false;
+
+		for ( int i = 0; ( i < iterations ) && ( bFailed == false ); ++i )
+		{
+			ServerCommands::BaseServerCommand *command = g_ServerCommandTests[test].createRandom( random );
+			data.Clear( );
+			const int size = protocoltest_Encode( command->BuildNetCommand( ), data );
+			delete command;
+
+			// The client has to read exactly what the server wrote.
+			++stats.ulNumRoundTrips;
+			if (( protocoltest_Parse( &data[0], size, pbEnd ) == false ) || ( pbEnd != &data[0] + size ))
+			{
+				Printf( "protocoltest: %s: %d byte command was not read completely (stopped at %td)\n",
+					g_ServerCommandTests[test].name, size, pbEnd - &data[0] );
+				bFailed = true;
+				break;
+			}
+
+			// Every truncated command has to be noticed.
+			for ( int length = 0; length < size; ++length )
+			{
+				++stats.ulNumTruncations;
+				if ( protocoltest_Parse( &data[0], length, pbEnd ))
+				{
+					Printf( "protocoltest: %s: command truncated to %d of %d bytes was not noticed\n",
+						g_ServerCommandTests[test].name, length, size );
+					bFailed = true;
+					break;
+				}
+			}
+
+			// Commands with random changes just must not crash the client.
+			for ( int mutation = 0; mutation < 4; ++mutation )
+			{
+				mutated = data;
+				for ( int changes = 1 + random( 4 ); changes > 0; --changes )
+					mutated[random( size )] ^= 1 << random( 8 );
+
+				++stats.ulNumMutations;
+				protocoltest_Parse( &mutated[0], size, pbEnd );
+			}
+		}
+
+		if ( bFailed )
+			++stats.ulNumFailures;
+	}
+
+	Printf( "%u commands: %lu round trips, %lu truncations, %lu mutations, %lu commands failed\n",
+		g_NumServerCommandTests, stats.ulNumRoundTrips, stats.ulNumTruncations, stats.ulNumMutations, stats.ulNumFailures );
+
+	// Time encoding a batch that contains every command iterations times,
+	// like the server does when it fills packets. The commands are created
+	// with their random parameters beforehand, so that only building the
+	// NetCommands and writing them to the stream is timed.
+	TArray<ServerCommands::BaseServerCommand *> commands;
+	for ( int i = 0; i < iterations; ++i )
+	{
+		for ( unsigned int test = 0; test < g_NumServerCommandTests; ++test )
+			commands.Push( g_ServerCommandTests[test].createRandom( random ));
+	}
+
+	cycle_t encodeCycles;
+	encodeCycles.Reset( );
+	data.Clear( );
+	const int numCommands = commands.Size( );
+
+	encodeCycles.Clock( );
+	for ( unsigned int i = 0; i < commands.Size( ); ++i )
+		protocoltest_Encode( commands[i]->BuildNetCommand( ), data );
+	encodeCycles.Unclock( );
+
+	for ( unsigned int i = 0; i < commands.Size( ); ++i )
+		delete commands[i];
+
+	// Time decoding the batch like the client does when it parses a packet.
+	cycle_t decodeCycles;
+	decodeCycles.Reset( );
+
+	BYTESTREAM_s byteStream;
+	byteStream.pbStream = &data[0];
+	byteStream.pbStreamEnd = &data[0] + data.Size( );
+	int numDecoded = 0;
+
+	decodeCycles.Clock( );
+	while ( byteStream.pbStream < byteStream.pbStreamEnd )
+	{
+		if ( CLIENT_SkipServerCommand( &byteStream ) == false )
+			break;
+		++numDecoded;
+	}
+	decodeCycles.Unclock( );
+
+	if ( numDecoded != numCommands )
+		Printf( "protocoltest: only %d of %d batched commands were decoded\n", numDecoded, numCommands );
+
+	const double dMegabytes = data.Size( ) / ( 1024.0 * 1024.0 );
+	Printf( "Encoded %d commands (%u bytes) in %.3f ms, %.1f MB/s\n",
+		numCommands, data.Size( ), encodeCycles.TimeMS( ), dMegabytes * 1000 / MAX( encodeCycles.TimeMS( ), 0.001 ));
+	Printf( "Decoded %d commands (%u bytes) in %.3f ms, %.1f MB/s\n",
+		numDecoded, data.Size( ), decodeCycles.TimeMS( ), dMegabytes * 1000 / MAX( decodeCycles.TimeMS( ), 0.001 ));
+}
@@ -88,6 +88,8 @@ BEGIN_ENUM( SVC )
 	ENUM_ELEMENT ( SVC_SPAWNPLAYER ),					// PLAYER COMMANDS
 	ENUM_ELEMENT ( SVC_SPAWNMORPHPLAYER ),
 	ENUM_ELEMENT ( SVC_MOVEPLAYER ),
+	ENUM_ELEMENT ( SVC_PLAYERMOVEMENTTIC ),
+	ENUM_ELEMENT ( SVC_MOVEPLAYERDELTA ),
 	ENUM_ELEMENT ( SVC_DAMAGEPLAYER ),
 	ENUM_ELEMENT ( SVC_KILLPLAYER ),
 	ENUM_ELEMENT ( SVC_SETPLAYERHEALTH ),
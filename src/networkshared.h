@@ -309,6 +309,70 @@ void			NETWORK_WriteShortByte( BYTESTREAM_s *byteStream, int value, int bits );
 void			NETWORK_WriteHeader( BYTESTREAM_s *pByteStream, int Byte );
 bool			NETWORK_StringToIP( const char *pszAddress, char *pszIP0, char *pszIP1, char *pszIP2, char *pszIP3 );
 
+//*****************************************************************************
+//
+// Loads and stores little-endian values at any alignment, without bounds
+// checks. The generated server command code uses these after checking the
+// bounds of a whole run of fixed size values at once.
+//
+inline int NETWORK_GetByte( const BYTE *data )
+{
+	return data[0];
+}
+
+inline int NETWORK_GetShort( const BYTE *data )
+{
+	return static_cast<SWORD>( data[0] | ( data[1] << 8 ));
+}
+
+inline int NETWORK_GetLong( const BYTE *data )
+{
+	return static_cast<SDWORD>( data[0] | ( data[1] << 8 ) | ( data[2] << 16 ) | ( static_cast<DWORD>( data[3] ) << 24 ));
+}
+
+inline float NETWORK_GetFloat( const BYTE *data )
+{
+	union
+	{
+		float	f;
+		int		i;
+	} dat;
+
+	dat.i = NETWORK_GetLong( data );
+	return ( dat.f );
+}
+
+inline void NETWORK_PutByte( BYTE *data, int value )
+{
+	data[0] = static_cast<BYTE>( value );
+}
+
+inline void NETWORK_PutShort( BYTE *data, int value )
+{
+	data[0] = static_cast<BYTE>( value );
+	data[1] = static_cast<BYTE>( value >> 8 );
+}
+
+inline void NETWORK_PutLong( BYTE *data, int value )
+{
+	data[0] = static_cast<BYTE>( value );
+	data[1] = static_cast<BYTE>( value >> 8 );
+	data[2] = static_cast<BYTE>( value >> 16 );
+	data[3] = static_cast<BYTE>( value >> 24 );
+}
+
+inline void NETWORK_PutFloat( BYTE *data, float value )
+{
+	union
+	{
+		float	f;
+		int		i;
+	} dat;
+
+	dat.f = value;
+	NETWORK_PutLong( data, dat.i );
+}
+
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 //-- CLASSES ---------------------------------------------------------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -86,6 +86,7 @@
 #include "invasion.h"
 #include "sv_commands.h"
 #include "network/nettraffic.h"
+#include "stats.h"
 #include "za_database.h"
 #include "cl_commands.h"
 #include "cl_main.h"
@@ -266,6 +267,7 @@ struct CallReturn
 	int ReturnAddress;
 	int bDiscardResult;
 	unsigned int EntryInstrCount;
+	cycle_t CallTime;	// Only used while acs_profiletime is on
 };
 
 static DLevelScript *P_GetScriptGoing (AActor *who, line_t *where, int num, const ScriptPtr *code, FBehavior *module,
@@ -2027,6 +2029,11 @@ void FBehavior::SerializeVarSet (FArchive &arc, SDWORD *vars, int max)
 	}
 }
 
+// Pre-decoding is done when a module is loaded, so changes only affect
+// modules loaded afterwards.
+CVAR (Bool, acs_predecode, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+CVAR (Bool, acs_superinstructions, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
 FBehavior::FBehavior (int lumpnum, FileReader * fr, int len)
 {
 	BYTE *object;
@@ -2042,6 +2049,10 @@ FBehavior::FBehavior (int lumpnum, FileReader * fr, int len)
 	ArrayStore = NULL;
 	Chunks = NULL;
 	Data = NULL;
+	Code = NULL;
+	CodeSize = 0;
+	OfsToCode = NULL;
+	CodeToOfs = NULL;
 	Format = ACS_Unknown;
 	LumpNum = lumpnum;
 	memset (MapVarStore, 0, sizeof(MapVarStore));
@@ -2461,11 +2472,28 @@ FBehavior::FBehavior (int lumpnum, FileReader * fr, int len)
 		}
 	}
 
+	if (acs_predecode && (Format == ACS_Enhanced || Format == ACS_LittleEnhanced))
+	{
+		if (!Predecode ())
+		{
+			DPrintf ("Could not pre-decode %s, interpreting it directly\n", ModuleName);
+		}
+	}
+
 	DPrintf ("Loaded %d scripts, %d functions\n", NumScripts, NumFunctions);
 }
 
 FBehavior::~FBehavior ()
 {
+	if (Code != NULL)
+	{
+		delete[] Code;
+		delete[] OfsToCode;
+		delete[] CodeToOfs;
+		Code = NULL;
+		OfsToCode = NULL;
+		CodeToOfs = NULL;
+	}
 	if (Scripts != NULL)
 	{
 		delete[] Scripts;
@@ -2686,6 +2714,558 @@ int STACK_ARGS FBehavior::SortScripts (const void *a, const void *b)
 	return ptr1->Number - ptr2->Number;
 }
 
+//============================================================================
+//
+// ACS pre-decoding
+//
+// ACS_LittleEnhanced code packs p-codes and most of their operands into
+// single bytes, so the interpreter needs to check the module's format for
+// nearly every operand it reads. When a module is loaded, its code is
+// translated into a stream with one word per p-code and operand, which the
+// interpreter can run as ACS_Enhanced code. Byte variants of p-codes are
+// widened to their word equivalents along the way, and a few common p-code
+// sequences are fused into single superinstructions.
+//
+// Jump operands keep their original offsets. Ofs2PC() and PC2Ofs() map them
+// to and from the decoded stream, so return addresses and savegames use the
+// same offsets whether or not a module was pre-decoded.
+//
+//============================================================================
+
+struct FACSCodeReader
+{
+	const BYTE *Data;
+	DWORD Size;
+	DWORD Pos;
+	bool Little;
+	bool Bad;
+
+	int RawByte ()
+	{
+		if (Pos + 1 > Size)
+		{
+			Bad = true;
+			return 0;
+		}
+		return Data[Pos++];
+	}
+
+	int Word ()
+	{
+		if (Pos + 4 > Size)
+		{
+			Bad = true;
+			return 0;
+		}
+		int res = Data[Pos] | (Data[Pos+1] << 8) | (Data[Pos+2] << 16) | (Data[Pos+3] << 24);
+		Pos += 4;
+		return res;
+	}
+
+	// Same as NEXTBYTE and NEXTSHORT in the interpreter
+	int Byte ()
+	{
+		return Little ? RawByte() : Word();
+	}
+
+	int Short ()
+	{
+		if (!Little)
+		{
+			return Word();
+		}
+		if (Pos + 2 > Size)
+		{
+			Bad = true;
+			return 0;
+		}
+		int res = SWORD(Data[Pos] | (Data[Pos+1] << 8));
+		Pos += 2;
+		return res;
+	}
+
+	int PCode ()
+	{
+		if (!Little)
+		{
+			return Word();
+		}
+		int pcd = RawByte();
+		if (pcd >= 256-16)
+		{
+			pcd = (256-16) + ((pcd - (256-16)) << 8) + RawByte();
+		}
+		return pcd;
+	}
+};
+
+struct FDecodedPCode
+{
+	DWORD Offset;			// Offset of the p-code in the original code
+	DWORD End;				// Offset just past its operands
+	int PCode;				// The p-code after widening
+	unsigned int FirstWord;	// Index of the p-code in the decoded words
+	bool IsTarget;			// Something other than the previous p-code can get here
+};
+
+//============================================================================
+//
+// DecodePCode
+//
+// Decodes one p-code with its operands, appending the decoded words to
+// words in little endian order. Jump targets are appended to targets.
+// Returns false if the p-code is unknown or runs past the end of the code.
+//
+//============================================================================
+
+static bool DecodePCode (FACSCodeReader &reader, TArray<int> &words, TArray<DWORD> &targets,
+	int &pcd, bool &fallthrough)
+{
+	int i, count, target;
+
+	pcd = reader.PCode();
+	fallthrough = true;
+
+	unsigned int first = words.Push (0);
+
+	switch (pcd)
+	{
+	case DLevelScript::PCD_PUSHBYTE:
+		pcd = DLevelScript::PCD_PUSHNUMBER;
+		words.Push (reader.RawByte());
+		break;
+
+	case DLevelScript::PCD_PUSH2BYTES:
+	case DLevelScript::PCD_PUSH3BYTES:
+	case DLevelScript::PCD_PUSH4BYTES:
+	case DLevelScript::PCD_PUSH5BYTES:
+	case DLevelScript::PCD_PUSHBYTES:
+		count = pcd == DLevelScript::PCD_PUSH2BYTES ? 2 :
+				pcd == DLevelScript::PCD_PUSH3BYTES ? 3 :
+				pcd == DLevelScript::PCD_PUSH4BYTES ? 4 :
+				pcd == DLevelScript::PCD_PUSH5BYTES ? 5 : reader.RawByte();
+		pcd = DLevelScript::PCD_X_PUSHNUMBERS;
+		words.Push (count);
+		for (i = 0; i < count; ++i)
+		{
+			words.Push (reader.RawByte());
+		}
+		break;
+
+	case DLevelScript::PCD_LSPEC1DIRECTB:
+	case DLevelScript::PCD_LSPEC2DIRECTB:
+	case DLevelScript::PCD_LSPEC3DIRECTB:
+	case DLevelScript::PCD_LSPEC4DIRECTB:
+	case DLevelScript::PCD_LSPEC5DIRECTB:
+		count = pcd - DLevelScript::PCD_LSPEC1DIRECTB + 1;
+		pcd = DLevelScript::PCD_LSPEC1DIRECT + count - 1;
+		for (i = 0; i <= count; ++i)
+		{
+			words.Push (reader.RawByte());
+		}
+		break;
+
+	case DLevelScript::PCD_DELAYDIRECTB:
+		pcd = DLevelScript::PCD_DELAYDIRECT;
+		words.Push (reader.RawByte());
+		break;
+
+	case DLevelScript::PCD_RANDOMDIRECTB:
+		pcd = DLevelScript::PCD_RANDOMDIRECT;
+		words.Push (reader.RawByte());
+		words.Push (reader.RawByte());
+		break;
+
+	case DLevelScript::PCD_LSPEC1DIRECT:
+	case DLevelScript::PCD_LSPEC2DIRECT:
+	case DLevelScript::PCD_LSPEC3DIRECT:
+	case DLevelScript::PCD_LSPEC4DIRECT:
+	case DLevelScript::PCD_LSPEC5DIRECT:
+		count = pcd - DLevelScript::PCD_LSPEC1DIRECT + 1;
+		words.Push (reader.Byte());
+		for (i = 0; i < count; ++i)
+		{
+			words.Push (reader.Word());
+		}
+		break;
+
+#define VARPCODES(op) \
+	case DLevelScript::PCD_##op##SCRIPTVAR: \
+	case DLevelScript::PCD_##op##MAPVAR: \
+	case DLevelScript::PCD_##op##WORLDVAR: \
+	case DLevelScript::PCD_##op##GLOBALVAR: \
+	case DLevelScript::PCD_##op##MAPARRAY: \
+	case DLevelScript::PCD_##op##WORLDARRAY: \
+	case DLevelScript::PCD_##op##GLOBALARRAY:
+
+	VARPCODES(ASSIGN)
+	VARPCODES(PUSH)
+	VARPCODES(ADD)
+	VARPCODES(SUB)
+	VARPCODES(MUL)
+	VARPCODES(DIV)
+	VARPCODES(MOD)
+	VARPCODES(AND)
+	VARPCODES(EOR)
+	VARPCODES(OR)
+	VARPCODES(LS)
+	VARPCODES(RS)
+	VARPCODES(INC)
+	VARPCODES(DEC)
+#undef VARPCODES
+	case DLevelScript::PCD_LSPEC1:
+	case DLevelScript::PCD_LSPEC2:
+	case DLevelScript::PCD_LSPEC3:
+	case DLevelScript::PCD_LSPEC4:
+	case DLevelScript::PCD_LSPEC5:
+	case DLevelScript::PCD_LSPEC5RESULT:
+	case DLevelScript::PCD_PUSHFUNCTION:
+	case DLevelScript::PCD_CALL:
+	case DLevelScript::PCD_CALLDISCARD:
+		words.Push (reader.Byte());
+		break;
+
+	case DLevelScript::PCD_CALLFUNC:
+		words.Push (reader.Byte());
+		words.Push (reader.Short());
+		break;
+
+	case DLevelScript::PCD_PUSHNUMBER:
+	case DLevelScript::PCD_DELAYDIRECT:
+	case DLevelScript::PCD_TAGWAITDIRECT:
+	case DLevelScript::PCD_POLYWAITDIRECT:
+	case DLevelScript::PCD_SCRIPTWAITDIRECT:
+	case DLevelScript::PCD_SETFONTDIRECT:
+	case DLevelScript::PCD_SETGRAVITYDIRECT:
+	case DLevelScript::PCD_SETAIRCONTROLDIRECT:
+	case DLevelScript::PCD_CHECKINVENTORYDIRECT:
+		words.Push (reader.Word());
+		break;
+
+	case DLevelScript::PCD_RANDOMDIRECT:
+	case DLevelScript::PCD_THINGCOUNTDIRECT:
+	case DLevelScript::PCD_CHANGEFLOORDIRECT:
+	case DLevelScript::PCD_CHANGECEILINGDIRECT:
+	case DLevelScript::PCD_GIVEINVENTORYDIRECT:
+	case DLevelScript::PCD_TAKEINVENTORYDIRECT:
+		words.Push (reader.Word());
+		words.Push (reader.Word());
+		break;
+
+	case DLevelScript::PCD_CONSOLECOMMANDDIRECT:
+	case DLevelScript::PCD_SETMUSICDIRECT:
+	case DLevelScript::PCD_LOCALSETMUSICDIRECT:
+	case DLevelScript::PCD_SPAWNSPOTDIRECT:
+	case DLevelScript::PCD_SPAWNDIRECT:
+		count = pcd == DLevelScript::PCD_SPAWNDIRECT ? 6 :
+				pcd == DLevelScript::PCD_SPAWNSPOTDIRECT ? 4 : 3;
+		for (i = 0; i < count; ++i)
+		{
+			words.Push (reader.Word());
+		}
+		break;
+
+	case DLevelScript::PCD_GOTO:
+		fallthrough = false;
+		// fall through
+	case DLevelScript::PCD_IFGOTO:
+	case DLevelScript::PCD_IFNOTGOTO:
+		target = reader.Word();
+		words.Push (target);
+		targets.Push (target);
+		break;
+
+	case DLevelScript::PCD_CASEGOTO:
+		words.Push (reader.Word());
+		target = reader.Word();
+		words.Push (target);
+		targets.Push (target);
+		break;
+
+	case DLevelScript::PCD_CASEGOTOSORTED:
+		// The count and jump table are 4-byte aligned
+		reader.Pos = DWORD((((size_t)reader.Data + reader.Pos + 3) & ~3) - (size_t)reader.Data);
+		count = reader.Word();
+		if (count < 0 || reader.Pos + DWORD(count) * 8 > reader.Size)
+		{
+			return false;
+		}
+		words.Push (count);
+		for (i = 0; i < count; ++i)
+		{
+			// The interpreter reads the case values without swapping them,
+			// so they must come out of the LittleLong below unchanged.
+			words.Push (LittleLong(*(const int *)(reader.Data + reader.Pos)));
+			reader.Pos += 4;
+			target = reader.Word();
+			words.Push (target);
+			targets.Push (target);
+		}
+		break;
+
+	case DLevelScript::PCD_TERMINATE:
+	case DLevelScript::PCD_RESTART:
+	case DLevelScript::PCD_GOTOSTACK:
+	case DLevelScript::PCD_RETURNVOID:
+	case DLevelScript::PCD_RETURNVAL:
+		fallthrough = false;
+		break;
+
+	default:
+		if (pcd < 0 || pcd >= DLevelScript::PCODE_COMMAND_COUNT)
+		{
+			return false;
+		}
+		break;
+	}
+	if (reader.Bad)
+	{
+		return false;
+	}
+	words[first] = pcd;
+	for (i = first; i < (int)words.Size(); ++i)
+	{
+		words[i] = LittleLong(words[i]);
+	}
+	return true;
+}
+
+//============================================================================
+//
+// FusePCodes
+//
+// Tries to replace the p-codes starting at pcodes with a superinstruction.
+// Only the first p-code of the sequence may be a jump target. Returns the
+// number of p-codes replaced, or 0 if none of the sequences matched.
+//
+//============================================================================
+
+static int FusePCodes (const FDecodedPCode *pcodes, int count, const TArray<int> &words, TArray<int> &code)
+{
+	int len;
+
+	// Find how many p-codes can be part of a sequence starting here.
+	for (len = 1; len < count && len < 4; ++len)
+	{
+		if (pcodes[len].IsTarget || pcodes[len].Offset != pcodes[len-1].End)
+		{
+			break;
+		}
+	}
+
+#define PCODE(n)	(pcodes[n].PCode)
+#define ARG(n,a)	(words[pcodes[n].FirstWord + 1 + (a)])
+
+	if (len >= 4 && PCODE(0) == DLevelScript::PCD_PUSHSCRIPTVAR && PCODE(1) == DLevelScript::PCD_PUSHNUMBER &&
+		PCODE(2) == DLevelScript::PCD_LT && PCODE(3) == DLevelScript::PCD_IFNOTGOTO)
+	{
+		code.Push (LittleLong(DLevelScript::PCD_X_LTSCRIPTVARNUMBERIFNOTGOTO));
+		code.Push (ARG(0,0));
+		code.Push (ARG(1,0));
+		code.Push (ARG(3,0));
+		return 4;
+	}
+	if (len >= 3 && PCODE(0) == DLevelScript::PCD_PUSHSCRIPTVAR && PCODE(1) == DLevelScript::PCD_PUSHSCRIPTVAR &&
+		PCODE(2) == DLevelScript::PCD_ADD)
+	{
+		code.Push (LittleLong(DLevelScript::PCD_X_ADDSCRIPTVARS));
+		code.Push (ARG(0,0));
+		code.Push (ARG(1,0));
+		return 3;
+	}
+	if (len >= 2)
+	{
+		int op = 0;
+
+		switch (PCODE(0))
+		{
+		case DLevelScript::PCD_PUSHSCRIPTVAR:
+			op = PCODE(1) == DLevelScript::PCD_PUSHSCRIPTVAR ? DLevelScript::PCD_X_PUSHSCRIPTVARS :
+				 PCODE(1) == DLevelScript::PCD_PUSHNUMBER ? DLevelScript::PCD_X_PUSHSCRIPTVARNUMBER : 0;
+			break;
+
+		case DLevelScript::PCD_PUSHNUMBER:
+			op = PCODE(1) == DLevelScript::PCD_ADD ? DLevelScript::PCD_X_ADDNUMBER :
+				 PCODE(1) == DLevelScript::PCD_ASSIGNSCRIPTVAR ? DLevelScript::PCD_X_ASSIGNSCRIPTVARNUMBER : 0;
+			break;
+
+		case DLevelScript::PCD_INCSCRIPTVAR:
+			op = PCODE(1) == DLevelScript::PCD_GOTO ? DLevelScript::PCD_X_INCSCRIPTVARGOTO : 0;
+			break;
+		}
+		if (op != 0)
+		{
+			code.Push (LittleLong(op));
+			code.Push (ARG(0,0));
+			if (op != DLevelScript::PCD_X_ADDNUMBER)
+			{
+				code.Push (ARG(1,0));
+			}
+			return 2;
+		}
+	}
+#undef PCODE
+#undef ARG
+	return 0;
+}
+
+//============================================================================
+//
+// FBehavior :: Predecode
+//
+// Decodes all code that can be reached from the scripts, functions and
+// jump points of the module. Returns false and leaves the module alone if
+// it contains anything the decoder does not understand.
+//
+//============================================================================
+
+bool FBehavior::Predecode ()
+{
+	FACSCodeReader reader = { Data, (DWORD)DataSize, 0, Format == ACS_LittleEnhanced, false };
+	TArray<BYTE> marks;
+	TArray<DWORD> work;
+	TArray<DWORD> targets;
+	TArray<int> words;
+	TArray<FDecodedPCode> pcodes;
+	unsigned int i, j;
+	int pcd;
+	bool fallthrough;
+
+	enum { MARK_PCODE = 1, MARK_TARGET = 2 };
+
+	marks.Resize (DataSize);
+	memset (&marks[0], 0, DataSize);
+
+	for (i = 0; i < (unsigned)NumScripts; ++i)
+	{
+		work.Push (Scripts[i].Address);
+	}
+	for (i = 0; i < (unsigned)NumFunctions; ++i)
+	{
+		ScriptFunction *func = &((ScriptFunction *)Functions)[i];
+		if (func->ImportNum == 0 && func->Address != 0)
+		{
+			work.Push (func->Address);
+		}
+	}
+	for (i = 0; i < JumpPoints.Size(); ++i)
+	{
+		work.Push (JumpPoints[i]);
+	}
+	for (i = 0; i < work.Size(); ++i)
+	{
+		if (work[i] >= (DWORD)DataSize)
+		{
+			return false;
+		}
+		marks[work[i]] |= MARK_TARGET;
+	}
+
+	// Find the start of every reachable p-code.
+	DWORD ofs;
+	while (work.Pop (ofs))
+	{
+		while (!(marks[ofs] & MARK_PCODE))
+		{
+			marks[ofs] |= MARK_PCODE;
+			reader.Pos = ofs;
+			words.Clear();
+			targets.Clear();
+			if (!DecodePCode (reader, words, targets, pcd, fallthrough))
+			{
+				return false;
+			}
+			for (j = 0; j < targets.Size(); ++j)
+			{
+				if (targets[j] >= (DWORD)DataSize)
+				{
+					return false;
+				}
+				marks[targets[j]] |= MARK_TARGET;
+				work.Push (targets[j]);
+			}
+			if (!fallthrough)
+			{
+				break;
+			}
+			if (reader.Pos >= (DWORD)DataSize)
+			{
+				return false;
+			}
+			ofs = reader.Pos;
+		}
+	}
+
+	// Decode them in their original order, so that falling through from
+	// one p-code to the next still works.
+	words.Clear();
+	for (ofs = 0; ofs < (DWORD)DataSize; ++ofs)
+	{
+		if (marks[ofs] & MARK_PCODE)
+		{
+			FDecodedPCode decoded;
+
+			if (pcodes.Size() > 0 && pcodes.Last().End > ofs)
+			{
+				// Something jumps into the middle of a p-code.
+				return false;
+			}
+			decoded.Offset = ofs;
+			decoded.FirstWord = words.Size();
+			decoded.IsTarget = !!(marks[ofs] & MARK_TARGET);
+			reader.Pos = ofs;
+			targets.Clear();
+			DecodePCode (reader, words, targets, decoded.PCode, fallthrough);
+			decoded.End = reader.Pos;
+			pcodes.Push (decoded);
+		}
+	}
+
+	TArray<int> code;
+	TArray<DWORD> codetoofs;
+
+	OfsToCode = new int[DataSize];
+	for (ofs = 0; ofs < (DWORD)DataSize; ++ofs)
+	{
+		OfsToCode[ofs] = -1;
+	}
+	for (i = 0; i < pcodes.Size(); )
+	{
+		unsigned int start = code.Size();
+		int used = 0;
+
+		if (acs_superinstructions)
+		{
+			used = FusePCodes (&pcodes[i], pcodes.Size() - i, words, code);
+		}
+		if (used == 0)
+		{
+			unsigned int end = i + 1 < pcodes.Size() ? pcodes[i+1].FirstWord : words.Size();
+			for (j = pcodes[i].FirstWord; j < end; ++j)
+			{
+				code.Push (words[j]);
+			}
+			used = 1;
+		}
+		OfsToCode[pcodes[i].Offset] = start;
+		for (j = start; j < code.Size(); ++j)
+		{
+			codetoofs.Push (pcodes[i].Offset);
+		}
+		i += used;
+	}
+	// Make PC2Ofs work for a pc just past the end of the code, too.
+	codetoofs.Push (DataSize);
+
+	CodeSize = code.Size();
+	Code = new int[CodeSize + 1];
+	memcpy (Code, &code[0], CodeSize * sizeof(int));
+	Code[CodeSize] = LittleLong(DLevelScript::PCD_TERMINATE);
+	CodeToOfs = new DWORD[codetoofs.Size()];
+	memcpy (CodeToOfs, &codetoofs[0], codetoofs.Size() * sizeof(DWORD));
+	return true;
+}
+
 //============================================================================
 //
 // FBehavior :: UnencryptStrings
@@ -3245,10 +3825,18 @@ void DACSThinker::Serialize (FArchive &arc)
 	}
 }
 
+// Time spent running scripts in the last tic and the most spent in any tic
+// since the last acsprofile clear.
+static cycle_t ACSTicCycles;
+static double ACSPeakTicMS;
+
 void DACSThinker::Tick ()
 {
 	DLevelScript *script = Scripts;
 
+	ACSTicCycles.Reset();
+	ACSTicCycles.Clock();
+
 	while (script)
 	{
 		DLevelScript *next = script->next;
@@ -3256,6 +3844,9 @@ void DACSThinker::Tick ()
 		script = next;
 	}
 
+	ACSTicCycles.Unclock();
+	ACSPeakTicMS = MAX (ACSPeakTicMS, ACSTicCycles.TimeMS());
+
 //	GlobalACSStrings.Clear();
 
 	if (ACS_StringBuilderStack.Size())
@@ -6913,6 +7504,11 @@ inline int getshort (int *&pc)
 	return res;
 }
 
+// Makes acsprofile also measure how long scripts and functions take. This
+// reads the clock for every script run and function call, so it is off by
+// default.
+CVAR (Bool, acs_profiletime, false, 0)
+
 int DLevelScript::RunScript ()
 {
 	DACSThinker *controller = DACSThinker::ActiveThinker;
@@ -6978,10 +7574,21 @@ int DLevelScript::RunScript ()
 		break;
 	}
 
+	// Read the CVAR once, so that calls and returns within this run always
+	// agree on whether they are being timed.
+	const bool profiletime = acs_profiletime;
+	cycle_t runtime;
+
+	if (profiletime)
+	{
+		runtime.Reset();
+		runtime.Clock();
+	}
+
 	SDWORD Stack[STACK_SIZE];
 	int sp = 0;
 	int *pc = this->pc;
-	ACSFormat fmt = activeBehavior->GetFormat();
+	ACSFormat fmt = activeBehavior->GetCodeFormat();
 	unsigned int runaway = 0;	// used to prevent infinite loops
 	int pcd;
 	FString work;
@@ -7292,13 +7899,18 @@ int DLevelScript::RunScript ()
 					Stack[sp+i] = 0;
 				}
 				sp += i;
-				::new(&Stack[sp]) CallReturn(activeBehavior->PC2Ofs(pc), activeFunction,
+				CallReturn *ret = ::new(&Stack[sp]) CallReturn(activeBehavior->PC2Ofs(pc), activeFunction,
 					activeBehavior, mylocals, pcd == PCD_CALLDISCARD, runaway);
+				if (profiletime)
+				{
+					ret->CallTime.Reset();
+					ret->CallTime.Clock();
+				}
 				sp += (sizeof(CallReturn) + sizeof(int) - 1) / sizeof(int);
 				pc = module->Ofs2PC (func->Address);
 				activeFunction = func;
 				activeBehavior = module;
-				fmt = module->GetFormat();
+				fmt = module->GetCodeFormat();
 			}
 			break;
 
@@ -7322,12 +7934,18 @@ int DLevelScript::RunScript ()
 				}
 				sp -= sizeof(CallReturn)/sizeof(int);
 				retsp = &Stack[sp];
-				activeBehavior->GetFunctionProfileData(activeFunction)->AddRun(runaway - ret->EntryInstrCount);
+				ACSProfileInfo *funcprofile = activeBehavior->GetFunctionProfileData(activeFunction);
+				funcprofile->AddRun(runaway - ret->EntryInstrCount);
+				if (profiletime)
+				{
+					ret->CallTime.Unclock();
+					funcprofile->AddTime(ret->CallTime.TimeMS());
+				}
 				sp = int(locals - Stack);
 				pc = ret->ReturnModule->Ofs2PC(ret->ReturnAddress);
 				activeFunction = ret->ReturnFunction;
 				activeBehavior = ret->ReturnModule;
-				fmt = activeBehavior->GetFormat();
+				fmt = activeBehavior->GetCodeFormat();
 				locals = ret->ReturnLocals;
 				if (!ret->bDiscardResult)
 				{
@@ -9144,6 +9762,7 @@ scriptwait:
 						lines[line].flags |= ML_BLOCK_PLAYERS;
 						break;
 					}
+					P_InvalidateSightCache ();
 
 					// If we're the server, tell clients to update this line.
 					if ( NETWORK_GetState( ) == NETSTATE_SERVER )
@@ -10632,12 +11251,72 @@ scriptwait:
 			sp--;
 			break;
 		// [CW] End team additions.
+
+		// Internal p-codes from FBehavior::Predecode. The superinstructions
+		// advance runaway by the number of p-codes they replace, so the
+		// runaway check and acsprofile still count the original p-codes.
+		case PCD_X_PUSHNUMBERS:
+			for (temp = NEXTWORD; temp > 0; --temp)
+			{
+				PushToStack (NEXTWORD);
+			}
+			break;
+
+		case PCD_X_PUSHSCRIPTVARS:
+			runaway += 1;
+			PushToStack (locals[NEXTWORD]);
+			PushToStack (locals[NEXTWORD]);
+			break;
+
+		case PCD_X_PUSHSCRIPTVARNUMBER:
+			runaway += 1;
+			PushToStack (locals[NEXTWORD]);
+			PushToStack (NEXTWORD);
+			break;
+
+		case PCD_X_ADDSCRIPTVARS:
+			runaway += 2;
+			temp = locals[NEXTWORD];
+			PushToStack (temp + locals[NEXTWORD]);
+			break;
+
+		case PCD_X_ADDNUMBER:
+			runaway += 1;
+			STACK(1) += NEXTWORD;
+			break;
+
+		case PCD_X_ASSIGNSCRIPTVARNUMBER:
+			runaway += 1;
+			temp = NEXTWORD;
+			locals[NEXTWORD] = temp;
+			break;
+
+		case PCD_X_INCSCRIPTVARGOTO:
+			runaway += 1;
+			++locals[NEXTWORD];
+			pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+			break;
+
+		case PCD_X_LTSCRIPTVARNUMBERIFNOTGOTO:
+			runaway += 3;
+			temp = locals[NEXTWORD];
+			if (temp < NEXTWORD)
+				pc++;
+			else
+				pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+			break;
  		}
  	}
 
 	if (runaway != 0 && InModuleScriptNumber >= 0)
 	{
-		activeBehavior->GetScriptPtr(InModuleScriptNumber)->ProfileData.AddRun(runaway);
+		ACSProfileInfo &profile = activeBehavior->GetScriptPtr(InModuleScriptNumber)->ProfileData;
+		profile.AddRun(runaway);
+		if (profiletime)
+		{
+			runtime.Unclock();
+			profile.AddTime(runtime.TimeMS());
+		}
 	}
 
 	if (state == SCRIPT_DivideBy0)
@@ -10987,6 +11666,17 @@ void DACSThinker::DumpScriptStatus ()
 	}
 }
 
+int DACSThinker::CountScripts () const
+{
+	int count = 0;
+
+	for (DLevelScript *script = Scripts; script != NULL; script = script->next)
+	{
+		++count;
+	}
+	return count;
+}
+
 // Profiling support --------------------------------------------------------
 
 ACSProfileInfo::ACSProfileInfo()
@@ -11000,6 +11690,8 @@ void ACSProfileInfo::Reset()
 	NumRuns = 0;
 	MinInstrPerRun = UINT_MAX;
 	MaxInstrPerRun = 0;
+	TotalMS = 0;
+	MaxMSPerRun = 0;
 }
 
 void ACSProfileInfo::AddRun(unsigned int num_instr)
@@ -11016,6 +11708,15 @@ void ACSProfileInfo::AddRun(unsigned int num_instr)
 	}
 }
 
+void ACSProfileInfo::AddTime(double ms)
+{
+	TotalMS += ms;
+	if (ms > MaxMSPerRun)
+	{
+		MaxMSPerRun = ms;
+	}
+}
+
 void ArrangeScriptProfiles(TArray<ProfileCollector> &profiles)
 {
 	for (unsigned int mod_num = 0; mod_num < FBehavior::StaticModules.Size(); ++mod_num)
@@ -11104,6 +11805,38 @@ static int STACK_ARGS sort_by_runs(const void *a_, const void *b_)
 	return b->ProfileData->NumRuns - a->ProfileData->NumRuns;
 }
 
+static int STACK_ARGS sort_by_time(const void *a_, const void *b_)
+{
+	const ProfileCollector *a = (const ProfileCollector *)a_;
+	const ProfileCollector *b = (const ProfileCollector *)b_;
+
+	return b->ProfileData->TotalMS > a->ProfileData->TotalMS ? 1 :
+		   b->ProfileData->TotalMS < a->ProfileData->TotalMS ? -1 : 0;
+}
+
+static FString GetProfileName(const ProfileCollector *prof, bool functions)
+{
+	FString name;
+
+	if (functions)
+	{
+		DWORD *fnames = (DWORD *)prof->Module->FindChunk(MAKE_ID('F','N','A','M'));
+		if (fnames != NULL && prof->Index >= 0 && prof->Index < (int)LittleLong(fnames[2]))
+		{
+			name = (char *)(fnames + 2) + LittleLong(fnames[3+prof->Index]);
+		}
+		else
+		{
+			name.Format("Function %d", prof->Index);
+		}
+	}
+	else
+	{
+		name = ScriptPresentation(prof->Module->GetScriptPtr(prof->Index)->Number).GetChars() + 7;
+	}
+	return name;
+}
+
 static void ShowProfileData(TArray<ProfileCollector> &profiles, long ilimit,
 	int (STACK_ARGS *sorter)(const void *, const void *), bool functions)
 {
@@ -11131,8 +11864,8 @@ static void ShowProfileData(TArray<ProfileCollector> &profiles, long ilimit,
 		limit = UINT_MAX;
 	}
 
-	Printf(TEXTCOLOR_YELLOW "Module       %-20s      Total    Runs     Avg     Min     Max\n", typelabels[functions]);
-	Printf(TEXTCOLOR_YELLOW "------------ -------------------- ---------- ------- ------- ------- -------\n");
+	Printf(TEXTCOLOR_YELLOW "Module       %-20s      Total    Runs     Avg     Min     Max   Time ms    Avg ms\n", typelabels[functions]);
+	Printf(TEXTCOLOR_YELLOW "------------ -------------------- ---------- ------- ------- ------- ------- --------- ---------\n");
 	for (unsigned int i = 0; i < limit && i < profiles.Size(); ++i)
 	{
 		ProfileCollector *prof = &profiles[i];
@@ -11145,35 +11878,72 @@ static void ShowProfileData(TArray<ProfileCollector> &profiles, long ilimit,
 		mysnprintf(modname, sizeof(modname), "%s", prof->Module->GetModuleName());
 
 		// Script/function name
-		if (functions)
-		{
-			DWORD *fnames = (DWORD *)prof->Module->FindChunk(MAKE_ID('F','N','A','M'));
-			if (prof->Index >= 0 && prof->Index < (int)LittleLong(fnames[2]))
-			{
-				mysnprintf(scriptname, sizeof(scriptname), "%s",
-					(char *)(fnames + 2) + LittleLong(fnames[3+prof->Index]));
-			}
-			else
-			{
-				mysnprintf(scriptname, sizeof(scriptname), "Function %d", prof->Index);
-			}
-		}
-		else
-		{
-			mysnprintf(scriptname, sizeof(scriptname), "%s",
-				ScriptPresentation(prof->Module->GetScriptPtr(prof->Index)->Number).GetChars() + 7);
-		}
-		Printf("%-12s %-20s%11llu%8u%8u%8u%8u\n",
+		mysnprintf(scriptname, sizeof(scriptname), "%s", GetProfileName(prof, functions).GetChars());
+
+		Printf("%-12s %-20s%11llu%8u%8u%8u%8u%10.2f%10.4f\n",
 			modname, scriptname,
 			prof->ProfileData->TotalInstr,
 			prof->ProfileData->NumRuns,
 			unsigned(prof->ProfileData->TotalInstr / prof->ProfileData->NumRuns),
 			prof->ProfileData->MinInstrPerRun,
-			prof->ProfileData->MaxInstrPerRun
+			prof->ProfileData->MaxInstrPerRun,
+			prof->ProfileData->TotalMS,
+			prof->ProfileData->TotalMS / prof->ProfileData->NumRuns
 			);
 	}
 }
 
+//==========================================================================
+//
+// WriteProfileCSV
+//
+// Writes every script and function that has run to a CSV file.
+//
+//==========================================================================
+
+static bool WriteProfileCSV(const char *filename, TArray<ProfileCollector> &scripts, TArray<ProfileCollector> &functions)
+{
+	FILE *file = fopen(filename, "w");
+
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	fprintf(file, "Type,Module,Name,TotalInstr,Runs,AvgInstr,MinInstr,MaxInstr,TotalMS,AvgMS,MaxMS\n");
+	for (int type = 0; type < 2; ++type)
+	{
+		TArray<ProfileCollector> &profiles = type == 0 ? scripts : functions;
+
+		for (unsigned int i = 0; i < profiles.Size(); ++i)
+		{
+			const ProfileCollector *prof = &profiles[i];
+			if (prof->ProfileData->NumRuns == 0)
+			{
+				continue;
+			}
+
+			// Quote the name, since named scripts can contain anything.
+			FString name = GetProfileName(prof, type != 0);
+			name.Substitute("\"", "\"\"");
+
+			fprintf(file, "%s,%s,\"%s\",%llu,%u,%u,%u,%u,%.4f,%.4f,%.4f\n",
+				type == 0 ? "script" : "function",
+				prof->Module->GetModuleName(), name.GetChars(),
+				prof->ProfileData->TotalInstr,
+				prof->ProfileData->NumRuns,
+				unsigned(prof->ProfileData->TotalInstr / prof->ProfileData->NumRuns),
+				prof->ProfileData->MinInstrPerRun,
+				prof->ProfileData->MaxInstrPerRun,
+				prof->ProfileData->TotalMS,
+				prof->ProfileData->TotalMS / prof->ProfileData->NumRuns,
+				prof->ProfileData->MaxMSPerRun);
+		}
+	}
+	fclose(file);
+	return true;
+}
+
 CCMD(acsprofile)
 {
 	static int (STACK_ARGS *sort_funcs[])(const void*, const void *) =
@@ -11182,10 +11952,11 @@ CCMD(acsprofile)
 		sort_by_min,
 		sort_by_max,
 		sort_by_avg,
-		sort_by_runs
+		sort_by_runs,
+		sort_by_time
 	};
-	static const char *sort_names[] = { "total", "min", "max", "avg", "runs" };
-	static const BYTE sort_match_len[] = {   1,     2,     2,     1,      1 };
+	static const char *sort_names[] = { "total", "min", "max", "avg", "runs", "time" };
+	static const BYTE sort_match_len[] = {   1,     2,     2,     1,      1,      2 };
 
 	TArray<ProfileCollector> ScriptProfiles, FuncProfiles;
 	long limit = 10;
@@ -11203,6 +11974,21 @@ CCMD(acsprofile)
 		{
 			ClearProfiles(ScriptProfiles);
 			ClearProfiles(FuncProfiles);
+			ACSPeakTicMS = 0;
+			return;
+		}
+		// `acsprofile csv <file>` writes all profiling information to a file.
+		if (stricmp(argv[1], "csv") == 0)
+		{
+			const char *filename = argv.argc() > 2 ? argv[2] : "acsprofile.csv";
+			if (WriteProfileCSV(filename, ScriptProfiles, FuncProfiles))
+			{
+				Printf("Wrote ACS profile to %s\n", filename);
+			}
+			else
+			{
+				Printf("Could not write %s\n", filename);
+			}
 			return;
 		}
 		for (int i = 1; i < argv.argc(); ++i)
@@ -11235,7 +12021,8 @@ CCMD(acsprofile)
 			{
 				Printf("Unknown option '%s'\n", argv[i]);
 				Printf("acsprofile clear : Reset profiling information\n");
-				Printf("acsprofile [total|min|max|avg|runs] [<limit>]\n");
+				Printf("acsprofile csv [<file>] : Write profiling information to a CSV file\n");
+				Printf("acsprofile [total|min|max|avg|runs|time] [<limit>]\n");
 				return;
 			}
 		}
@@ -11243,6 +12030,302 @@ CCMD(acsprofile)
 
 	ShowProfileData(ScriptProfiles, limit, sorter, false);
 	ShowProfileData(FuncProfiles, limit, sorter, true);
+	if (!acs_profiletime)
+	{
+		Printf("Set acs_profiletime to true to measure script times.\n");
+	}
+}
+
+ADD_STAT(acs)
+{
+	FString out;
+	int running = 0;
+
+	if (DACSThinker::ActiveThinker != NULL)
+	{
+		running = DACSThinker::ActiveThinker->CountScripts();
+	}
+	out.Format("Scripts: %d running, %.3f ms this tic, %.3f ms peak", running, ACSTicCycles.TimeMS(), ACSPeakTicMS);
+	return out;
+}
+
+//============================================================================
+//
+// ACS benchmark
+//
+// Assembles a small ACSe module with a few loop-heavy scripts and times
+// each of them with the module interpreted directly, pre-decoded, and
+// pre-decoded with superinstructions.
+//
+//============================================================================
+
+class FACSBenchAssembler
+{
+public:
+	TArray<BYTE> Lump;
+
+	FACSBenchAssembler ()
+	{
+		Byte ('A'); Byte ('C'); Byte ('S'); Byte ('e');
+		Word (0);	// Offset of the chunks, filled in by Finish
+	}
+
+	DWORD Here () const
+	{
+		return Lump.Size();
+	}
+
+	void Byte (int val)
+	{
+		Lump.Push (BYTE(val));
+	}
+
+	void Word (int val)
+	{
+		Byte (val); Byte (val >> 8); Byte (val >> 16); Byte (val >> 24);
+	}
+
+	void PCode (int pcd)
+	{
+		if (pcd >= 256-16)
+		{
+			Byte ((256-16) + ((pcd - (256-16)) >> 8));
+			Byte (pcd - (256-16));
+		}
+		else
+		{
+			Byte (pcd);
+		}
+	}
+
+	void PCode (int pcd, int arg)
+	{
+		PCode (pcd);
+		Byte (arg);
+	}
+
+	// Emits a jump and returns the position of its operand for Patch.
+	DWORD Jump (int pcd)
+	{
+		PCode (pcd);
+		Word (0);
+		return Here() - 4;
+	}
+
+	void Patch (DWORD at, DWORD val)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			Lump[at + i] = BYTE(val >> (i * 8));
+		}
+	}
+
+	// Starts a loop that runs script variable 0 from 0 to count-1.
+	DWORD BeginLoop (int count, DWORD &top)
+	{
+		PCode (DLevelScript::PCD_PUSHBYTE, 0);
+		PCode (DLevelScript::PCD_ASSIGNSCRIPTVAR, 0);
+		top = Here();
+		PCode (DLevelScript::PCD_PUSHSCRIPTVAR, 0);
+		PCode (DLevelScript::PCD_PUSHNUMBER);
+		Word (count);
+		PCode (DLevelScript::PCD_LT);
+		return Jump (DLevelScript::PCD_IFNOTGOTO);
+	}
+
+	void EndLoop (DWORD exit, DWORD top)
+	{
+		PCode (DLevelScript::PCD_INCSCRIPTVAR, 0);
+		PCode (DLevelScript::PCD_GOTO);
+		Word (top);
+		Patch (exit, Here());
+		PCode (DLevelScript::PCD_TERMINATE);
+	}
+
+	void Finish (const TArray<DWORD> &addresses)
+	{
+		while (Here() & 3)
+		{
+			Byte (0);
+		}
+		Patch (4, Here());
+		Byte ('S'); Byte ('P'); Byte ('T'); Byte ('R');
+		Word (addresses.Size() * 8);
+		for (unsigned int i = 0; i < addresses.Size(); ++i)
+		{
+			Byte (i + 1); Byte (0);		// Number
+			Byte (SCRIPT_Closed);		// Type
+			Byte (0);					// ArgCount
+			Word (addresses[i]);
+		}
+	}
+};
+
+static const char *const BenchScriptNames[] =
+{
+	"Counting loop",
+	"Case dispatch",
+	"Byte pushes",
+};
+
+static void AssembleBenchModule (FACSBenchAssembler &as)
+{
+	TArray<DWORD> addresses;
+	DWORD top, exit, jumps[4];
+
+	// Script 1: for (i = 0; i < 100000; ++i) sum = sum + i;
+	addresses.Push (as.Here());
+	exit = as.BeginLoop (100000, top);
+	as.PCode (DLevelScript::PCD_PUSHSCRIPTVAR, 1);
+	as.PCode (DLevelScript::PCD_PUSHSCRIPTVAR, 0);
+	as.PCode (DLevelScript::PCD_ADD);
+	as.PCode (DLevelScript::PCD_ASSIGNSCRIPTVAR, 1);
+	as.EndLoop (exit, top);
+
+	// Script 2: for (i = 0; i < 50000; ++i) switch (i % 3) { ... }
+	addresses.Push (as.Here());
+	exit = as.BeginLoop (50000, top);
+	as.PCode (DLevelScript::PCD_PUSHSCRIPTVAR, 0);
+	as.PCode (DLevelScript::PCD_PUSHBYTE, 3);
+	as.PCode (DLevelScript::PCD_MODULUS);
+	as.PCode (DLevelScript::PCD_CASEGOTO);
+	as.Word (0);
+	jumps[0] = as.Here();
+	as.Word (0);
+	as.PCode (DLevelScript::PCD_CASEGOTO);
+	as.Word (1);
+	jumps[1] = as.Here();
+	as.Word (0);
+	as.PCode (DLevelScript::PCD_DROP);
+	as.PCode (DLevelScript::PCD_INCSCRIPTVAR, 2);
+	jumps[2] = as.Jump (DLevelScript::PCD_GOTO);
+	as.Patch (jumps[0], as.Here());
+	as.PCode (DLevelScript::PCD_INCSCRIPTVAR, 3);
+	jumps[3] = as.Jump (DLevelScript::PCD_GOTO);
+	as.Patch (jumps[1], as.Here());
+	as.PCode (DLevelScript::PCD_INCSCRIPTVAR, 4);
+	as.Patch (jumps[2], as.Here());
+	as.Patch (jumps[3], as.Here());
+	as.EndLoop (exit, top);
+
+	// Script 3: for (i = 0; i < 50000; ++i) sum = sum + 1 + 2 + 3;
+	addresses.Push (as.Here());
+	exit = as.BeginLoop (50000, top);
+	as.PCode (DLevelScript::PCD_PUSH3BYTES);
+	as.Byte (1); as.Byte (2); as.Byte (3);
+	as.PCode (DLevelScript::PCD_ADD);
+	as.PCode (DLevelScript::PCD_ADD);
+	as.PCode (DLevelScript::PCD_PUSHSCRIPTVAR, 1);
+	as.PCode (DLevelScript::PCD_ADD);
+	as.PCode (DLevelScript::PCD_ASSIGNSCRIPTVAR, 1);
+	as.EndLoop (exit, top);
+
+	as.Finish (addresses);
+}
+
+void ACS_RunBenchmark (int iterations)
+{
+	enum { NUM_BENCHSCRIPTS = countof(BenchScriptNames), NUM_BENCHMODES = 3 };
+	static const char *const modenames[NUM_BENCHMODES] = { "direct", "predecoded", "superinstr" };
+
+	FACSBenchAssembler as;
+	double times[NUM_BENCHSCRIPTS][NUM_BENCHMODES];
+	unsigned int pcodes[NUM_BENCHSCRIPTS];
+	bool oldpredecode = acs_predecode;
+	bool oldsuperinstructions = acs_superinstructions;
+	int i, m;
+
+	AssembleBenchModule (as);
+
+	for (m = 0; m < NUM_BENCHMODES; ++m)
+	{
+		acs_predecode = m > 0;
+		acs_superinstructions = m > 1;
+
+		MemoryReader fr ((const char *)&as.Lump[0], as.Lump.Size());
+		FBehavior *module = new FBehavior (-1, &fr, as.Lump.Size());
+		bool good = module->IsGood() && module->IsPredecoded() == (m > 0);
+
+		for (i = 0; good && i < NUM_BENCHSCRIPTS; ++i)
+		{
+			const ScriptPtr *code = module->FindScript (i + 1);
+			cycle_t clock;
+
+			clock.Reset();
+			for (int j = 0; j < iterations; ++j)
+			{
+				DLevelScript *script = new DLevelScript (NULL, NULL, i + 1, code, module, NULL, 0, ACS_ALWAYS);
+				clock.Clock();
+				script->RunScript ();
+				clock.Unclock();
+				script->Destroy ();
+			}
+			times[i][m] = clock.TimeMS() / iterations;
+			pcodes[i] = code->ProfileData.NumRuns > 0 ? unsigned(code->ProfileData.TotalInstr / code->ProfileData.NumRuns) : 0;
+		}
+
+		// The module added itself to the loaded modules when it was created.
+		assert (FBehavior::StaticModules.Last() == module);
+		FBehavior::StaticModules.Pop ();
+		delete module;
+
+		if (!good)
+		{
+			Printf ("Could not load the benchmark module in %s mode.\n", modenames[m]);
+			break;
+		}
+	}
+	acs_predecode = oldpredecode;
+	acs_superinstructions = oldsuperinstructions;
+
+	if (m < NUM_BENCHMODES)
+	{
+		return;
+	}
+
+	Printf ("ACS benchmark, %d runs per script (ms per run, ns per p-code):\n", iterations);
+	Printf ("%-14s %8s", "Script", "P-codes");
+	for (m = 0; m < NUM_BENCHMODES; ++m)
+	{
+		Printf (" %20s", modenames[m]);
+	}
+	Printf ("\n");
+	for (i = 0; i < NUM_BENCHSCRIPTS; ++i)
+	{
+		Printf ("%-14s %8u", BenchScriptNames[i], pcodes[i]);
+		for (m = 0; m < NUM_BENCHMODES; ++m)
+		{
+			Printf (" %9.3fms %6.2fns", times[i][m], pcodes[i] > 0 ? times[i][m] * 1e6 / pcodes[i] : 0.);
+		}
+		Printf ("\n");
+	}
+	for (m = 1; m < NUM_BENCHMODES; ++m)
+	{
+		double before = 0, after = 0;
+		for (i = 0; i < NUM_BENCHSCRIPTS; ++i)
+		{
+			before += times[i][0];
+			after += times[i][m];
+		}
+		Printf ("%s: %.2fx the speed of direct interpretation\n", modenames[m], after > 0 ? before / after : 0.);
+	}
+}
+
+//============================================================================
+//
+// acsbench [runs]
+//
+//============================================================================
+
+CCMD (acsbench)
+{
+	if (gamestate != GS_LEVEL)
+	{
+		Printf ("You must be in a level to run the ACS benchmark.\n");
+		return;
+	}
+	int iterations = argv.argc() > 1 ? atoi (argv[1]) : 20;
+	ACS_RunBenchmark (MAX (iterations, 1));
 }
 
 
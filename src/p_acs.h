@@ -139,9 +139,13 @@ struct ACSProfileInfo
 	unsigned int NumRuns;
 	unsigned int MinInstrPerRun;
 	unsigned int MaxInstrPerRun;
+	// Only collected while acs_profiletime is on
+	double TotalMS;
+	double MaxMSPerRun;
 
 	ACSProfileInfo();
 	void AddRun(unsigned int num_instr);
+	void AddTime(double ms);
 	void Reset();
 };
 
@@ -317,10 +321,14 @@ public:
 	const ScriptPtr *FindScript (int number) const;
 	void StartTypedScripts (WORD type, AActor *activator, bool always, int arg1, bool runNow, bool onlyClientSideScripts=false, int arg2=0, int arg3=0); // [BB] Added arg2+arg3
 	int CountTypedScripts( WORD type );
-	DWORD PC2Ofs (int *pc) const { return (DWORD)((BYTE *)pc - Data); }
-	int *Ofs2PC (DWORD ofs) const {	return (int *)(Data + ofs); }
+	DWORD PC2Ofs (int *pc) const { return Code != NULL ? CodeToOfs[pc - Code] : (DWORD)((BYTE *)pc - Data); }
+	int *Ofs2PC (DWORD ofs) const {	return Code != NULL ? Code + OfsToCode[ofs] : (int *)(Data + ofs); }
 	int *Jump2PC (DWORD jumpPoint) const { return Ofs2PC(JumpPoints[jumpPoint]); }
 	ACSFormat GetFormat() const { return Format; }
+	// The format the interpreter has to use for this module's code. Pre-decoded
+	// code always stores one word per p-code and operand.
+	ACSFormat GetCodeFormat() const { return Code != NULL ? ACS_Enhanced : Format; }
+	bool IsPredecoded() const { return Code != NULL; }
 	ScriptFunction *GetFunction (int funcnum, FBehavior *&module) const;
 	int GetArrayVal (int arraynum, int index) const;
 	void SetArrayVal (int arraynum, int index, int value);
@@ -330,7 +338,7 @@ public:
 	int FindMapVarName (const char *varname) const;
 	int FindMapArray (const char *arrayname) const;
 	int GetLibraryID () const { return LibraryID; }
-	int *GetScriptAddress (const ScriptPtr *ptr) const { return (int *)(ptr->Address + Data); }
+	int *GetScriptAddress (const ScriptPtr *ptr) const { return Ofs2PC(ptr->Address); }
 	int GetScriptIndex (const ScriptPtr *ptr) const { ptrdiff_t index = ptr - Scripts; return index >= NumScripts ? -1 : (int)index; }
 	ScriptPtr *GetScriptPtr(int index) const { return index >= 0 && index < NumScripts ? &Scripts[index] : NULL; }
 	int GetLumpNum() const { return LumpNum; }
@@ -386,9 +394,18 @@ private:
 	char ModuleName[9];
 	TArray<int> JumpPoints;
 
+	// Pre-decoded code. When Code is non-NULL, the interpreter runs this
+	// instead of the original code in Data. OfsToCode and CodeToOfs map
+	// between offsets in Data and indices in Code.
+	int *Code;
+	int CodeSize;
+	int *OfsToCode;
+	DWORD *CodeToOfs;
+
 	static TArray<FBehavior *> StaticModules;
 
 	void LoadScriptsDirectory ();
+	bool Predecode ();
 
 	static int STACK_ARGS SortScripts (const void *a, const void *b);
 	void UnencryptStrings ();
@@ -404,6 +421,7 @@ private:
 
 	friend void ArrangeScriptProfiles(TArray<ProfileCollector> &profiles);
 	friend void ArrangeFunctionProfiles(TArray<ProfileCollector> &profiles);
+	friend void ACS_RunBenchmark(int iterations);
 };
 
 class DLevelScript : public DObject
@@ -786,7 +804,18 @@ public:
 		// [CW] Begin team additions.
 		PCD_GETTEAMPLAYERCOUNT,
 		// [CW] End team additions.
-/*363*/	PCODE_COMMAND_COUNT
+/*363*/	PCODE_COMMAND_COUNT,
+
+		// Internal p-codes. These never appear in a compiled module and are
+		// only produced by FBehavior::Predecode.
+		PCD_X_PUSHNUMBERS = PCODE_COMMAND_COUNT,
+		PCD_X_PUSHSCRIPTVARS,
+		PCD_X_PUSHSCRIPTVARNUMBER,
+		PCD_X_ADDSCRIPTVARS,
+		PCD_X_ADDNUMBER,
+		PCD_X_ASSIGNSCRIPTVARNUMBER,
+		PCD_X_INCSCRIPTVARGOTO,
+		PCD_X_LTSCRIPTVARNUMBERIFNOTGOTO
 	};
 
 	// Some constants used by ACS scripts
@@ -969,6 +998,7 @@ public:
 	static TObjPtr<DACSThinker> ActiveThinker;
 
 	void DumpScriptStatus();
+	int CountScripts() const;
 	void StopScriptsFor (AActor *actor);
 	// [BB] Added StopAndDestroyAllScripts, which is needed in GAME_ResetMap.
 	void StopAndDestroyAllScripts ();
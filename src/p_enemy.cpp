@@ -1398,13 +1398,13 @@ bool P_LookForMonsters (AActor *actor)
 AActor *LookForTIDInBlock (AActor *lookee, int index, void *extparams)
 {
 	FLookExParams *params = (FLookExParams *)extparams;
-	FBlockNode *block;
+	FBlockCell &cell = blocklinks[index];
 	AActor *link;
 	AActor *other;
 	
-	for (block = blocklinks[index]; block != NULL; block = block->NextActor)
+	for (int i = cell.Size() - 1; i >= 0; --i)
 	{
-		link = block->Me;
+		link = cell[i].Me;
 
         if (!(link->flags & MF_SHOOTABLE))
 			continue;			// not shootable (observer or dead)
@@ -1568,14 +1568,14 @@ bool P_LookForTID (AActor *actor, INTBOOL allaround, FLookExParams *params)
 
 AActor *LookForEnemiesInBlock (AActor *lookee, int index, void *extparam)
 {
-	FBlockNode *block;
+	FBlockCell &cell = blocklinks[index];
 	AActor *link;
 	AActor *other;
 	FLookExParams *params = (FLookExParams *)extparam;
 	
-	for (block = blocklinks[index]; block != NULL; block = block->NextActor)
+	for (int i = cell.Size() - 1; i >= 0; --i)
 	{
-		link = block->Me;
+		link = cell[i].Me;
 
         if (!(link->flags & MF_SHOOTABLE))
 			continue;			// not shootable (observer or dead)
@@ -36,6 +36,7 @@
 #include "templates.h"
 #include "p_local.h"
 #include "p_lnspec.h"
+#include "unlagged.h"
 
 enum
 {
@@ -94,6 +95,8 @@ bool sector_t::IsLinked(sector_t *other, bool ceiling) const
 
 static bool MoveCeiling(sector_t *sector, int crush, fixed_t move)
 {
+	UNLAGGED_SectorMoving( sector );
+	P_InvalidateSightCache( );
 	sector->ceilingplane.ChangeHeight (move);
 	sector->ChangePlaneTexZ(sector_t::ceiling, move);
 
@@ -112,6 +115,8 @@ static bool MoveCeiling(sector_t *sector, int crush, fixed_t move)
 
 static bool MoveFloor(sector_t *sector, int crush, fixed_t move)
 {
+	UNLAGGED_SectorMoving( sector );
+	P_InvalidateSightCache( );
 	sector->floorplane.ChangeHeight (move);
 	sector->ChangePlaneTexZ(sector_t::floor, move);
 
@@ -2849,6 +2849,7 @@ FUNC(LS_Line_SetBlocking)
 	for(int line = -1; (line = P_FindLineFromID (arg0, line)) >= 0; )
 	{
 		lines[line].flags = (lines[line].flags & ~clearflags) | setflags;
+		P_InvalidateSightCache ();
 
 		// [Dusk] Update clients on the line flags
 		if ( NETWORK_GetState() == NETSTATE_SERVER )
@@ -3378,6 +3379,7 @@ FUNC(LS_ClearForceField)
 			{
 				line->flags &= ~(ML_BLOCKING|ML_BLOCKEVERYTHING);
 				line->special = 0;
+				P_InvalidateSightCache ();
 				line->sidedef[0]->SetTexture(side_t::mid, FNullTextureID());
 				line->sidedef[1]->SetTexture(side_t::mid, FNullTextureID());
 
@@ -3404,6 +3406,7 @@ FUNC(LS_GlassBreak)
 	bool quest1, quest2;
 
 	ln->flags &= ~(ML_BLOCKING|ML_BLOCKEVERYTHING);
+	P_InvalidateSightCache ();
 
 	// [BC] If we're the server, update this line's blocking.
 	if ( NETWORK_GetState( ) == NETSTATE_SERVER )
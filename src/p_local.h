@@ -321,7 +321,17 @@ class FBlockThingsIterator
 
 	int curx, cury;
 
-	FBlockNode *block;
+	FBlockCell *block;
+	int blockindex;			// index of the last entry checked in block
+
+	// Every actor is only returned once. This is tracked with a visit stamp in
+	// the actors, or with a hash table if all visit stamp slots are in use by
+	// other iterators.
+	int visitslot;
+	DWORD visitstamp;
+
+	static DWORD SlotsInUse;
+	static DWORD SlotStamps[NUM_BLOCKVISIT_SLOTS];
 
 	int Buckets[32];
 
@@ -339,16 +349,23 @@ class FBlockThingsIterator
 	void StartBlock(int x, int y);
 	void SwitchBlock(int x, int y);
 	void ClearHash();
+	bool CheckHash(AActor *me);
+	void AcquireVisitSlot();
 
 	// The following is only for use in the path traverser 
 	// and therefore declared private.
 	FBlockThingsIterator();
 
+	// Copies would share the visit slot.
+	FBlockThingsIterator(const FBlockThingsIterator &other);
+	FBlockThingsIterator &operator=(const FBlockThingsIterator &other);
+
 	friend class FPathTraverse;
 
 public:
 	FBlockThingsIterator(int minx, int miny, int maxx, int maxy);
 	FBlockThingsIterator(const FBoundingBox &box);
+	~FBlockThingsIterator();
 	AActor *Next(bool centeronly = false);
 	void Reset() { StartBlock(minx, miny); }
 };
@@ -461,7 +478,18 @@ enum ESightFlags
 	SF_IGNOREWATERBOUNDARY=8
 };
 
+// One sight query for P_CheckSightBatch.
+struct FSightQuery
+{
+	const AActor *Looker;
+	const AActor *Target;
+	int Flags;
+};
+
+void	P_CheckSightBatch (const FSightQuery *queries, int count, bool *results);
+void	P_InvalidateSightCache ();
 void	P_ResetSightCounters (bool full);
+void	P_ResetBlockmapCounters ();
 void	P_ResetSpawnCounters( void ); // [BC]
 bool	P_TalkFacing (AActor *player);
 void	P_UseLines (player_t* player);
@@ -577,7 +605,7 @@ extern int				bmapwidth;
 extern int				bmapheight; 	// in mapblocks
 extern fixed_t			bmaporgx;
 extern fixed_t			bmaporgy;		// origin of block map
-extern FBlockNode**		blocklinks; 	// for thing chains
+extern FBlockCell*		blocklinks; 	// for thing chains
 
 
 
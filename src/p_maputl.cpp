@@ -40,6 +40,8 @@
 #include "r_state.h"
 #include "templates.h"
 #include "po_man.h"
+#include "c_dispatch.h"
+#include "stats.h"
 
 // [Leo] Zandronum includes
 #include "v_text.h"
@@ -300,23 +302,27 @@ void AActor::UnlinkFromWorld ()
 		}
 	}
 		
-	if (!(flags & MF_NOBLOCKMAP))
+	if (!(flags & MF_NOBLOCKMAP) && InBlockmap)
 	{
 		// [RH] Unlink from all blocks this actor uses
-		FBlockNode *block = this->BlockNode;
-
-		while (block != NULL)
+		for (int y = BlockY1; y <= BlockY2; ++y)
 		{
-			if (block->NextActor != NULL)
+			for (int x = BlockX1; x <= BlockX2; ++x)
 			{
-				block->NextActor->PrevActor = block->PrevActor;
+				FBlockCell &cell = blocklinks[y*bmapwidth + x];
+
+				// Search from the end, since actors that move are relinked often.
+				for (int i = cell.Size() - 1; i >= 0; --i)
+				{
+					if (cell[i].Me == this)
+					{
+						cell.Delete(i);
+						break;
+					}
+				}
 			}
-			*(block->PrevActor) = block->NextActor;
-			FBlockNode *next = block->NextBlock;
-			block->Release ();
-			block = next;
 		}
-		BlockNode = NULL;
+		InBlockmap = false;
 	}
 }
 
@@ -397,37 +403,28 @@ void AActor::LinkToWorld (sector_t *sec)
 
 		if (x1 >= bmapwidth || x2 < 0 || y1 >= bmapheight || y2 < 0)
 		{ // thing is off the map
-			BlockNode = NULL;
+			InBlockmap = false;
 		}
 		else
         { // [RH] Link into every block this actor touches, not just the center one
-			FBlockNode **alink = &this->BlockNode;
+			FBlockThing thing;
 			x1 = MAX (0, x1);
 			y1 = MAX (0, y1);
 			x2 = MIN (bmapwidth - 1, x2);
 			y2 = MIN (bmapheight - 1, y2);
+			thing.Me = this;
 			for (int y = y1; y <= y2; ++y)
 			{
 				for (int x = x1; x <= x2; ++x)
 				{
-					FBlockNode **link = &blocklinks[y*bmapwidth + x];
-					FBlockNode *node = FBlockNode::Create (this, x, y);
-
-					// Link in to block
-					if ((node->NextActor = *link) != NULL)
-					{
-						(*link)->PrevActor = &node->NextActor;
-					}
-					node->PrevActor = link;
-					*link = node;
-
-					// Link in to actor
-					node->PrevBlock = alink;
-					node->NextBlock = NULL;
-					(*alink) = node;
-					alink = &node->NextBlock;
+					blocklinks[y*bmapwidth + x].Push (thing);
 				}
 			}
+			InBlockmap = true;
+			BlockX1 = x1;
+			BlockY1 = y1;
+			BlockX2 = x2;
+			BlockY2 = y2;
 		}
 	}
 }
@@ -610,36 +607,6 @@ void AActor::SetOrigin (fixed_t ix, fixed_t iy, fixed_t iz)
 	ulSTFlags |= STFL_POSITIONCHANGED;
 }
 
-FBlockNode *FBlockNode::FreeBlocks = NULL;
-
-FBlockNode *FBlockNode::Create (AActor *who, int x, int y)
-{
-	FBlockNode *block;
-
-	if (FreeBlocks != NULL)
-	{
-		block = FreeBlocks;
-		FreeBlocks = block->NextBlock;
-	}
-	else
-	{
-		block = new FBlockNode;
-	}
-	block->BlockIndex = x + y*bmapwidth;
-	block->Me = who;
-	block->NextActor = NULL;
-	block->PrevActor = NULL;
-	block->PrevBlock = NULL;
-	block->NextBlock = NULL;
-	return block;
-}
-
-void FBlockNode::Release ()
-{
-	NextBlock = FreeBlocks;
-	FreeBlocks = this;
-}
-
 //
 // BLOCK MAP ITERATORS
 // For each line/thing in the given mapblock,
@@ -781,13 +748,22 @@ line_t *FBlockLinesIterator::Next()
 //
 //===========================================================================
 
+DWORD FBlockThingsIterator::SlotsInUse;
+DWORD FBlockThingsIterator::SlotStamps[NUM_BLOCKVISIT_SLOTS];
+
+static unsigned int BlockThingsQueries;
+static unsigned int BlockThingsCells;
+static unsigned int BlockThingsReturned;
+
 FBlockThingsIterator::FBlockThingsIterator()
 : DynHash(0)
 {
 	minx = maxx = 0;
 	miny = maxy = 0;
 	ClearHash();
+	AcquireVisitSlot();
 	block = NULL;
+	blockindex = 0;
 }
 
 FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int _maxy)
@@ -798,6 +774,7 @@ FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int
 	miny = _miny;
 	maxy = _maxy;
 	ClearHash();
+	AcquireVisitSlot();
 	Reset();
 }
 
@@ -809,9 +786,60 @@ FBlockThingsIterator::FBlockThingsIterator(const FBoundingBox &box)
 	maxx = GetSafeBlockX(box.Right() - bmaporgx);
 	minx = GetSafeBlockX(box.Left() - bmaporgx);
 	ClearHash();
+	AcquireVisitSlot();
 	Reset();
 }
 
+FBlockThingsIterator::~FBlockThingsIterator()
+{
+	if (visitslot >= 0)
+	{
+		SlotsInUse &= ~(1u << visitslot);
+	}
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: AcquireVisitSlot
+//
+// Takes a free visit stamp slot and a new stamp for it. Each slot has its
+// own stamps, so when they wrap around, only the actors' stamps of this
+// slot need to be cleared, and no other iterator is using it.
+//
+//===========================================================================
+
+void FBlockThingsIterator::AcquireVisitSlot()
+{
+	BlockThingsQueries++;
+
+	for (visitslot = 0; visitslot < NUM_BLOCKVISIT_SLOTS; ++visitslot)
+	{
+		if (!(SlotsInUse & (1u << visitslot)))
+		{
+			break;
+		}
+	}
+	if (visitslot == NUM_BLOCKVISIT_SLOTS)
+	{
+		visitslot = -1;
+		return;
+	}
+
+	SlotsInUse |= 1u << visitslot;
+	if ((visitstamp = ++SlotStamps[visitslot]) == 0)
+	{
+		for (int i = bmapwidth * bmapheight - 1; i >= 0; --i)
+		{
+			FBlockCell &cell = blocklinks[i];
+			for (unsigned int j = 0; j < cell.Size(); ++j)
+			{
+				cell[j].Me->BlockVisit[visitslot] = 0;
+			}
+		}
+		visitstamp = ++SlotStamps[visitslot];
+	}
+}
+
 //===========================================================================
 //
 // FBlockThingsIterator :: ClearHash
@@ -825,6 +853,53 @@ void FBlockThingsIterator::ClearHash()
 	DynHash.Clear();
 }
 
+//===========================================================================
+//
+// FBlockThingsIterator :: CheckHash
+//
+// Returns true if the actor was already returned, otherwise adds it to
+// the hash table.
+//
+//===========================================================================
+
+bool FBlockThingsIterator::CheckHash(AActor *me)
+{
+	HashEntry *entry;
+	int i;
+
+	size_t hash = ((size_t)me >> 3) % countof(Buckets);
+	for (i = Buckets[hash]; i >= 0; )
+	{
+		entry = GetHashEntry(i);
+		if (entry->Actor == me)
+		{ // I've already been checked. Skip to the next actor.
+			return true;
+		}
+		i = entry->Next;
+	}
+
+	// Add me to the hash table.
+	if (NumFixedHash < (int)countof(FixedHash))
+	{
+		entry = &FixedHash[NumFixedHash];
+		entry->Next = Buckets[hash];
+		Buckets[hash] = NumFixedHash++;
+	}
+	else
+	{
+		if (DynHash.Size() == 0)
+		{
+			DynHash.Grow(50);
+		}
+		i = DynHash.Reserve(1);
+		entry = &DynHash[i];
+		entry->Next = Buckets[hash];
+		Buckets[hash] = i + countof(FixedHash);
+	}
+	entry->Actor = me;
+	return false;
+}
+
 //===========================================================================
 //
 // FBlockThingsIterator :: StartBlock
@@ -837,12 +912,15 @@ void FBlockThingsIterator::StartBlock(int x, int y)
 	cury = y; 
 	if (x >= 0 && y >= 0 && x < bmapwidth && y <bmapheight)
 	{
-		block = blocklinks[y*bmapwidth + x];
+		block = &blocklinks[y*bmapwidth + x];
+		blockindex = block->Size();
+		BlockThingsCells++;
 	}
 	else
 	{
 		// invalid block
 		block = NULL;
+		blockindex = 0;
 	}
 }
 
@@ -869,68 +947,54 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 {
 	for (;;)
 	{
-		while (block != NULL)
+		if (block != NULL)
 		{
-			AActor *me = block->Me;
-			FBlockNode *mynode = block;
-			HashEntry *entry;
-			int i;
-
-			block = block->NextActor;
-			// Don't recheck things that were already checked
-			if (mynode->NextBlock == NULL && mynode->PrevBlock == &me->BlockNode)
-			{ // This actor doesn't span blocks, so we know it can only ever be checked once.
-				return me;
-			}
-			if (centeronly)
+			// The caller may have unlinked actors from this block since the last
+			// call. Entries are only ever removed or appended, so the ones that
+			// haven't been checked yet are still below blockindex. Each removal
+			// below it moves an entry that was already checked down there too,
+			// which is why every returned actor is stamped, even if it is only
+			// linked into this block.
+			if (blockindex > (int)block->Size())
 			{
-				// Block boundaries for compatibility mode
-				fixed_t blockleft = (curx << MAPBLOCKSHIFT) + bmaporgx;
-				fixed_t blockright = blockleft + MAPBLOCKSIZE;
-				fixed_t blockbottom = (cury << MAPBLOCKSHIFT) + bmaporgy;
-				fixed_t blocktop = blockbottom + MAPBLOCKSIZE;
-
-				// only return actors with the center in this block
-				if (me->x >= blockleft && me->x < blockright &&
-					me->y >= blockbottom && me->y < blocktop)
-				{
-					return me;
-				}
+				blockindex = block->Size();
 			}
-			else
+
+			while (--blockindex >= 0)
 			{
-				size_t hash = ((size_t)me >> 3) % countof(Buckets);
-				for (i = Buckets[hash]; i >= 0; )
+				AActor *me = (*block)[blockindex].Me;
+
+				if (centeronly)
 				{
-					entry = GetHashEntry(i);
-					if (entry->Actor == me)
-					{ // I've already been checked. Skip to the next actor.
-						break;
-					}
-					i = entry->Next;
-				}
-				if (i < 0)
-				{ // Add me to the hash table and return me.
-					if (NumFixedHash < (int)countof(FixedHash))
+					// Block boundaries for compatibility mode
+					fixed_t blockleft = (curx << MAPBLOCKSHIFT) + bmaporgx;
+					fixed_t blockright = blockleft + MAPBLOCKSIZE;
+					fixed_t blockbottom = (cury << MAPBLOCKSHIFT) + bmaporgy;
+					fixed_t blocktop = blockbottom + MAPBLOCKSIZE;
+
+					// only return actors with the center in this block
+					if (me->x < blockleft || me->x >= blockright ||
+						me->y < blockbottom || me->y >= blocktop)
 					{
-						entry = &FixedHash[NumFixedHash];
-						entry->Next = Buckets[hash];
-						Buckets[hash] = NumFixedHash++;
+						continue;
 					}
-					else
+				}
+
+				// Don't recheck things that were already checked
+				if (visitslot >= 0)
+				{
+					if (me->BlockVisit[visitslot] == visitstamp)
 					{
-						if (DynHash.Size() == 0)
-						{
-							DynHash.Grow(50);
-						}
-						i = DynHash.Reserve(1);
-						entry = &DynHash[i];
-						entry->Next = Buckets[hash];
-						Buckets[hash] = i + countof(FixedHash);
+						continue;
 					}
-					entry->Actor = me;
-					return me;
+					me->BlockVisit[visitslot] = visitstamp;
 				}
+				else if (CheckHash(me))
+				{
+					continue;
+				}
+				BlockThingsReturned++;
+				return me;
 			}
 		}
 
@@ -943,6 +1007,168 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 	}
 }
 
+//===========================================================================
+//
+// P_ResetBlockmapCounters
+//
+//===========================================================================
+
+void P_ResetBlockmapCounters ()
+{
+	BlockThingsQueries = 0;
+	BlockThingsCells = 0;
+	BlockThingsReturned = 0;
+}
+
+ADD_STAT (blockmap)
+{
+	FString out;
+	out.Format ("%5u thing queries, %6u blocks, %6u things returned",
+		BlockThingsQueries, BlockThingsCells, BlockThingsReturned);
+	return out;
+}
+
+//===========================================================================
+//
+// P_CheckBlockThingsRemoval
+//
+// Iterates the first cell with at least four actors. After the second one
+// is returned, does to the cell what P_RadiusAttack can do: the returned
+// actor is relinked and the oldest actor of the cell is unlinked. That's
+// two removals at or below the iterator's position, so the first returned
+// actor moves below it. Every remaining actor must still be returned
+// exactly once, and the unlinked one not at all. The cell is restored
+// afterwards.
+//
+//===========================================================================
+
+static void P_CheckBlockThingsRemoval()
+{
+	int index;
+
+	for (index = 0; index < bmapwidth * bmapheight; ++index)
+	{
+		if (blocklinks[index].Size() >= 4)
+		{
+			break;
+		}
+	}
+	if (index == bmapwidth * bmapheight)
+	{
+		Printf ("blockmapbench: No cell with at least four actors to check the iterator.\n");
+		return;
+	}
+
+	FBlockCell &cell = blocklinks[index];
+	FBlockCell saved = cell;
+	TArray<AActor *> returned;
+	const int x = index % bmapwidth, y = index / bmapwidth;
+
+	FBlockThingsIterator it (x, y, x, y);
+	for (AActor *thing; (thing = it.Next ()) != NULL; )
+	{
+		if (returned.Push (thing) == 1)
+		{
+			unsigned int i = cell.Size();
+			while (cell[--i].Me != thing)
+			{
+			}
+			FBlockThing relinked = cell[i];
+			cell.Delete (i);
+			cell.Delete (0);
+			cell.Push (relinked);
+		}
+	}
+
+	bool passed = returned.Size() == saved.Size() - 1;
+	for (unsigned int i = 1; i < saved.Size() && passed; ++i)
+	{
+		unsigned int count = 0;
+		for (unsigned int j = 0; j < returned.Size(); ++j)
+		{
+			count += returned[j] == saved[i].Me;
+		}
+		passed = count == 1;
+	}
+	for (unsigned int j = 0; j < returned.Size() && passed; ++j)
+	{
+		passed = returned[j] != saved[0].Me;
+	}
+	cell = saved;
+
+	Printf ("blockmapbench: Unlinking while iterating a cell of %u actors %s.\n",
+		saved.Size(), passed ? "works" : TEXTCOLOR_RED "returned wrong actors" TEXTCOLOR_NORMAL);
+}
+
+//===========================================================================
+//
+// CCMD blockmapbench
+//
+// Runs the blockmap queries that P_CheckPosition and P_RadiusAttack would
+// do for every solid or shootable actor on the map, as if for the given
+// number of tics, and reports how long they took. Nothing is changed.
+//
+// Afterwards, checks that FBlockThingsIterator returns every actor of a
+// cell once when the caller unlinks entries while iterating it.
+//
+//===========================================================================
+
+CCMD (blockmapbench)
+{
+	if (gamestate != GS_LEVEL || blocklinks == NULL)
+	{
+		Printf ("blockmapbench: Not in a level.\n");
+		return;
+	}
+
+	const int tics = argv.argc() >= 2 ? clamp (atoi (argv[1]), 1, 100000) : 350;
+	TArray<AActor *> actors;
+	TThinkerIterator<AActor> iterator;
+	AActor *mo;
+
+	while ((mo = iterator.Next ()) != NULL)
+	{
+		if ((mo->flags & (MF_SOLID|MF_SHOOTABLE)) && !(mo->flags & MF_NOBLOCKMAP))
+		{
+			actors.Push (mo);
+		}
+	}
+
+	cycle_t cycles;
+	unsigned int queries = 0, returned = 0;
+	DWORD checksum = 0;
+
+	cycles.Reset ();
+	cycles.Clock ();
+	for (int tic = 0; tic < tics; ++tic)
+	{
+		for (unsigned int i = 0; i < actors.Size(); ++i)
+		{
+			mo = actors[i];
+
+			FBlockThingsIterator it (FBoundingBox (mo->x, mo->y, mo->radius + MAXRADIUS));
+			for (AActor *thing; (thing = it.Next ()) != NULL; ++returned)
+			{
+				checksum += thing->x ^ thing->radius;
+			}
+
+			FBlockThingsIterator it2 (FBoundingBox (mo->x, mo->y, 128 * FRACUNIT));
+			for (AActor *thing; (thing = it2.Next ()) != NULL; ++returned)
+			{
+				checksum += thing->y ^ thing->height;
+			}
+			queries += 2;
+		}
+	}
+	cycles.Unclock ();
+
+	Printf ("%d tics, %u actors: %u queries returned %u things in %.2f ms (%.0f ns per query, %.2f ms per tic) [%08x]\n",
+		tics, actors.Size(), queries, returned, cycles.TimeMS(),
+		queries ? cycles.TimeMS() * 1e6 / queries : 0., cycles.TimeMS() / tics, checksum);
+
+	P_CheckBlockThingsRemoval();
+}
+
 
 //===========================================================================
 //
@@ -1521,19 +1747,21 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 static AActor *RoughBlockCheck (AActor *mo, int index, void *param)
 {
 	bool onlyseekable = param != NULL;
-	FBlockNode *link;
+	FBlockCell &cell = blocklinks[index];
 
-	for (link = blocklinks[index]; link != NULL; link = link->NextActor)
+	for (int i = cell.Size() - 1; i >= 0; --i)
 	{
-		if (link->Me != mo)
+		AActor *link = cell[i].Me;
+
+		if (link != mo)
 		{
-			if (onlyseekable && !mo->CanSeek(link->Me))
+			if (onlyseekable && !mo->CanSeek(link))
 			{
 				continue;
 			}
-			if (mo->IsOkayToAttack (link->Me))
+			if (mo->IsOkayToAttack (link))
 			{
-				return link->Me;
+				return link;
 			}
 		}
 	}
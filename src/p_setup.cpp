@@ -58,6 +58,7 @@
 #include "doomerrors.h"
 #include "gi.h"
 #include "p_conversation.h"
+#include "dobjpool.h"
 #include "a_keys.h"
 #include "s_sndseq.h"
 #include "sbar.h"
@@ -87,6 +88,9 @@
 #include "joinqueue.h"
 #include "cl_demo.h"
 #include "domination.h"
+#include "sv_relevance.h"
+#include "unlagged.h"
+#include "sv_main.h"
 
 // [BB] New #includes..
 #include "gl/dynlights/gl_dynlight.h"
@@ -189,7 +193,7 @@ fixed_t 		bmaporgy;
 int				bmapnegx;		// min negs of block map before wrapping
 int				bmapnegy;
 
-FBlockNode**	blocklinks;		// for thing chains
+FBlockCell*		blocklinks;		// for thing chains
 
 
 // REJECT
@@ -3169,19 +3173,9 @@ void P_LoadBlockMap (MapData * map)
 
 	// clear out mobj chains
 	count = bmapwidth*bmapheight;
-	blocklinks = new FBlockNode *[count];
-	memset (blocklinks, 0, count*sizeof(*blocklinks));
+	blocklinks = new FBlockCell[count];
 	blockmap = blockmaplump+4;
 
-	// [BC] Also, build the node list for the bot pathing module.
-	// [K6/BB] This is handled in CSkullBot(), unless we already have bots in game (from the previous map).
-	if (( NETWORK_InClientMode() == false ) &&
-		(( level.flagsZA & LEVEL_ZA_NOBOTNODES ) == false ) &&
-		( BOTS_CountBots( ) > 0 ))
-	{
-		ASTAR_BuildNodes( );
-	}
-
 	if ( level.flagsZA & LEVEL_ZA_NOBOTNODES || level.flagsZA & LEVEL_ZA_ISLOBBY )
 		BOTS_RemoveAllBots( false );
 }
@@ -3731,6 +3725,7 @@ void P_FreeLevelData ()
 	FPolyObj::ClearAllSubsectorLinks(); // can't be done as part of the polyobj deletion process.
 	SN_StopAllSequences ();
 	DThinker::DestroyAllThinkers ();
+	ObjectPool.ReleaseUnused ();
 	level.total_monsters = level.total_items = level.total_secrets =
 		level.killed_monsters = level.found_items = level.found_secrets =
 		wminfo.maxfrags = 0;
@@ -3880,16 +3875,6 @@ void P_FreeExtraLevelData()
 	// Free all blocknodes and msecnodes.
 	// *NEVER* call this function without calling
 	// P_FreeLevelData() first, or they might not all be freed.
-	{
-		FBlockNode *node = FBlockNode::FreeBlocks;
-		while (node != NULL)
-		{
-			FBlockNode *next = node->NextBlock;
-			delete node;
-			node = next;
-		}
-		FBlockNode::FreeBlocks = NULL;
-	}
 	{
 		msecnode_t *node = headsecnode;
 
@@ -4341,6 +4326,16 @@ void P_SetupLevel (char *lumpname, int position)
 	P_GroupLines (buildmap);
 	times[12].Unclock();
 
+	// [BC] Also, build the node list for the bot pathing module. The navigation graph
+	// needs the subsectors' sectors and the sectors' line lists set up by P_GroupLines.
+	// [K6/BB] This is handled in CSkullBot(), unless we already have bots in game (from the previous map).
+	if (( NETWORK_InClientMode() == false ) &&
+		(( level.flagsZA & LEVEL_ZA_NOBOTNODES ) == false ) &&
+		( BOTS_CountBots( ) > 0 ))
+	{
+		ASTAR_BuildNodes( );
+	}
+
 	times[13].Clock();
 	P_FloodZones ();
 	times[13].Unclock();
@@ -4448,6 +4443,15 @@ void P_SetupLevel (char *lumpname, int position)
 			vertexes[i].numheights=0;
 			vertexes[i].numsectors=0;
 		}
+
+		// Prepare the relevance checks of the actor updates for the new level.
+		SERVERRELEVANCE_SetupLevel( );
+
+		// Only sectors that move need to be recorded for unlagged.
+		UNLAGGED_SetupLevel( );
+
+		// The launcher response has to describe the new map.
+		SERVER_MASTER_InvalidateServerInfo( QUERYRESPONSESEGMENT_ALL );
 	}
 
 	// [BC] Now that all the items have been loaded, potentially set the game mode.
@@ -10,6 +10,7 @@
 //**************************************************************************
 
 #include <assert.h>
+#include <algorithm>
 
 #include "doomdef.h"
 #include "i_system.h"
@@ -24,6 +25,7 @@
 #include "r_state.h"
 
 #include "stats.h"
+#include "c_cvars.h"
 
 static FRandom pr_botchecksight ("BotCheckSight");
 static FRandom pr_checksight ("CheckSight");
@@ -640,29 +642,16 @@ sightcounts[2]++;
 /*
 =====================
 =
-= P_CheckSight
-=
-= Returns true if a straight line between t1 and t2 is unobstructed
-= look from eyes of t1 to any part of t2
+= P_SightPossible
 =
-= killough 4/20/98: cleaned up, made to use new LOS struct
+= Does the cheap tests that can rule out a line of sight between t1 and t2
+= without walking the map
 =
 =====================
 */
 
-bool P_CheckSight (const AActor *t1, const AActor *t2, int flags)
+static bool P_SightPossible (const AActor *t1, const AActor *t2, int flags)
 {
-	SightCycles.Clock();
-
-	bool res;
-
-	assert (t1 != NULL);
-	assert (t2 != NULL);
-	if (t1 == NULL || t2 == NULL)
-	{
-		return false;
-	}
-
 	const sector_t *s1 = t1->Sector;
 	const sector_t *s2 = t2->Sector;
 	int pnum = int(s1 - sectors) * numsectors + int(s2 - sectors);
@@ -674,8 +663,7 @@ bool P_CheckSight (const AActor *t1, const AActor *t2, int flags)
 		(rejectmatrix[pnum>>3] & (1 << (pnum & 7))))
 	{
 sightcounts[0]++;
-		res = false;			// can't possibly be connected
-		goto done;
+		return false;			// can't possibly be connected
 	}
 
 //
@@ -687,8 +675,7 @@ sightcounts[0]++;
 	{ // small chance of an attack being made anyway
 		if (pr_checksight() > 50)
 		{
-			res = false;
-			goto done;
+			return false;
 		}
 	}
 
@@ -708,13 +695,73 @@ sightcounts[0]++;
 			  (t2->z >= s2->heightsec->ceilingplane.ZatPoint (t2->x, t2->y) &&
 			   t1->z + t2->height <= s2->heightsec->ceilingplane.ZatPoint (t1->x, t1->y)))))
 		{
-			res = false;
-			goto done;
+			return false;
 		}
 	}
+	return true;
+}
 
-	// An unobstructed LOS is possible.
-	// Now look from eyes of t1 to any part of t2.
+//==========================================================================
+//
+// P_SightTraverseCached
+//
+// The line traversal only depends on the position and height of both
+// actors, the sight flags and the map geometry, so its result can be
+// reused for as long as none of these changes. The cache is a direct
+// mapped table that is emptied every tic, and in between whenever
+// something moves a plane or polyobject or changes a line's flags.
+//
+//==========================================================================
+
+// Cache the results of sight checks between actors that didn't move.
+CVAR (Bool, sightcache, true, 0)
+
+enum { SIGHTCACHE_SIZE = 4096 };
+
+struct FSightCacheEntry
+{
+	const AActor *Looker;
+	const AActor *Target;
+	fixed_t LookerX, LookerY, LookerZ, LookerHeight;
+	fixed_t TargetX, TargetY, TargetZ, TargetHeight;
+	int Flags;
+	DWORD Generation;
+	bool Result;
+};
+
+static FSightCacheEntry SightCache[SIGHTCACHE_SIZE];
+static DWORD SightCacheGeneration = 1;
+static int SightCacheHits, SightCacheMisses, SightBatchQueries;
+
+static inline FSightCacheEntry *P_SightCacheSlot (const AActor *t1, const AActor *t2, int flags)
+{
+	DWORD hash = DWORD(size_t(t1) >> 4) * 0x9E3779B1u;
+	hash ^= DWORD(size_t(t2) >> 4) * 0x85EBCA77u;
+	hash ^= flags;
+	hash ^= hash >> 15;
+	return &SightCache[hash & (SIGHTCACHE_SIZE - 1)];
+}
+
+static bool P_SightTraverseCached (const AActor *t1, const AActor *t2, int flags)
+{
+	FSightCacheEntry *entry = NULL;
+	bool res;
+
+	if (sightcache)
+	{
+		entry = P_SightCacheSlot (t1, t2, flags);
+		if (entry->Generation == SightCacheGeneration &&
+			entry->Looker == t1 && entry->Target == t2 && entry->Flags == flags &&
+			entry->LookerX == t1->x && entry->LookerY == t1->y &&
+			entry->LookerZ == t1->z && entry->LookerHeight == t1->height &&
+			entry->TargetX == t2->x && entry->TargetY == t2->y &&
+			entry->TargetZ == t2->z && entry->TargetHeight == t2->height)
+		{
+			SightCacheHits++;
+			return entry->Result;
+		}
+		SightCacheMisses++;
+	}
 
 	validcount++;
 	{
@@ -722,17 +769,148 @@ sightcounts[0]++;
 		res = s.P_SightPathTraverse (t1->x, t1->y, t2->x, t2->y);
 	}
 
-done:
+	if (entry != NULL)
+	{
+		entry->Looker = t1;
+		entry->Target = t2;
+		entry->Flags = flags;
+		entry->LookerX = t1->x;
+		entry->LookerY = t1->y;
+		entry->LookerZ = t1->z;
+		entry->LookerHeight = t1->height;
+		entry->TargetX = t2->x;
+		entry->TargetY = t2->y;
+		entry->TargetZ = t2->z;
+		entry->TargetHeight = t2->height;
+		entry->Generation = SightCacheGeneration;
+		entry->Result = res;
+	}
+	return res;
+}
+
+//==========================================================================
+//
+// P_InvalidateSightCache
+//
+// Must be called whenever the map geometry changes in a way that can
+// affect line of sight.
+//
+//==========================================================================
+
+void P_InvalidateSightCache ()
+{
+	if (++SightCacheGeneration == 0)
+	{
+		// The generation wrapped around, so old entries could look valid again.
+		memset (SightCache, 0, sizeof(SightCache));
+		SightCacheGeneration = 1;
+	}
+}
+
+/*
+=====================
+=
+= P_CheckSight
+=
+= Returns true if a straight line between t1 and t2 is unobstructed
+= look from eyes of t1 to any part of t2
+=
+= killough 4/20/98: cleaned up, made to use new LOS struct
+=
+=====================
+*/
+
+bool P_CheckSight (const AActor *t1, const AActor *t2, int flags)
+{
+	SightCycles.Clock();
+
+	bool res;
+
+	assert (t1 != NULL);
+	assert (t2 != NULL);
+	if (t1 == NULL || t2 == NULL)
+	{
+		return false;
+	}
+
+	// An unobstructed LOS is possible.
+	// Now look from eyes of t1 to any part of t2.
+	res = P_SightPossible (t1, t2, flags) && P_SightTraverseCached (t1, t2, flags);
+
 	SightCycles.Unclock();
 	return res;
 }
 
+//==========================================================================
+//
+// P_CheckSightBatch
+//
+// Checks several looker/target pairs at once. The cheap rejection tests
+// run in the order given, so pr_checksight is called exactly as if each
+// pair had been passed to P_CheckSight. The remaining traversals are then
+// done grouped by sector, which keeps the lines and blockmap cells they
+// walk through warm in the cache.
+//
+//==========================================================================
+
+static TArray<int> SightBatchPending;
+
+void P_CheckSightBatch (const FSightQuery *queries, int count, bool *results)
+{
+	SightCycles.Clock();
+
+	SightBatchPending.Clear();
+	for (int i = 0; i < count; ++i)
+	{
+		const FSightQuery &query = queries[i];
+
+		assert (query.Looker != NULL);
+		assert (query.Target != NULL);
+		if (query.Looker == NULL || query.Target == NULL || !P_SightPossible (query.Looker, query.Target, query.Flags))
+		{
+			results[i] = false;
+		}
+		else
+		{
+			SightBatchPending.Push (i);
+		}
+	}
+
+	if (SightBatchPending.Size() > 1)
+	{
+		std::sort (&SightBatchPending[0], &SightBatchPending[0] + SightBatchPending.Size(), [queries](int a, int b)
+		{
+			const FSightQuery &qa = queries[a];
+			const FSightQuery &qb = queries[b];
+
+			if (qa.Looker->Sector != qb.Looker->Sector)
+				return qa.Looker->Sector < qb.Looker->Sector;
+			if (qa.Target->Sector != qb.Target->Sector)
+				return qa.Target->Sector < qb.Target->Sector;
+			return a < b;
+		});
+	}
+
+	for (unsigned int i = 0; i < SightBatchPending.Size(); ++i)
+	{
+		const FSightQuery &query = queries[SightBatchPending[i]];
+		results[SightBatchPending[i]] = P_SightTraverseCached (query.Looker, query.Target, query.Flags);
+	}
+
+	SightBatchQueries += count;
+	SightCycles.Unclock();
+}
+
 ADD_STAT (sight)
 {
 	FString out;
 	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d%4d\n",
 		SightCycles.TimeMS(), MaxSightCycles.TimeMS(),
 		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[3], sightcounts[4], sightcounts[5]);
+	int lookups = SightCacheHits + SightCacheMisses;
+	out.AppendFormat ("cache %5d hits %5d misses (%5.1f%%), %5d batched",
+		SightCacheHits, SightCacheMisses, lookups > 0 ? SightCacheHits * 100. / lookups : 0.,
+		SightBatchQueries);
 	return out;
 }
 
@@ -748,6 +926,8 @@ void P_ResetSightCounters (bool full)
 	}
 	SightCycles.Reset();
 	memset (sightcounts, 0, sizeof(sightcounts));
+	SightCacheHits = SightCacheMisses = SightBatchQueries = 0;
+	P_InvalidateSightCache ();
 }
 
 
@@ -151,6 +151,7 @@ void P_Ticker (void)
 		if ( ( ( i == MAXPLAYERS ) || ( S_IsMusicPaused () == false ) ) && ( CLIENTDEMO_IsSkipping() == false ) )
 			S_ResumeSound (false);
 		P_ResetSightCounters (false);
+		P_ResetBlockmapCounters ();
 
 		// Since things will be moving, it's okay to interpolate them in the renderer.
 		r_NoInterpolate = false;
@@ -1496,7 +1496,6 @@ void FPolyObj::UnLinkPolyobj ()
 bool FPolyObj::CheckMobjBlocking (side_t *sd)
 {
 	static TArray<AActor *> checker;
-	FBlockNode *block;
 	AActor *mobj;
 	int i, j, k;
 	int left, right, top, bottom;
@@ -1531,9 +1530,12 @@ bool FPolyObj::CheckMobjBlocking (side_t *sd)
 	{
 		for (i = left; i <= right; i++)
 		{
-			for (block = blocklinks[j+i]; block != NULL; block = block->NextActor)
+			FBlockCell &cell = blocklinks[j+i];
+
+			// Blocked actors may be damaged and unlinked while doing this.
+			for (int b = cell.Size() - 1; b >= 0; b = MIN<int>(b, cell.Size()) - 1)
 			{
-				mobj = block->Me;
+				mobj = cell[b].Me;
 				for (k = (int)checker.Size()-1; k >= 0; --k)
 				{
 					if (checker[k] == mobj)
@@ -1630,6 +1632,9 @@ void FPolyObj::LinkPolyobj ()
 	polyblock_t **link;
 	polyblock_t *tempLink;
 
+	// The polyobject's lines have moved.
+	P_InvalidateSightCache ();
+
 	// calculate the polyobj bbox
 	Bounds.ClearBox();
 	for(unsigned i = 0; i < Sidedefs.Size(); i++)
@@ -247,10 +247,6 @@ struct secplane_t
 
 	fixed_t a, b, c, d, ic;
 
-	// [Spleen] Store the old D's of the plane for unlagged support
-	fixed_t		unlaggedD[UNLAGGEDTICS];
-	fixed_t		restoreD;
-
 	// Returns < 0 : behind; == 0 : on; > 0 : in front
 	int PointOnSide (fixed_t x, fixed_t y, fixed_t z) const
 	{
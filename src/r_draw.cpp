@@ -1577,9 +1577,10 @@ extern "C" void STACK_ARGS R_DrawSlabC(int dx, fixed_t v, int dy, fixed_t vi, co
 
 // wallscan stuff, in C
 
+int vlinebits;
+
 #ifndef X86_ASM
 static DWORD STACK_ARGS vlinec1 ();
-static int vlinebits;
 
 DWORD (STACK_ARGS *dovline1)() = vlinec1;
 DWORD (STACK_ARGS *doprevline1)() = vlinec1;
@@ -1629,6 +1630,7 @@ void (STACK_ARGS *domvline4)() = mvlineasm4;
 
 void setupvline (int fracbits)
 {
+	vlinebits = fracbits;
 #ifdef X86_ASM
 	if (CPU.Family <= 5)
 	{
@@ -1655,12 +1657,9 @@ void setupvline (int fracbits)
 			dovline4 = vlinetallasmathlon4;
 		}
 	}
-#else
-	vlinebits = fracbits;
-#ifdef X64_ASM
+#elif defined(X64_ASM)
 	setupvlinetallasm(fracbits);
 #endif
-#endif
 }
 
 #if !defined(X86_ASM)
@@ -74,6 +74,7 @@ extern "C" void vlinetallasm4();
 extern void (STACK_ARGS *dovline4) ();
 #endif
 extern void setupvline (int);
+extern int vlinebits;	// The fracbits passed to setupvline
 
 extern DWORD (STACK_ARGS *domvline1) ();
 extern void (STACK_ARGS *domvline4) ();
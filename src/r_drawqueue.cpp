@@ -0,0 +1,607 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: r_drawqueue.cpp
+//
+// Description: Queues the wall and flat drawers of the opaque pass and runs them in column strips on worker threads.
+//
+//-----------------------------------------------------------------------------
+
+#include <atomic>
+#include "templates.h"
+#include "c_cvars.h"
+#include "r_local.h"
+#include "r_draw.h"
+#include "r_drawqueue.h"
+#include "stats.h"
+#include "workerpool.h"
+
+//==========================================================================
+//
+// The drawers that can be queued
+//
+// Only the opaque walls and flats are queued: they cover every pixel of
+// the view exactly once, so the columns of the view can be drawn in any
+// order. Everything else (decals, sloped flats, sprites, masked and
+// translucent walls) is drawn directly after the queue has been drawn.
+//
+//==========================================================================
+
+enum
+{
+	DC_VLine1,		// One wall column (dovline1)
+	DC_VLine4,		// Four adjacent wall columns (dovline4)
+	DC_Span,		// One row of a flat (R_DrawSpan)
+	DC_FillSpan,	// One row of a flat in a single color (R_FillSpan)
+};
+
+struct FColumnDrawer
+{
+	const BYTE *Source[4];
+	const BYTE *Colormap[4];
+	DWORD Frac[4];
+	DWORD Step[4];
+};
+
+struct FSpanDrawer
+{
+	const BYTE *Source;
+	const BYTE *Colormap;
+	dsfixed_t XFrac, YFrac;
+	dsfixed_t XStep, YStep;
+	BYTE XBits, YBits;
+	BYTE Color;
+};
+
+struct FDrawerCommand
+{
+	BYTE Type;
+	BYTE Bits;		// The fracbits of columns, see setupvline
+	int X;			// The first column
+	int Count;		// The height of columns, or the width of spans
+	BYTE *Dest;
+	union
+	{
+		FColumnDrawer Column;
+		FSpanDrawer Span;
+	};
+};
+
+//==========================================================================
+//
+// FDrawQueue
+//
+// Collects the drawers of the opaque pass. When the queue is run, the view
+// is split into strips of columns, and the main thread and the worker
+// threads take strips until none are left. Each strip goes through all
+// queued drawers in order and only draws the part that falls within it.
+//
+//==========================================================================
+
+class FDrawQueue
+{
+public:
+	FDrawQueue();
+	~FDrawQueue();
+
+	void SetNumThreads(unsigned int numThreads) { Pool.SetNumThreads(numThreads); }
+	unsigned int GetNumThreads() const { return Pool.GetNumThreads(); }
+	unsigned int GetNumStrips() const { return GetNumThreads() > 0 ? (GetNumThreads() + 1) * STRIPS_PER_THREAD : 0; }
+
+	void Begin(BYTE *destorg, int pitch, int width);
+	FDrawerCommand &Add(BYTE type, BYTE *dest, int count);
+	BYTE *AllocMemory(size_t size);
+	void Run();
+
+	unsigned int NumQueued;
+	unsigned int NumBatches;
+	cycle_t RunCycles;
+
+private:
+	// More strips than threads, so that a thread that got an easy strip
+	// can take another one.
+	enum { STRIPS_PER_THREAD = 3 };
+	enum { MEMORY_BLOCK_SIZE = 65536 };
+
+	void DrawStrips();
+	void DrawStrip(int x1, int x2) const;
+
+	TArray<FDrawerCommand> Commands;
+	BYTE *DestOrg;
+	int Pitch;
+	int ViewWidth;
+	int StripWidth;
+	unsigned int NumStrips;
+
+	TArray<BYTE *> MemoryBlocks;
+	unsigned int CurrentBlock;
+	size_t MemoryUsed;
+
+	FWorkerPool Pool;
+	std::atomic<unsigned int> NextStrip;
+};
+
+static FDrawQueue DrawQueue;
+
+bool r_queuedrawers;
+
+// Draws the walls and flats of the software renderer in column strips on
+// several threads. 1 uses one thread per core (up to 8), anything higher
+// sets the number of threads.
+CUSTOM_CVAR (Int, r_multithreaded, 0, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0 || self > 16)
+	{
+		self = clamp<int>(self, 0, 16);
+		return;
+	}
+
+	unsigned int numThreads = 0;
+	if (self == 1)
+	{
+		// The main thread draws strips, too.
+		numThreads = std::thread::hardware_concurrency();
+		numThreads = clamp<unsigned int>(numThreads, 2, 8) - 1;
+	}
+	else if (self > 1)
+	{
+		numThreads = self - 1;
+	}
+	R_EndDrawQueue();
+	DrawQueue.SetNumThreads(numThreads);
+}
+
+//==========================================================================
+//
+// The drawers, with their state passed in instead of global
+//
+//==========================================================================
+
+static void R_DrawQueuedColumn (const FDrawerCommand &cmd, int z, int pitch)
+{
+	const BYTE *source = cmd.Column.Source[z];
+	const BYTE *colormap = cmd.Column.Colormap[z];
+	DWORD frac = cmd.Column.Frac[z];
+	const DWORD fracstep = cmd.Column.Step[z];
+	const int bits = cmd.Bits;
+	BYTE *dest = cmd.Dest + z;
+	int count = cmd.Count;
+
+	do
+	{
+		*dest = colormap[source[frac>>bits]];
+		frac += fracstep;
+		dest += pitch;
+	} while (--count);
+}
+
+static void R_DrawQueuedColumns4 (const FDrawerCommand &cmd, int pitch)
+{
+	const FColumnDrawer &col = cmd.Column;
+	DWORD place[4] = { col.Frac[0], col.Frac[1], col.Frac[2], col.Frac[3] };
+	const int bits = cmd.Bits;
+	BYTE *dest = cmd.Dest;
+	int count = cmd.Count;
+
+	do
+	{
+		dest[0] = col.Colormap[0][col.Source[0][place[0]>>bits]]; place[0] += col.Step[0];
+		dest[1] = col.Colormap[1][col.Source[1][place[1]>>bits]]; place[1] += col.Step[1];
+		dest[2] = col.Colormap[2][col.Source[2][place[2]>>bits]]; place[2] += col.Step[2];
+		dest[3] = col.Colormap[3][col.Source[3][place[3]>>bits]]; place[3] += col.Step[3];
+		dest += pitch;
+	} while (--count);
+}
+
+static void R_DrawQueuedSpan (const FDrawerCommand &cmd, int x1, int x2)
+{
+	const FSpanDrawer &span = cmd.Span;
+
+	// Only draw the part of the span within [x1,x2).
+	const int skip = MAX(x1 - cmd.X, 0);
+	int count = MIN(cmd.X + cmd.Count, x2) - (cmd.X + skip);
+	if (count <= 0)
+	{
+		return;
+	}
+
+	BYTE *dest = cmd.Dest + skip;
+
+	if (cmd.Type == DC_FillSpan)
+	{
+		memset (dest, span.Color, count);
+		return;
+	}
+
+	const BYTE *source = span.Source;
+	const BYTE *colormap = span.Colormap;
+	dsfixed_t xfrac = span.XFrac + span.XStep * skip;
+	dsfixed_t yfrac = span.YFrac + span.YStep * skip;
+	const dsfixed_t xstep = span.XStep;
+	const dsfixed_t ystep = span.YStep;
+	int spot;
+
+	if (span.XBits == 6 && span.YBits == 6)
+	{
+		// 64x64 is the most common case by far, so special case it.
+		do
+		{
+			spot = ((xfrac>>(32-6-6))&(63*64)) + (yfrac>>(32-6));
+			*dest++ = colormap[source[spot]];
+			xfrac += xstep;
+			yfrac += ystep;
+		} while (--count);
+	}
+	else
+	{
+		BYTE yshift = 32 - span.YBits;
+		BYTE xshift = yshift - span.XBits;
+		int xmask = ((1 << span.XBits) - 1) << span.YBits;
+
+		do
+		{
+			spot = ((xfrac >> xshift) & xmask) + (yfrac >> yshift);
+			*dest++ = colormap[source[spot]];
+			xfrac += xstep;
+			yfrac += ystep;
+		} while (--count);
+	}
+}
+
+//==========================================================================
+//
+// FDrawQueue
+//
+//==========================================================================
+
+FDrawQueue::FDrawQueue()
+	: NumQueued(0), NumBatches(0), DestOrg(NULL), Pitch(0), ViewWidth(0), StripWidth(0), NumStrips(0),
+	  CurrentBlock(0), MemoryUsed(0), NextStrip(0)
+{
+}
+
+FDrawQueue::~FDrawQueue()
+{
+	SetNumThreads(0);
+	for (unsigned int i = 0; i < MemoryBlocks.Size(); ++i)
+	{
+		delete[] MemoryBlocks[i];
+	}
+}
+
+void FDrawQueue::Begin(BYTE *destorg, int pitch, int width)
+{
+	DestOrg = destorg;
+	Pitch = pitch;
+	ViewWidth = width;
+	NumQueued = 0;
+	NumBatches = 0;
+	RunCycles.Reset();
+}
+
+FDrawerCommand &FDrawQueue::Add(BYTE type, BYTE *dest, int count)
+{
+	FDrawerCommand &cmd = Commands[Commands.Reserve(1)];
+
+	cmd.Type = type;
+	cmd.Dest = dest;
+	cmd.Count = count;
+	cmd.X = int((dest - DestOrg) % Pitch);
+	return cmd;
+}
+
+BYTE *FDrawQueue::AllocMemory(size_t size)
+{
+	assert(size <= MEMORY_BLOCK_SIZE);
+
+	size = (size + 15) & ~15;
+	if (MemoryUsed + size > MEMORY_BLOCK_SIZE)
+	{
+		CurrentBlock++;
+		MemoryUsed = 0;
+	}
+	if (CurrentBlock == MemoryBlocks.Size())
+	{
+		MemoryBlocks.Push(new BYTE[MEMORY_BLOCK_SIZE]);
+	}
+
+	BYTE *mem = MemoryBlocks[CurrentBlock] + MemoryUsed;
+	MemoryUsed += size;
+	return mem;
+}
+
+void FDrawQueue::Run()
+{
+	if (Commands.Size() == 0)
+	{
+		return;
+	}
+
+	RunCycles.Clock();
+
+	// Strips are a multiple of four columns wide, so the groups of four
+	// columns drawn by wallscan are never split.
+	NumStrips = GetNumStrips();
+	StripWidth = ((ViewWidth + NumStrips - 1) / NumStrips + 3) & ~3;
+	NextStrip = 0;
+	Pool.Run([this] (unsigned int) { DrawStrips(); });
+
+	NumQueued += Commands.Size();
+	NumBatches++;
+	Commands.Clear();
+	CurrentBlock = 0;
+	MemoryUsed = 0;
+
+	RunCycles.Unclock();
+}
+
+void FDrawQueue::DrawStrips()
+{
+	unsigned int strip;
+
+	while ((strip = NextStrip++) < NumStrips)
+	{
+		const int x1 = strip * StripWidth;
+		// The last strip takes whatever is left.
+		const int x2 = (strip == NumStrips - 1) ? MAXWIDTH : x1 + StripWidth;
+
+		DrawStrip(x1, x2);
+	}
+}
+
+void FDrawQueue::DrawStrip(int x1, int x2) const
+{
+	const int pitch = Pitch;
+
+	for (unsigned int i = 0; i < Commands.Size(); ++i)
+	{
+		const FDrawerCommand &cmd = Commands[i];
+
+		switch (cmd.Type)
+		{
+		case DC_VLine1:
+			if (cmd.X >= x1 && cmd.X < x2)
+			{
+				R_DrawQueuedColumn (cmd, 0, pitch);
+			}
+			break;
+
+		case DC_VLine4:
+			if (cmd.X >= x1 && cmd.X + 3 < x2)
+			{
+				R_DrawQueuedColumns4 (cmd, pitch);
+			}
+			else if (cmd.X + 3 >= x1 && cmd.X < x2)
+			{
+				for (int z = 0; z < 4; ++z)
+				{
+					if (cmd.X + z >= x1 && cmd.X + z < x2)
+					{
+						R_DrawQueuedColumn (cmd, z, pitch);
+					}
+				}
+			}
+			break;
+
+		case DC_Span:
+		case DC_FillSpan:
+			R_DrawQueuedSpan (cmd, x1, x2);
+			break;
+		}
+	}
+}
+
+//==========================================================================
+//
+// R_BeginDrawQueue
+//
+//==========================================================================
+
+void R_BeginDrawQueue ()
+{
+	R_EndDrawQueue ();
+
+	if (DrawQueue.GetNumThreads() > 0)
+	{
+		DrawQueue.Begin (dc_destorg, dc_pitch, viewwidth);
+		r_queuedrawers = true;
+	}
+}
+
+//==========================================================================
+//
+// R_EndDrawQueue
+//
+//==========================================================================
+
+void R_EndDrawQueue ()
+{
+	if (r_queuedrawers)
+	{
+		DrawQueue.Run ();
+		r_queuedrawers = false;
+	}
+}
+
+//==========================================================================
+//
+// R_SuspendDrawQueue
+//
+//==========================================================================
+
+bool R_SuspendDrawQueue ()
+{
+	const bool queued = r_queuedrawers;
+
+	R_EndDrawQueue ();
+	return queued;
+}
+
+//==========================================================================
+//
+// R_ResumeDrawQueue
+//
+//==========================================================================
+
+void R_ResumeDrawQueue (bool queued)
+{
+	r_queuedrawers = queued;
+}
+
+//==========================================================================
+//
+// R_QueueVLine1
+//
+//==========================================================================
+
+DWORD R_QueueVLine1 ()
+{
+	if (dc_count > 0)
+	{
+		FDrawerCommand &cmd = DrawQueue.Add (DC_VLine1, dc_dest, dc_count);
+
+		cmd.Bits = vlinebits;
+		cmd.Column.Source[0] = dc_source;
+		cmd.Column.Colormap[0] = dc_colormap;
+		cmd.Column.Frac[0] = dc_texturefrac;
+		cmd.Column.Step[0] = dc_iscale;
+	}
+	return DWORD(dc_texturefrac) + DWORD(dc_iscale) * DWORD(dc_count);
+}
+
+//==========================================================================
+//
+// R_QueueVLine4
+//
+//==========================================================================
+
+void R_QueueVLine4 ()
+{
+	if (dc_count <= 0)
+	{
+		return;
+	}
+
+	FDrawerCommand &cmd = DrawQueue.Add (DC_VLine4, dc_dest, dc_count);
+
+	cmd.Bits = vlinebits;
+	for (int z = 0; z < 4; ++z)
+	{
+		cmd.Column.Source[z] = bufplce[z];
+		cmd.Column.Colormap[z] = palookupoffse[z];
+		cmd.Column.Frac[z] = vplce[z];
+		cmd.Column.Step[z] = vince[z];
+		vplce[z] += vince[z] * dc_count;
+	}
+}
+
+//==========================================================================
+//
+// R_QueueSpan
+//
+//==========================================================================
+
+void R_QueueSpan ()
+{
+	BYTE type;
+
+	if (spanfunc == R_DrawSpan)
+	{
+		type = DC_Span;
+	}
+	else if (spanfunc == R_FillSpan)
+	{
+		type = DC_FillSpan;
+	}
+	else
+	{
+		// A masked or translucent span has to be drawn on top of what has
+		// been queued.
+		const bool queued = R_SuspendDrawQueue ();
+		spanfunc ();
+		R_ResumeDrawQueue (queued);
+		return;
+	}
+
+	FDrawerCommand &cmd = DrawQueue.Add (type, ylookup[ds_y] + ds_x1 + dc_destorg, ds_x2 - ds_x1 + 1);
+
+	cmd.Span.Source = ds_source;
+	cmd.Span.Colormap = ds_colormap;
+	cmd.Span.XFrac = ds_xfrac;
+	cmd.Span.YFrac = ds_yfrac;
+	cmd.Span.XStep = ds_xstep;
+	cmd.Span.YStep = ds_ystep;
+	cmd.Span.XBits = ds_xbits;
+	cmd.Span.YBits = ds_ybits;
+	cmd.Span.Color = ds_color;
+}
+
+//==========================================================================
+//
+// R_AllocDrawQueueMemory
+//
+//==========================================================================
+
+BYTE *R_AllocDrawQueueMemory (size_t size)
+{
+	return DrawQueue.AllocMemory (size);
+}
+
+//==========================================================================
+//
+// R_GetNumDrawStrips
+//
+//==========================================================================
+
+unsigned int R_GetNumDrawStrips ()
+{
+	return DrawQueue.GetNumStrips ();
+}
+
+ADD_STAT (drawqueue)
+{
+	FString out;
+	out.Format ("%u threads, %u strips: %u drawers queued in %u batches, drawn in %04.1f ms",
+		DrawQueue.GetNumThreads(), DrawQueue.GetNumStrips(), DrawQueue.NumQueued, DrawQueue.NumBatches,
+		DrawQueue.RunCycles.TimeMS());
+	return out;
+}
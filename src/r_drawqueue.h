@@ -0,0 +1,82 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: r_drawqueue.h
+//
+// Description: Queues the wall and flat drawers of the opaque pass and runs them in column strips on worker threads.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __R_DRAWQUEUE_H__
+#define __R_DRAWQUEUE_H__
+
+#include "doomtype.h"
+
+// True while the wall and flat drawers are queued instead of drawn right away.
+extern bool r_queuedrawers;
+
+// Starts queuing the drawers of the opaque pass if r_multithreaded is on.
+void R_BeginDrawQueue ();
+
+// Draws everything queued so far and stops queuing.
+void R_EndDrawQueue ();
+
+// Draws everything queued so far, so that the caller can draw on top of it
+// directly. Returns whether drawers were queued before, for R_ResumeDrawQueue.
+bool R_SuspendDrawQueue ();
+void R_ResumeDrawQueue (bool queued);
+
+// These take the same dc_ and ds_ variables as the drawers they stand in for.
+// R_QueueVLine1 returns the texture position after the column, like dovline1,
+// and R_QueueVLine4 advances vplce like dovline4.
+DWORD R_QueueVLine1 ();
+void R_QueueVLine4 ();
+void R_QueueSpan ();
+
+// Returns memory that stays valid until the queue has been drawn, for
+// column data that is built on the fly.
+BYTE *R_AllocDrawQueueMemory (size_t size);
+
+// Number of column strips the opaque pass is split into, 0 if it isn't.
+unsigned int R_GetNumDrawStrips ();
+
+#endif
@@ -42,6 +42,7 @@
 #include "r_plane.h"
 #include "r_bsp.h"
 #include "r_3dfloors.h"
+#include "r_drawqueue.h"
 #include "r_sky.h"
 #include "st_stuff.h"
 #include "c_cvars.h"
@@ -171,6 +172,10 @@ void (STACK_ARGS *hcolfunc_post4) (int sx, int yl, int yh);
 
 cycle_t WallCycles, PlaneCycles, MaskedCycles, WallScanCycles;
 
+// The total time spent in R_RenderActorView, for the -timedemo report.
+static cycle_t ViewCycles;
+static unsigned int NumViews;
+
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
 static int lastcenteryfrac;
@@ -782,6 +787,7 @@ void R_SetupBuffer ()
 
 void R_RenderActorView (AActor *actor, bool dontmaplines)
 {
+	ViewCycles.Clock();
 	WallCycles.Reset();
 	PlaneCycles.Reset();
 	MaskedCycles.Reset();
@@ -799,6 +805,10 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 	R_ClearPlanes (true);
 	R_ClearSprites ();
 
+	// With r_multithreaded, the walls and flats are drawn in column strips
+	// on several threads once the masked things are about to be drawn.
+	R_BeginDrawQueue ();
+
 	NetUpdate ();
 
 	// [RH] Show off segs if r_drawflat is 1
@@ -866,7 +876,9 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 		}
 
 		NetUpdate ();
-		
+
+		R_EndDrawQueue ();
+
 		MaskedCycles.Clock();
 		R_DrawMasked ();
 		MaskedCycles.Unclock();
@@ -883,6 +895,7 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 			}
 		}
 	}
+	R_EndDrawQueue ();
 	WallMirrors.Clear ();
 	interpolator.RestoreInterpolations ();
 	R_SetupBuffer ();
@@ -893,6 +906,39 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 	{
 		realfixedcolormap = NULL;
 	}
+
+	NumViews++;
+	ViewCycles.Unclock();
+}
+
+//==========================================================================
+//
+// R_GetViewTimingReport
+//
+// Describes how long the software renderer took per view, so that
+// -timedemo runs with and without r_multithreaded can be compared.
+//
+//==========================================================================
+
+FString R_GetViewTimingReport ()
+{
+	FString out;
+
+	if (NumViews > 0)
+	{
+		const unsigned int strips = R_GetNumDrawStrips ();
+
+		out.Format ("%u views rendered in %.2f ms each, ", NumViews, ViewCycles.TimeMS() / NumViews);
+		if (strips > 0)
+		{
+			out.AppendFormat ("walls and flats in %u column strips\n", strips);
+		}
+		else
+		{
+			out += "single-threaded\n";
+		}
+	}
+	return out;
 }
 
 //==========================================================================
@@ -134,6 +134,9 @@ void R_SetupBuffer ();
 
 void R_RenderViewToCanvas (AActor *actor, DCanvas *canvas, int x, int y, int width, int height, bool dontmaplines = false);
 
+// Returns the average time R_RenderActorView took, for the -timedemo report.
+FString R_GetViewTimingReport ();
+
 // [RH] Initialize multires stuff for renderer
 void R_MultiresInit (void);
 
@@ -60,6 +60,7 @@
 #include "r_plane.h"
 #include "r_segs.h"
 #include "r_3dfloors.h"
+#include "r_drawqueue.h"
 #include "v_palette.h"
 #include "r_data/colormaps.h"
 // [BC] New #includes.
@@ -244,7 +245,14 @@ void R_MapPlane (int y, int x1)
 	ds_x1 = x1;
 	ds_x2 = x2;
 
-	spanfunc ();
+	if (r_queuedrawers)
+	{
+		R_QueueSpan ();
+	}
+	else
+	{
+		spanfunc ();
+	}
 }
 
 //==========================================================================
@@ -868,7 +876,10 @@ extern FTexture *rw_pic;
 // Allow for layer skies up to 512 pixels tall. This is overkill,
 // since the most anyone can ever see of the sky is 500 pixels.
 // We need 4 skybufs because wallscan can draw up to 4 columns at a time.
+// Queued columns are drawn later, so their skybufs are allocated from the
+// draw queue instead.
 static BYTE skybuf[4][512];
+static BYTE *skycols[4];
 static DWORD lastskycol[4];
 static int skycolplace;
 
@@ -895,12 +906,13 @@ static const BYTE *R_GetTwoSkyColumns (FTexture *fronttex, int x)
 	{
 		if (lastskycol[i] == skycol)
 		{
-			return skybuf[i];
+			return skycols[i];
 		}
 	}
 
+	BYTE *composite = r_queuedrawers ? R_AllocDrawQueueMemory (512) : skybuf[skycolplace];
 	lastskycol[skycolplace] = skycol;
-	BYTE *composite = skybuf[skycolplace];
+	skycols[skycolplace] = composite;
 	skycolplace = (skycolplace + 1) & 3;
 
 	// The ordering of the following code has been tuned to allow VC++ to optimize
@@ -1727,6 +1739,9 @@ void R_DrawTiltedPlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 		}
 	}
 
+	// Sloped planes aren't queued. Opaque ones don't overlap anything that
+	// is, but the others have to be drawn on top of it.
+	const bool queued = (alpha < OPAQUE || additive || masked) ? R_SuspendDrawQueue () : r_queuedrawers;
 #if defined(X86_ASM)
 	if (ds_source != ds_curtiltedsource)
 		R_SetTiltedSpanSource_ASM (ds_source);
@@ -1734,6 +1749,7 @@ void R_DrawTiltedPlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 #else
 	R_MapVisPlane (pl, R_MapTiltedPlane);
 #endif
+	R_ResumeDrawQueue (queued);
 }
 
 //==========================================================================
@@ -50,6 +50,7 @@
 #include "r_plane.h"
 #include "r_segs.h"
 #include "r_3dfloors.h"
+#include "r_drawqueue.h"
 #include "v_palette.h"
 #include "r_data/colormaps.h"
 
@@ -1048,7 +1049,32 @@ inline fixed_t prevline1 (fixed_t vince, BYTE *colormap, int count, fixed_t vplc
 	dc_texturefrac = vplce;
 	dc_source = bufplce;
 	dc_dest = dest;
-	return doprevline1 ();
+	return r_queuedrawers ? R_QueueVLine1 () : doprevline1 ();
+}
+
+// While the opaque pass is queued, wallscan's columns are queued, too.
+inline void vline1 ()
+{
+	if (r_queuedrawers)
+	{
+		R_QueueVLine1 ();
+	}
+	else
+	{
+		dovline1 ();
+	}
+}
+
+inline void vline4 ()
+{
+	if (r_queuedrawers)
+	{
+		R_QueueVLine4 ();
+	}
+	else
+	{
+		dovline4 ();
+	}
 }
 
 void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t *lwal,
@@ -1114,7 +1140,7 @@ void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t
 		dc_count = y2ve[0] - y1ve[0];
 		dc_texturefrac = texturemid + FixedMul (dc_iscale, (y1ve[0]<<FRACBITS)-centeryfrac+FRACUNIT);
 
-		dovline1();
+		vline1();
 	}
 
 	for(; x <= x2-3; x += 4)
@@ -1175,7 +1201,7 @@ void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t
 		{
 			dc_count = d4-u4;
 			dc_dest = ylookup[u4]+x+dc_destorg;
-			dovline4();
+			vline4();
 		}
 
 		BYTE *i = x+ylookup[d4]+dc_destorg;
@@ -1207,7 +1233,7 @@ void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t
 		dc_count = y2ve[0] - y1ve[0];
 		dc_texturefrac = texturemid + FixedMul (dc_iscale, (y1ve[0]<<FRACBITS)-centeryfrac+FRACUNIT);
 
-		dovline1();
+		vline1();
 	}
 
 //unclock (WallScanCycles);
@@ -2600,9 +2626,15 @@ void R_StoreWallRange (int start, int stop)
 	}
 
 	// [RH] Draw any decals bound to the seg
-	for (DBaseDecal *decal = curline->sidedef->AttachedDecals; decal != NULL; decal = decal->WallNext)
+	if (curline->sidedef->AttachedDecals != NULL)
 	{
-		R_RenderDecal (curline->sidedef, decal, ds_p, 0);
+		// Decals go on top of the wall, so it has to be drawn first.
+		const bool queued = R_SuspendDrawQueue ();
+		for (DBaseDecal *decal = curline->sidedef->AttachedDecals; decal != NULL; decal = decal->WallNext)
+		{
+			R_RenderDecal (curline->sidedef, decal, ds_p, 0);
+		}
+		R_ResumeDrawQueue (queued);
 	}
 
 	ds_p++;
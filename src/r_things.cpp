@@ -57,6 +57,7 @@
 #include "r_plane.h"
 #include "r_segs.h"
 #include "r_3dfloors.h"
+#include "r_drawqueue.h"
 #include "v_palette.h"
 #include "r_data/r_translate.h"
 #include "r_data/colormaps.h"
@@ -2030,6 +2031,9 @@ void R_DrawHeightPlanes(fixed_t height); // kg3D - fake planes
 
 void R_DrawMasked (void)
 {
+	// Masked things are drawn on top of the queued walls and flats.
+	const bool queued = R_SuspendDrawQueue ();
+
 	R_SortVisSprites (DrewAVoxel ? sv_compare2d : sv_compare, firstvissprite - vissprites);
 
 	if (height_top == NULL)
@@ -2081,6 +2085,8 @@ void R_DrawMasked (void)
 		fake3D = 0;
 	}
 	R_DrawPlayerSprites ();
+
+	R_ResumeDrawQueue (queued);
 }
 
 
@@ -78,6 +78,8 @@
 #include "po_man.h"
 #include "i_system.h"
 #include "r_data/colormaps.h"
+#include "network/playermovement.h"
+#include "sv_relevance.h"
 #include "network_enums.h"
 #include "decallib.h"
 #include "network/netcommand.h"
@@ -86,6 +88,7 @@
 CVAR (Bool, sv_showwarnings, false, CVAR_GLOBALCONFIG|CVAR_ARCHIVE)
 
 EXTERN_CVAR( Float, sv_aircontrol )
+EXTERN_CVAR( Bool, sv_deltaplayermovement )
 
 //*****************************************************************************
 class AdminClientIterator : public ClientIterator
@@ -200,6 +203,48 @@ void CheckPositionReuse( AActor *pActor, ULONG &ulBits )
 		ulBits |= CM_REUSE_Z;
 	}
 }
+//*****************************************************************************
+//
+// Sends an update of the actor's position or angle only to the clients the actor is
+// relevant for. For the others, the update is deferred till the actor becomes relevant.
+static void SendToRelevantClients( ServerCommands::BaseServerCommand &command, AActor *pActor, ULONG ulPlayerExtra, ServerCommandFlags flags )
+{
+	if (( SERVERRELEVANCE_IsEnabled( ) == false ) || ( flags & SVCF_ONLYTHISCLIENT ))
+	{
+		command.sendCommandToClients( ulPlayerExtra, flags );
+		return;
+	}
+
+	bool bAllRelevant = true;
+	bool abRelevant[MAXPLAYERS];
+
+	for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
+	{
+		abRelevant[*it] = SERVERRELEVANCE_IsActorRelevant( *it, pActor );
+		if ( abRelevant[*it] == false )
+			bAllRelevant = false;
+		// The client has to know everything the following update may refer to.
+		else if ( SERVERRELEVANCE_HasDeferredUpdate( *it, pActor ))
+			SERVERRELEVANCE_SendDeferredUpdate( *it, pActor );
+	}
+
+	if ( bAllRelevant )
+	{
+		command.sendCommandToClients( ulPlayerExtra, flags );
+		return;
+	}
+
+	// Encode the command only once for all relevant clients.
+	NetCommand netCommand = command.BuildNetCommand();
+	for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
+	{
+		if ( abRelevant[*it] )
+			netCommand.sendCommandToOneClient( *it );
+		else
+			SERVERRELEVANCE_DeferUpdate( *it, pActor );
+	}
+}
+
 //*****************************************************************************
 //
 void SERVERCOMMANDS_Ping( ULONG ulTime )
@@ -286,34 +331,93 @@ void SERVERCOMMANDS_MovePlayer( ULONG ulPlayer, ULONG ulPlayerExtra, ServerComma
 	if ( PLAYER_IsValidPlayerWithMo( ulPlayer ) == false )
 		return;
 
+	PlayerMovementCycles.Clock();
+
 	// [BB] Check if ulPlayer is pressing any attack buttons.
 	if ( players[ulPlayer].cmd.ucmd.buttons & BT_ATTACK )
 		ulPlayerAttackFlags |= PLAYER_ATTACK;
 	if ( players[ulPlayer].cmd.ucmd.buttons & BT_ALTATTACK )
 		ulPlayerAttackFlags |= PLAYER_ALTATTACK;
 
+	const AActor *pMo = players[ulPlayer].mo;
+	PlayerMovementState state;
+	state.Set( pMo->x, pMo->y, pMo->z, pMo->angle, pMo->velx, pMo->vely, pMo->velz, ( players[ulPlayer].crouchdir >= 0 ));
+
 	ServerCommands::MovePlayer fullCommand;
 	fullCommand.SetPlayer ( &players[ulPlayer] );
 	fullCommand.SetFlags( ulPlayerAttackFlags | PLAYER_VISIBLE );
-	fullCommand.SetX( players[ulPlayer].mo->x );
-	fullCommand.SetY( players[ulPlayer].mo->y );
-	fullCommand.SetZ( players[ulPlayer].mo->z );
-	fullCommand.SetAngle( players[ulPlayer].mo->angle );
-	fullCommand.SetVelx( players[ulPlayer].mo->velx );
-	fullCommand.SetVely( players[ulPlayer].mo->vely );
-	fullCommand.SetVelz( players[ulPlayer].mo->velz );
-	fullCommand.SetIsCrouching(( players[ulPlayer].crouchdir >= 0 ) ? true : false );
+	fullCommand.SetX( state.x );
+	fullCommand.SetY( state.y );
+	fullCommand.SetZ( state.z );
+	fullCommand.SetAngle( state.angle );
+	fullCommand.SetVelx( state.velx );
+	fullCommand.SetVely( state.vely );
+	fullCommand.SetVelz( state.velz );
+	fullCommand.SetIsCrouching( state.isCrouching );
 
 	ServerCommands::MovePlayer stubCommand = fullCommand;
 	stubCommand.SetFlags( ulPlayerAttackFlags );
 
+	// The fields of the delta command that depend on the client are set below.
+	ServerCommands::MovePlayerDelta deltaCommand;
+	deltaCommand.SetPlayer ( &players[ulPlayer] );
+	deltaCommand.SetFlags( ulPlayerAttackFlags | PLAYER_VISIBLE );
+	deltaCommand.SetX( state.x );
+	deltaCommand.SetY( state.y );
+	deltaCommand.SetZ( state.z );
+	deltaCommand.SetAngle( state.angle );
+	deltaCommand.SetVelx( state.velx );
+	deltaCommand.SetVely( state.vely );
+	deltaCommand.SetVelz( state.velz );
+
+	// The full and the stub update are the same for every client, so encode them only once.
+	NetCommand fullNetCommand = fullCommand.BuildNetCommand();
+	NetCommand stubNetCommand = stubCommand.BuildNetCommand();
+	const int fullSize = fullNetCommand.calcSize();
+
 	for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
 	{
-		if ( SERVER_IsPlayerVisible( *it, ulPlayer ))
-			fullCommand.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+		if ( SERVER_IsPlayerVisible( *it, ulPlayer ) == false )
+		{
+			stubNetCommand.sendCommandToOneClient( *it );
+			continue;
+		}
+
+		CLIENT_s *pClient = SERVER_GetClient( *it );
+
+		// Send only what changed since the last movement the client confirmed to have received.
+		const PlayerMovementState *pBaseline = NULL;
+		if ( sv_deltaplayermovement && (( gametic - pClient->lLastAckedMovementTic ) < PLAYER_MOVEMENT_HISTORY_SIZE ))
+			pBaseline = pClient->MovementHistory.Find( ulPlayer, pClient->lLastAckedMovementTic );
+
+		if ( pBaseline )
+		{
+			deltaCommand.SetBaselineAge( gametic - pClient->lLastAckedMovementTic );
+			deltaCommand.SetFields( state.GetChangedFields( *pBaseline ) | ( state.isCrouching ? PLAYERMOVE_CROUCHING : 0 ));
+			NetCommand deltaNetCommand = deltaCommand.BuildNetCommand();
+			PLAYERMOVEMENT_AddDeltaUpdate( deltaNetCommand.calcSize(), fullSize );
+			deltaNetCommand.sendCommandToOneClient( *it );
+		}
 		else
-			stubCommand.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+		{
+			PLAYERMOVEMENT_AddFullUpdate( fullSize );
+			fullNetCommand.sendCommandToOneClient( *it );
+		}
+
+		if ( sv_deltaplayermovement )
+			pClient->MovementHistory.Store( ulPlayer, gametic, state );
 	}
+
+	PlayerMovementCycles.Unclock();
+}
+
+//*****************************************************************************
+//
+void SERVERCOMMANDS_PlayerMovementTic( ULONG ulPlayerExtra, ServerCommandFlags flags )
+{
+	ServerCommands::PlayerMovementTic command;
+	command.SetTic( gametic );
+	command.sendCommandToClients( ulPlayerExtra, flags );
 }
 
 //*****************************************************************************
@@ -344,12 +448,13 @@ void SERVERCOMMANDS_DamagePlayer( ULONG ulPlayer )
 	fullCommand.SetArmor( ulArmorPoints );
 	fullCommand.SetAttacker( players[ulPlayer].attacker );
 
+	NetCommand netCommand = fullCommand.BuildNetCommand();
 	for ( ClientIterator it; it.notAtEnd(); ++it )
 	{
 		// [EP] Send the updated health and armor of the player who's being damaged to this client
 		// only if this client is allowed to know.
 		if ( SERVER_IsPlayerAllowedToKnowHealth( *it, ulPlayer ))
-			fullCommand.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+			netCommand.sendCommandToOneClient( *it );
 	}
 }
 
@@ -402,10 +507,11 @@ void SERVERCOMMANDS_SetPlayerHealth( ULONG ulPlayer, ULONG ulPlayerExtra, Server
 	command.SetPlayer( &players[ulPlayer] );
 	command.SetHealth( players[ulPlayer].health );
 
+	NetCommand netCommand = command.BuildNetCommand();
 	for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
 	{
 		if ( SERVER_IsPlayerAllowedToKnowHealth( *it, ulPlayer ))
-			command.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+			netCommand.sendCommandToOneClient( *it );
 	}
 }
 
@@ -426,10 +532,11 @@ void SERVERCOMMANDS_SetPlayerArmor( ULONG ulPlayer, ULONG ulPlayerExtra, ServerC
 	command.SetArmorAmount( pArmor->Amount );
 	command.SetArmorIcon( pArmor->Icon.isValid() ? TexMan( pArmor->Icon )->Name : "" );
 
+	NetCommand netCommand = command.BuildNetCommand();
 	for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
 	{
 		if ( SERVER_IsPlayerAllowedToKnowHealth( *it, ulPlayer ))
-			command.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+			netCommand.sendCommandToOneClient( *it );
 	}
 }
 
@@ -1019,6 +1126,7 @@ void SERVERCOMMANDS_PlayerSay( ULONG ulPlayer, const char *pszString, ULONG ulMo
 	command.SetMode( ulMode );
 	command.SetMessage( pszString );
 
+	NetCommand netCommand = command.BuildNetCommand();
 	for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
 	{
 		// Don't allow the chat message to be broadcasted to this player.
@@ -1044,7 +1152,7 @@ void SERVERCOMMANDS_PlayerSay( ULONG ulPlayer, const char *pszString, ULONG ulMo
 				continue;
 		}
 
-		command.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+		netCommand.sendCommandToOneClient( *it );
 	}
 }
 
@@ -1324,7 +1432,7 @@ void SERVERCOMMANDS_MoveThing( AActor *actor, ULONG bits, ULONG ulPlayerExtra, S
 	command.SetVelZ( actor->velz );
 	command.SetPitch( actor->pitch );
 	command.SetMovedir( actor->movedir );
-	command.sendCommandToClients( ulPlayerExtra, flags );
+	SendToRelevantClients( command, actor, ulPlayerExtra, flags );
 
 	// [BB] Only mark something as updated, if it the update was sent to all players.
 	if ( flags == 0 )
@@ -1366,7 +1474,7 @@ void SERVERCOMMANDS_MoveThingExact( AActor *actor, ULONG bits, ULONG ulPlayerExt
 	command.SetVelZ( actor->velz );
 	command.SetPitch( actor->pitch );
 	command.SetMovedir( actor->movedir );
-	command.sendCommandToClients( ulPlayerExtra, flags );
+	SendToRelevantClients( command, actor, ulPlayerExtra, flags );
 
 	// [BB] Only mark something as updated, if it the update was sent to all players.
 	if ( flags == 0 )
@@ -1437,7 +1545,7 @@ void SERVERCOMMANDS_SetThingAngle( AActor *pActor, ULONG ulPlayerExtra, ServerCo
 	ServerCommands::SetThingAngle command;
 	command.SetActor( pActor );
 	command.SetAngle( pActor->angle );
-	command.sendCommandToClients( ulPlayerExtra, flags );
+	SendToRelevantClients( command, pActor, ulPlayerExtra, flags );
 }
 
 //*****************************************************************************
@@ -1450,7 +1558,7 @@ void SERVERCOMMANDS_SetThingAngleExact( AActor *pActor, ULONG ulPlayerExtra, Ser
 	ServerCommands::SetThingAngleExact command;
 	command.SetActor( pActor );
 	command.SetAngle( pActor->angle );
-	command.sendCommandToClients( ulPlayerExtra, flags );
+	SendToRelevantClients( command, pActor, ulPlayerExtra, flags );
 }
 
 //*****************************************************************************
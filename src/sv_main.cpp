@@ -110,6 +110,7 @@
 #include "sv_commands.h"
 #include "sv_save.h"
 #include "sv_rcon.h"
+#include "sv_relevance.h"
 #include "gamemode.h"
 #include "domination.h"
 #include "a_movingcamera.h"
@@ -123,6 +124,7 @@
 #include "d_protocol.h"
 #include "p_enemy.h"
 #include "network/packetarchive.h"
+#include "network/netcommand.h"
 #include "p_lnspec.h"
 #include "unlagged.h"
 
@@ -237,6 +239,14 @@ static	int			g_MapMusicOrder;
 // Maximum packet size.
 static	ULONG		g_ulMaxPacketSize = 0;
 
+// Time spent in the individual parts of the last SERVER_Tick call (see "stat servertic").
+static	cycle_t		g_PacketIntakeCycles;
+static	cycle_t		g_TickerCycles;
+static	cycle_t		g_WriteCommandsCycles;
+static	cycle_t		g_SendOutPacketsCycles;
+static	cycle_t		g_IdleCycles;
+static	LONG		g_lTicsLastServerTick = 0;
+
 // List of all translations edited by level scripts.
 static	TArray<EDITEDTRANSLATION_s>		g_EditedTranslationList;
 
@@ -281,6 +291,18 @@ CVAR( Int, sv_afk2spec, 0, CVAR_ARCHIVE | CVAR_SERVERINFO ) // [K6]
 CVAR( Bool, sv_forcelogintojoin, false, CVAR_ARCHIVE|CVAR_NOSETBYACS )
 CVAR( Bool, sv_useticbuffer, true, CVAR_ARCHIVE|CVAR_NOSETBYACS|CVAR_DEBUGONLY )
 
+// If enabled, the server blocks on its socket until either a packet arrives or the
+// next tic is due, instead of polling the socket once per millisecond.
+CVAR( Bool, sv_waitforpackets, false, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// If enabled, the packets sent to the clients during a tic are collected and sent
+// with as few system calls as possible (only has an effect where sendmmsg is available).
+CVAR( Bool, sv_batchpackets, true, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// If enabled, the player movement is only sent as difference to the last movement
+// the client confirmed to have received.
+CVAR( Bool, sv_deltaplayermovement, true, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
 CUSTOM_CVAR( String, sv_adminlistfile, "adminlist.txt", CVAR_ARCHIVE|CVAR_SENSITIVESERVERSETTING|CVAR_NOSETBYACS )
 {
 	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
@@ -555,25 +577,48 @@ void SERVER_Tick( void )
 	LONG			lPreviousTics;
 	LONG			lCurTics;
 	ULONG			ulIdx;
+	const double	dMSPerTic = ( 1.0 / (double)35.75 ) * 1000.0;
+
+	g_PacketIntakeCycles.Reset( );
+	g_TickerCycles.Reset( );
+	g_WriteCommandsCycles.Reset( );
+	g_SendOutPacketsCycles.Reset( );
+	g_IdleCycles.Reset( );
 
-	I_DoSelect();
-	lPreviousTics = static_cast<LONG> ( g_lGameTime / (( 1.0 / (double)35.75 ) * 1000.0 ) );
+	// In the event driven mode, NETWORK_WaitForPackets takes care of the console input.
+	if ( sv_waitforpackets == false )
+		I_DoSelect();
+	lPreviousTics = static_cast<LONG> ( g_lGameTime / dMSPerTic );
 
 	lNowTime = I_MSTime( );
-	lNewTics = static_cast<LONG> ( lNowTime / (( 1.0 / (double)35.75 ) * 1000.0 ) );
+	lNewTics = static_cast<LONG> ( lNowTime / dMSPerTic );
 
 	lCurTics = lNewTics - lPreviousTics;
 	while ( lCurTics <= 0 )
 	{
 		// [BB] Recieve packets whenever possible (not only once each tic) to allow
 		// for an accurate ping measurement.
+		g_PacketIntakeCycles.Clock( );
 		SERVER_GetPackets( );
+		g_PacketIntakeCycles.Unclock( );
+
+		g_IdleCycles.Clock( );
+		if ( sv_waitforpackets )
+		{
+			// Sleep until either a packet arrives or the next tic is due, so that
+			// packets are processed the moment they arrive.
+			const LONG lNextTicTime = static_cast<LONG> ( ceil ( ( lPreviousTics + 1 ) * dMSPerTic ) );
+			NETWORK_WaitForPackets( lNextTicTime - static_cast<LONG> ( I_MSTime( ) ) );
+		}
+		else
+			I_Sleep( 1 );
+		g_IdleCycles.Unclock( );
 
-		I_Sleep( 1 );
 		lNowTime = I_MSTime( );
-		lNewTics = static_cast<LONG> ( lNowTime / (( 1.0 / (double)35.75 ) * 1000.0 ) );
+		lNewTics = static_cast<LONG> ( lNowTime / dMSPerTic );
 		lCurTics = lNewTics - lPreviousTics;
 	}
+	g_lTicsLastServerTick = lCurTics;
 
 #ifdef NO_SERVER_GUI
 	// console input
@@ -593,13 +638,17 @@ void SERVER_Tick( void )
 		//DObject::BeginFrame ();
 
 		// Recieve packets.
+		g_PacketIntakeCycles.Clock( );
 		SERVER_GetPackets( );
+		g_PacketIntakeCycles.Unclock( );
 
 		// We have to record player positions before their mobj moves.
 		// [BB] Tick the unlagged module.
 		UNLAGGED_Tick( );
 
+		g_TickerCycles.Clock( );
 		G_Ticker ();
+		g_TickerCycles.Unclock( );
 
 		// However we need to spawn the unlagged debug actors here i.e. after having processed their
 		// movement commands which updated their last server gametic.
@@ -640,14 +689,22 @@ void SERVER_Tick( void )
 			}
 		}
 
+		// Collect the packets sent from here on and send them all at once below.
+		if ( sv_batchpackets )
+			NETWORK_BeginPacketBatch( );
+
 		// Drop anyone who's been disconnected.
 		SERVER_CheckTimeouts( );
 
 		// Send out player's true position, etc.
+		g_WriteCommandsCycles.Clock( );
 		SERVER_WriteCommands( );
+		g_WriteCommandsCycles.Unclock( );
 
 		// Check everyone's PacketBuffer for anything that needs to be sent.
+		g_SendOutPacketsCycles.Clock( );
 		SERVER_SendOutPackets( );
+		g_SendOutPacketsCycles.Unclock( );
 
 		// [BB] Send out sheduled packets, respecting sv_maxpacketspertick.
 		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
@@ -658,6 +715,10 @@ void SERVER_Tick( void )
 			SERVER_GetClient ( ulIdx )->SavedPackets.Tick ( );
 		}
 
+		g_SendOutPacketsCycles.Clock( );
+		NETWORK_FlushPacketBatch( );
+		g_SendOutPacketsCycles.Unclock( );
+
 		// Potentially send an update to the master server.
 		SERVER_MASTER_Tick( );
 
@@ -1238,6 +1299,7 @@ void SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream )
 
 	// This player is now in the game.
 	playeringame[g_lCurrentClient] = true;
+	SERVER_MASTER_InvalidateServerInfo( 1 << QUERYRESPONSESEGMENT_PLAYERS );
 
 	// [BB] If necessary, spawn a voodoo doll for the player.
 	if ( COOP_PlayersVoodooDollsNeedToBeSpawned ( g_lCurrentClient ) )
@@ -1879,6 +1941,9 @@ void SERVER_SetupNewConnection( BYTESTREAM_s *pByteStream, bool bNewPlayer )
 	// [CK] Since the client is not up to date at all, the farthest the client
 	// should be able to go back is the gametic they connected with.
 	g_aClients[lClient].lLastServerGametic = gametic;
+	g_aClients[lClient].MovementHistory.Clear();
+	g_aClients[lClient].lLastAckedMovementTic = -1;
+	SERVERRELEVANCE_ClearClient( lClient );
 
 	SERVER_InitClientSRPData ( lClient );
 
@@ -2638,10 +2703,43 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 	SERVER_GetClient ( ulClient )->bFullUpdateIncomplete = true;
 }
 
+//*****************************************************************************
+//
+// Makes sure that the next movement update isn't split from the PlayerMovementTic
+// command it belongs to by a premature packet launch. Returns true if the movement
+// of the current tic is spread over more than one packet.
+//
+static bool server_PrepareMovementUpdate( ULONG ulClient )
+{
+	// The delta command with all fields set is the largest movement update.
+	const ULONG ulMaxMovementUpdateSize = 25;
+
+	CLIENT_s *pClient = SERVER_GetClient( ulClient );
+	if ( pClient == NULL )
+		return false;
+
+	SERVER_CheckClientBuffer( ulClient, ulMaxMovementUpdateSize, false );
+
+	// The buffer was launched, so start the new packet with the tic again.
+	if ( pClient->UnreliablePacketBuffer.CalcSize( ) == 0 )
+	{
+		SERVERCOMMANDS_PlayerMovementTic( ulClient, SVCF_ONLYTHISCLIENT );
+		return true;
+	}
+
+	return false;
+}
+
 //*****************************************************************************
 //
 void SERVER_WriteCommands( void )
 {
+	PLAYERMOVEMENT_BeginTic( );
+	NETCOMMAND_BeginTic( );
+
+	// Bring the clients up to date with the actors that became relevant for them.
+	SERVERRELEVANCE_Tick( );
+
 	// Ping clients and stuff.
 	SERVER_SendHeartBeat( );
 
@@ -2680,6 +2778,12 @@ void SERVER_WriteCommands( void )
 		// [BB] Only necessary if we are in a level.
 		if ( gamestate == GS_LEVEL )
 		{
+			bool bMovementSplit = false;
+
+			// Tell the client which tic the following movement belongs to.
+			if ( sv_deltaplayermovement )
+				SERVERCOMMANDS_PlayerMovementTic( ulIdx, SVCF_ONLYTHISCLIENT );
+
 			for ( ULONG ulPlayer = 0; ulPlayer < MAXPLAYERS; ulPlayer++ )
 			{
 				if ( ( playeringame[ulPlayer] == false ) || players[ulPlayer].bSpectating )
@@ -2689,8 +2793,20 @@ void SERVER_WriteCommands( void )
 				if ( ulPlayer == ulIdx )
 					continue;
 
+				// Players the client can't see are updated less often.
+				if ( SERVERRELEVANCE_ShouldUpdatePlayer( ulIdx, ulPlayer ) == false )
+					continue;
+
+				if ( sv_deltaplayermovement )
+					bMovementSplit |= server_PrepareMovementUpdate( ulIdx );
+
 				SERVERCOMMANDS_MovePlayer( ulPlayer, ulIdx, SVCF_ONLYTHISCLIENT );
 			}
+
+			// If the movement didn't fit into a single packet, the client may only receive a part
+			// of it and still acknowledge the tic. So this tic can't be used as baseline.
+			if ( bMovementSplit )
+				g_aClients[ulIdx].MovementHistory.InvalidateTic( gametic );
 		}
 
 		// Spectators can move around freely, without us telling it what to do (lag-less).
@@ -2880,6 +2996,7 @@ void SERVER_DisconnectClient( ULONG ulClient, bool bBroadcast, bool bSaveInfo )
 	g_aClients[ulClient].State = CLS_FREE;
 	g_aClients[ulClient].ulLastGameTic = 0;
 	playeringame[ulClient] = false;
+	SERVER_MASTER_InvalidateServerInfo( 1 << QUERYRESPONSESEGMENT_PLAYERS );
 
 	// Run the disconnect scripts now that the player is leaving.
 	if (( players[ulClient].bSpectating == false ) ||
@@ -5052,6 +5169,11 @@ ClientMoveCommand::ClientMoveCommand ( BYTESTREAM_s *pByteStream )
 	// when processing the command.
 	moveCmd.ulServerGametic = NETWORK_ReadLong( pByteStream );
 
+	// Read in the last tic of which the client received all player movement. It's sent
+	// relative to the server gametic above, 255 means none.
+	const ULONG ulMovementTicAge = NETWORK_ReadByte( pByteStream );
+	moveCmd.lAckedMovementTic = ( ulMovementTicAge == 255 ) ? -1 : static_cast<LONG>( moveCmd.ulServerGametic - ulMovementTicAge );
+
 	// Read in the information the client is sending us.
 	const ULONG ulBits = NETWORK_ReadByte( pByteStream );
 
@@ -5120,6 +5242,10 @@ bool ClientMoveCommand::process( const ULONG ulClient ) const
 	if ( ( moveCmd.ulServerGametic <= unsigned ( gametic ) ) && ( unsigned ( g_aClients[ulClient].lLastServerGametic ) < moveCmd.ulServerGametic ) )
 		g_aClients[ulClient].lLastServerGametic = moveCmd.ulServerGametic; // [CK] Use the gametic from what we saw
 
+	// The same goes for the acknowledged player movement.
+	if ( ( moveCmd.lAckedMovementTic <= gametic ) && ( g_aClients[ulClient].lLastAckedMovementTic < moveCmd.lAckedMovementTic ) )
+		g_aClients[ulClient].lLastAckedMovementTic = moveCmd.lAckedMovementTic;
+
 	// If the client is attacking, he always sends the name of the weapon he's using.
 	if ( pCmd->ucmd.buttons & BT_ATTACK )
 	{
@@ -6871,6 +6997,27 @@ CCMD( trytocrashclient )
 }
 #endif	// _DEBUG
 
+//*****************************************************************************
+//	STATISTICS
+
+ADD_STAT( servertic )
+{
+	FString	Out;
+
+	Out.Format( "Intake = %04.1f ms, Ticker = %04.1f ms, WriteCommands = %04.1f ms, SendOutPackets = %04.1f ms, Idle = %04.1f ms (%d tic%s, %s)",
+		g_PacketIntakeCycles.TimeMS(),
+		g_TickerCycles.TimeMS(),
+		g_WriteCommandsCycles.TimeMS(),
+		g_SendOutPacketsCycles.TimeMS(),
+		g_IdleCycles.TimeMS(),
+		static_cast<int> (g_lTicsLastServerTick),
+		g_lTicsLastServerTick == 1 ? "" : "s",
+		sv_waitforpackets ? "waiting" : "polling"
+		);
+
+	return ( Out );
+}
+
 #ifdef CREATE_PACKET_LOG
 
 //*****************************************************************************
@@ -58,6 +58,7 @@
 #include "s_sndseq.h"
 #include "r_data/sprites.h"
 #include "network/packetarchive.h"
+#include "network/playermovement.h"
 #include <list>
 #include <queue>
 
@@ -140,6 +141,24 @@
 
 #define	MAX_STORED_QUERY_IPS		512
 
+//*****************************************************************************
+// Parts of the launcher response that are cached separately.
+enum
+{
+	// Server name, map, settings and limits.
+	QUERYRESPONSESEGMENT_SETTINGS,
+
+	// Player list, team damage and team information.
+	QUERYRESPONSESEGMENT_PLAYERS,
+
+	// Testing server, dmflags, security settings, optional wads and DeHackEd patches.
+	QUERYRESPONSESEGMENT_EXTENDED,
+
+	NUM_QUERYRESPONSESEGMENTS
+};
+
+#define	QUERYRESPONSESEGMENT_ALL	(( 1 << NUM_QUERYRESPONSESEGMENTS ) - 1 )
+
 //*****************************************************************************
 enum CLIENTSTATE_e
 {
@@ -188,6 +207,9 @@ struct CLIENT_MOVE_COMMAND_s
 	ULONG				ulGametic;
 	ULONG			ulServerGametic;
 
+	// The last server tic of which the client received all player movement, -1 if none.
+	LONG			lAckedMovementTic;
+
 	// [BB] We want to process the command from the lowest gametic first.
 	// This puts the lowest gametic on top of the queue. 
 	bool operator<(const CLIENT_MOVE_COMMAND_s& other) const {
@@ -339,6 +361,13 @@ struct CLIENT_s
 	// [CK] The client communicates back to us with the last gametic from the server it saw
 	LONG			lLastServerGametic;
 
+	// The player movement we sent to this client during the last tics. Used as baseline
+	// to delta compress the movement updates.
+	PlayerMovementHistory	MovementHistory;
+
+	// The last tic of which the client confirmed to have received all player movement, -1 if none.
+	LONG			lLastAckedMovementTic;
+
 	// [TP] The size of this client's screen, for ACS.
 	WORD			ScreenWidth;
 	WORD			ScreenHeight;
@@ -484,6 +513,7 @@ void		SERVER_MASTER_Destruct( void );
 void		SERVER_MASTER_Tick( void );
 void		SERVER_MASTER_Broadcast( void );
 void		SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ulTime, bool bBroadcasting );
+void		SERVER_MASTER_InvalidateServerInfo( ULONG ulSegments );
 const char	*SERVER_MASTER_GetGameName( void );
 NETADDRESS_s SERVER_MASTER_GetMasterAddress( void );
 void		SERVER_MASTER_HandleVerificationRequest( BYTESTREAM_s *pByteStream );
@@ -70,6 +70,7 @@
 #include "sv_ban.h"
 #include "version.h"
 #include "d_dehacked.h"
+#include "stats.h"
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 //-- VARIABLES -------------------------------------------------------------------------------------------------------------------------------------
@@ -95,9 +96,57 @@ extern	NETADDRESS_s		g_LocalAddress;
 
 FString g_VersionWithOS;
 
+// Pre-serialized parts of the launcher response, one for each combination of flags
+// that the part depends on. They are rebuilt when they are invalidated or too old.
+struct QUERYRESPONSESEGMENT_s
+{
+	TArray<BYTE>	Data;
+	LONG			lBuildTic;
+};
+
+static	TMap<ULONG, QUERYRESPONSESEGMENT_s>	g_QueryResponseSegments[NUM_QUERYRESPONSESEGMENTS];
+
+// Scratch buffer the segments are serialized into before they are cached.
+static	NETBUFFER_s			g_QueryResponseScratchBuffer;
+
+static	ULONG				g_ulQueryResponseSegmentHits;
+static	ULONG				g_ulQueryResponseSegmentRebuilds;
+
+// Flags whose data is written by the respective segment.
+static	const ULONG			g_ulQueryResponseSegmentFlags[NUM_QUERYRESPONSESEGMENTS] =
+{
+	// QUERYRESPONSESEGMENT_SETTINGS
+	SQF_NAME|SQF_URL|SQF_EMAIL|SQF_MAPNAME|SQF_MAXCLIENTS|SQF_MAXPLAYERS|SQF_PWADS|SQF_GAMETYPE|SQF_GAMENAME|SQF_IWAD|
+	SQF_FORCEPASSWORD|SQF_FORCEJOINPASSWORD|SQF_GAMESKILL|SQF_BOTSKILL|SQF_DMFLAGS|SQF_LIMITS,
+
+	// QUERYRESPONSESEGMENT_PLAYERS
+	SQF_TEAMDAMAGE|SQF_TEAMSCORES|SQF_NUMPLAYERS|SQF_PLAYERDATA|SQF_TEAMINFO_NUMBER|SQF_TEAMINFO_NAME|SQF_TEAMINFO_COLOR|SQF_TEAMINFO_SCORE,
+
+	// QUERYRESPONSESEGMENT_EXTENDED
+	SQF_TESTING_SERVER|SQF_DATA_MD5SUM|SQF_ALL_DMFLAGS|SQF_SECURITY_SETTINGS|SQF_OPTIONAL_WADS|SQF_DEH,
+};
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	void	servermaster_WriteSettings( BYTESTREAM_s *pByteStream, ULONG ulBits );
+static	void	servermaster_WritePlayers( BYTESTREAM_s *pByteStream, ULONG ulBits );
+static	void	servermaster_WriteExtended( BYTESTREAM_s *pByteStream, ULONG ulBits );
+static	void	servermaster_WriteSegment( BYTESTREAM_s *pByteStream, ULONG ulSegment, ULONG ulBits );
+
 //*****************************************************************************
 //	CONSOLE VARIABLES
 
+// How long (in seconds) a pre-serialized part of the launcher response may be reused. 0 rebuilds the
+// response for every query. Players joining or leaving and map changes invalidate them immediately.
+CUSTOM_CVAR( Int, sv_queryresponsecachetime, 1, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	if ( self < 0 )
+		self = 0;
+	else
+		SERVER_MASTER_InvalidateServerInfo( QUERYRESPONSESEGMENT_ALL );
+}
+
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 //-- FUNCTIONS -------------------------------------------------------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -112,6 +161,9 @@ void SERVER_MASTER_Construct( void )
 	g_MasterServerBuffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
 	g_MasterServerBuffer.Clear();
 
+	g_QueryResponseScratchBuffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+	g_QueryResponseScratchBuffer.Clear();
+
 	// Allow the user to specify which port the master server is on.
 	pszPort = Args->CheckValue( "-masterport" );
     if ( pszPort )
@@ -150,6 +202,7 @@ void SERVER_MASTER_Destruct( void )
 {
 	// Free our local buffer.
 	g_MasterServerBuffer.Free();
+	g_QueryResponseScratchBuffer.Free();
 }
 
 //*****************************************************************************
@@ -375,72 +428,152 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 
 	NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, ulBits );
 
+	for ( ulIdx = 0; ulIdx < NUM_QUERYRESPONSESEGMENTS; ulIdx++ )
+		servermaster_WriteSegment( &g_MasterServerBuffer.ByteStream, ulIdx, ulBits );
+
+//	NETWORK_LaunchPacket( &g_MasterServerBuffer, Address, true );
+	NETWORK_LaunchPacket( &g_MasterServerBuffer, Address );
+}
+
+//*****************************************************************************
+//
+void SERVER_MASTER_InvalidateServerInfo( ULONG ulSegments )
+{
+	for ( ULONG ulIdx = 0; ulIdx < NUM_QUERYRESPONSESEGMENTS; ulIdx++ )
+	{
+		if ( ulSegments & ( 1 << ulIdx ))
+			g_QueryResponseSegments[ulIdx].Clear( );
+	}
+}
+
+//*****************************************************************************
+//
+static void servermaster_WriteSegment( BYTESTREAM_s *pByteStream, ULONG ulSegment, ULONG ulBits )
+{
+	void	(*pWriteFunction)( BYTESTREAM_s *, ULONG );
+
+	ulBits &= g_ulQueryResponseSegmentFlags[ulSegment];
+	if ( ulBits == 0 )
+		return;
+
+	switch ( ulSegment )
+	{
+	case QUERYRESPONSESEGMENT_SETTINGS:
+
+		pWriteFunction = servermaster_WriteSettings;
+		break;
+	case QUERYRESPONSESEGMENT_PLAYERS:
+
+		pWriteFunction = servermaster_WritePlayers;
+		break;
+	default:
+
+		pWriteFunction = servermaster_WriteExtended;
+		break;
+	}
+
+	if ( sv_queryresponsecachetime == 0 )
+	{
+		pWriteFunction( pByteStream, ulBits );
+		return;
+	}
+
+	// Reuse the serialized segment if it's recent enough.
+	QUERYRESPONSESEGMENT_s *pSegment = g_QueryResponseSegments[ulSegment].CheckKey( ulBits );
+	if (( pSegment != NULL ) && (( gametic - pSegment->lBuildTic ) >= 0 ) && (( gametic - pSegment->lBuildTic ) < TICRATE * sv_queryresponsecachetime ))
+	{
+		g_ulQueryResponseSegmentHits++;
+		NETWORK_WriteBuffer( pByteStream, &pSegment->Data[0], pSegment->Data.Size( ));
+		return;
+	}
+
+	g_ulQueryResponseSegmentRebuilds++;
+	g_QueryResponseScratchBuffer.Clear();
+	pWriteFunction( &g_QueryResponseScratchBuffer.ByteStream, ulBits );
+
+	// Launchers only ever use a handful of flag combinations, don't let anybody grow this indefinitely.
+	if ( g_QueryResponseSegments[ulSegment].CountUsed( ) >= 64 )
+		g_QueryResponseSegments[ulSegment].Clear( );
+
+	pSegment = &g_QueryResponseSegments[ulSegment][ulBits];
+	pSegment->Data.Resize( g_QueryResponseScratchBuffer.CalcSize( ));
+	if ( pSegment->Data.Size( ) > 0 )
+		memcpy( &pSegment->Data[0], g_QueryResponseScratchBuffer.pbData, pSegment->Data.Size( ));
+	pSegment->lBuildTic = gametic;
+
+	NETWORK_WriteBuffer( pByteStream, g_QueryResponseScratchBuffer.pbData, pSegment->Data.Size( ));
+}
+
+//*****************************************************************************
+//
+static void servermaster_WriteSettings( BYTESTREAM_s *pByteStream, ULONG ulBits )
+{
 	// Send the server name.
 	if ( ulBits & SQF_NAME )
-		NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, sv_hostname );
+		NETWORK_WriteString( pByteStream, sv_hostname );
 
 	// Send the website URL.
 	if ( ulBits & SQF_URL )
-		NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, sv_website );
+		NETWORK_WriteString( pByteStream, sv_website );
 
 	// Send the host's e-mail address.
 	if ( ulBits & SQF_EMAIL )
-		NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, sv_hostemail );
+		NETWORK_WriteString( pByteStream, sv_hostemail );
 
 	if ( ulBits & SQF_MAPNAME )
-		NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, level.mapname );
+		NETWORK_WriteString( pByteStream, level.mapname );
 
 	if ( ulBits & SQF_MAXCLIENTS )
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, sv_maxclients );
+		NETWORK_WriteByte( pByteStream, sv_maxclients );
 
 	if ( ulBits & SQF_MAXPLAYERS )
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, sv_maxplayers );
+		NETWORK_WriteByte( pByteStream, sv_maxplayers );
 
 	// Send out the PWAD information.
 	if ( ulBits & SQF_PWADS )
 	{
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, NETWORK_GetPWADList().Size( ));
+		NETWORK_WriteByte( pByteStream, NETWORK_GetPWADList().Size( ));
 
 		for ( unsigned i = 0; i < NETWORK_GetPWADList().Size(); ++i )
-			NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, NETWORK_GetPWADList()[i].name );
+			NETWORK_WriteString( pByteStream, NETWORK_GetPWADList()[i].name );
 	}
 
 	if ( ulBits & SQF_GAMETYPE )
 	{
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, GAMEMODE_GetCurrentMode( ));
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, instagib );
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, buckshot );
+		NETWORK_WriteByte( pByteStream, GAMEMODE_GetCurrentMode( ));
+		NETWORK_WriteByte( pByteStream, instagib );
+		NETWORK_WriteByte( pByteStream, buckshot );
 	}
 
 	if ( ulBits & SQF_GAMENAME )
-		NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, SERVER_MASTER_GetGameName( ));
+		NETWORK_WriteString( pByteStream, SERVER_MASTER_GetGameName( ));
 
 	if ( ulBits & SQF_IWAD )
-		NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, NETWORK_GetIWAD( ));
+		NETWORK_WriteString( pByteStream, NETWORK_GetIWAD( ));
 
 	if ( ulBits & SQF_FORCEPASSWORD )
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, sv_forcepassword );
+		NETWORK_WriteByte( pByteStream, sv_forcepassword );
 
 	if ( ulBits & SQF_FORCEJOINPASSWORD )
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, sv_forcejoinpassword );
+		NETWORK_WriteByte( pByteStream, sv_forcejoinpassword );
 
 	if ( ulBits & SQF_GAMESKILL )
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, gameskill );
+		NETWORK_WriteByte( pByteStream, gameskill );
 
 	if ( ulBits & SQF_BOTSKILL )
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, botskill );
+		NETWORK_WriteByte( pByteStream, botskill );
 
 	if ( ulBits & SQF_DMFLAGS )
 	{
-		NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, dmflags );
-		NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, dmflags2 );
-		NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, compatflags );
+		NETWORK_WriteLong( pByteStream, dmflags );
+		NETWORK_WriteLong( pByteStream, dmflags2 );
+		NETWORK_WriteLong( pByteStream, compatflags );
 	}
 
 	if ( ulBits & SQF_LIMITS )
 	{
-		NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, fraglimit );
-		NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, static_cast<SHORT>(timelimit) );
+		NETWORK_WriteShort( pByteStream, fraglimit );
+		NETWORK_WriteShort( pByteStream, static_cast<SHORT>(timelimit) );
 		// [BB] We have to base the decision on whether to send "time left" on the same rounded
 		// timelimit value we just sent to the client.
 		if ( static_cast<SHORT>(timelimit) )
@@ -450,18 +583,25 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 			lTimeLeft = (LONG)( timelimit - ( level.time / ( TICRATE * 60 )));
 			if ( lTimeLeft < 0 )
 				lTimeLeft = 0;
-			NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, lTimeLeft );
+			NETWORK_WriteShort( pByteStream, lTimeLeft );
 		}
-		NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, duellimit );
-		NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, pointlimit );
-		NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, winlimit );
+		NETWORK_WriteShort( pByteStream, duellimit );
+		NETWORK_WriteShort( pByteStream, pointlimit );
+		NETWORK_WriteShort( pByteStream, winlimit );
 	}
+}
+
+//*****************************************************************************
+//
+static void servermaster_WritePlayers( BYTESTREAM_s *pByteStream, ULONG ulBits )
+{
+	ULONG	ulIdx;
 
 	// Send the team damage scale.
 	if ( teamplay || teamgame || teamlms || teampossession || (( deathmatch == false ) && ( teamgame == false )))
 	{
 		if ( ulBits & SQF_TEAMDAMAGE )
-			NETWORK_WriteFloat( &g_MasterServerBuffer.ByteStream, teamdamage );
+			NETWORK_WriteFloat( pByteStream, teamdamage );
 	}
 
 	if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS )
@@ -473,17 +613,17 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 			for ( ulIdx = 0; ulIdx < 2; ulIdx++ )
 			{
 				if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNFRAGS )
-					NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, TEAM_GetFragCount( ulIdx ));
+					NETWORK_WriteShort( pByteStream, TEAM_GetFragCount( ulIdx ));
 				else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNWINS )
-					NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, TEAM_GetWinCount( ulIdx ));
+					NETWORK_WriteShort( pByteStream, TEAM_GetWinCount( ulIdx ));
 				else
-					NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, TEAM_GetScore( ulIdx ));
+					NETWORK_WriteShort( pByteStream, TEAM_GetScore( ulIdx ));
 			}
 		}
 	}
 
 	if ( ulBits & SQF_NUMPLAYERS )
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, SERVER_CalcNumPlayers( ));
+		NETWORK_WriteByte( pByteStream, SERVER_CalcNumPlayers( ));
 
 	if ( ulBits & SQF_PLAYERDATA )
 	{
@@ -492,115 +632,117 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 			if ( playeringame[ulIdx] == false )
 				continue;
 
-			NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, players[ulIdx].userinfo.GetName() );
+			NETWORK_WriteString( pByteStream, players[ulIdx].userinfo.GetName() );
 			if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNPOINTS )
-				NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, players[ulIdx].lPointCount );
+				NETWORK_WriteShort( pByteStream, players[ulIdx].lPointCount );
 			else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNWINS )
-				NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, players[ulIdx].ulWins );
+				NETWORK_WriteShort( pByteStream, players[ulIdx].ulWins );
 			else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNFRAGS )
-				NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, players[ulIdx].fragcount );
+				NETWORK_WriteShort( pByteStream, players[ulIdx].fragcount );
 			else
-				NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, players[ulIdx].killcount );
+				NETWORK_WriteShort( pByteStream, players[ulIdx].killcount );
 
-			NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, players[ulIdx].ulPing );
-			NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, PLAYER_IsTrueSpectator( &players[ulIdx] ));
-			NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, players[ulIdx].bIsBot );
+			NETWORK_WriteShort( pByteStream, players[ulIdx].ulPing );
+			NETWORK_WriteByte( pByteStream, PLAYER_IsTrueSpectator( &players[ulIdx] ));
+			NETWORK_WriteByte( pByteStream, players[ulIdx].bIsBot );
 
 			if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS )
 			{
 				if ( players[ulIdx].bOnTeam == false )
-					NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, 255 );
+					NETWORK_WriteByte( pByteStream, 255 );
 				else
-					NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, players[ulIdx].ulTeam );
+					NETWORK_WriteByte( pByteStream, players[ulIdx].ulTeam );
 			}
 
-			NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, players[ulIdx].ulTime / ( TICRATE * 60 ));
+			NETWORK_WriteByte( pByteStream, players[ulIdx].ulTime / ( TICRATE * 60 ));
 		}
 	}
 
 	if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS )
 	{
 		if ( ulBits & SQF_TEAMINFO_NUMBER )
-			NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, TEAM_GetNumAvailableTeams( ));
+			NETWORK_WriteByte( pByteStream, TEAM_GetNumAvailableTeams( ));
 
 		if ( ulBits & SQF_TEAMINFO_NAME )
 			for ( ulIdx = 0; ulIdx < TEAM_GetNumAvailableTeams( ); ulIdx++ )
-				NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, TEAM_GetName( ulIdx ));
+				NETWORK_WriteString( pByteStream, TEAM_GetName( ulIdx ));
 
 		if ( ulBits & SQF_TEAMINFO_COLOR )
 			for ( ulIdx = 0; ulIdx < TEAM_GetNumAvailableTeams( ); ulIdx++ )
-				NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, TEAM_GetColor( ulIdx ));
+				NETWORK_WriteLong( pByteStream, TEAM_GetColor( ulIdx ));
 
 		if ( ulBits & SQF_TEAMINFO_SCORE )
 		{
 			for ( ulIdx = 0; ulIdx < TEAM_GetNumAvailableTeams( ); ulIdx++ )
 			{
 				if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNFRAGS )
-					NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, TEAM_GetFragCount( ulIdx ));
+					NETWORK_WriteShort( pByteStream, TEAM_GetFragCount( ulIdx ));
 				else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNWINS )
-					NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, TEAM_GetWinCount( ulIdx ));
+					NETWORK_WriteShort( pByteStream, TEAM_GetWinCount( ulIdx ));
 				else
-					NETWORK_WriteShort( &g_MasterServerBuffer.ByteStream, TEAM_GetScore( ulIdx ));
+					NETWORK_WriteShort( pByteStream, TEAM_GetScore( ulIdx ));
 			}
 		}
 	}
+}
 
+//*****************************************************************************
+//
+static void servermaster_WriteExtended( BYTESTREAM_s *pByteStream, ULONG ulBits )
+{
 	// [BB] Testing server and what's the binary name?
 	if ( ulBits & SQF_TESTING_SERVER )
 	{
 #if ( BUILD_ID == BUILD_RELEASE )
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, 0 );
-		NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, "" );
+		NETWORK_WriteByte( pByteStream, 0 );
+		NETWORK_WriteString( pByteStream, "" );
 #else
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, 1 );
+		NETWORK_WriteByte( pByteStream, 1 );
 		// [BB] Name of the testing binary archive found in http://zandronum.com/
 		FString testingBinary;
 		testingBinary.Format ( "downloads/testing/%s/ZandroDev%s-%swindows.zip", GAMEVER_STRING, GAMEVER_STRING, GetGitTime() );
-		NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, testingBinary.GetChars() );
+		NETWORK_WriteString( pByteStream, testingBinary.GetChars() );
 #endif
 	}
 
 	// [BB] We don't have a mandatory main data file anymore, so just send an empty string.
 	if ( ulBits & SQF_DATA_MD5SUM )
-		NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, "" );
+		NETWORK_WriteString( pByteStream, "" );
 
 	// [BB] Send all dmflags and compatflags.
 	if ( ulBits & SQF_ALL_DMFLAGS )
 	{
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, 6 );
-		NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, dmflags );
-		NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, dmflags2 );
-		NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, zadmflags );
-		NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, compatflags );
-		NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, zacompatflags );
-		NETWORK_WriteLong( &g_MasterServerBuffer.ByteStream, compatflags2 );
+		NETWORK_WriteByte( pByteStream, 6 );
+		NETWORK_WriteLong( pByteStream, dmflags );
+		NETWORK_WriteLong( pByteStream, dmflags2 );
+		NETWORK_WriteLong( pByteStream, zadmflags );
+		NETWORK_WriteLong( pByteStream, compatflags );
+		NETWORK_WriteLong( pByteStream, zacompatflags );
+		NETWORK_WriteLong( pByteStream, compatflags2 );
 	}
 
 	// [BB] Send special security settings like sv_enforcemasterbanlist.
 	if ( ulBits & SQF_SECURITY_SETTINGS )
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, sv_enforcemasterbanlist );
+		NETWORK_WriteByte( pByteStream, sv_enforcemasterbanlist );
 
 	// [TP] Send optional wad indices.
 	if ( ulBits & SQF_OPTIONAL_WADS )
 	{
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, g_OptionalWadIndices.Size() );
+		NETWORK_WriteByte( pByteStream, g_OptionalWadIndices.Size() );
 
 		for ( unsigned i = 0; i < g_OptionalWadIndices.Size(); ++i )
-			NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, g_OptionalWadIndices[i] );
+			NETWORK_WriteByte( pByteStream, g_OptionalWadIndices[i] );
 	}
 
 	// [TP] Send deh patches
 	if ( ulBits & SQF_DEH )
 	{
 		const TArray<FString>& names = D_GetDehFileNames();
-		NETWORK_WriteByte( &g_MasterServerBuffer.ByteStream, names.Size() );
+		NETWORK_WriteByte( pByteStream, names.Size() );
 
 		for ( unsigned i = 0; i < names.Size(); ++i )
-			NETWORK_WriteString( &g_MasterServerBuffer.ByteStream, names[i] );
+			NETWORK_WriteString( pByteStream, names[i] );
 	}
-
-//	NETWORK_LaunchPacket( &g_MasterServerBuffer, Address, true );
-	NETWORK_LaunchPacket( &g_MasterServerBuffer, Address );
 }
 
 //*****************************************************************************
@@ -701,6 +843,25 @@ CVAR( String, sv_hostemail, "", CVAR_ARCHIVE|CVAR_NOSETBYACS|CVAR_SERVERINFO )
 // [BB] Client and server use this now, therefore the name doesn't begin with "sv_"
 CVAR( String, masterhostname, "master.zandronum.com", CVAR_ARCHIVE|CVAR_GLOBALCONFIG|CVAR_NOSETBYACS )
 
+//*****************************************************************************
+//	STATISTICS
+
+ADD_STAT( launcherqueries )
+{
+	FString	Out;
+	ULONG	ulNumSegments = 0;
+
+	for ( ULONG ulIdx = 0; ulIdx < NUM_QUERYRESPONSESEGMENTS; ulIdx++ )
+		ulNumSegments += g_QueryResponseSegments[ulIdx].CountUsed( );
+
+	Out.Format( "Cached response segments: %d, reused: %d, rebuilt: %d",
+		static_cast<int> ( ulNumSegments ),
+		static_cast<int> ( g_ulQueryResponseSegmentHits ),
+		static_cast<int> ( g_ulQueryResponseSegmentRebuilds ));
+
+	return ( Out );
+}
+
 CCMD( wads )
 {
 	Printf( "IWAD: %s\n", NETWORK_GetIWAD( ) );
@@ -0,0 +1,475 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: sv_relevance.cpp
+//
+// Description: Decides which actors are relevant for a client, so that updates of irrelevant actors can be deferred.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "c_dispatch.h"
+#include "doomstat.h"
+#include "network.h"
+#include "p_local.h"
+#include "r_state.h"
+#include "stats.h"
+#include "sv_commands.h"
+#include "sv_main.h"
+#include "sv_relevance.h"
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+//-- DEFINES ---------------------------------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+// Everything a deferred update has to bring the client up to date with.
+#define	DEFERRED_UPDATE_BITS	( CM_X|CM_Y|CM_Z|CM_LAST_X|CM_LAST_Y|CM_LAST_Z|CM_ANGLE|CM_VELX|CM_VELY|CM_VELZ|CM_PITCH|CM_MOVEDIR )
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+//-- TYPES -----------------------------------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	// The network IDs of the actors whose updates were deferred and the tics the first update was deferred.
+	TArray<LONG>	DeferredIDs;
+	TArray<int>		DeferredTics;
+
+	// Bit field over all network IDs to quickly check if an actor has a deferred update.
+	BYTE			abIsDeferred[IDList<AActor>::MAX_NETID / 8];
+
+	// The last tic the movement of each player was sent to this client.
+	int				alLastPlayerUpdateTic[MAXPLAYERS];
+
+} RELEVANCECLIENT_t;
+
+typedef struct
+{
+	ULONG			ulNumDeferred;
+	ULONG			ulNumSentDeferred;
+	ULONG			ulNumSkippedPlayerUpdates;
+
+} RELEVANCESTATS_t;
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+//-- VARIABLES -------------------------------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+static	RELEVANCECLIENT_t	g_RelevanceClients[MAXPLAYERS];
+
+// The connected component of the sector graph every sector belongs to. Actors in
+// different components can't interact with each other other than by teleporting.
+static	TArray<int>			g_SectorComponents;
+
+static	RELEVANCESTATS_t	g_StatsThisTic;
+static	RELEVANCESTATS_t	g_StatsLastTic;
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+//-- PROTOTYPES ------------------------------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+static	AActor	*serverrelevance_GetViewpoint( ULONG ulClient );
+static	bool	serverrelevance_IsRelevantFrom( AActor *pViewpoint, AActor *pActor );
+static	int		serverrelevance_FindComponent( int iSector );
+static	void	serverrelevance_RemoveDeferredUpdate( ULONG ulClient, unsigned int uiIdx );
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+//-- CVARS -----------------------------------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+// If enabled, position updates of actors a client can't see (according to the REJECT
+// table and the sector connectivity) or that are too far away are deferred until
+// the actor becomes relevant for the client.
+CVAR( Bool, sv_relevancefilter, false, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// Actors farther away from the client's viewpoint than this are considered irrelevant
+// (0 means no limit).
+CVAR( Int, sv_relevancedistance, 0, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// Even irrelevant actors and players are updated at least this often (in tics).
+CVAR( Int, sv_irrelevantupdateinterval, TICRATE, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+//-- FUNCTIONS -------------------------------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+void SERVERRELEVANCE_SetupLevel( void )
+{
+	// Find the connected components of the sector graph (union-find over all two-sided lines).
+	g_SectorComponents.Resize( numsectors );
+	for ( int i = 0; i < numsectors; ++i )
+		g_SectorComponents[i] = i;
+
+	for ( int i = 0; i < numlines; ++i )
+	{
+		if (( lines[i].frontsector == NULL ) || ( lines[i].backsector == NULL ))
+			continue;
+
+		const int iFront = serverrelevance_FindComponent( int( lines[i].frontsector - sectors ));
+		const int iBack = serverrelevance_FindComponent( int( lines[i].backsector - sectors ));
+		if ( iFront != iBack )
+			g_SectorComponents[iBack] = iFront;
+	}
+
+	for ( int i = 0; i < numsectors; ++i )
+		g_SectorComponents[i] = serverrelevance_FindComponent( i );
+
+	// The actors of the previous level are gone.
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ++ulIdx )
+		SERVERRELEVANCE_ClearClient( ulIdx );
+}
+
+//*****************************************************************************
+//
+void SERVERRELEVANCE_ClearClient( ULONG ulClient )
+{
+	if ( ulClient >= MAXPLAYERS )
+		return;
+
+	RELEVANCECLIENT_t &Client = g_RelevanceClients[ulClient];
+	Client.DeferredIDs.Clear( );
+	Client.DeferredTics.Clear( );
+	memset( Client.abIsDeferred, 0, sizeof( Client.abIsDeferred ));
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ++ulIdx )
+		Client.alLastPlayerUpdateTic[ulIdx] = 0;
+}
+
+//*****************************************************************************
+//
+// Sends the deferred updates of all actors that became relevant or were
+// deferred for too long.
+//
+void SERVERRELEVANCE_Tick( void )
+{
+	g_StatsLastTic = g_StatsThisTic;
+	memset( &g_StatsThisTic, 0, sizeof( g_StatsThisTic ));
+
+	for ( ULONG ulClient = 0; ulClient < MAXPLAYERS; ++ulClient )
+	{
+		RELEVANCECLIENT_t &Client = g_RelevanceClients[ulClient];
+		if ( Client.DeferredIDs.Size( ) == 0 )
+			continue;
+
+		if ( SERVER_IsValidClient( ulClient ) == false )
+		{
+			SERVERRELEVANCE_ClearClient( ulClient );
+			continue;
+		}
+
+		// The filter was turned off, so bring the client up to date with every
+		// actor it didn't get updates for.
+		if ( SERVERRELEVANCE_IsEnabled( ) == false )
+		{
+			for ( unsigned int i = Client.DeferredIDs.Size( ); i-- > 0; )
+			{
+				AActor *pActor = g_NetIDList.findPointerByID( Client.DeferredIDs[i] );
+
+				if ( pActor == NULL )
+					serverrelevance_RemoveDeferredUpdate( ulClient, i );
+				else
+					SERVERRELEVANCE_SendDeferredUpdate( ulClient, pActor );
+			}
+
+			SERVERRELEVANCE_ClearClient( ulClient );
+			continue;
+		}
+
+		AActor *pViewpoint = serverrelevance_GetViewpoint( ulClient );
+
+		// Go backwards, so that removing an entry doesn't skip another one.
+		for ( unsigned int i = Client.DeferredIDs.Size( ); i-- > 0; )
+		{
+			AActor *pActor = g_NetIDList.findPointerByID( Client.DeferredIDs[i] );
+
+			if ( pActor == NULL )
+				serverrelevance_RemoveDeferredUpdate( ulClient, i );
+			else if (( serverrelevance_IsRelevantFrom( pViewpoint, pActor ))
+				|| (( gametic - Client.DeferredTics[i] ) >= sv_irrelevantupdateinterval ))
+			{
+				SERVERRELEVANCE_SendDeferredUpdate( ulClient, pActor );
+			}
+		}
+	}
+}
+
+//*****************************************************************************
+//
+bool SERVERRELEVANCE_IsEnabled( void )
+{
+	return (( NETWORK_GetState( ) == NETSTATE_SERVER ) && sv_relevancefilter && ( gamestate == GS_LEVEL ));
+}
+
+//*****************************************************************************
+//
+bool SERVERRELEVANCE_IsActorRelevant( ULONG ulClient, AActor *pActor )
+{
+	// Player bodies are always relevant, the clients need them for prediction.
+	if (( SERVERRELEVANCE_IsEnabled( ) == false ) || ( pActor == NULL ) || pActor->player )
+		return ( true );
+
+	return ( serverrelevance_IsRelevantFrom( serverrelevance_GetViewpoint( ulClient ), pActor ));
+}
+
+//*****************************************************************************
+//
+// Irrelevant players are only updated every sv_irrelevantupdateinterval tics.
+//
+bool SERVERRELEVANCE_ShouldUpdatePlayer( ULONG ulClient, ULONG ulPlayer )
+{
+	if (( SERVERRELEVANCE_IsEnabled( ) == false ) || ( ulClient >= MAXPLAYERS ) || ( ulPlayer >= MAXPLAYERS ))
+		return ( true );
+
+	int &lLastUpdateTic = g_RelevanceClients[ulClient].alLastPlayerUpdateTic[ulPlayer];
+
+	if (( serverrelevance_IsRelevantFrom( serverrelevance_GetViewpoint( ulClient ), players[ulPlayer].mo ) == false )
+		&& (( gametic - lLastUpdateTic ) < sv_irrelevantupdateinterval ))
+	{
+		g_StatsThisTic.ulNumSkippedPlayerUpdates++;
+		return ( false );
+	}
+
+	lLastUpdateTic = gametic;
+	return ( true );
+}
+
+//*****************************************************************************
+//
+bool SERVERRELEVANCE_HasDeferredUpdate( ULONG ulClient, AActor *pActor )
+{
+	if (( ulClient >= MAXPLAYERS ) || ( pActor == NULL ) || ( pActor->lNetID < 0 ) || ( pActor->lNetID >= IDList<AActor>::MAX_NETID ))
+		return ( false );
+
+	return !!( g_RelevanceClients[ulClient].abIsDeferred[pActor->lNetID >> 3] & ( 1 << ( pActor->lNetID & 7 )));
+}
+
+//*****************************************************************************
+//
+void SERVERRELEVANCE_DeferUpdate( ULONG ulClient, AActor *pActor )
+{
+	if (( ulClient >= MAXPLAYERS ) || ( pActor == NULL ) || ( pActor->lNetID < 0 ) || ( pActor->lNetID >= IDList<AActor>::MAX_NETID ))
+		return;
+
+	g_StatsThisTic.ulNumDeferred++;
+
+	// The deferred update will contain everything anyway.
+	if ( SERVERRELEVANCE_HasDeferredUpdate( ulClient, pActor ))
+		return;
+
+	RELEVANCECLIENT_t &Client = g_RelevanceClients[ulClient];
+	Client.abIsDeferred[pActor->lNetID >> 3] |= ( 1 << ( pActor->lNetID & 7 ));
+	Client.DeferredIDs.Push( pActor->lNetID );
+	Client.DeferredTics.Push( gametic );
+}
+
+//*****************************************************************************
+//
+// Brings the client up to date with the position of the actor, including the
+// last position the other clients know, since the following updates may
+// refer to it.
+//
+void SERVERRELEVANCE_SendDeferredUpdate( ULONG ulClient, AActor *pActor )
+{
+	if ( SERVERRELEVANCE_HasDeferredUpdate( ulClient, pActor ) == false )
+		return;
+
+	RELEVANCECLIENT_t &Client = g_RelevanceClients[ulClient];
+	for ( unsigned int i = 0; i < Client.DeferredIDs.Size( ); ++i )
+	{
+		if ( Client.DeferredIDs[i] == pActor->lNetID )
+		{
+			serverrelevance_RemoveDeferredUpdate( ulClient, i );
+			break;
+		}
+	}
+
+	g_StatsThisTic.ulNumSentDeferred++;
+	SERVERCOMMANDS_MoveThingExact( pActor, DEFERRED_UPDATE_BITS, ulClient, SVCF_ONLYTHISCLIENT );
+}
+
+//*****************************************************************************
+//
+// Returns the actor the client is looking from, or NULL if the server doesn't
+// know where the client is looking from.
+//
+static AActor *serverrelevance_GetViewpoint( ULONG ulClient )
+{
+	const ULONG ulDisplayPlayer = SERVER_GetClient( ulClient )->ulDisplayPlayer;
+
+	// The client is spying on another player.
+	if (( ulDisplayPlayer != ulClient ) && PLAYER_IsValidPlayerWithMo( ulDisplayPlayer ))
+		return ( players[ulDisplayPlayer].mo );
+
+	// Free spectators move around on their own.
+	if ( players[ulClient].bSpectating )
+		return ( NULL );
+
+	if ( players[ulClient].camera )
+		return ( players[ulClient].camera );
+
+	return ( players[ulClient].mo );
+}
+
+//*****************************************************************************
+//
+static bool serverrelevance_IsRelevantFrom( AActor *pViewpoint, AActor *pActor )
+{
+	if (( pViewpoint == NULL ) || ( pActor == NULL ) || ( pActor == pViewpoint ))
+		return ( true );
+
+	if (( pViewpoint->Sector == NULL ) || ( pActor->Sector == NULL ))
+		return ( true );
+
+	const int iViewSector = int( pViewpoint->Sector - sectors );
+	const int iActorSector = int( pActor->Sector - sectors );
+
+	// Not connected at all.
+	if (( static_cast<unsigned>( iViewSector ) < g_SectorComponents.Size( ))
+		&& ( static_cast<unsigned>( iActorSector ) < g_SectorComponents.Size( ))
+		&& ( g_SectorComponents[iViewSector] != g_SectorComponents[iActorSector] ))
+	{
+		return ( false );
+	}
+
+	// The REJECT table says that the sectors can't see each other.
+	if ( rejectmatrix != NULL )
+	{
+		const int iRejectNum = iViewSector * numsectors + iActorSector;
+		if ( rejectmatrix[iRejectNum >> 3] & ( 1 << ( iRejectNum & 7 )))
+			return ( false );
+	}
+
+	// Too far away.
+	if (( sv_relevancedistance > 0 ) && ( P_AproxDistance( pActor->x - pViewpoint->x, pActor->y - pViewpoint->y ) > ( sv_relevancedistance * FRACUNIT )))
+		return ( false );
+
+	return ( true );
+}
+
+//*****************************************************************************
+//
+static int serverrelevance_FindComponent( int iSector )
+{
+	while ( g_SectorComponents[iSector] != iSector )
+	{
+		// Path halving keeps the trees flat.
+		g_SectorComponents[iSector] = g_SectorComponents[g_SectorComponents[iSector]];
+		iSector = g_SectorComponents[iSector];
+	}
+
+	return ( iSector );
+}
+
+//*****************************************************************************
+//
+static void serverrelevance_RemoveDeferredUpdate( ULONG ulClient, unsigned int uiIdx )
+{
+	RELEVANCECLIENT_t &Client = g_RelevanceClients[ulClient];
+	const LONG lNetID = Client.DeferredIDs[uiIdx];
+
+	Client.abIsDeferred[lNetID >> 3] &= ~( 1 << ( lNetID & 7 ));
+
+	// The order doesn't matter, so just move the last entry here.
+	const unsigned int uiLast = Client.DeferredIDs.Size( ) - 1;
+	Client.DeferredIDs[uiIdx] = Client.DeferredIDs[uiLast];
+	Client.DeferredTics[uiIdx] = Client.DeferredTics[uiLast];
+	Client.DeferredIDs.Pop( );
+	Client.DeferredTics.Pop( );
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+//-- CONSOLE ---------------------------------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+// Shows how many of the networked actors are relevant for each client.
+CCMD( dumprelevance )
+{
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+		return;
+
+	if ( SERVERRELEVANCE_IsEnabled( ) == false )
+	{
+		Printf( "The relevance filter is not active (see sv_relevancefilter).\n" );
+		return;
+	}
+
+	for ( ULONG ulClient = 0; ulClient < MAXPLAYERS; ++ulClient )
+	{
+		if ( SERVER_IsValidClient( ulClient ) == false )
+			continue;
+
+		AActor *pViewpoint = serverrelevance_GetViewpoint( ulClient );
+		ULONG ulNumActors = 0;
+		ULONG ulNumRelevant = 0;
+
+		TThinkerIterator<AActor> Iterator;
+		AActor *pActor;
+		while (( pActor = Iterator.Next( )))
+		{
+			if ( pActor->lNetID < 0 )
+				continue;
+
+			ulNumActors++;
+			if ( serverrelevance_IsRelevantFrom( pViewpoint, pActor ))
+				ulNumRelevant++;
+		}
+
+		Printf( "%s: %u of %u actors relevant, %u deferred updates\n", players[ulClient].userinfo.GetName( ),
+			static_cast<unsigned int>( ulNumRelevant ), static_cast<unsigned int>( ulNumActors ), g_RelevanceClients[ulClient].DeferredIDs.Size( ));
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+//-- STATISTICS ------------------------------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+ADD_STAT( relevance )
+{
+	FString	Out;
+
+	Out.Format( "Last tic: %u updates deferred, %u deferred updates sent, %u player updates skipped",
+		static_cast<unsigned int>( g_StatsLastTic.ulNumDeferred ),
+		static_cast<unsigned int>( g_StatsLastTic.ulNumSentDeferred ),
+		static_cast<unsigned int>( g_StatsLastTic.ulNumSkippedPlayerUpdates ));
+
+	return ( Out );
+}
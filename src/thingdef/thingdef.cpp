@@ -320,6 +320,9 @@ static void FinishThingdef()
 		I_Error("%d errors during actor postprocessing", errorcount);
 	}
 
+	// Lower all resolved expressions to bytecode for faster evaluation.
+	StateParams.CompileAll();
+
 	// Since these are defined in DECORATE now the table has to be initialized here.
 	for(int i=0;i<31;i++)
 	{
@@ -42,6 +42,8 @@ INTBOOL CheckActorFlag(const AActor *owner, const char *flagname, bool printerro
 //
 //==========================================================================
 class FxExpression;
+class FxProgram;
+struct ExpVal;
 
 struct FStateLabels;
 
@@ -121,6 +123,7 @@ public:
 struct FStateExpression
 {
 	FxExpression *expr;
+	FxProgram *code;
 	const PClass *owner;
 	bool constant;
 	bool cloned;
@@ -138,7 +141,10 @@ public:
 	void Set(int num, FxExpression *x, bool cloned = false);
 	void Copy(int dest, int src, int cnt);
 	int ResolveAll();
+	void CompileAll();
 	FxExpression *Get(int no);
+	bool Evaluate(int no, AActor *self, ExpVal &val);
+	void Benchmark(AActor *self, int iterations);
 	unsigned int Size() { return expressions.Size(); }
 };
 
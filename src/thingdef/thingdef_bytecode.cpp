@@ -0,0 +1,1446 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: thingdef_bytecode.cpp
+//
+// Description: Compiles resolved DECORATE expressions to register based bytecode and runs it.
+//
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <string.h>
+#include "actor.h"
+#include "sc_man.h"
+#include "tarray.h"
+#include "templates.h"
+#include "i_system.h"
+#include "m_random.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "doomstat.h"
+#include "d_player.h"
+#include "stats.h"
+#include "thingdef.h"
+#include "thingdef_exp.h"
+#include "network.h"
+
+// Evaluate the DECORATE expressions with the compiled bytecode instead
+// of walking the expression trees.
+CVAR (Bool, decorate_bytecode, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+// The register file lives on the stack, so keep it small. Expressions
+// that need more registers are left to the tree walker.
+enum { FX_MAXREGISTERS = 64 };
+
+enum EFxOpcode
+{
+	OP_RET,				// return A
+	OP_MOVE,			// Dest = A
+	OP_INTCAST,			// Dest = int(A)
+	OP_BOOL,			// Dest = bool(A)
+	OP_NEGI,
+	OP_NEGF,
+	OP_NOT,				// bitwise
+	OP_LNOT,			// logical
+	OP_ABS,
+
+	OP_ADDI,
+	OP_SUBI,
+	OP_MULI,
+	OP_DIVI,
+	OP_MODI,
+	OP_ADDF,
+	OP_SUBF,
+	OP_MULF,
+	OP_DIVF,
+	OP_MODF,
+
+	OP_LTI,
+	OP_GTI,
+	OP_LEI,
+	OP_GEI,
+	OP_EQI,
+	OP_NEI,
+	OP_LTF,
+	OP_GTF,
+	OP_LEF,
+	OP_GEF,
+	OP_EQF,
+	OP_NEF,
+
+	OP_SHL,
+	OP_SHR,
+	OP_USHR,
+	OP_AND,
+	OP_OR,
+	OP_XOR,
+
+	OP_JMP,				// goto Arg
+	OP_JMPF,			// if (!A) goto Arg
+	OP_JMPT,			// if (A) goto Arg
+
+	// Everything from here on depends on the actor or the game state
+	// and is never folded.
+	OP_SELF,
+	OP_SELFINT,			// Dest = *(int *)(self + Arg)
+	OP_SELFBOOL,
+	OP_SELFFIXED,
+	OP_SELFANGLE,
+	OP_SELFFLOAT,
+	OP_SELFMEMBER,		// Dest = self->(PSymbolVariable *)Ptr
+	OP_SELFADDR,		// Dest = &self + Arg
+	OP_MEMBER,			// Dest = A->(PSymbolVariable *)Ptr
+	OP_MEMBERADDR,
+	OP_GLOBAL,			// Dest = (PSymbolVariable *)Ptr
+	OP_GLOBALADDR,
+	OP_INDEX,			// Dest = A[B], with Arg elements
+	OP_FRANDOMRANGE,	// Dest = Dest * (B - A) + A
+
+	// These have side effects.
+	OP_RANDOM,			// Dest = (FRandom *)Ptr
+	OP_RANDOMRANGE,		// Dest = random in [A, B]
+	OP_FRANDOM,
+	OP_RANDOM2,
+	OP_EVAL,			// Dest = ((FxExpression *)Ptr)->EvalExpression
+};
+
+//==========================================================================
+//
+// FxCompiler
+//
+// While compiling, temporaries are numbered from 0 upwards and constants
+// from -1 downwards. Temporaries are allocated like a stack: the result
+// of a subexpression always ends up in the first temporary that was free
+// when compiling it started.
+//
+//==========================================================================
+
+class FxCompiler
+{
+public:
+	FxCompiler();
+
+	int GetTempMark() const { return NextTemp; }
+	void FreeTemps(int mark) { NextTemp = mark; }
+	int AllocTemp();
+
+	int GetConstant(const ExpVal &val);
+	int GetConstant(int val);
+	bool IsConstant(int reg) const { return reg < 0; }
+	const ExpVal &GetConstantValue(int reg) const { return Constants[-1 - reg]; }
+
+	void Emit(int op, int dest, int a = 0, int b = 0, int arg = 0);
+	void EmitPtr(int op, int dest, int a, int b, void *ptr);
+	int EmitPure(int op, int a, int b, int mark);
+	int EmitEval(FxExpression *x);
+	int EmitJump(int op, int cond);
+	void PatchJump(int jump);
+	int LastOp(int reg) const;
+	int RemoveLast();
+
+	FxProgram *Finish(int result);
+
+	static int NumCompiled, NumFallbacks, NumConstant, NumInstructions, NumFolded;
+
+private:
+	struct Instruction
+	{
+		int Op, Dest, A, B;
+		union
+		{
+			int Arg;
+			void *Ptr;
+		};
+	};
+
+	int MapRegister(int reg, int numtemps) const { return reg < 0 ? numtemps - 1 - reg : reg; }
+
+	TArray<Instruction> Code;
+	TArray<ExpVal> Constants;
+	int NextTemp;
+	int MaxTemps;
+	int LastLabel;
+};
+
+int FxCompiler::NumCompiled, FxCompiler::NumFallbacks, FxCompiler::NumConstant;
+int FxCompiler::NumInstructions, FxCompiler::NumFolded;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static inline void SetInt(ExpVal &d, int v)
+{
+	d.Type = VAL_Int;
+	d.Int = v;
+}
+
+static inline void SetFloat(ExpVal &d, double v)
+{
+	d.Type = VAL_Float;
+	d.Float = v;
+}
+
+static inline char *CheckObject(void *object)
+{
+	if (object == NULL)
+	{
+		I_Error("Accessing member variable without valid object");
+	}
+	return (char *)object;
+}
+
+static ExpVal DivisionByZero()
+{
+	// [BB] Due to Zandronum's jump handling, valid code can cause this on the clients.
+	if ( NETWORK_GetState( ) != NETSTATE_CLIENT )
+	{
+		I_Error("Division by 0");
+	}
+	return handleClientDivisionByZero();
+}
+
+//==========================================================================
+//
+// RunCode
+//
+// The interpreter loop. Operands are always read before the destination
+// is written, because the destination may be one of them.
+//
+//==========================================================================
+
+static ExpVal RunCode(const FxInstruction *code, ExpVal *regs, AActor *self)
+{
+	const FxInstruction *pc = code;
+
+	for (;;)
+	{
+		const FxInstruction &ins = *pc++;
+		ExpVal &d = regs[ins.Dest];
+		const ExpVal &a = regs[ins.A];
+		const ExpVal &b = regs[ins.B];
+
+		switch (ins.Op)
+		{
+		case OP_RET:		return a;
+		case OP_MOVE:		{ ExpVal v = a; d = v; } break;
+		case OP_INTCAST:	SetInt(d, a.GetInt()); break;
+		case OP_BOOL:		SetInt(d, a.GetBool()); break;
+		case OP_NEGI:		SetInt(d, -a.GetInt()); break;
+		case OP_NEGF:		SetFloat(d, -a.GetFloat()); break;
+		case OP_NOT:		SetInt(d, ~a.GetInt()); break;
+		case OP_LNOT:		SetInt(d, !a.GetBool()); break;
+
+		case OP_ABS:
+		{
+			ExpVal v = a;
+			if (v.Type == VAL_Float) v.Float = fabs(v.Float);
+			else v.Int = abs(v.Int);
+			d = v;
+			break;
+		}
+
+		case OP_ADDI:		SetInt(d, a.GetInt() + b.GetInt()); break;
+		case OP_SUBI:		SetInt(d, a.GetInt() - b.GetInt()); break;
+		case OP_MULI:		SetInt(d, a.GetInt() * b.GetInt()); break;
+		case OP_ADDF:		SetFloat(d, a.GetFloat() + b.GetFloat()); break;
+		case OP_SUBF:		SetFloat(d, a.GetFloat() - b.GetFloat()); break;
+		case OP_MULF:		SetFloat(d, a.GetFloat() * b.GetFloat()); break;
+
+		case OP_DIVI:
+		case OP_MODI:
+		{
+			int v1 = a.GetInt(), v2 = b.GetInt();
+			if (v2 == 0) d = DivisionByZero();
+			else SetInt(d, ins.Op == OP_DIVI ? v1 / v2 : v1 % v2);
+			break;
+		}
+
+		case OP_DIVF:
+		case OP_MODF:
+		{
+			double v1 = a.GetFloat(), v2 = b.GetFloat();
+			if (v2 == 0) d = DivisionByZero();
+			else SetFloat(d, ins.Op == OP_DIVF ? v1 / v2 : fmod(v1, v2));
+			break;
+		}
+
+		case OP_LTI:		SetInt(d, a.GetInt() < b.GetInt()); break;
+		case OP_GTI:		SetInt(d, a.GetInt() > b.GetInt()); break;
+		case OP_LEI:		SetInt(d, a.GetInt() <= b.GetInt()); break;
+		case OP_GEI:		SetInt(d, a.GetInt() >= b.GetInt()); break;
+		case OP_EQI:		SetInt(d, a.GetInt() == b.GetInt()); break;
+		case OP_NEI:		SetInt(d, a.GetInt() != b.GetInt()); break;
+		case OP_LTF:		SetInt(d, a.GetFloat() < b.GetFloat()); break;
+		case OP_GTF:		SetInt(d, a.GetFloat() > b.GetFloat()); break;
+		case OP_LEF:		SetInt(d, a.GetFloat() <= b.GetFloat()); break;
+		case OP_GEF:		SetInt(d, a.GetFloat() >= b.GetFloat()); break;
+		case OP_EQF:		SetInt(d, a.GetFloat() == b.GetFloat()); break;
+		case OP_NEF:		SetInt(d, a.GetFloat() != b.GetFloat()); break;
+
+		case OP_SHL:		SetInt(d, a.GetInt() << b.GetInt()); break;
+		case OP_SHR:		SetInt(d, a.GetInt() >> b.GetInt()); break;
+		case OP_USHR:		SetInt(d, int((unsigned int)(a.GetInt()) >> b.GetInt())); break;
+		case OP_AND:		SetInt(d, a.GetInt() & b.GetInt()); break;
+		case OP_OR:			SetInt(d, a.GetInt() | b.GetInt()); break;
+		case OP_XOR:		SetInt(d, a.GetInt() ^ b.GetInt()); break;
+
+		case OP_JMP:		pc = code + ins.Arg; break;
+		case OP_JMPF:		if (!a.GetBool()) pc = code + ins.Arg; break;
+		case OP_JMPT:		if (a.GetBool()) pc = code + ins.Arg; break;
+
+		case OP_SELF:
+			d.Type = VAL_Object;
+			d.pointer = self;
+			break;
+
+		case OP_SELFINT:
+			SetInt(d, *(int *)(CheckObject(self) + ins.Arg));
+			break;
+
+		case OP_SELFBOOL:
+			SetInt(d, *(bool *)(CheckObject(self) + ins.Arg));
+			break;
+
+		case OP_SELFFIXED:
+			SetFloat(d, (*(fixed_t *)(CheckObject(self) + ins.Arg)) / 65536.);
+			break;
+
+		case OP_SELFANGLE:
+			SetFloat(d, (*(angle_t *)(CheckObject(self) + ins.Arg)) * 90./ANGLE_90);
+			break;
+
+		case OP_SELFFLOAT:
+			SetFloat(d, *(double *)(CheckObject(self) + ins.Arg));
+			break;
+
+		case OP_SELFMEMBER:
+		{
+			PSymbolVariable *var = (PSymbolVariable *)ins.Ptr;
+			d = GetVariableValue(CheckObject(self) + var->offset, var->ValueType);
+			break;
+		}
+
+		case OP_SELFADDR:
+			d.pointer = CheckObject(self) + ins.Arg;
+			d.Type = VAL_Pointer;
+			break;
+
+		case OP_MEMBER:
+		{
+			PSymbolVariable *var = (PSymbolVariable *)ins.Ptr;
+			d = GetVariableValue(CheckObject(a.GetPointer<char>()) + var->offset, var->ValueType);
+			break;
+		}
+
+		case OP_MEMBERADDR:
+		{
+			PSymbolVariable *var = (PSymbolVariable *)ins.Ptr;
+			char *object = CheckObject(a.GetPointer<char>());
+			d.pointer = object + var->offset;
+			d.Type = VAL_Pointer;
+			break;
+		}
+
+		case OP_GLOBAL:
+		{
+			PSymbolVariable *var = (PSymbolVariable *)ins.Ptr;
+			d = GetVariableValue((void*)var->offset, var->ValueType);
+			break;
+		}
+
+		case OP_GLOBALADDR:
+			d.pointer = (void*)((PSymbolVariable *)ins.Ptr)->offset;
+			d.Type = VAL_Pointer;
+			break;
+
+		case OP_INDEX:
+		{
+			int *arraystart = a.GetPointer<int>();
+			int indexval = b.GetInt();
+
+			if (indexval < 0 || indexval >= ins.Arg)
+			{
+				I_Error("Array index out of bounds");
+			}
+			SetInt(d, arraystart[indexval]);
+			break;
+		}
+
+		case OP_FRANDOMRANGE:
+		{
+			double minval = a.GetFloat();
+			double maxval = b.GetFloat();
+
+			if (maxval < minval)
+			{
+				swapvalues (maxval, minval);
+			}
+			SetFloat(d, d.Float * (maxval - minval) + minval);
+			break;
+		}
+
+		case OP_RANDOM:
+			SetInt(d, (*(FRandom *)ins.Ptr)());
+			break;
+
+		case OP_RANDOMRANGE:
+		{
+			int minval = a.GetInt();
+			int maxval = b.GetInt();
+
+			if (maxval < minval)
+			{
+				swapvalues (maxval, minval);
+			}
+			SetInt(d, (*(FRandom *)ins.Ptr)(maxval - minval + 1) + minval);
+			break;
+		}
+
+		case OP_FRANDOM:
+			SetFloat(d, (*(FRandom *)ins.Ptr)(0x40000000) / double(0x40000000));
+			break;
+
+		case OP_RANDOM2:
+			SetInt(d, ((FRandom *)ins.Ptr)->Random2(a.GetInt()));
+			break;
+
+		case OP_EVAL:
+			d = ((FxExpression *)ins.Ptr)->EvalExpression(self);
+			break;
+
+		default:
+			I_Error("Bad DECORATE bytecode %d", ins.Op);
+		}
+	}
+}
+
+//==========================================================================
+//
+// FxProgram
+//
+//==========================================================================
+
+FxProgram::FxProgram()
+{
+	Code = NULL;
+	Constants = NULL;
+	NumInstructions = NumTemps = NumConstants = 0;
+	Pure = true;
+}
+
+FxProgram::~FxProgram()
+{
+	if (Code != NULL) delete[] Code;
+	if (Constants != NULL) delete[] Constants;
+}
+
+//==========================================================================
+//
+// FxProgram :: Execute
+//
+//==========================================================================
+
+ExpVal FxProgram::Execute(AActor *self) const
+{
+	// Constant expressions don't need to run any code.
+	if (Code == NULL)
+	{
+		return Constants[0];
+	}
+
+	ExpVal regs[FX_MAXREGISTERS];
+	memcpy(regs + NumTemps, Constants, NumConstants * sizeof(ExpVal));
+	return RunCode(Code, regs, self);
+}
+
+//==========================================================================
+//
+// FxProgram :: Compile
+//
+// Returns NULL if the expression can't be compiled, in which case it has
+// to be evaluated by walking the tree.
+//
+//==========================================================================
+
+FxProgram *FxProgram::Compile(FxExpression *x)
+{
+	FxCompiler build;
+	return build.Finish(x->Compile(build));
+}
+
+//==========================================================================
+//
+// FxCompiler
+//
+//==========================================================================
+
+FxCompiler::FxCompiler()
+{
+	NextTemp = MaxTemps = 0;
+	LastLabel = 0;
+}
+
+int FxCompiler::AllocTemp()
+{
+	int reg = NextTemp++;
+	if (NextTemp > MaxTemps) MaxTemps = NextTemp;
+	return reg;
+}
+
+//==========================================================================
+//
+// FxCompiler :: GetConstant
+//
+// Returns the register holding the constant, sharing it with earlier
+// uses of the same value.
+//
+//==========================================================================
+
+int FxCompiler::GetConstant(const ExpVal &val)
+{
+	ExpVal copy;
+	memset(&copy, 0, sizeof(copy));
+	copy.Type = val.Type;
+	switch (val.Type)
+	{
+	case VAL_Float:
+		copy.Float = val.Float;
+		break;
+
+	case VAL_Object:
+	case VAL_Class:
+	case VAL_Pointer:
+	case VAL_State:
+		copy.pointer = val.pointer;
+		break;
+
+	default:
+		copy.Int = val.Int;
+		break;
+	}
+	// Compare the cleaned up copy, so that the unused bytes of the union
+	// don't keep equal constants apart.
+	for (unsigned i = 0; i < Constants.Size(); i++)
+	{
+		if (Constants[i].Type == copy.Type && !memcmp(&Constants[i].Float, &copy.Float, sizeof(copy.Float)))
+		{
+			return -1 - int(i);
+		}
+	}
+	return -1 - int(Constants.Push(copy));
+}
+
+int FxCompiler::GetConstant(int val)
+{
+	ExpVal v;
+	SetInt(v, val);
+	return GetConstant(v);
+}
+
+//==========================================================================
+//
+// FxCompiler :: Emit
+//
+//==========================================================================
+
+void FxCompiler::Emit(int op, int dest, int a, int b, int arg)
+{
+	Instruction ins;
+	ins.Op = op;
+	ins.Dest = dest;
+	ins.A = a;
+	ins.B = b;
+	ins.Ptr = NULL;
+	ins.Arg = arg;
+	Code.Push(ins);
+}
+
+void FxCompiler::EmitPtr(int op, int dest, int a, int b, void *ptr)
+{
+	Instruction ins;
+	ins.Op = op;
+	ins.Dest = dest;
+	ins.A = a;
+	ins.B = b;
+	ins.Ptr = ptr;
+	Code.Push(ins);
+}
+
+//==========================================================================
+//
+// FxCompiler :: EmitPure
+//
+// Emits an operation without side effects on A and B (B is ignored by the
+// unary ones). If both operands are constant the operation is carried out
+// right away and only its result is kept. Divisions by zero are left for
+// run time, so that they are still reported the same way.
+//
+//==========================================================================
+
+int FxCompiler::EmitPure(int op, int a, int b, int mark)
+{
+	if (IsConstant(a) && IsConstant(b))
+	{
+		bool fold = true;
+
+		if (op == OP_DIVI || op == OP_MODI)
+		{
+			fold = GetConstantValue(b).GetInt() != 0;
+		}
+		else if (op == OP_DIVF || op == OP_MODF)
+		{
+			fold = GetConstantValue(b).GetFloat() != 0;
+		}
+
+		if (fold)
+		{
+			FxInstruction code[2];
+			ExpVal regs[3];
+
+			memset(code, 0, sizeof(code));
+			regs[0] = GetConstantValue(a);
+			regs[1] = GetConstantValue(b);
+			code[0].Op = op;
+			code[0].Dest = 2;
+			code[0].A = 0;
+			code[0].B = 1;
+			code[1].Op = OP_RET;
+			code[1].A = 2;
+			NumFolded++;
+			return GetConstant(RunCode(code, regs, NULL));
+		}
+	}
+	FreeTemps(mark);
+	int dest = AllocTemp();
+	Emit(op, dest, a, b);
+	return dest;
+}
+
+//==========================================================================
+//
+// FxCompiler :: EmitEval
+//
+// Leaves the expression to the tree walker.
+//
+//==========================================================================
+
+int FxCompiler::EmitEval(FxExpression *x)
+{
+	int dest = AllocTemp();
+	EmitPtr(OP_EVAL, dest, 0, 0, x);
+	return dest;
+}
+
+//==========================================================================
+//
+// FxCompiler :: EmitJump / PatchJump
+//
+//==========================================================================
+
+int FxCompiler::EmitJump(int op, int cond)
+{
+	Emit(op, 0, cond, 0, -1);
+	return Code.Size() - 1;
+}
+
+void FxCompiler::PatchJump(int jump)
+{
+	Code[jump].Arg = LastLabel = Code.Size();
+}
+
+//==========================================================================
+//
+// FxCompiler :: LastOp
+//
+// Returns the last emitted opcode if it produced reg and nothing jumps
+// past it, so that it can be replaced by a combined instruction.
+//
+//==========================================================================
+
+int FxCompiler::LastOp(int reg) const
+{
+	if (Code.Size() == 0 || int(Code.Size()) <= LastLabel || IsConstant(reg))
+	{
+		return -1;
+	}
+	const Instruction &ins = Code[Code.Size() - 1];
+	return ins.Dest == reg ? ins.Op : -1;
+}
+
+int FxCompiler::RemoveLast()
+{
+	Instruction ins;
+	Code.Pop(ins);
+	return ins.Arg;
+}
+
+//==========================================================================
+//
+// FxCompiler :: Finish
+//
+//==========================================================================
+
+FxProgram *FxCompiler::Finish(int result)
+{
+	FxProgram *prog;
+
+	if (Code.Size() == 0 && IsConstant(result))
+	{
+		prog = new FxProgram;
+		prog->Constants = new ExpVal[1];
+		prog->Constants[0] = GetConstantValue(result);
+		prog->NumConstants = 1;
+		NumCompiled++;
+		NumConstant++;
+		return prog;
+	}
+
+	Emit(OP_RET, 0, result);
+	if (MaxTemps + int(Constants.Size()) > FX_MAXREGISTERS)
+	{
+		NumFallbacks++;
+		return NULL;
+	}
+
+	prog = new FxProgram;
+	prog->NumInstructions = Code.Size();
+	prog->NumTemps = MaxTemps;
+	prog->NumConstants = Constants.Size();
+	prog->Code = new FxInstruction[Code.Size()];
+	for (unsigned i = 0; i < Code.Size(); i++)
+	{
+		const Instruction &src = Code[i];
+		FxInstruction &dest = prog->Code[i];
+
+		dest.Op = BYTE(src.Op);
+		dest.Dest = BYTE(MapRegister(src.Dest, MaxTemps));
+		dest.A = BYTE(MapRegister(src.A, MaxTemps));
+		dest.B = BYTE(MapRegister(src.B, MaxTemps));
+		dest.Ptr = src.Ptr;
+		if (src.Op >= OP_RANDOM)
+		{
+			prog->Pure = false;
+		}
+	}
+	if (Constants.Size() > 0)
+	{
+		prog->Constants = new ExpVal[Constants.Size()];
+		memcpy(prog->Constants, &Constants[0], Constants.Size() * sizeof(ExpVal));
+	}
+	NumCompiled++;
+	NumInstructions += Code.Size();
+	return prog;
+}
+
+//==========================================================================
+//
+// FxExpression :: Compile
+//
+// Every Compile method returns the register that holds the result.
+// Anything without a better translation is evaluated by the tree walker.
+//
+//==========================================================================
+
+int FxExpression::Compile(FxCompiler &build)
+{
+	return build.EmitEval(this);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxConstant::Compile(FxCompiler &build)
+{
+	return build.GetConstant(value);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxIntCast::Compile(FxCompiler &build)
+{
+	int mark = build.GetTempMark();
+	int a = basex->Compile(build);
+	return build.EmitPure(OP_INTCAST, a, a, mark);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxMinusSign::Compile(FxCompiler &build)
+{
+	int mark = build.GetTempMark();
+	int a = Operand->Compile(build);
+	return build.EmitPure(ValueType == VAL_Int ? OP_NEGI : OP_NEGF, a, a, mark);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxUnaryNotBitwise::Compile(FxCompiler &build)
+{
+	int mark = build.GetTempMark();
+	int a = Operand->Compile(build);
+	return build.EmitPure(OP_NOT, a, a, mark);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxUnaryNotBoolean::Compile(FxCompiler &build)
+{
+	int mark = build.GetTempMark();
+	int a = Operand->Compile(build);
+	return build.EmitPure(OP_LNOT, a, a, mark);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxAddSub::Compile(FxCompiler &build)
+{
+	bool isfloat = ValueType == VAL_Float;
+	int op;
+
+	switch (Operator)
+	{
+	case '+':	op = isfloat ? OP_ADDF : OP_ADDI; break;
+	case '-':	op = isfloat ? OP_SUBF : OP_SUBI; break;
+	default:	return FxExpression::Compile(build);
+	}
+
+	int mark = build.GetTempMark();
+	int a = left->Compile(build);
+	int b = right->Compile(build);
+	return build.EmitPure(op, a, b, mark);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxMulDiv::Compile(FxCompiler &build)
+{
+	bool isfloat = ValueType == VAL_Float;
+	int op;
+
+	switch (Operator)
+	{
+	case '*':	op = isfloat ? OP_MULF : OP_MULI; break;
+	case '/':	op = isfloat ? OP_DIVF : OP_DIVI; break;
+	case '%':	op = isfloat ? OP_MODF : OP_MODI; break;
+	default:	return FxExpression::Compile(build);
+	}
+
+	int mark = build.GetTempMark();
+	int a = left->Compile(build);
+	int b = right->Compile(build);
+	return build.EmitPure(op, a, b, mark);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxCompareRel::Compile(FxCompiler &build)
+{
+	bool isfloat = left->ValueType == VAL_Float || right->ValueType == VAL_Float;
+	int op;
+
+	switch (Operator)
+	{
+	case '<':		op = isfloat ? OP_LTF : OP_LTI; break;
+	case '>':		op = isfloat ? OP_GTF : OP_GTI; break;
+	case TK_Geq:	op = isfloat ? OP_GEF : OP_GEI; break;
+	case TK_Leq:	op = isfloat ? OP_LEF : OP_LEI; break;
+	default:		return FxExpression::Compile(build);
+	}
+
+	int mark = build.GetTempMark();
+	int a = left->Compile(build);
+	int b = right->Compile(build);
+	return build.EmitPure(op, a, b, mark);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxCompareEq::Compile(FxCompiler &build)
+{
+	int op;
+
+	if (left->ValueType == VAL_Float || right->ValueType == VAL_Float)
+	{
+		op = Operator == TK_Eq ? OP_EQF : OP_NEF;
+	}
+	else if (ValueType == VAL_Int)
+	{
+		op = Operator == TK_Eq ? OP_EQI : OP_NEI;
+	}
+	else
+	{
+		// Pointer comparison is not implemented and doesn't look at the operands.
+		return build.GetConstant(0);
+	}
+
+	int mark = build.GetTempMark();
+	int a = left->Compile(build);
+	int b = right->Compile(build);
+	return build.EmitPure(op, a, b, mark);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxBinaryInt::Compile(FxCompiler &build)
+{
+	int op;
+
+	switch (Operator)
+	{
+	case TK_LShift:		op = OP_SHL; break;
+	case TK_RShift:		op = OP_SHR; break;
+	case TK_URShift:	op = OP_USHR; break;
+	case '&':			op = OP_AND; break;
+	case '|':			op = OP_OR; break;
+	case '^':			op = OP_XOR; break;
+	default:			return FxExpression::Compile(build);
+	}
+
+	int mark = build.GetTempMark();
+	int a = left->Compile(build);
+	int b = right->Compile(build);
+	return build.EmitPure(op, a, b, mark);
+}
+
+//==========================================================================
+//
+// The right operand is skipped with a jump. A constant left operand
+// decides at compile time whether it is needed at all.
+//
+//==========================================================================
+
+int FxBinaryLogical::Compile(FxCompiler &build)
+{
+	if (Operator != TK_AndAnd && Operator != TK_OrOr)
+	{
+		return FxExpression::Compile(build);
+	}
+
+	int mark = build.GetTempMark();
+	int l = left->Compile(build);
+
+	if (build.IsConstant(l))
+	{
+		bool b_left = build.GetConstantValue(l).GetBool();
+
+		if (b_left == (Operator == TK_OrOr))
+		{
+			return build.GetConstant(b_left);
+		}
+		int r = right->Compile(build);
+		return build.EmitPure(OP_BOOL, r, r, mark);
+	}
+
+	build.FreeTemps(mark);
+	int dest = build.AllocTemp();
+	build.Emit(OP_BOOL, dest, l);
+	int jump = build.EmitJump(Operator == TK_AndAnd ? OP_JMPF : OP_JMPT, dest);
+	build.Emit(OP_BOOL, dest, right->Compile(build));
+	build.PatchJump(jump);
+	build.FreeTemps(dest + 1);
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxConditional::Compile(FxCompiler &build)
+{
+	int mark = build.GetTempMark();
+	int cond = condition->Compile(build);
+
+	if (build.IsConstant(cond))
+	{
+		FxExpression *e = build.GetConstantValue(cond).GetBool() ? truex : falsex;
+		return e->Compile(build);
+	}
+
+	build.FreeTemps(mark);
+	int dest = build.AllocTemp();
+	int jump = build.EmitJump(OP_JMPF, cond);
+	build.Emit(OP_MOVE, dest, truex->Compile(build));
+	int skip = build.EmitJump(OP_JMP, 0);
+	build.PatchJump(jump);
+	build.FreeTemps(dest + 1);
+	build.Emit(OP_MOVE, dest, falsex->Compile(build));
+	build.PatchJump(skip);
+	build.FreeTemps(dest + 1);
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxAbs::Compile(FxCompiler &build)
+{
+	int mark = build.GetTempMark();
+	int a = val->Compile(build);
+	return build.EmitPure(OP_ABS, a, a, mark);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxRandom::Compile(FxCompiler &build)
+{
+	int dest;
+
+	if (min != NULL && max != NULL)
+	{
+		int mark = build.GetTempMark();
+		int a = min->Compile(build);
+		int b = max->Compile(build);
+		build.FreeTemps(mark);
+		dest = build.AllocTemp();
+		build.EmitPtr(OP_RANDOMRANGE, dest, a, b, rng);
+	}
+	else
+	{
+		dest = build.AllocTemp();
+		build.EmitPtr(OP_RANDOM, dest, 0, 0, rng);
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+// The random number is generated before the range is evaluated.
+//
+//==========================================================================
+
+int FxFRandom::Compile(FxCompiler &build)
+{
+	int dest = build.AllocTemp();
+
+	build.EmitPtr(OP_FRANDOM, dest, 0, 0, rng);
+	if (min != NULL && max != NULL)
+	{
+		int a = min->Compile(build);
+		int b = max->Compile(build);
+		build.Emit(OP_FRANDOMRANGE, dest, a, b);
+		build.FreeTemps(dest + 1);
+	}
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxRandom2::Compile(FxCompiler &build)
+{
+	int mark = build.GetTempMark();
+	int a = mask->Compile(build);
+	build.FreeTemps(mark);
+	int dest = build.AllocTemp();
+	build.EmitPtr(OP_RANDOM2, dest, a, 0, rng);
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxSelf::Compile(FxCompiler &build)
+{
+	int dest = build.AllocTemp();
+	build.Emit(OP_SELF, dest);
+	return dest;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FxGlobalVariable::Compile(FxCompiler &build)
+{
+	int dest = build.AllocTemp();
+	build.EmitPtr(AddressRequested ? OP_GLOBALADDR : OP_GLOBAL, dest, 0, 0, var);
+	return dest;
+}
+
+//==========================================================================
+//
+// Members of self are by far the most common case, so loading self and
+// reading the member is combined into a single instruction.
+//
+//==========================================================================
+
+int FxClassMember::Compile(FxCompiler &build)
+{
+	if (classx->ValueType == VAL_Class)
+	{
+		return FxExpression::Compile(build);
+	}
+
+	int mark = build.GetTempMark();
+	int a = classx->Compile(build);
+
+	if (build.LastOp(a) == OP_SELF)
+	{
+		int op = OP_SELFMEMBER;
+
+		build.RemoveLast();
+		if (AddressRequested)
+		{
+			op = OP_SELFADDR;
+		}
+		else switch (membervar->ValueType.Type)
+		{
+		case VAL_Int:	op = OP_SELFINT; break;
+		case VAL_Bool:	op = OP_SELFBOOL; break;
+		case VAL_Fixed:	op = OP_SELFFIXED; break;
+		case VAL_Angle:	op = OP_SELFANGLE; break;
+		case VAL_Float:	op = OP_SELFFLOAT; break;
+		default:		break;
+		}
+
+		if (op == OP_SELFMEMBER)
+		{
+			build.EmitPtr(op, a, 0, 0, membervar);
+		}
+		else
+		{
+			build.Emit(op, a, 0, 0, int(membervar->offset));
+		}
+		return a;
+	}
+
+	build.FreeTemps(mark);
+	int dest = build.AllocTemp();
+	build.EmitPtr(AddressRequested ? OP_MEMBERADDR : OP_MEMBER, dest, a, 0, membervar);
+	return dest;
+}
+
+//==========================================================================
+//
+// A constant index into an array of self turns into a plain member load.
+//
+//==========================================================================
+
+int FxArrayElement::Compile(FxCompiler &build)
+{
+	int mark = build.GetTempMark();
+	int a = Array->Compile(build);
+	int b = index->Compile(build);
+
+	if (build.IsConstant(b) && build.LastOp(a) == OP_SELFADDR)
+	{
+		int indexval = build.GetConstantValue(b).GetInt();
+
+		if (indexval >= 0 && indexval < Array->ValueType.size)
+		{
+			int offset = build.RemoveLast();
+			build.Emit(OP_SELFINT, a, 0, 0, offset + indexval * int(sizeof(int)));
+			return a;
+		}
+	}
+
+	build.FreeTemps(mark);
+	int dest = build.AllocTemp();
+	build.Emit(OP_INDEX, dest, a, b, Array->ValueType.size);
+	return dest;
+}
+
+//==========================================================================
+//
+// FStateExpressions :: CompileAll
+//
+// Called once all expressions have been resolved. Copied entries share
+// the program of the expression they were copied from.
+//
+//==========================================================================
+
+void FStateExpressions::CompileAll()
+{
+	TMap<FxExpression *, FxProgram *> compiled;
+
+	FxCompiler::NumCompiled = FxCompiler::NumFallbacks = FxCompiler::NumConstant = 0;
+	FxCompiler::NumInstructions = FxCompiler::NumFolded = 0;
+
+	for (unsigned i = 0; i < Size(); i++)
+	{
+		FStateExpression &exp = expressions[i];
+
+		if (exp.expr == NULL)
+		{
+			continue;
+		}
+		if (exp.cloned)
+		{
+			FxProgram **code = compiled.CheckKey(exp.expr);
+			exp.code = code != NULL ? *code : NULL;
+		}
+		else
+		{
+			exp.code = FxProgram::Compile(exp.expr);
+			compiled[exp.expr] = exp.code;
+		}
+	}
+	DPrintf("Compiled %d DECORATE expressions (%d constant) to %d instructions, %d folded operations, %d left to the tree walker\n",
+		FxCompiler::NumCompiled, FxCompiler::NumConstant, FxCompiler::NumInstructions,
+		FxCompiler::NumFolded, FxCompiler::NumFallbacks);
+}
+
+//==========================================================================
+//
+// FStateExpressions :: Evaluate
+//
+//==========================================================================
+
+bool FStateExpressions::Evaluate(int num, AActor *self, ExpVal &val)
+{
+	if (num < 0 || num >= int(Size()))
+	{
+		return false;
+	}
+
+	const FStateExpression &exp = expressions[num];
+
+	if (exp.code != NULL && decorate_bytecode)
+	{
+		val = exp.code->Execute(self);
+	}
+	else if (exp.expr != NULL)
+	{
+		val = exp.expr->EvalExpression(self);
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FStateExpressions :: Benchmark
+//
+// Evaluates every expression without side effects against the given
+// actor, once by walking the tree and once with the bytecode, and checks
+// that both produce the same values.
+//
+//==========================================================================
+
+static bool SameValue(const ExpVal &a, const ExpVal &b)
+{
+	if (a.Type != b.Type)
+	{
+		return false;
+	}
+	switch (a.Type)
+	{
+	case VAL_Float:
+		return a.Float == b.Float || (a.Float != a.Float && b.Float != b.Float);
+
+	case VAL_Object:
+	case VAL_Class:
+	case VAL_Pointer:
+	case VAL_State:
+		return a.pointer == b.pointer;
+
+	default:
+		return a.Int == b.Int;
+	}
+}
+
+void FStateExpressions::Benchmark(AActor *self, int iterations)
+{
+	TArray<unsigned int> list;
+	unsigned int skipped = 0, mismatches = 0, instructions = 0;
+
+	for (unsigned i = 0; i < Size(); i++)
+	{
+		const FStateExpression &exp = expressions[i];
+
+		if (exp.expr == NULL || exp.cloned)
+		{
+			continue;
+		}
+		// Random numbers and anything left to the tree walker may have
+		// side effects, which a benchmark must not cause.
+		if (exp.code == NULL || !exp.code->IsPure())
+		{
+			skipped++;
+			continue;
+		}
+		if (!SameValue(exp.expr->EvalExpression(self), exp.code->Execute(self)))
+		{
+			mismatches++;
+			continue;
+		}
+		list.Push(i);
+		instructions += exp.code->GetCodeSize();
+	}
+
+	if (list.Size() == 0)
+	{
+		Printf("There are no DECORATE expressions to benchmark.\n");
+		return;
+	}
+
+	cycle_t treetime, codetime;
+	unsigned int checksum = 0;
+
+	treetime.Reset();
+	treetime.Clock();
+	for (int iter = 0; iter < iterations; iter++)
+	{
+		for (unsigned i = 0; i < list.Size(); i++)
+		{
+			checksum += expressions[list[i]].expr->EvalExpression(self).Int;
+		}
+	}
+	treetime.Unclock();
+
+	codetime.Reset();
+	codetime.Clock();
+	for (int iter = 0; iter < iterations; iter++)
+	{
+		for (unsigned i = 0; i < list.Size(); i++)
+		{
+			checksum -= expressions[list[i]].code->Execute(self).Int;
+		}
+	}
+	codetime.Unclock();
+
+	double evals = double(list.Size()) * iterations;
+	double treems = treetime.TimeMS();
+	double codems = codetime.TimeMS();
+
+	Printf("%u expressions (%u instructions), %u skipped, %u mismatches, %d iterations\n",
+		list.Size(), instructions, skipped, mismatches, iterations);
+	Printf("Tree:     %8.2f ms, %6.2f M evaluations/s\n", treems, treems > 0 ? evals / treems / 1000. : 0.);
+	Printf("Bytecode: %8.2f ms, %6.2f M evaluations/s\n", codems, codems > 0 ? evals / codems / 1000. : 0.);
+	if (codems > 0)
+	{
+		Printf("Speedup:  %.2fx\n", treems / codems);
+	}
+	if (checksum != 0 && mismatches == 0)
+	{
+		// Both loops have to produce the same values, so this can't happen.
+		Printf("Bytecode results differ from the tree walker\n");
+	}
+}
+
+//==========================================================================
+//
+// CCMD decoratebench
+//
+// Measures the evaluation throughput of all loaded DECORATE expressions
+// against the console player's actor.
+//
+//==========================================================================
+
+CCMD (decoratebench)
+{
+	if (gamestate != GS_LEVEL || players[consoleplayer].mo == NULL)
+	{
+		Printf("You must be in a level to run the benchmark.\n");
+		return;
+	}
+
+	int iterations = argv.argc() > 1 ? atoi(argv[1]) : 1000;
+	if (iterations <= 0)
+	{
+		Printf("Usage: decoratebench [iterations]\n");
+		return;
+	}
+	StateParams.Benchmark(players[consoleplayer].mo, iterations);
+}
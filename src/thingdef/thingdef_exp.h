@@ -142,6 +142,59 @@ struct ExpVal
 
 };
 
+ExpVal GetVariableValue (void *address, FExpressionType &type);
+ExpVal handleClientDivisionByZero ( void );
+
+
+//==========================================================================
+//
+//	FxProgram
+//
+//	A resolved expression lowered to a flat list of register based
+//	instructions. Constants are kept in the registers after the
+//	temporaries and get copied in before the code runs.
+//
+//==========================================================================
+
+class FxExpression;
+class FxCompiler;
+
+struct FxInstruction
+{
+	BYTE Op;
+	BYTE Dest;
+	BYTE A;
+	BYTE B;
+	union
+	{
+		int Arg;
+		void *Ptr;
+	};
+};
+
+class FxProgram
+{
+public:
+	FxProgram();
+	~FxProgram();
+
+	static FxProgram *Compile(FxExpression *x);
+
+	ExpVal Execute(AActor *self) const;
+	bool IsPure() const { return Pure; }
+	int GetCodeSize() const { return NumInstructions; }
+
+private:
+	FxInstruction *Code;
+	ExpVal *Constants;
+	int NumInstructions;
+	int NumTemps;
+	int NumConstants;
+	bool Pure;
+
+	friend class FxCompiler;
+};
+
 
 //==========================================================================
 //
@@ -163,6 +216,7 @@ public:
 	FxExpression *ResolveAsBoolean(FCompileContext &ctx);
 	
 	virtual ExpVal EvalExpression (AActor *self);
+	virtual int Compile(FxCompiler &build);
 	virtual bool isConstant() const;
 	virtual void RequestAddress();
 
@@ -290,6 +344,7 @@ public:
 		return true;
 	}
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 
@@ -310,6 +365,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 
@@ -344,6 +400,7 @@ public:
 	~FxMinusSign();
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -361,6 +418,7 @@ public:
 	~FxUnaryNotBitwise();
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -378,6 +436,7 @@ public:
 	~FxUnaryNotBoolean();
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -411,6 +470,7 @@ public:
 	FxAddSub(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -426,6 +486,7 @@ public:
 	FxMulDiv(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -441,6 +502,7 @@ public:
 	FxCompareRel(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -456,6 +518,7 @@ public:
 	FxCompareEq(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -471,6 +534,7 @@ public:
 	FxBinaryInt(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -491,6 +555,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -511,6 +576,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -530,6 +596,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -551,6 +618,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -564,6 +632,7 @@ class FxFRandom : public FxRandom
 public:
 	FxFRandom(FRandom *, FxExpression *mi, FxExpression *ma, const FScriptPosition &pos);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -584,6 +653,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 
@@ -603,6 +673,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 	void RequestAddress();
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -623,6 +694,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 	void RequestAddress();
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -637,6 +709,7 @@ public:
 	FxSelf(const FScriptPosition&);
 	FxExpression *Resolve(FCompileContext&);
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 //==========================================================================
@@ -657,6 +730,7 @@ public:
 	FxExpression *Resolve(FCompileContext&);
 	//void RequestAddress();
 	ExpVal EvalExpression (AActor *self);
+	int Compile(FxCompiler &build);
 };
 
 
@@ -102,42 +102,40 @@ DEFINE_MEMBER_VARIABLE(meleerange, AActor)
 
 int EvalExpressionI (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Evaluate(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetInt();
+	return val.GetInt();
 }
 
 int EvalExpressionCol (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Evaluate(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetColor();
+	return val.GetColor();
 }
 
 FSoundID EvalExpressionSnd (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Evaluate(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetSoundID();
+	return val.GetSoundID();
 }
 
 double EvalExpressionF (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Evaluate(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetFloat();
+	return val.GetFloat();
 }
 
 fixed_t EvalExpressionFix (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
-
-	ExpVal val = x->EvalExpression (self);
+	ExpVal val;
+	if (!StateParams.Evaluate(xi, self, val)) return 0;
 
 	switch (val.Type)
 	{
@@ -152,26 +150,26 @@ fixed_t EvalExpressionFix (DWORD xi, AActor *self)
 
 FName EvalExpressionName (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Evaluate(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetName();
+	return val.GetName();
 }
 
 const PClass * EvalExpressionClass (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Evaluate(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetClass();
+	return val.GetClass();
 }
 
 FState *EvalExpressionState (DWORD xi, AActor *self)
 {
-	FxExpression *x = StateParams.Get(xi);
-	if (x == NULL) return 0;
+	ExpVal val;
+	if (!StateParams.Evaluate(xi, self, val)) return 0;
 
-	return x->EvalExpression (self).GetState();
+	return val.GetState();
 }
 
 
@@ -181,7 +179,7 @@ FState *EvalExpressionState (DWORD xi, AActor *self)
 //
 //==========================================================================
 
-static ExpVal GetVariableValue (void *address, FExpressionType &type)
+ExpVal GetVariableValue (void *address, FExpressionType &type)
 {
 	// NOTE: This cannot access native variables of types
 	// char, short and float. These need to be redefined if necessary!
@@ -976,7 +974,7 @@ FxExpression *FxMulDiv::Resolve(FCompileContext& ctx)
 
 
 // [BB]
-static inline ExpVal handleClientDivisionByZero ( void )
+ExpVal handleClientDivisionByZero ( void )
 {
 	ExpVal ret;
 
@@ -2781,6 +2779,10 @@ void FStateExpressions::Clear()
 		{
 			delete expressions[i].expr;
 		}
+		if (expressions[i].code != NULL && !expressions[i].cloned)
+		{
+			delete expressions[i].code;
+		}
 	}
 	expressions.Clear();
 }
@@ -2796,6 +2798,7 @@ int FStateExpressions::Add(FxExpression *x, const PClass *o, bool c)
 	int idx = expressions.Reserve(1);
 	FStateExpression &exp = expressions[idx];
 	exp.expr = x;
+	exp.code = NULL;
 	exp.owner = o;
 	exp.constant = c;
 	exp.cloned = false;
@@ -2815,6 +2818,7 @@ int FStateExpressions::Reserve(int num, const PClass *cls)
 	for(int i=0; i<num; i++)
 	{
 		exp[i].expr = NULL;
+		exp[i].code = NULL;
 		exp[i].owner = cls;
 		exp[i].constant = false;
 		exp[i].cloned = false;
@@ -61,6 +61,7 @@
 #include "sv_commands.h"
 #include "templates.h"
 #include "d_netinf.h"
+#include "stats.h"
 
 CVAR(Flag, sv_nounlagged, zadmflags, ZADF_NOUNLAGGED);
 CVAR( Bool, sv_unlagged_debugactors, false, 0 )
@@ -68,12 +69,49 @@ CVAR( Bool, sv_unlagged_debugactors, false, 0 )
 bool reconciledGame = false;
 int reconciliationBlockers = 0;
 
+// A sector whose floor or ceiling moved during the last UNLAGGEDTICS tics. Sectors that
+// didn't move during that time are at their unlagged position anyway, so only these need
+// to be recorded, reconciled and restored.
+struct UnlaggedSector
+{
+	sector_t	*sector;
+
+	// The gametic during which the sector moved the last time.
+	int			lastMoveTic;
+
+	fixed_t		floorD[UNLAGGEDTICS];
+	fixed_t		ceilingD[UNLAGGEDTICS];
+	fixed_t		restoreFloorD;
+	fixed_t		restoreCeilingD;
+};
+
+static TArray<UnlaggedSector> movingSectors;
+
+// For every sector of the level its index in movingSectors, or -1 if it's not in there.
+static TArray<int> movingSectorIndices;
+
+// Number of sector planes accessed by the unlagged module, for "stat unlagged".
+struct UnlaggedStats
+{
+	int reconciliations;
+	int sectorsAccessed;
+	int sectorsAccessedBefore; // What the same work cost when all sectors were handled.
+};
+
+static UnlaggedStats thisTicStats;
+static UnlaggedStats lastTicStats;
+
+static void unlagged_RemoveMovingSector( unsigned int index );
+
 void UNLAGGED_Tick( void )
 {
 	// [BB] Only the server has to do anything here.
 	if ( NETWORK_GetState() != NETSTATE_SERVER )
 		return;
 
+	lastTicStats = thisTicStats;
+	memset( &thisTicStats, 0, sizeof( thisTicStats ));
+
 	// [Spleen] Record sectors soon before they are reconciled/restored
 	UNLAGGED_RecordSectors( );
 
@@ -156,16 +194,25 @@ void UNLAGGED_Reconcile( AActor *actor )
 	//find the index
 	const int unlaggedIndex = unlaggedGametic % UNLAGGEDTICS;
 
-	//reconcile the sectors
-	for (int i = 0; i < numsectors; ++i)
+	//reconcile the sectors that moved recently, all others are already where they were back then
+	for (unsigned int i = 0; i < movingSectors.Size(); ++i)
 	{
-		sectors[i].floorplane.restoreD = sectors[i].floorplane.d;
-		sectors[i].ceilingplane.restoreD = sectors[i].ceilingplane.d;
+		UnlaggedSector &entry = movingSectors[i];
 
-		sectors[i].floorplane.d = sectors[i].floorplane.unlaggedD[unlaggedIndex];
-		sectors[i].ceilingplane.d = sectors[i].ceilingplane.unlaggedD[unlaggedIndex];
+		entry.restoreFloorD = entry.sector->floorplane.d;
+		entry.restoreCeilingD = entry.sector->ceilingplane.d;
+
+		entry.sector->floorplane.d = entry.floorD[unlaggedIndex];
+		entry.sector->ceilingplane.d = entry.ceilingD[unlaggedIndex];
 	}
 
+	if ( movingSectors.Size() > 0 )
+		P_InvalidateSightCache( );
+
+	thisTicStats.reconciliations++;
+	thisTicStats.sectorsAccessed += movingSectors.Size();
+	thisTicStats.sectorsAccessedBefore += numsectors;
+
 	//reconcile the players
 	for (int i = 0; i < MAXPLAYERS; ++i)
 	{
@@ -215,7 +262,7 @@ void UNLAGGED_Reconcile( AActor *actor )
 				//floor moved up - a client might have mispredicted himself too low due to gravity
 				//and the client thinking the floor is lower than it actually is
 				// [BB] But only do this if the sector actually moved. Note: This adjustment seems to break on some kind of non-moving 3D floors.
-				if ( (serverFloorZ > actor->floorz) && (( actor->Sector->floorplane.restoreD != actor->Sector->floorplane.d ) || ( actor->Sector->ceilingplane.restoreD != actor->Sector->ceilingplane.d )) )
+				if ( (serverFloorZ > actor->floorz) && UNLAGGED_IsSectorReconciledElsewhere( actor->Sector ) )
 				{
 					//shooter was standing on the floor, let's pull him down to his floor if
 					//he wasn't falling
@@ -236,11 +283,15 @@ void UNLAGGED_SwapSectorUnlaggedStatus( )
 	if ( reconciledGame == false )
 		return;
 
-	for (int i = 0; i < numsectors; ++i)
+	for (unsigned int i = 0; i < movingSectors.Size(); ++i)
 	{
-		swapvalues ( sectors[i].floorplane.d, sectors[i].floorplane.restoreD );
-		swapvalues ( sectors[i].ceilingplane.d, sectors[i].ceilingplane.restoreD );
+		UnlaggedSector &entry = movingSectors[i];
+		swapvalues ( entry.sector->floorplane.d, entry.restoreFloorD );
+		swapvalues ( entry.sector->ceilingplane.d, entry.restoreCeilingD );
 	}
+
+	thisTicStats.sectorsAccessed += movingSectors.Size();
+	thisTicStats.sectorsAccessedBefore += numsectors;
 }
 
 // Restore everything that has been shifted
@@ -255,12 +306,19 @@ void UNLAGGED_Restore( AActor *actor )
 		return;
 
 	//restore the sectors
-	for (int i = 0; i < numsectors; ++i)
+	for (unsigned int i = 0; i < movingSectors.Size(); ++i)
 	{
-		sectors[i].floorplane.d = sectors[i].floorplane.restoreD;
-		sectors[i].ceilingplane.d = sectors[i].ceilingplane.restoreD;
+		UnlaggedSector &entry = movingSectors[i];
+		entry.sector->floorplane.d = entry.restoreFloorD;
+		entry.sector->ceilingplane.d = entry.restoreCeilingD;
 	}
 
+	if ( movingSectors.Size() > 0 )
+		P_InvalidateSightCache( );
+
+	thisTicStats.sectorsAccessed += movingSectors.Size();
+	thisTicStats.sectorsAccessedBefore += numsectors;
+
 	//restore the players
 	for (int i = 0; i < MAXPLAYERS; ++i)
 	{
@@ -329,12 +387,92 @@ void UNLAGGED_RecordSectors( )
 	//find the index
 	const int unlaggedIndex = gametic % UNLAGGEDTICS;
 
-	//record the sectors
+	//record the sectors that moved recently
+	for (unsigned int i = 0; i < movingSectors.Size(); )
+	{
+		UnlaggedSector &entry = movingSectors[i];
+
+		// The sector has been standing still for all the tics we keep, so it doesn't
+		// need to be handled anymore.
+		if ( gametic - entry.lastMoveTic >= UNLAGGEDTICS )
+		{
+			unlagged_RemoveMovingSector( i );
+			continue;
+		}
+
+		entry.floorD[unlaggedIndex] = entry.sector->floorplane.d;
+		entry.ceilingD[unlaggedIndex] = entry.sector->ceilingplane.d;
+		++i;
+	}
+
+	thisTicStats.sectorsAccessed += movingSectors.Size();
+	thisTicStats.sectorsAccessedBefore += numsectors;
+}
+
+// Prepare the sector recording for a new level. Must be called after the sectors were loaded.
+void UNLAGGED_SetupLevel( )
+{
+	movingSectors.Clear();
+	movingSectorIndices.Resize( numsectors );
 	for (int i = 0; i < numsectors; ++i)
+		movingSectorIndices[i] = -1;
+}
+
+// Must be called before the floor or ceiling of a sector is moved, so that the sector's current
+// position can be recorded for the tics before.
+void UNLAGGED_SectorMoving( sector_t *sector )
+{
+	//Only do anything if it's on a server
+	if (NETWORK_GetState() != NETSTATE_SERVER)
+		return;
+
+	const int sectorNum = static_cast<int> ( sector - sectors );
+	if ( ( sectorNum < 0 ) || ( sectorNum >= static_cast<int> ( movingSectorIndices.Size() ) ) )
+		return;
+
+	if ( movingSectorIndices[sectorNum] < 0 )
+	{
+		// The sector didn't move during the last UNLAGGEDTICS tics, so it has been at
+		// its current position during all of them.
+		UnlaggedSector entry;
+		entry.sector = sector;
+		for (int i = 0; i < UNLAGGEDTICS; ++i)
+		{
+			entry.floorD[i] = sector->floorplane.d;
+			entry.ceilingD[i] = sector->ceilingplane.d;
+		}
+		entry.restoreFloorD = sector->floorplane.d;
+		entry.restoreCeilingD = sector->ceilingplane.d;
+
+		movingSectorIndices[sectorNum] = movingSectors.Push( entry );
+	}
+
+	movingSectors[movingSectorIndices[sectorNum]].lastMoveTic = gametic;
+}
+
+// Is the sector at a different position than it actually is (only meaningful while the game is reconciled)?
+bool UNLAGGED_IsSectorReconciledElsewhere( const sector_t *sector )
+{
+	const int sectorNum = static_cast<int> ( sector - sectors );
+	if ( ( sectorNum < 0 ) || ( sectorNum >= static_cast<int> ( movingSectorIndices.Size() ) ) || ( movingSectorIndices[sectorNum] < 0 ) )
+		return false;
+
+	const UnlaggedSector &entry = movingSectors[movingSectorIndices[sectorNum]];
+	return ( entry.restoreFloorD != sector->floorplane.d ) || ( entry.restoreCeilingD != sector->ceilingplane.d );
+}
+
+static void unlagged_RemoveMovingSector( unsigned int index )
+{
+	movingSectorIndices[movingSectors[index].sector - sectors] = -1;
+
+	// Fill the gap with the last entry.
+	const unsigned int lastIndex = movingSectors.Size() - 1;
+	if ( index != lastIndex )
 	{
-		sectors[i].floorplane.unlaggedD[unlaggedIndex] = sectors[i].floorplane.d;
-		sectors[i].ceilingplane.unlaggedD[unlaggedIndex] = sectors[i].ceilingplane.d;
+		movingSectors[index] = movingSectors[lastIndex];
+		movingSectorIndices[movingSectors[index].sector - sectors] = index;
 	}
+	movingSectors.Delete( lastIndex );
 }
 
 bool UNLAGGED_DrawRailClientside ( AActor *attacker )
@@ -439,3 +577,13 @@ void UNLAGGED_SpawnDebugActors ( )
 		pActor->Destroy();
 	}
 }
+
+ADD_STAT( unlagged )
+{
+	FString out;
+	out.Format( "%d of %d sectors moving, last tic: %d reconciliation%s, %d sector accesses (%d when handling all sectors)",
+		static_cast<int> ( movingSectors.Size() ), numsectors,
+		lastTicStats.reconciliations, lastTicStats.reconciliations == 1 ? "" : "s",
+		lastTicStats.sectorsAccessed, lastTicStats.sectorsAccessedBefore );
+	return out;
+}
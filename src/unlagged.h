@@ -63,6 +63,9 @@ void	UNLAGGED_Restore( AActor *actor );
 void	UNLAGGED_RecordPlayer( player_t *player );
 void	UNLAGGED_ResetPlayer( player_t *player );
 void	UNLAGGED_RecordSectors( );
+void	UNLAGGED_SetupLevel( );
+void	UNLAGGED_SectorMoving( sector_t *sector );
+bool	UNLAGGED_IsSectorReconciledElsewhere( const sector_t *sector );
 bool	UNLAGGED_DrawRailClientside ( AActor *attacker );
 void	UNLAGGED_GetHitOffset ( const AActor *attacker, const FTraceResults &trace, TVector3<fixed_t> &hitOffset );
 bool	UNLAGGED_IsReconciled ( );
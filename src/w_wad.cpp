@@ -41,6 +41,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <string.h>
+#include <thread>
 
 #include "doomtype.h"
 #include "m_argv.h"
@@ -56,6 +57,7 @@
 #include "doomerrors.h"
 #include "resourcefiles/resourcefile.h"
 #include "md5.h"
+#include "workerpool.h"
 // [TP]
 #include "c_cvars.h"
 
@@ -1152,6 +1154,200 @@ FMemLump FWadCollection::ReadLump (int lump)
 	return FMemLump(FString(ELumpNum(lump)));
 }
 
+//==========================================================================
+//
+// PrefetchLumps
+//
+// Loads the given lumps into their caches before they get parsed. For
+// lumps in compressed archives this includes decompressing them, which
+// is where most of the time goes. Lumps from different files are read on
+// separate threads. Lumps that share a file are read one after another by
+// the same thread, because they share its file position.
+//
+// On return the list only contains the lumps that were actually cached.
+// Lumps that are read directly from their file or were already cached
+// are dropped. The caller must release the cached lumps with
+// ReleasePrefetchedLumps.
+//
+// If includes is not NULL, the names of all files that the lumps include
+// with #include or include are added to it.
+//
+//==========================================================================
+
+enum { MAX_PREFETCH_THREADS = 8 };
+
+struct FPrefetchInclude
+{
+	const char *Start;
+	int Length;
+};
+
+struct FPrefetchGroup
+{
+	const void *Key;
+	TArray<FResourceLump *> Lumps;
+	TArray<FPrefetchInclude> Includes;
+};
+
+static void ScanIncludes (const char *text, int size, TArray<FPrefetchInclude> &includes)
+{
+	const char *p = text, *end = text + size;
+
+	// This only needs to find the includes, not to understand the lump,
+	// so anything looking like one at the start of a line counts. Looking
+	// for a file that isn't really included costs nothing but a lookup.
+	while (p < end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t')) p++;
+		if (p < end && *p == '#') p++;
+		if (end - p > 7 && strnicmp (p, "include", 7) == 0)
+		{
+			p += 7;
+			while (p < end && (*p == ' ' || *p == '\t')) p++;
+			if (p < end && *p == '"')
+			{
+				const char *start = ++p;
+				while (p < end && *p != '"' && *p != '\n') p++;
+				if (p < end && *p == '"' && p > start)
+				{
+					FPrefetchInclude inc = { start, int(p - start) };
+					includes.Push (inc);
+				}
+			}
+		}
+		while (p < end && *p != '\n') p++;
+		p++;
+	}
+}
+
+static void PrefetchGroup (FPrefetchGroup &group, bool scanincludes)
+{
+	for (unsigned i = 0; i < group.Lumps.Size(); i++)
+	{
+		FResourceLump *lump = group.Lumps[i];
+
+		try
+		{
+			lump->CacheLump ();
+		}
+		catch (...)
+		{
+			// Leave the error to the parser, which will report it when it
+			// reads the lump itself.
+			if (lump->RefCount == 0 && lump->Cache != NULL)
+			{
+				delete[] lump->Cache;
+				lump->Cache = NULL;
+			}
+			continue;
+		}
+		if (scanincludes && lump->Cache != NULL)
+		{
+			ScanIncludes (lump->Cache, lump->LumpSize, group.Includes);
+		}
+	}
+}
+
+int FWadCollection::PrefetchLumps (TArray<int> &lumps, TArray<FString> *includes)
+{
+	TArray<FPrefetchGroup> groups;
+	TArray<int> pending;
+
+	for (unsigned i = 0; i < lumps.Size(); i++)
+	{
+		int lumpnum = lumps[i];
+
+		if ((unsigned)lumpnum >= NumLumps)
+		{
+			continue;
+		}
+
+		FResourceLump *lump = LumpInfo[lumpnum].lump;
+
+		if (lump->LumpSize <= 0 || lump->Cache != NULL || IsUncompressedFile (lumpnum))
+		{
+			continue;
+		}
+
+		// Lumps of files nested in another file may share the FILE of the outer one.
+		FileReader *reader = lump->Owner != NULL ? lump->Owner->Reader : NULL;
+		const void *key = (reader != NULL && reader->GetFile() != NULL) ? (const void *)reader->GetFile() : (const void *)lump->Owner;
+		unsigned j;
+
+		for (j = 0; j < groups.Size() && groups[j].Key != key; j++)
+		{
+		}
+		if (j == groups.Size())
+		{
+			groups.Reserve (1);
+			groups[j].Key = key;
+		}
+		// The same lump may be requested twice, e.g. when it is included twice.
+		unsigned k;
+		for (k = 0; k < groups[j].Lumps.Size() && groups[j].Lumps[k] != lump; k++)
+		{
+		}
+		if (k < groups[j].Lumps.Size())
+		{
+			continue;
+		}
+		groups[j].Lumps.Push (lump);
+		pending.Push (lumpnum);
+	}
+
+	lumps.Clear ();
+	if (groups.Size() == 0)
+	{
+		return 0;
+	}
+
+	unsigned int numThreads = std::thread::hardware_concurrency ();
+	if (numThreads > MAX_PREFETCH_THREADS) numThreads = MAX_PREFETCH_THREADS;
+
+	bool scanincludes = includes != NULL;
+	FWorkerPool::ParallelFor (groups.Size(), numThreads, [&groups, scanincludes] (unsigned int index)
+	{
+		PrefetchGroup (groups[index], scanincludes);
+	});
+
+	for (unsigned i = 0; i < pending.Size(); i++)
+	{
+		FResourceLump *lump = LumpInfo[pending[i]].lump;
+		if (lump->Cache != NULL && lump->RefCount > 0)
+		{
+			lumps.Push (pending[i]);
+		}
+	}
+	if (includes != NULL)
+	{
+		for (unsigned i = 0; i < groups.Size(); i++)
+		{
+			for (unsigned j = 0; j < groups[i].Includes.Size(); j++)
+			{
+				includes->Push (FString (groups[i].Includes[j].Start, groups[i].Includes[j].Length));
+			}
+		}
+	}
+	return lumps.Size();
+}
+
+//==========================================================================
+//
+// ReleasePrefetchedLumps
+//
+//==========================================================================
+
+void FWadCollection::ReleasePrefetchedLumps (const TArray<int> &lumps)
+{
+	for (unsigned i = 0; i < lumps.Size(); i++)
+	{
+		if ((unsigned)lumps[i] < NumLumps)
+		{
+			LumpInfo[lumps[i]].lump->ReleaseCache ();
+		}
+	}
+}
+
 //==========================================================================
 //
 // OpenLumpNum
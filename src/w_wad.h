@@ -177,6 +177,9 @@ public:
 	FMemLump ReadLump (int lump);
 	FMemLump ReadLump (const char *name) { return ReadLump (GetNumForName (name)); }
 
+	int PrefetchLumps (TArray<int> &lumps, TArray<FString> *includes = NULL);	// Caches lumps ahead of parsing, several files at once
+	void ReleasePrefetchedLumps (const TArray<int> &lumps);
+
 	FWadLump OpenLumpNum (int lump);
 	FWadLump OpenLumpName (const char *name) { return OpenLumpNum (GetNumForName (name)); }
 	FWadLump *ReopenLumpNum (int lump);	// Opens a new, independent FILE
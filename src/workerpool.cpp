@@ -0,0 +1,191 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: workerpool.cpp
+//
+// Description: A pool of worker threads that run the same task side by side.
+//
+//-----------------------------------------------------------------------------
+
+#include <atomic>
+#include "templates.h"
+#include "workerpool.h"
+
+//==========================================================================
+//
+// FWorkerPool
+//
+//==========================================================================
+
+FWorkerPool::FWorkerPool()
+	: Generation(0), NumBusyThreads(0), Quit(false)
+{
+}
+
+FWorkerPool::~FWorkerPool()
+{
+	SetNumThreads(0);
+}
+
+void FWorkerPool::SetNumThreads(unsigned int numThreads)
+{
+	if (numThreads == Threads.Size())
+	{
+		return;
+	}
+
+	Wait();
+
+	if (Threads.Size() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Quit = true;
+		}
+		WorkAvailable.notify_all();
+		for (unsigned int i = 0; i < Threads.Size(); ++i)
+		{
+			Threads[i]->join();
+			delete Threads[i];
+		}
+		Threads.Clear();
+		Quit = false;
+	}
+
+	// The new threads must only react to tasks started from now on, so they
+	// are given the current generation instead of reading it once they run.
+	unsigned int generation;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		generation = Generation;
+	}
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+	{
+		Threads.Push(new std::thread(&FWorkerPool::RunWorker, this, i, generation));
+	}
+}
+
+void FWorkerPool::Start(const Task &task)
+{
+	if (Threads.Size() == 0)
+	{
+		return;
+	}
+
+	Wait();
+
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		CurrentTask = task;
+		NumBusyThreads = Threads.Size();
+		Generation++;
+	}
+	WorkAvailable.notify_all();
+}
+
+void FWorkerPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	WorkDone.wait(lock, [this] { return NumBusyThreads == 0; });
+}
+
+void FWorkerPool::Run(const Task &task)
+{
+	Start(task);
+
+	// The calling thread helps out instead of just waiting.
+	task(Threads.Size());
+
+	Wait();
+}
+
+void FWorkerPool::ParallelFor(unsigned int count, unsigned int maxThreads, const std::function<void (unsigned int)> &body)
+{
+	const unsigned int numThreads = MIN(count, maxThreads);
+
+	if (numThreads <= 1)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			body(i);
+		}
+		return;
+	}
+
+	FWorkerPool pool;
+	std::atomic<unsigned int> next(0);
+
+	pool.SetNumThreads(numThreads - 1);
+	pool.Run([&body, &next, count] (unsigned int)
+	{
+		unsigned int index;
+		while ((index = next++) < count)
+		{
+			body(index);
+		}
+	});
+}
+
+void FWorkerPool::RunWorker(unsigned int index, unsigned int generation)
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (true)
+	{
+		WorkAvailable.wait(lock, [this, generation] { return Quit || Generation != generation; });
+		if (Quit)
+		{
+			return;
+		}
+		generation = Generation;
+
+		// CurrentTask doesn't change until every thread is done with it.
+		lock.unlock();
+		CurrentTask(index);
+		lock.lock();
+
+		if (--NumBusyThreads == 0)
+		{
+			WorkDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,110 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: workerpool.h
+//
+// Description: A pool of worker threads that run the same task side by side.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __WORKERPOOL_H__
+#define __WORKERPOOL_H__
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "tarray.h"
+
+//==========================================================================
+//
+// FWorkerPool
+//
+// A fixed set of threads that sleep until a task is started. Every thread
+// then calls the task once, with its own index (0 to GetNumThreads() - 1),
+// so tasks usually take their work items from a shared atomic counter.
+// Only one task can be in progress at a time.
+//
+//==========================================================================
+
+class FWorkerPool
+{
+public:
+	typedef std::function<void (unsigned int)> Task;
+
+	FWorkerPool();
+	~FWorkerPool();
+
+	// Changes the number of threads. Waits for the current task first.
+	void SetNumThreads(unsigned int numThreads);
+	unsigned int GetNumThreads() const { return Threads.Size(); }
+
+	// Lets every thread start with the task and returns immediately.
+	void Start(const Task &task);
+
+	// Blocks until every thread has finished the task passed to Start.
+	void Wait();
+
+	// Runs the task on every thread and on the calling thread, which gets
+	// the index GetNumThreads(), and returns once all of them are done.
+	void Run(const Task &task);
+
+	// Calls body for every index in [0, count) on up to maxThreads threads,
+	// the calling thread included.
+	static void ParallelFor(unsigned int count, unsigned int maxThreads, const std::function<void (unsigned int)> &body);
+
+private:
+	void RunWorker(unsigned int index, unsigned int generation);
+
+	TArray<std::thread *> Threads;
+	std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	std::condition_variable WorkDone;
+	Task CurrentTask;
+
+	// Incremented whenever a task is started, so that the threads notice it.
+	unsigned int Generation;
+	unsigned int NumBusyThreads;
+	bool Quit;
+};
+
+#endif
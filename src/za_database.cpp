@@ -49,7 +49,12 @@
 #include "i_system.h"
 #include "g_game.h"
 #include "p_acs.h"
+#include "stats.h"
 #include <sqlite3.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 //*****************************************************************************
 //	DEFINES
@@ -58,12 +63,74 @@
 
 #define TIMEQUERY "SELECT (julianday('now') - 2440587.5)*86400.0"
 
+// If this many writes are queued, they are written without waiting for database_flushinterval.
+#define MAX_PENDING_WRITES 4096
+
+// The read cache is emptied when it grows beyond this many entries.
+#define MAX_CACHED_ENTRIES 65536
+
+//*****************************************************************************
+//	STRUCTURES
+
+// A change to an entry that hasn't been written to the database yet.
+struct DatabaseWrite
+{
+	FString Namespace;
+	FString EntryName;
+	FString EntryValue;
+	bool Delete;
+};
+
+// The value of an entry as known to the main thread.
+struct DatabaseCacheEntry
+{
+	FString EntryValue;
+	bool Exists;
+};
+
 //*****************************************************************************
 //	VARIABLES
 
 // [BB] Handle to our database.
 sqlite3 *g_db = NULL;
 
+// Serializes all accesses to g_db, since the write thread uses it as well.
+static std::recursive_mutex g_DatabaseMutex;
+
+// The write thread writes the queued changes in a single transaction every
+// database_flushinterval milliseconds, so that ACS doesn't have to wait for the disk.
+static std::thread g_WriteThread;
+static bool g_bWriteThreadRunning = false;
+
+// Everything below is protected by g_QueueMutex.
+static std::mutex g_QueueMutex;
+static std::condition_variable g_QueueCondition;
+static std::condition_variable g_FlushedCondition;
+static TMap<FString, DatabaseWrite> g_PendingWrites;
+static bool g_bWriteInProgress = false;
+static bool g_bFlushRequested = false;
+static bool g_bQuitWriteThread = false;
+static int g_FlushInterval = 1000;
+static TArray<FString> g_WriteThreadMessages;
+
+static struct
+{
+	unsigned int NumFlushes;
+	unsigned int LastFlushSize;
+	double LastFlushMS;
+	double MaxFlushMS;
+} g_FlushStats;
+
+// Values of entries read or written by the main thread. Changes are put in here
+// right away, so that reads are consistent with the writes that are still queued.
+static TMap<FString, DatabaseCacheEntry> g_EntryCache;
+
+// Only true on the write thread.
+static thread_local bool g_bIsWriteThread = false;
+
+static void database_StartWriteThread ( void );
+static void database_StopWriteThread ( void );
+
 // [BB] Filename for the database.
 CUSTOM_CVAR( String, databasefile, ":memory:", CVAR_ARCHIVE|CVAR_NOSETBYACS )
 {
@@ -77,9 +144,52 @@ CUSTOM_CVAR( Int, database_maxpagecount, 32768, CVAR_ARCHIVE|CVAR_NOSETBYACS )
 		DATABASE_SetMaxPageCount ( self );
 }
 
+// If enabled, changes to database entries are written by a separate thread.
+CUSTOM_CVAR( Bool, database_writebehind, true, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	DATABASE_Flush ( );
+	if ( self && DATABASE_IsAvailable() )
+		database_StartWriteThread ( );
+	else
+		database_StopWriteThread ( );
+}
+
+// How often (in milliseconds) the write thread writes the queued changes.
+CUSTOM_CVAR( Int, database_flushinterval, 1000, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	if ( self < 1 )
+		self = 1;
+	else
+	{
+		std::lock_guard<std::mutex> lock ( g_QueueMutex );
+		g_FlushInterval = self;
+	}
+}
+
 //*****************************************************************************
 //	PROTOTYPES
 
+//*****************************************************************************
+//
+// Prints an error message. The write thread may not call Printf, so its
+// messages are printed by the main thread later.
+static void database_Error ( const char *Format, ... )
+{
+	va_list argptr;
+	va_start ( argptr, Format );
+	FString message;
+	message.VFormat ( Format, argptr );
+	va_end ( argptr );
+
+	if ( g_bIsWriteThread )
+	{
+		std::lock_guard<std::mutex> lock ( g_QueueMutex );
+		g_WriteThreadMessages.Push ( message );
+	}
+	else
+		Printf ( "%s", message.GetChars() );
+}
+
 /**
  * \brief Handles the preparation, binding and execution of an SQLite command.
  *
@@ -87,13 +197,15 @@ CUSTOM_CVAR( Int, database_maxpagecount, 32768, CVAR_ARCHIVE|CVAR_NOSETBYACS )
  */
 class DataBaseCommand
 {
+	// Held as long as the statement exists.
+	std::unique_lock<std::recursive_mutex> _lock;
 	sqlite3_stmt *_stmt;
 public:
-	DataBaseCommand ( const char *Command ) : _stmt ( NULL )
+	DataBaseCommand ( const char *Command ) : _lock ( g_DatabaseMutex ), _stmt ( NULL )
 	{
 		int error = sqlite3_prepare ( g_db, Command, -1, &_stmt, NULL );
 		if ( error != SQLITE_OK )
-			Printf ( "Could not prepare statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			database_Error ( "Could not prepare statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
 	}
 
 	~DataBaseCommand ( )
@@ -105,14 +217,14 @@ public:
 	{
 		int error = sqlite3_bind_text ( _stmt, Index, String, -1, SQLITE_STATIC );
 		if ( error != SQLITE_OK )
-			Printf ( "Could not bind text. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			database_Error ( "Could not bind text. Error: %s\n", sqlite3_errmsg ( g_db ) );
 	}
 
 	void bindInt ( const int Index, const int IntValue )
 	{
 		int error = sqlite3_bind_int ( _stmt, Index, IntValue );
 		if ( error != SQLITE_OK )
-			Printf ( "Could not bind integer. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			database_Error ( "Could not bind integer. Error: %s\n", sqlite3_errmsg ( g_db ) );
 	}
 
 	void finalize ( )
@@ -129,7 +241,7 @@ public:
 		const int result = sqlite3_step ( _stmt );
 		if ( ( result != SQLITE_ROW ) && ( result != SQLITE_DONE ) )
 		{
-			Printf ( "Could not step statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			database_Error ( "Could not step statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
 			finalize ( );
 		}
 
@@ -140,9 +252,9 @@ public:
 	{
 		const int result = sqlite3_step ( _stmt );
 		if ( result == SQLITE_ROW )
-			Printf ( "Executing statement did not finish, sqlite3_step() has another row ready.\n" );
+			database_Error ( "Executing statement did not finish, sqlite3_step() has another row ready.\n" );
 		else if ( result != SQLITE_DONE )
-			Printf ( "Could not execute statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			database_Error ( "Could not execute statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
 
 		finalize();
 	}
@@ -186,9 +298,219 @@ void database_ClearHandle ( void )
 //
 void database_ExecuteCommand ( const char *Command, int (*Callback)(void*,int,char**,char**) = NULL, void *Data = NULL )
 {
+	std::lock_guard<std::recursive_mutex> lock ( g_DatabaseMutex );
 	int error = sqlite3_exec ( g_db, Command, Callback, Data, 0);
 	if ( error != SQLITE_OK )
-		Printf ( "Error: %s\n", sqlite3_errmsg ( g_db ) );
+		database_Error ( "Error: %s\n", sqlite3_errmsg ( g_db ) );
+}
+
+//*****************************************************************************
+//
+static void database_PrintWriteThreadMessages ( void )
+{
+	std::lock_guard<std::mutex> lock ( g_QueueMutex );
+	for ( unsigned int i = 0; i < g_WriteThreadMessages.Size(); ++i )
+		Printf ( "%s", g_WriteThreadMessages[i].GetChars() );
+	g_WriteThreadMessages.Clear();
+}
+
+//*****************************************************************************
+//
+static void database_WriteEntries ( TMap<FString, DatabaseWrite> &Writes )
+{
+	database_ExecuteCommand ( "BEGIN TRANSACTION" );
+
+	TMapIterator<FString, DatabaseWrite> it ( Writes );
+	TMap<FString, DatabaseWrite>::Pair *pair;
+	while ( it.NextPair ( pair ) )
+	{
+		const DatabaseWrite &write = pair->Value;
+		if ( write.Delete )
+		{
+			DataBaseCommand cmd ( "DELETE FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2" );
+			cmd.bindString ( 1, write.Namespace );
+			cmd.bindString ( 2, write.EntryName );
+			cmd.exec ( );
+		}
+		else
+		{
+			DataBaseCommand cmd ( "INSERT OR REPLACE INTO " TABLENAME " VALUES(?1,?2,?3,(" TIMEQUERY "))" );
+			cmd.bindString ( 1, write.Namespace );
+			cmd.bindString ( 2, write.EntryName );
+			cmd.bindString ( 3, write.EntryValue );
+			cmd.exec ( );
+		}
+	}
+
+	database_ExecuteCommand ( "END TRANSACTION" );
+}
+
+//*****************************************************************************
+//
+static void database_WriteThread ( void )
+{
+	g_bIsWriteThread = true;
+	std::unique_lock<std::mutex> queueLock ( g_QueueMutex );
+
+	while ( true )
+	{
+		if ( ( g_bQuitWriteThread == false ) && ( g_bFlushRequested == false ) && ( g_PendingWrites.CountUsed() < MAX_PENDING_WRITES ) )
+			g_QueueCondition.wait_for ( queueLock, std::chrono::milliseconds ( g_FlushInterval ) );
+
+		if ( g_PendingWrites.CountUsed() > 0 )
+		{
+			// Take the database before the queued writes. This way, a query of the main thread
+			// either still finds the writes in the queue or waits until they are committed.
+			queueLock.unlock();
+			std::lock_guard<std::recursive_mutex> databaseLock ( g_DatabaseMutex );
+			queueLock.lock();
+
+			TMap<FString, DatabaseWrite> writes;
+			writes.TransferFrom ( g_PendingWrites );
+			g_bWriteInProgress = true;
+			queueLock.unlock();
+
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			database_WriteEntries ( writes );
+			const double flushMS = std::chrono::duration<double, std::milli> ( std::chrono::steady_clock::now() - start ).count();
+
+			queueLock.lock();
+			g_bWriteInProgress = false;
+			g_FlushStats.NumFlushes++;
+			g_FlushStats.LastFlushSize = writes.CountUsed();
+			g_FlushStats.LastFlushMS = flushMS;
+			if ( flushMS > g_FlushStats.MaxFlushMS )
+				g_FlushStats.MaxFlushMS = flushMS;
+		}
+
+		if ( g_PendingWrites.CountUsed() == 0 )
+		{
+			g_bFlushRequested = false;
+			g_FlushedCondition.notify_all();
+
+			if ( g_bQuitWriteThread )
+				break;
+		}
+	}
+}
+
+//*****************************************************************************
+//
+static void database_StartWriteThread ( void )
+{
+	if ( g_bWriteThreadRunning )
+		return;
+
+	g_EntryCache.Clear();
+	g_bQuitWriteThread = false;
+	g_FlushInterval = database_flushinterval;
+	memset ( &g_FlushStats, 0, sizeof ( g_FlushStats ) );
+	g_WriteThread = std::thread ( database_WriteThread );
+	g_bWriteThreadRunning = true;
+}
+
+//*****************************************************************************
+//
+// Writes all queued changes and stops the write thread.
+static void database_StopWriteThread ( void )
+{
+	if ( g_bWriteThreadRunning == false )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock ( g_QueueMutex );
+		g_bQuitWriteThread = true;
+		g_QueueCondition.notify_one();
+	}
+
+	g_WriteThread.join();
+	g_bWriteThreadRunning = false;
+	g_EntryCache.Clear();
+	database_PrintWriteThreadMessages ( );
+}
+
+//*****************************************************************************
+//
+// Is the write thread responsible for changes to this entry?
+static bool database_UseWriteBehind ( const char *Namespace, const char *EntryName, const char *EntryValue = "" )
+{
+	return g_bWriteThreadRunning && ( Namespace != NULL ) && ( EntryName != NULL ) && ( EntryValue != NULL );
+}
+
+//*****************************************************************************
+//
+static FString database_GetCacheKey ( const char *Namespace, const char *EntryName )
+{
+	// Prefix the length of the namespace so that different pairs can't result in the same key.
+	FString key;
+	key.Format ( "%d:%s%s", static_cast<int> ( strlen ( Namespace ) ), Namespace, EntryName );
+	return key;
+}
+
+//*****************************************************************************
+//
+static void database_QueueWrite ( const char *Namespace, const char *EntryName, const char *EntryValue, const bool Delete )
+{
+	const FString key = database_GetCacheKey ( Namespace, EntryName );
+
+	if ( g_EntryCache.CountUsed() >= MAX_CACHED_ENTRIES )
+		g_EntryCache.Clear();
+
+	DatabaseCacheEntry &entry = g_EntryCache[key];
+	entry.Exists = ( Delete == false );
+	entry.EntryValue = Delete ? "" : EntryValue;
+
+	DatabaseWrite write;
+	write.Namespace = Namespace;
+	write.EntryName = EntryName;
+	write.EntryValue = entry.EntryValue;
+	write.Delete = Delete;
+
+	std::lock_guard<std::mutex> lock ( g_QueueMutex );
+	g_PendingWrites[key] = write;
+	if ( g_PendingWrites.CountUsed() >= MAX_PENDING_WRITES )
+		g_QueueCondition.notify_one();
+}
+
+//*****************************************************************************
+//
+static const DatabaseCacheEntry &database_LookupEntry ( const char *Namespace, const char *EntryName )
+{
+	const FString key = database_GetCacheKey ( Namespace, EntryName );
+
+	const DatabaseCacheEntry *cachedEntry = g_EntryCache.CheckKey ( key );
+	if ( cachedEntry != NULL )
+		return *cachedEntry;
+
+	DatabaseCacheEntry entry;
+	bool found = false;
+
+	// The entry may have been dropped from the cache while its change is still queued.
+	{
+		std::lock_guard<std::mutex> lock ( g_QueueMutex );
+		const DatabaseWrite *write = g_PendingWrites.CheckKey ( key );
+		if ( write != NULL )
+		{
+			entry.Exists = ( write->Delete == false );
+			entry.EntryValue = write->EntryValue;
+			found = true;
+		}
+	}
+
+	if ( found == false )
+	{
+		DataBaseCommand cmd ( "SELECT * FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2" );
+		cmd.bindString ( 1, Namespace );
+		cmd.bindString ( 2, EntryName );
+		entry.Exists = cmd.step( );
+		if ( entry.Exists )
+			entry.EntryValue.AppendFormat ( "%s", cmd.getText(2) );
+	}
+
+	if ( g_EntryCache.CountUsed() >= MAX_CACHED_ENTRIES )
+		g_EntryCache.Clear();
+
+	return ( g_EntryCache[key] = entry );
 }
 
 //*****************************************************************************
@@ -205,6 +527,7 @@ void DATABASE_Construct( void )
 
 void DATABASE_Destruct( void )
 {
+	database_StopWriteThread ( );
 	database_ClearHandle ( );
 }
 
@@ -213,6 +536,7 @@ void DATABASE_Destruct( void )
 void DATABASE_Init ( void )
 {
 	// [BB] Make sure no database is open.
+	database_StopWriteThread ( );
 	database_ClearHandle ( );
 
 	const char *dbFileName = databasefile.GetGenericRep( CVAR_String ).String;
@@ -238,6 +562,9 @@ void DATABASE_Init ( void )
 
 	// [BB] Now that the database is ready, we can set the max page count.
 	DATABASE_SetMaxPageCount ( database_maxpagecount );
+
+	if ( database_writebehind )
+		database_StartWriteThread ( );
 }
 
 //*****************************************************************************
@@ -248,9 +575,30 @@ bool DATABASE_IsAvailable ( const char *CallingFunction )
 	if ( !available && CallingFunction )
 		Printf ( "%s error: No database.\n", CallingFunction );
 
+	if ( g_bWriteThreadRunning )
+		database_PrintWriteThreadMessages ( );
+
 	return available;
 }
 
+//*****************************************************************************
+//
+// Waits until all queued changes are written to the database.
+void DATABASE_Flush ( void )
+{
+	if ( g_bWriteThreadRunning == false )
+		return;
+
+	std::unique_lock<std::mutex> lock ( g_QueueMutex );
+	g_bFlushRequested = true;
+	g_QueueCondition.notify_one();
+	while ( ( g_PendingWrites.CountUsed() > 0 ) || g_bWriteInProgress )
+		g_FlushedCondition.wait ( lock );
+	lock.unlock();
+
+	database_PrintWriteThreadMessages ( );
+}
+
 //*****************************************************************************
 //
 void DATABASE_SetMaxPageCount ( const unsigned int MaxPageCount )
@@ -269,6 +617,10 @@ void DATABASE_BeginTransaction ( void )
 	if ( DATABASE_IsAvailable ( "DATABASE_BeginTransaction" ) == false )
 		return;
 
+	// The write thread already groups the changes into transactions.
+	if ( g_bWriteThreadRunning )
+		return;
+
 	database_ExecuteCommand ( "BEGIN TRANSACTION" );
 }
 
@@ -279,6 +631,9 @@ void DATABASE_EndTransaction ( void )
 	if ( DATABASE_IsAvailable ( "DATABASE_EndTransaction" ) == false )
 		return;
 
+	if ( g_bWriteThreadRunning )
+		return;
+
 	database_ExecuteCommand ( "END TRANSACTION" );
 }
 
@@ -299,6 +654,8 @@ void DATABASE_ClearTable ( )
 	if ( DATABASE_IsAvailable ( "DATABASE_ClearTable" ) == false )
 		return;
 
+	DATABASE_Flush ( );
+	g_EntryCache.Clear();
 	database_ExecuteCommand ( "DELETE FROM " TABLENAME );
 }
 
@@ -309,6 +666,8 @@ void DATABASE_DeleteTable ( )
 	if ( DATABASE_IsAvailable ( "DATABASE_DeleteTable" ) == false )
 		return;
 
+	DATABASE_Flush ( );
+	g_EntryCache.Clear();
 	database_ExecuteCommand ( "DROP TABLE " TABLENAME );
 }
 
@@ -330,6 +689,7 @@ void DATABASE_DumpTable ( )
 	if ( DATABASE_IsAvailable ( "DATABASE_DumpTable" ) == false )
 		return;
 
+	DATABASE_Flush ( );
 	Printf ( "Dumping table \"%s\"\n", TABLENAME );
 	database_ExecuteCommand ( "SELECT * from " TABLENAME, database_DumpTableCallback );
 }
@@ -341,6 +701,7 @@ void DATABASE_EnableWAL ( )
 	if ( DATABASE_IsAvailable ( "DATABASE_EnableWAL" ) == false )
 		return;
 
+	DATABASE_Flush ( );
 	database_ExecuteCommand ( "PRAGMA journal_mode=WAL" );
 }
 
@@ -351,6 +712,7 @@ void DATABASE_DisableWAL ( )
 	if ( DATABASE_IsAvailable ( "DATABASE_DisableWAL" ) == false )
 		return;
 
+	DATABASE_Flush ( );
 	database_ExecuteCommand ( "PRAGMA journal_mode=DELETE" );
 }
 
@@ -361,6 +723,7 @@ void DATABASE_DumpNamespace ( const char *Namespace )
 	if ( DATABASE_IsAvailable ( "DATABASE_DumpNamespace" ) == false )
 		return;
 
+	DATABASE_Flush ( );
 	Printf ( "Dumping namespace \"%s\"\n", Namespace );
 	DataBaseCommand cmd ( "SELECT * from " TABLENAME " WHERE Namespace=?1" );
 	cmd.bindString ( 1, Namespace );
@@ -376,6 +739,14 @@ void DATABASE_AddEntry ( const char *Namespace, const char *EntryName, const cha
 	if ( DATABASE_IsAvailable ( "DATABASE_AddEntry" ) == false )
 		return;
 
+	if ( database_UseWriteBehind ( Namespace, EntryName, EntryValue ) )
+	{
+		// Like INSERT, don't overwrite an existing entry.
+		if ( database_LookupEntry ( Namespace, EntryName ).Exists == false )
+			database_QueueWrite ( Namespace, EntryName, EntryValue, false );
+		return;
+	}
+
 	DataBaseCommand cmd ( "INSERT INTO " TABLENAME " VALUES(?1,?2,?3,(" TIMEQUERY "))" );
 	cmd.bindString ( 1, Namespace );
 	cmd.bindString ( 2, EntryName );
@@ -390,6 +761,14 @@ void DATABASE_SetEntry ( const char *Namespace, const char *EntryName, const cha
 	if ( DATABASE_IsAvailable ( "DATABASE_SetEntry" ) == false )
 		return;
 
+	if ( database_UseWriteBehind ( Namespace, EntryName, EntryValue ) )
+	{
+		// Like UPDATE, only change an existing entry.
+		if ( database_LookupEntry ( Namespace, EntryName ).Exists )
+			database_QueueWrite ( Namespace, EntryName, EntryValue, false );
+		return;
+	}
+
 	DataBaseCommand cmd ( "UPDATE " TABLENAME " SET Value=?3,Timestamp=(" TIMEQUERY ") WHERE Namespace=?1 AND KeyName=?2" );
 	cmd.bindString ( 1, Namespace );
 	cmd.bindString ( 2, EntryName );
@@ -404,6 +783,9 @@ FString DATABASE_GetEntry ( const char *Namespace, const char *EntryName )
 	if ( DATABASE_IsAvailable ( "DATABASE_GetEntry" ) == false )
 		return "";
 
+	if ( database_UseWriteBehind ( Namespace, EntryName ) )
+		return database_LookupEntry ( Namespace, EntryName ).EntryValue;
+
 	DataBaseCommand cmd ( "SELECT * FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2" );
 	cmd.bindString ( 1, Namespace );
 	cmd.bindString ( 2, EntryName );
@@ -422,6 +804,9 @@ bool DATABASE_EntryExists ( const char *Namespace, const char *EntryName )
 	if ( DATABASE_IsAvailable ( "DATABASE_GetEntry" ) == false )
 		return "";
 
+	if ( database_UseWriteBehind ( Namespace, EntryName ) )
+		return database_LookupEntry ( Namespace, EntryName ).Exists;
+
 	DataBaseCommand cmd ( "SELECT * FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2" );
 	cmd.bindString ( 1, Namespace );
 	cmd.bindString ( 2, EntryName );
@@ -436,6 +821,12 @@ void DATABASE_DeleteEntry ( const char *Namespace, const char *EntryName )
 	if ( DATABASE_IsAvailable ( "DATABASE_DeleteEntry" ) == false )
 		return;
 
+	if ( database_UseWriteBehind ( Namespace, EntryName ) )
+	{
+		database_QueueWrite ( Namespace, EntryName, "", true );
+		return;
+	}
+
 	DataBaseCommand cmd ( "DELETE FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2" );
 	cmd.bindString ( 1, Namespace );
 	cmd.bindString ( 2, EntryName );
@@ -492,6 +883,16 @@ void DATABASE_SaveIncrementEntryInt ( const char *Namespace, const char *EntryNa
 		return;
 
 	FString newVal;
+	if ( database_UseWriteBehind ( Namespace, EntryName ) )
+	{
+		// Convert the old value like CAST(Value AS INTEGER) does.
+		const DatabaseCacheEntry &entry = database_LookupEntry ( Namespace, EntryName );
+		const long long oldValue = entry.Exists ? strtoll ( entry.EntryValue.GetChars(), NULL, 10 ) : 0;
+		newVal.AppendFormat ( "%lld", oldValue + Increment );
+		database_QueueWrite ( Namespace, EntryName, newVal.GetChars(), false );
+		return;
+	}
+
 	if ( DATABASE_EntryExists ( Namespace, EntryName ) )
 	{
 		// [BB] Get the old value and set the incremented value in a single query.
@@ -515,6 +916,9 @@ int DATABASE_GetEntryRank ( const char *Namespace, const char *EntryName, const
 	if ( DATABASE_IsAvailable ( "DATABASE_GetEntryRank" ) == false )
 		return -1;
 
+	// The queries below need the queued changes to be in the database.
+	DATABASE_Flush ( );
+
 	if ( DATABASE_EntryExists ( Namespace, EntryName ) )
 	{
 		// [BB] To get the rank of a certain entry, we get the value of the entry,
@@ -548,6 +952,8 @@ int DATABASE_GetSortedEntries ( const char *Namespace, const int N, const int Of
 		return 0;
 	}
 
+	DATABASE_Flush ( );
+
 	FString commandString;
 	commandString.Format ( "SELECT * from " TABLENAME " WHERE Namespace=?1 ORDER BY CAST(Value AS INTEGER) " );
 	commandString += Descending ? "DESC" : "ASC";
@@ -570,6 +976,8 @@ int DATABASE_GetEntries ( const char *Namespace, TArray<std::pair<FString, FStri
 		return 0;
 	}
 
+	DATABASE_Flush ( );
+
 	DataBaseCommand cmd ( "SELECT * from " TABLENAME " WHERE Namespace=?1" );
 	cmd.bindString ( 1, Namespace );
 	cmd.iterateAndGetReturnedEntries ( Entries );
@@ -601,3 +1009,28 @@ CCMD ( db_disable_wal )
 
 	DATABASE_DisableWAL();
 }
+
+//*****************************************************************************
+//	STATISTICS
+
+ADD_STAT( database )
+{
+	FString out;
+
+	if ( g_bWriteThreadRunning == false )
+	{
+		out = "Write-behind disabled";
+		return out;
+	}
+
+	std::lock_guard<std::mutex> lock ( g_QueueMutex );
+	out.Format ( "%d queued writes%s, %d cached entries, %u flushes, last: %u writes in %.2f ms, max: %.2f ms",
+		static_cast<int> ( g_PendingWrites.CountUsed() ),
+		g_bWriteInProgress ? " (writing)" : "",
+		static_cast<int> ( g_EntryCache.CountUsed() ),
+		g_FlushStats.NumFlushes,
+		g_FlushStats.LastFlushSize,
+		g_FlushStats.LastFlushMS,
+		g_FlushStats.MaxFlushMS );
+	return out;
+}
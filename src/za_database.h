@@ -56,6 +56,7 @@ void	DATABASE_Construct ( void );
 void	DATABASE_Destruct ( void );
 void	DATABASE_Init ( void );
 bool	DATABASE_IsAvailable ( const char *CallingFunction = NULL );
+void	DATABASE_Flush ( void );
 void	DATABASE_SetMaxPageCount ( const unsigned int MaxPageCount );
 void	DATABASE_BeginTransaction ( void );
 void	DATABASE_EndTransaction ( void );